@@ -37,13 +37,38 @@ void main() {
 }
 )";
 
+// pixelLayout: 0 packed BGRA, 1 three planes (Y, U, V), 2 NV12, 3 NV21
 static const char* fs_blend = R"(
 varying vec2 texCoord;
 
 uniform sampler2D movie;
+uniform sampler2D movieU;
+uniform sampler2D movieV;
+uniform int pixelLayout;
+uniform float cropX;
+uniform mat3 yuvMatrix;
 
 void main() {
-     gl_FragColor = texture2D(movie, texCoord);
+    vec2 tc = vec2(texCoord.x * cropX, texCoord.y);
+    if (pixelLayout == 0) {
+        gl_FragColor = vec4(texture2D(movie, tc).bgr, 1.0);
+    } else {
+        vec3 yuv;
+        yuv.x = texture2D(movie, tc).r - 0.0625;
+        if (pixelLayout == 1) {
+            yuv.y = texture2D(movieU, tc).r - 0.5;
+            yuv.z = texture2D(movieV, tc).r - 0.5;
+        } else if (pixelLayout == 2) {
+            vec4 uv = texture2D(movieU, tc);
+            yuv.y = uv.r - 0.5;
+            yuv.z = uv.a - 0.5;
+        } else {
+            vec4 vu = texture2D(movieU, tc);
+            yuv.y = vu.a - 0.5;
+            yuv.z = vu.r - 0.5;
+        }
+        gl_FragColor = vec4(yuvMatrix * yuv, 1.0);
+    }
 }
 )";
 
@@ -54,12 +79,49 @@ precision mediump float;
 varying vec2 texCoord;
 
 uniform sampler2D movie;
+uniform sampler2D movieU;
+uniform sampler2D movieV;
+uniform int pixelLayout;
+uniform float cropX;
+uniform mat3 yuvMatrix;
 
 void main() {
-     gl_FragColor = texture2D(movie, texCoord);
+    vec2 tc = vec2(texCoord.x * cropX, texCoord.y);
+    if (pixelLayout == 0) {
+        gl_FragColor = vec4(texture2D(movie, tc).bgr, 1.0);
+    } else {
+        vec3 yuv;
+        yuv.x = texture2D(movie, tc).r - 0.0625;
+        if (pixelLayout == 1) {
+            yuv.y = texture2D(movieU, tc).r - 0.5;
+            yuv.z = texture2D(movieV, tc).r - 0.5;
+        } else if (pixelLayout == 2) {
+            vec4 uv = texture2D(movieU, tc);
+            yuv.y = uv.r - 0.5;
+            yuv.z = uv.a - 0.5;
+        } else {
+            vec4 vu = texture2D(movieU, tc);
+            yuv.y = vu.a - 0.5;
+            yuv.z = vu.r - 0.5;
+        }
+        gl_FragColor = vec4(yuvMatrix * yuv, 1.0);
+    }
 }
 )";
 
+//limited range YUV转RGB，按行给出
+static const float s_bt601Matrix[9] = {
+    1.164f,  0.000f,  1.596f,
+    1.164f, -0.392f, -0.813f,
+    1.164f,  2.017f,  0.000f
+};
+
+static const float s_bt709Matrix[9] = {
+    1.164f,  0.000f,  1.793f,
+    1.164f, -0.213f, -0.533f,
+    1.164f,  2.112f,  0.000f
+};
+
 static const char* vs_blend_corner = R"(
 attribute vec2 position;
 attribute vec2 maskTexCoord;
@@ -221,6 +283,7 @@ namespace dmr {
         m_pGlProgCorner = nullptr;
 
         if (m_pFbo) delete m_pFbo;
+        releaseVideoTextures();
         doneCurrent();
     }
 
@@ -253,6 +316,11 @@ namespace dmr {
         m_pGlProgBlend->enableAttributeArray(coordLocBlend);
         m_pGlProgBlend->setAttributeBuffer(coordLocBlend, GL_FLOAT, 2*sizeof(GLfloat), 2, 6*sizeof(GLfloat));
         m_pGlProgBlend->setUniformValue("movie", 0);
+        m_pGlProgBlend->setUniformValue("movieU", 1);
+        m_pGlProgBlend->setUniformValue("movieV", 2);
+        m_pGlProgBlend->setUniformValue("pixelLayout", 0);
+        m_pGlProgBlend->setUniformValue("cropX", 1.0f);
+        m_pGlProgBlend->setUniformValue("yuvMatrix", QMatrix3x3(s_bt601Matrix));
         m_pGlProgBlend->release();
         m_vaoBlend.release();
 
@@ -648,7 +716,12 @@ namespace dmr {
         m_pCornerMasks[1] = nullptr;
         m_pCornerMasks[2] = nullptr;
         m_pCornerMasks[3] = nullptr;
-        m_pVideoTex = nullptr;
+        m_pVideoTex[0] = nullptr;
+        m_pVideoTex[1] = nullptr;
+        m_pVideoTex[2] = nullptr;
+        m_videoFormat = QVideoFrame::Format_Invalid;
+        m_nPixelLayout = 0;
+        m_fCropX = 1.0f;
         m_bRawFormat = false;
 
         m_currWidth = rect().width();
@@ -660,7 +733,10 @@ namespace dmr {
     void QtPlayerGLWidget::paintGL()
     {
         QOpenGLFunctions *pGLFunction = QOpenGLContext::currentContext()->functions();
-        if (m_bPlaying && m_pVideoTex) {
+        if (m_bPlaying) {
+            uploadVideoFrame();
+        }
+        if (m_bPlaying && m_pVideoTex[0]) {
             {
                 pGLFunction->glEnable(GL_BLEND);
                 pGLFunction->glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
@@ -671,11 +747,20 @@ namespace dmr {
                 QOpenGLVertexArrayObject::Binder vaoBind(&m_vaoBlend);
                 m_vaoBlend.bind();
                 m_pGlProgBlend->bind();
-                QOpenGLTexture *pGLTexture = m_pVideoTex;
-                pGLTexture->bind();
+                m_pGlProgBlend->setUniformValue("pixelLayout", m_nPixelLayout);
+                m_pGlProgBlend->setUniformValue("cropX", m_fCropX);
+                m_pGlProgBlend->setUniformValue("yuvMatrix", QMatrix3x3(m_currHeight >= 720 ? s_bt709Matrix : s_bt601Matrix));
+                for (uint i = 0; i < 3; i++) {
+                    if (m_pVideoTex[i])
+                        m_pVideoTex[i]->bind(i);
+                }
                 pGLFunction->glActiveTexture(GL_TEXTURE0);
                 pGLFunction->glDrawArrays(GL_TRIANGLES, 0, 6);
-                pGLTexture->release();
+                for (uint i = 0; i < 3; i++) {
+                    if (m_pVideoTex[i])
+                        m_pVideoTex[i]->release(i);
+                }
+                pGLFunction->glActiveTexture(GL_TEXTURE0);
                 m_pGlProgBlend->release();
 
                 pGLFunction->glDisable(GL_BLEND);
@@ -798,8 +883,10 @@ namespace dmr {
     {
         if (m_bPlaying != bFalse) {
             m_bPlaying = bFalse;
-            delete m_pVideoTex;
-            m_pVideoTex = nullptr;
+            m_pendingFrame = QVideoFrame();
+            makeCurrent();
+            releaseVideoTextures();
+            doneCurrent();
         }
         updateVbo();
         updateVboCorners();
@@ -807,26 +894,123 @@ namespace dmr {
         update();
     }
 
-    void QtPlayerGLWidget::setVideoTex(QImage image)
+    void QtPlayerGLWidget::setVideoFrame(const QVideoFrame &frame)
     {
-        if(!m_pVideoTex){
-            QFileInfo fi("/dev/mwv206_0");
-            QFileInfo jmfi("/dev/jmgpu");
-            if (fi.exists() || jmfi.exists()) {
-                m_pVideoTex = new QOpenGLTexture(image, QOpenGLTexture::DontGenerateMipMaps);
-            } else {
-                m_pVideoTex = new QOpenGLTexture(image, QOpenGLTexture::GenerateMipMaps);
+        //只保留最新一帧，上传在paintGL中进行，由update()按刷新率合并
+        m_pendingFrame = frame;
+    }
+
+    void QtPlayerGLWidget::releaseVideoTextures()
+    {
+        for (int i = 0; i < 3; i++) {
+            delete m_pVideoTex[i];
+            m_pVideoTex[i] = nullptr;
+        }
+        m_videoFormat = QVideoFrame::Format_Invalid;
+        m_videoTexSizes.clear();
+    }
+
+    bool QtPlayerGLWidget::uploadVideoFrame()
+    {
+        if (!m_pendingFrame.isValid())
+            return false;
+
+        QVideoFrame frame = m_pendingFrame;
+        m_pendingFrame = QVideoFrame();
+        if (!frame.map(QAbstractVideoBuffer::ReadOnly))
+            return false;
+
+        QOpenGLTexture::TextureFormat texFormats[3];
+        QOpenGLTexture::PixelFormat pixFormats[3];
+        int bytesPerPixel[3] = {1, 1, 1};
+        int heights[3] = {frame.height(), (frame.height() + 1) / 2, (frame.height() + 1) / 2};
+        int nPlanes = 1;
+        int nLayout = 0;
+
+        switch (frame.pixelFormat()) {
+        case QVideoFrame::Format_RGB32:
+        case QVideoFrame::Format_ARGB32:
+            texFormats[0] = QOpenGLTexture::RGBAFormat;
+            pixFormats[0] = QOpenGLTexture::RGBA;
+            bytesPerPixel[0] = 4;
+            break;
+        case QVideoFrame::Format_YUV420P:
+        case QVideoFrame::Format_YV12:
+            nPlanes = 3;
+            nLayout = 1;
+            for (int i = 0; i < 3; i++) {
+                texFormats[i] = QOpenGLTexture::LuminanceFormat;
+                pixFormats[i] = QOpenGLTexture::Luminance;
             }
-        } else {
-            m_pVideoTex->setData(image);
+            break;
+        case QVideoFrame::Format_NV12:
+        case QVideoFrame::Format_NV21:
+            nPlanes = 2;
+            nLayout = frame.pixelFormat() == QVideoFrame::Format_NV12 ? 2 : 3;
+            texFormats[0] = QOpenGLTexture::LuminanceFormat;
+            pixFormats[0] = QOpenGLTexture::Luminance;
+            texFormats[1] = QOpenGLTexture::LuminanceAlphaFormat;
+            pixFormats[1] = QOpenGLTexture::LuminanceAlpha;
+            bytesPerPixel[1] = 2;
+            break;
+        default:
+            qWarning() << "unsupported video frame format" << frame.pixelFormat();
+            frame.unmap();
+            return false;
         }
 
-        if(m_currWidth != image.width() || m_currHeight != image.height())
-        {
-            m_currWidth = image.width();
-            m_currHeight = image.height();
+        if (frame.planeCount() < nPlanes) {
+            frame.unmap();
+            return false;
+        }
+
+        //纹理宽度取行跨度，多出的部分在着色器中裁掉，避免依赖GL_UNPACK_ROW_LENGTH
+        QList<QSize> texSizes;
+        for (int i = 0; i < nPlanes; i++) {
+            texSizes.append(QSize(frame.bytesPerLine(i) / bytesPerPixel[i], heights[i]));
+        }
+
+        //格式或尺寸不变时复用纹理，只更新内容，不生成mipmap
+        if (frame.pixelFormat() != m_videoFormat || texSizes != m_videoTexSizes) {
+            releaseVideoTextures();
+            for (int i = 0; i < nPlanes; i++) {
+                QOpenGLTexture *pTex = new QOpenGLTexture(QOpenGLTexture::Target2D);
+                pTex->setSize(texSizes[i].width(), texSizes[i].height());
+                pTex->setFormat(texFormats[i]);
+                pTex->setMipLevels(1);
+                pTex->setMinificationFilter(QOpenGLTexture::Linear);
+                pTex->setMagnificationFilter(QOpenGLTexture::Linear);
+                pTex->setWrapMode(QOpenGLTexture::ClampToEdge);
+                pTex->allocateStorage(pixFormats[i], QOpenGLTexture::UInt8);
+                m_pVideoTex[i] = pTex;
+            }
+            m_videoFormat = frame.pixelFormat();
+            m_videoTexSizes = texSizes;
+        }
+
+        //YV12的V平面在前，上传到V纹理后与YUV420P共用着色器分支
+        int texIndex[3] = {0, 1, 2};
+        if (frame.pixelFormat() == QVideoFrame::Format_YV12) {
+            texIndex[1] = 2;
+            texIndex[2] = 1;
+        }
+
+        QOpenGLPixelTransferOptions options;
+        options.setAlignment(1);
+        for (int i = 0; i < nPlanes; i++) {
+            m_pVideoTex[texIndex[i]]->setData(pixFormats[i], QOpenGLTexture::UInt8, frame.bits(i), &options);
+        }
+        frame.unmap();
+
+        m_nPixelLayout = nLayout;
+        m_fCropX = texSizes[0].width() > 0 ? static_cast<float>(frame.width()) / texSizes[0].width() : 1.0f;
+        if (m_currWidth != frame.width() || m_currHeight != frame.height()) {
+            m_currWidth = frame.width();
+            m_currHeight = frame.height();
             updateVboBlend();
         }
+
+        return true;
     }
 
 #ifdef __x86_64__
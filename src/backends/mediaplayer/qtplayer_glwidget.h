@@ -7,6 +7,7 @@
 #define _DMR_QTPLAYER_GLWIDGET_H
 
 #include <QtWidgets>
+#include <QVideoFrame>
 #undef Bool
 #include "../../vendor/qthelper.hpp"
 #include <DGuiApplicationHelper>
@@ -31,7 +32,11 @@ public:
 
     void setPlaying(bool);
 
-    void setVideoTex(QImage image);
+    /**
+     * @brief 设置待显示的视频帧，调用者随后以update()触发绘制
+     * @param frame 视频帧，支持RGB32与YUV420P/YV12/NV12/NV21
+     */
+    void setVideoFrame(const QVideoFrame &frame);
 
 #ifdef __x86_64__
     //更新全屏时影院播放进度
@@ -63,6 +68,12 @@ private:
 
     void prepareSplashImages();
 
+    /**
+     * @brief 把待显示帧的各平面上传到常驻纹理，在paintGL中调用
+     */
+    bool uploadVideoFrame();
+    void releaseVideoTextures();
+
 private:
 
     bool m_bPlaying;                   //记录播放状态
@@ -90,7 +101,12 @@ private:
     QImage m_imgBgDark;                    //深色主题背景图
     QImage m_imgBgLight;                   //浅色主题背景图
 
-    QOpenGLTexture* m_pVideoTex;
+    QOpenGLTexture *m_pVideoTex[3];        //视频平面纹理(Y/U/V或UV，RGB只用第一个)
+    QVideoFrame m_pendingFrame;            //尚未上传的最新一帧
+    QVideoFrame::PixelFormat m_videoFormat;
+    QList<QSize> m_videoTexSizes;
+    int m_nPixelLayout;                    //着色器中的像素布局
+    float m_fCropX;                        //行跨度大于宽度时的纹理坐标裁剪比例
     int m_currWidth;
     int m_currHeight;
 #ifdef __x86_64__
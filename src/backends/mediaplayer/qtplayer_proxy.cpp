@@ -106,12 +106,12 @@ void QtPlayerProxy::setState(PlayState state)
     }
 }
 
-void QtPlayerProxy::pollingEndOfPlayback()
+void QtPlayerProxy::requestEndOfPlayback()
 {
     if (_state != Backend::Stopped) {
         stop();
         setState(Backend::Stopped);
-        return;
+        emit stopCompleted();
     }
 }
 
@@ -170,12 +170,84 @@ void QtPlayerProxy::slotMediaError(QMediaPlayer::Error error)
 
 void QtPlayerProxy::processFrame(QVideoFrame &frame)
 {
-    frame.map(QAbstractVideoBuffer::ReadOnly);
-    QImage recvImage(frame.bits(), frame.width(), frame.height(), QVideoFrame::imageFormatFromPixelFormat(frame.pixelFormat()));
-    m_currentImage = recvImage;
-    m_pGLWidget->setVideoTex(recvImage);
-    m_pGLWidget->repaint();
+    //只持有帧的引用，不做映射和拷贝，纹理上传在下一次绘制时进行
+    m_currentFrame = frame;
+    m_pGLWidget->setVideoFrame(frame);
+    m_pGLWidget->update();
+}
+
+static inline uchar clampColor(int nValue)
+{
+    return static_cast<uchar>(qBound(0, nValue, 255));
+}
+
+QImage QtPlayerProxy::currentImage()
+{
+    QVideoFrame frame = m_currentFrame;
+    if (!frame.isValid() || !frame.map(QAbstractVideoBuffer::ReadOnly))
+        return QImage();
+
+    QImage img;
+    QImage::Format format = QVideoFrame::imageFormatFromPixelFormat(frame.pixelFormat());
+    if (format != QImage::Format_Invalid) {
+        img = QImage(frame.bits(), frame.width(), frame.height(), frame.bytesPerLine(), format).copy();
+        frame.unmap();
+        return img;
+    }
+
+    const uchar *pU = nullptr;
+    const uchar *pV = nullptr;
+    int nUStride = 0;
+    int nVStride = 0;
+    int nStep = 1;
+    switch (frame.pixelFormat()) {
+    case QVideoFrame::Format_YUV420P:
+        pU = frame.bits(1);
+        pV = frame.bits(2);
+        nUStride = frame.bytesPerLine(1);
+        nVStride = frame.bytesPerLine(2);
+        break;
+    case QVideoFrame::Format_YV12:
+        pV = frame.bits(1);
+        pU = frame.bits(2);
+        nVStride = frame.bytesPerLine(1);
+        nUStride = frame.bytesPerLine(2);
+        break;
+    case QVideoFrame::Format_NV12:
+        pU = frame.bits(1);
+        pV = pU + 1;
+        nUStride = nVStride = frame.bytesPerLine(1);
+        nStep = 2;
+        break;
+    case QVideoFrame::Format_NV21:
+        pV = frame.bits(1);
+        pU = pV + 1;
+        nUStride = nVStride = frame.bytesPerLine(1);
+        nStep = 2;
+        break;
+    default:
+        frame.unmap();
+        return QImage();
+    }
+
+    //BT.601 limited range
+    img = QImage(frame.width(), frame.height(), QImage::Format_RGB32);
+    const uchar *pY = frame.bits(0);
+    int nYStride = frame.bytesPerLine(0);
+    for (int y = 0; y < frame.height(); y++) {
+        QRgb *pLine = reinterpret_cast<QRgb *>(img.scanLine(y));
+        for (int x = 0; x < frame.width(); x++) {
+            int c = pY[y * nYStride + x] - 16;
+            int d = pU[(y / 2) * nUStride + (x / 2) * nStep] - 128;
+            int e = pV[(y / 2) * nVStride + (x / 2) * nStep] - 128;
+            pLine[x] = qRgb(clampColor((298 * c + 409 * e + 128) >> 8),
+                            clampColor((298 * c - 100 * d - 208 * e + 128) >> 8),
+                            clampColor((298 * c + 516 * d + 128) >> 8));
+        }
+    }
     frame.unmap();
+
+    return img;
 }
 
 void QtPlayerProxy::showEvent(QShowEvent *pEvent)
@@ -356,7 +428,7 @@ void QtPlayerProxy::setVideoRotation(int degree)
 
 QImage QtPlayerProxy::takeScreenshot()
 {
-    return m_currentImage;
+    return currentImage();
 }
 
 void QtPlayerProxy::burstScreenshot()
@@ -376,7 +448,7 @@ void QtPlayerProxy::burstScreenshot()
         QEventLoop loop;
         QTimer::singleShot(200, &loop, SLOT(quit()));
         loop.exec();
-        emit notifyScreenshot(m_currentImage, nTime/1000);
+        emit notifyScreenshot(currentImage(), nTime/1000);
     }
 
     m_pPlayer->setPosition(nCurrentPos);
@@ -43,8 +43,10 @@ public:
     {
         return true;
     }
-    // polling until current playback ended
-    void pollingEndOfPlayback();
+    /**
+     * @brief 结束当前播放，QMediaPlayer停止是同步的，直接发出stopCompleted
+     */
+    void requestEndOfPlayback();
     // polling until current playback started
     void pollingStartOfPlayback();
     /**
@@ -169,6 +171,10 @@ private:
     void updatePlayingMovieInfo();
     void setState(PlayState state);
     int volumeCorrection(int);
+    /**
+     * @brief 把当前帧转换为RGB图像，仅在截图时调用
+     */
+    QImage currentImage();
 
 private:
     QMediaPlayer* m_pPlayer;
@@ -194,7 +200,7 @@ private:
     QVector<QVariant> m_vecWaitCommand;    //等待mpv初始化后设置的参数
     //mpv播放配置
     QMap<QString, QString> *m_pConfig;
-    QImage m_currentImage;                 //当前画面
+    QVideoFrame m_currentFrame;            //当前画面，截图时才转换为图像
 };
 
 }
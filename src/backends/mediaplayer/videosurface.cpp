@@ -18,7 +18,13 @@ QList<QVideoFrame::PixelFormat> VideoSurface::supportedPixelFormats(QAbstractVid
 {
     QList<QVideoFrame::PixelFormat> listPixelFormats;
 
-    listPixelFormats << QVideoFrame::Format_RGB32;
+    //优先使用YUV格式，由着色器完成颜色转换，避免解码端逐帧转换为RGB
+    listPixelFormats << QVideoFrame::Format_YUV420P
+                     << QVideoFrame::Format_YV12
+                     << QVideoFrame::Format_NV12
+                     << QVideoFrame::Format_NV21
+                     << QVideoFrame::Format_RGB32
+                     << QVideoFrame::Format_ARGB32;
 
     return listPixelFormats;
 }
@@ -0,0 +1,155 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "mpv_event_thread.h"
+
+namespace dmr {
+
+static_assert(MpvPropertyMirror::PropertyCount <= 32, "property bits exceed m_nQueuedProps");
+
+MpvEventThread::MpvEventThread(mpv_handle *pHandle, mpv_waitEvent waitEvent, mpv_wakeUp wakeup,
+                               MpvPropertyMirror *pMirror, QObject *parent)
+    : QThread(parent),
+      m_pHandle(pHandle),
+      m_waitEvent(waitEvent),
+      m_wakeup(wakeup),
+      m_pMirror(pMirror)
+{
+    m_statTimer.start();
+}
+
+MpvEventThread::~MpvEventThread()
+{
+    stop();
+}
+
+void MpvEventThread::stop()
+{
+    if (!isRunning())
+        return;
+
+    requestInterruption();
+    if (m_wakeup)
+        m_wakeup(m_pHandle);
+    wait();
+}
+
+void MpvEventThread::acknowledge()
+{
+    m_bNotified.store(false);
+}
+
+bool MpvEventThread::takeEvent(MpvEventData &event)
+{
+    if (!m_queue.pop(event))
+        return false;
+
+    //先清除标记再由调用者读取镜像，之后的变化会重新入队
+    if (event.id == MPV_EVENT_PROPERTY_CHANGE && event.prop != MpvPropertyMirror::PropertyCount)
+        m_nQueuedProps.fetch_and(~(1u << event.prop));
+
+    return true;
+}
+
+void MpvEventThread::addGuiTime(qint64 nNsecs)
+{
+    m_nGuiNsecs.fetch_add(nNsecs, std::memory_order_relaxed);
+}
+
+MpvEventThread::Statistics MpvEventThread::takeStatistics()
+{
+    Statistics stat;
+    const double dSecs = m_statTimer.restart() / 1000.0;
+    const qint64 nEvents = m_nEventCount.exchange(0);
+    const qint64 nGuiNsecs = m_nGuiNsecs.exchange(0);
+    if (dSecs > 0) {
+        stat.dEventsPerSec = nEvents / dSecs;
+        stat.dGuiMsPerSec = nGuiNsecs / 1e6 / dSecs;
+    }
+
+    return stat;
+}
+
+void MpvEventThread::run()
+{
+    //没有mpv_wakeup时用超时等待检查退出请求
+    const double dTimeout = m_wakeup ? -1.0 : 0.1;
+
+    while (!isInterruptionRequested()) {
+        mpv_event *pEvent = m_waitEvent(m_pHandle, dTimeout);
+        if (pEvent->event_id == MPV_EVENT_NONE)
+            continue;
+
+        m_nEventCount.fetch_add(1, std::memory_order_relaxed);
+
+        MpvEventData event;
+        event.id = pEvent->event_id;
+        event.nError = pEvent->error;
+        event.nUserData = pEvent->reply_userdata;
+
+        switch (pEvent->event_id) {
+        case MPV_EVENT_SHUTDOWN:
+            return;
+
+        case MPV_EVENT_LOG_MESSAGE: {
+            mpv_event_log_message *pLog = reinterpret_cast<mpv_event_log_message *>(pEvent->data);
+            printLog(pLog);
+            //界面线程只需要处理警告和错误
+            if (pLog->log_level > MPV_LOG_LEVEL_WARN)
+                continue;
+            event.logLevel = pLog->log_level;
+            event.sPrefix = QString::fromUtf8(pLog->prefix);
+            event.sText = QString::fromUtf8(pLog->text);
+            break;
+        }
+
+        case MPV_EVENT_PROPERTY_CHANGE: {
+            m_pMirror->update(pEvent->reply_userdata, reinterpret_cast<mpv_event_property *>(pEvent->data));
+            event.prop = MpvPropertyMirror::fromTag(pEvent->reply_userdata);
+            if (event.prop == MpvPropertyMirror::PropertyCount)
+                continue;
+            //同一属性已在队列中，界面线程处理时读取最新值
+            const quint32 nBit = 1u << event.prop;
+            if (m_nQueuedProps.fetch_or(nBit) & nBit)
+                continue;
+            break;
+        }
+
+        case MPV_EVENT_END_FILE:
+            event.nEndReason = reinterpret_cast<mpv_event_end_file *>(pEvent->data)->reason;
+            break;
+
+        default:
+            break;
+        }
+
+        publish(std::move(event));
+    }
+}
+
+void MpvEventThread::publish(MpvEventData &&event)
+{
+    m_queue.push(std::move(event));
+    if (!m_bNotified.exchange(true))
+        emit eventsReady();
+}
+
+void MpvEventThread::printLog(const mpv_event_log_message *pLog)
+{
+    const QString sLog = QString("%1: %2").arg(pLog->prefix).arg(pLog->text);
+    switch (pLog->log_level) {
+    case MPV_LOG_LEVEL_WARN:
+        qWarning() << sLog;
+        break;
+    case MPV_LOG_LEVEL_ERROR:
+    case MPV_LOG_LEVEL_FATAL:
+        qCritical() << sLog;
+        break;
+    default:
+        qInfo() << sLog;
+        break;
+    }
+}
+
+}
@@ -0,0 +1,152 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_MPV_EVENT_THREAD_H
+#define _DMR_MPV_EVENT_THREAD_H
+
+#include <QtCore>
+#include <mpv/client.h>
+
+#include <atomic>
+
+#include "mpv_proxy.h"
+#include "mpv_property_mirror.h"
+
+namespace dmr {
+
+/**
+ * @brief 单生产者单消费者无锁队列
+ * 链表实现、没有容量上限，push只能在生产者线程调用，pop只能在消费者线程调用
+ */
+template <typename T>
+class MpvSpscQueue
+{
+public:
+    MpvSpscQueue() : m_pHead(new Node), m_pTail(m_pHead) {}
+    ~MpvSpscQueue()
+    {
+        while (m_pHead) {
+            Node *pNode = m_pHead;
+            m_pHead = pNode->pNext.load(std::memory_order_relaxed);
+            delete pNode;
+        }
+    }
+
+    void push(T &&value)
+    {
+        Node *pNode = new Node;
+        pNode->value = std::move(value);
+        m_pTail->pNext.store(pNode, std::memory_order_release);
+        m_pTail = pNode;
+    }
+
+    bool pop(T &value)
+    {
+        Node *pNext = m_pHead->pNext.load(std::memory_order_acquire);
+        if (!pNext)
+            return false;
+
+        value = std::move(pNext->value);
+        delete m_pHead;
+        m_pHead = pNext;
+        return true;
+    }
+
+private:
+    struct Node {
+        T value;
+        std::atomic<Node *> pNext {nullptr};
+    };
+
+    Node *m_pHead;  //消费者持有，指向已取出的哨兵节点
+    Node *m_pTail;  //生产者持有
+};
+
+/**
+ * @brief 交给界面线程处理的mpv事件，已在事件线程中转换为Qt类型
+ */
+struct MpvEventData {
+    mpv_event_id id {MPV_EVENT_NONE};
+    int nError {0};
+    uint64_t nUserData {0};
+    int nEndReason {0};                                                   //MPV_EVENT_END_FILE的结束原因
+    MpvPropertyMirror::Property prop {MpvPropertyMirror::PropertyCount}; //变化的属性，值在镜像中
+    mpv_log_level logLevel {MPV_LOG_LEVEL_NONE};
+    QString sPrefix;
+    QString sText;
+};
+
+/**
+ * @file mpv事件线程
+ * 在独立线程中阻塞等待mpv事件：属性值写入镜像，日志在本线程输出，
+ * 其余事件转换后放入无锁队列，队列由空变为非空时通知界面线程取出。
+ * 同一属性在界面线程处理前多次变化只排队一次，界面线程读取镜像中的最新值
+ */
+class MpvEventThread : public QThread
+{
+    Q_OBJECT
+
+public:
+    struct Statistics {
+        double dEventsPerSec {0.0};  //mpv事件数/秒
+        double dGuiMsPerSec {0.0};   //界面线程处理事件耗时 毫秒/秒
+    };
+
+    MpvEventThread(mpv_handle *pHandle, mpv_waitEvent waitEvent, mpv_wakeUp wakeup,
+                   MpvPropertyMirror *pMirror, QObject *parent = nullptr);
+    ~MpvEventThread() override;
+
+    /**
+     * @brief 唤醒mpv_wait_event并等待线程退出，须在销毁mpv句柄前调用
+     */
+    void stop();
+
+    /**
+     * @brief 界面线程开始取事件前调用，之后再入队的事件会重新通知
+     */
+    void acknowledge();
+    /**
+     * @brief 取出下一个事件，只能在界面线程调用
+     */
+    bool takeEvent(MpvEventData &event);
+    /**
+     * @brief 累计界面线程处理事件的耗时
+     */
+    void addGuiTime(qint64 nNsecs);
+    /**
+     * @brief 自上次调用以来的统计，只能在界面线程调用，不会自动输出
+     */
+    Statistics takeStatistics();
+
+signals:
+    /**
+     * @brief 队列由空变为非空
+     */
+    void eventsReady();
+
+protected:
+    void run() override;
+
+private:
+    void publish(MpvEventData &&event);
+    void printLog(const mpv_event_log_message *pLog);
+
+private:
+    mpv_handle *m_pHandle;
+    mpv_waitEvent m_waitEvent;
+    mpv_wakeUp m_wakeup;
+    MpvPropertyMirror *m_pMirror;
+
+    MpvSpscQueue<MpvEventData> m_queue;
+    std::atomic<bool> m_bNotified {false};  //已通知界面线程且尚未开始处理
+    std::atomic<quint32> m_nQueuedProps {0}; //已在队列中的属性，按位对应MpvPropertyMirror::Property
+
+    std::atomic<qint64> m_nEventCount {0};
+    std::atomic<qint64> m_nGuiNsecs {0};
+    QElapsedTimer m_statTimer;               //界面线程使用
+};
+
+}
+
+#endif /* ifndef _DMR_MPV_EVENT_THREAD_H */
@@ -18,6 +18,7 @@
 //#include "../../window/qplatformnativeinterface.h"
 //qpa/qplatformnativeinterface.h
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 
 #if defined(_WIN32) && !defined(_WIN32_WCE) && !defined(__SCITECH_SNAP__)
 /* Win32 but not WinCE */
@@ -1055,9 +1056,7 @@ namespace dmr {
     void MpvGLWidget::initMpvFuns()
     {
         qInfo() << "MpvGLWidget开始initMpvFuns";
-        QString libmpvPath;
-        libmpvPath = CompositingManager::libPath("libmpv.so.");
-        QLibrary mpvLibrary(libmpvPath);
+        QLibrary &mpvLibrary = RuntimeRegistry::get().library("libmpv.so.");
         m_callback = reinterpret_cast<mpv_render_contextSet_update_callback>(mpvLibrary.resolve("mpv_render_context_set_update_callback"));
         m_context_report = reinterpret_cast<mpv_render_contextReport_swap>(mpvLibrary.resolve("mpv_render_context_report_swap"));
         m_renderContex = reinterpret_cast<mpv_renderContext_free>(mpvLibrary.resolve("mpv_render_context_free"));
@@ -0,0 +1,147 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "mpv_property_mirror.h"
+
+#define MIRROR_TAG_BASE 0x100
+
+namespace dmr {
+
+struct MirrorEntry {
+    const char *name;
+    mpv_format format;
+};
+
+static const MirrorEntry s_entries[MpvPropertyMirror::PropertyCount] = {
+    {"time-pos", MPV_FORMAT_DOUBLE},
+    {"duration", MPV_FORMAT_DOUBLE},
+    {"pause", MPV_FORMAT_FLAG},
+    {"mute", MPV_FORMAT_FLAG},
+    {"volume", MPV_FORMAT_DOUBLE},
+    {"sid", MPV_FORMAT_INT64},
+    {"aid", MPV_FORMAT_INT64},
+    {"dwidth", MPV_FORMAT_INT64},
+    {"dheight", MPV_FORMAT_INT64},
+    {"sub-visibility", MPV_FORMAT_FLAG},
+    {"sub-delay", MPV_FORMAT_DOUBLE},
+    {"video-rotate", MPV_FORMAT_INT64},
+    {"video-aspect", MPV_FORMAT_DOUBLE},
+    {"core-idle", MPV_FORMAT_FLAG},
+    {"paused-for-cache", MPV_FORMAT_FLAG},
+};
+
+MpvPropertyMirror::MpvPropertyMirror()
+{
+    reset();
+}
+
+const char *MpvPropertyMirror::name(Property prop)
+{
+    return s_entries[prop].name;
+}
+
+mpv_format MpvPropertyMirror::format(Property prop)
+{
+    return s_entries[prop].format;
+}
+
+uint64_t MpvPropertyMirror::tag(Property prop)
+{
+    return MIRROR_TAG_BASE + static_cast<uint64_t>(prop);
+}
+
+MpvPropertyMirror::Property MpvPropertyMirror::find(const QString &sName)
+{
+    for (int i = 0; i < PropertyCount; i++) {
+        if (sName == QLatin1String(s_entries[i].name))
+            return static_cast<Property>(i);
+    }
+
+    return PropertyCount;
+}
+
+MpvPropertyMirror::Property MpvPropertyMirror::fromTag(uint64_t nUserData)
+{
+    if (nUserData < MIRROR_TAG_BASE || nUserData >= MIRROR_TAG_BASE + PropertyCount)
+        return PropertyCount;
+
+    return static_cast<Property>(nUserData - MIRROR_TAG_BASE);
+}
+
+bool MpvPropertyMirror::update(uint64_t nUserData, const mpv_event_property *pEvent)
+{
+    Property prop = fromTag(nUserData);
+    if (prop == PropertyCount)
+        return false;
+
+    //格式无法转换时事件以MPV_FORMAT_NONE送达，此时快照失效
+    store(prop, pEvent->format == format(prop) ? pEvent->data : nullptr);
+
+    return true;
+}
+
+void MpvPropertyMirror::store(Property prop, const void *pData)
+{
+    Slot &slot = m_slots[prop];
+    if (!pData) {
+        slot.valid.store(false, std::memory_order_release);
+        return;
+    }
+
+    switch (format(prop)) {
+    case MPV_FORMAT_DOUBLE:
+        slot.dValue.store(*static_cast<const double *>(pData), std::memory_order_relaxed);
+        break;
+    case MPV_FORMAT_INT64:
+        slot.nValue.store(*static_cast<const int64_t *>(pData), std::memory_order_relaxed);
+        break;
+    case MPV_FORMAT_FLAG:
+        slot.nValue.store(*static_cast<const int *>(pData), std::memory_order_relaxed);
+        break;
+    default:
+        return;
+    }
+    slot.valid.store(true, std::memory_order_release);
+}
+
+void MpvPropertyMirror::reset()
+{
+    for (Slot &slot : m_slots) {
+        slot.valid.store(false);
+        slot.dValue.store(0.0);
+        slot.nValue.store(0);
+    }
+}
+
+bool MpvPropertyMirror::getDouble(Property prop, double &dValue) const
+{
+    const Slot &slot = m_slots[prop];
+    if (!slot.valid.load(std::memory_order_acquire))
+        return false;
+
+    dValue = slot.dValue.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool MpvPropertyMirror::getInt64(Property prop, qint64 &nValue) const
+{
+    const Slot &slot = m_slots[prop];
+    if (!slot.valid.load(std::memory_order_acquire))
+        return false;
+
+    nValue = slot.nValue.load(std::memory_order_relaxed);
+    return true;
+}
+
+bool MpvPropertyMirror::getFlag(Property prop, bool &bValue) const
+{
+    qint64 nValue = 0;
+    if (!getInt64(prop, nValue))
+        return false;
+
+    bValue = nValue != 0;
+    return true;
+}
+
+}
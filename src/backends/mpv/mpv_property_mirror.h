@@ -0,0 +1,94 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_MPV_PROPERTY_MIRROR_H
+#define _DMR_MPV_PROPERTY_MIRROR_H
+
+#include <QtCore>
+#include <mpv/client.h>
+
+#include <atomic>
+
+namespace dmr {
+
+/**
+ * @file mpv属性镜像
+ * 以原生格式(DOUBLE/INT64/FLAG)观察界面常用的mpv属性，属性变化事件到达时写入快照，
+ * 读取时无锁、不访问mpv；快照无效（未收到事件或格式无法转换）时由调用者回退到同步读取
+ */
+class MpvPropertyMirror
+{
+public:
+    enum Property {
+        TimePos = 0,
+        Duration,
+        Pause,
+        Mute,
+        Volume,
+        Sid,
+        Aid,
+        DWidth,
+        DHeight,
+        SubVisibility,
+        SubDelay,
+        VideoRotate,
+        VideoAspect,
+        CoreIdle,
+        PausedForCache,
+        PropertyCount
+    };
+
+    MpvPropertyMirror();
+
+    static const char *name(Property prop);
+    static mpv_format format(Property prop);
+    /**
+     * @brief 观察属性时使用的reply_userdata，与其他异步请求的标记区分
+     */
+    static uint64_t tag(Property prop);
+    /**
+     * @brief 根据属性名查找，未镜像的属性返回PropertyCount
+     */
+    static Property find(const QString &sName);
+    /**
+     * @brief 根据reply_userdata查找，不是镜像属性的标记返回PropertyCount
+     */
+    static Property fromTag(uint64_t nUserData);
+
+    /**
+     * @brief 处理属性变化事件
+     * @param nUserData 事件的reply_userdata
+     * @return 事件属于镜像属性时返回true
+     */
+    bool update(uint64_t nUserData, const mpv_event_property *pEvent);
+    /**
+     * @brief 写入同步读取到的原生值，pData为空表示读取失败
+     */
+    void store(Property prop, const void *pData);
+    /**
+     * @brief 清空所有快照，用于mpv句柄重建
+     */
+    void reset();
+
+    /**
+     * @brief 读取快照
+     * @return 快照无效时返回false，输出参数不变
+     */
+    bool getDouble(Property prop, double &dValue) const;
+    bool getInt64(Property prop, qint64 &nValue) const;
+    bool getFlag(Property prop, bool &bValue) const;
+
+private:
+    struct Slot {
+        std::atomic<bool> valid;
+        std::atomic<double> dValue;
+        std::atomic<qint64> nValue;
+    };
+
+    Slot m_slots[PropertyCount];
+};
+
+}
+
+#endif /* ifndef _DMR_MPV_PROPERTY_MIRROR_H */
@@ -8,8 +8,11 @@
 #include "mpv_proxy.h"
 #include "mpv_glwidget.h"
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 #include "player_engine.h"
 #include "hwdec_probe.h"
+#include "burst_screenshot_worker.h"
+#include "mpv_event_thread.h"
 
 #ifndef _LIBDMR_
 #include "dmr_settings.h"
@@ -93,11 +96,6 @@ typedef struct  {
 //返回值大于0表示支持硬解， index 视频格式解码请求值， result 返回解码支持信息
 typedef unsigned int (*gpu_decoderInfo)(decoder_profile index, VDP_Decoder_t *result );
 
-static void mpv_callback(void *d)
-{
-    MpvProxy *pMpv = static_cast<MpvProxy *>(d);
-    QMetaObject::invokeMethod(pMpv, "has_mpv_events", Qt::QueuedConnection);
-}
 
 MpvProxy::MpvProxy(QWidget *parent)
     : Backend(parent)
@@ -123,7 +121,10 @@ MpvProxy::MpvProxy(QWidget *parent)
 
 MpvProxy::~MpvProxy()
 {
-    disconnect(this, &MpvProxy::has_mpv_events, this, &MpvProxy::handle_mpv_events);
+    //先停止事件线程，mpv句柄随成员析构销毁
+    if (m_pEventThread) {
+        m_pEventThread->stop();
+    }
     m_bConnectStateChange = false;
     disconnect(window()->windowHandle(), &QWindow::windowStateChanged, nullptr, nullptr);
     if (CompositingManager::get().composited()) {
@@ -139,9 +140,7 @@ void MpvProxy::setDecodeModel(const QVariant &value)
 
 void MpvProxy::initMpvFuns()
 {
-    QString libmpvPath;
-    libmpvPath = CompositingManager::libPath("libmpv.so.");
-    QLibrary mpvLibrary(libmpvPath);
+    QLibrary &mpvLibrary = RuntimeRegistry::get().library("libmpv.so.");
 
     m_waitEvent = reinterpret_cast<mpv_waitEvent>(mpvLibrary.resolve("mpv_wait_event"));
     m_setOptionString = reinterpret_cast<mpv_set_optionString>(mpvLibrary.resolve("mpv_set_option_string"));
@@ -154,7 +153,7 @@ void MpvProxy::initMpvFuns()
     m_eventName = reinterpret_cast<mpv_eventName>(mpvLibrary.resolve("mpv_event_name"));
     m_creat = reinterpret_cast<mpvCreate>(mpvLibrary.resolve("mpv_create"));
     m_requestLogMessage = reinterpret_cast<mpv_requestLog_messages>(mpvLibrary.resolve("mpv_request_log_messages"));
-    m_setWakeupCallback = reinterpret_cast<mpv_setWakeup_callback>(mpvLibrary.resolve("mpv_set_wakeup_callback"));
+    m_wakeup = reinterpret_cast<mpv_wakeUp>(mpvLibrary.resolve("mpv_wakeup"));
     m_initialize = reinterpret_cast<mpvinitialize>(mpvLibrary.resolve("mpv_initialize"));
     m_freeNodecontents = reinterpret_cast<mpv_freeNode_contents>(mpvLibrary.resolve("mpv_free_node_contents"));
 }
@@ -167,7 +166,7 @@ void MpvProxy::initGpuInfoFuns()
         return;
     }
 
-    QLibrary mpvLibrary(CompositingManager::libPath("libgpuinfo.so"));
+    QLibrary &mpvLibrary = RuntimeRegistry::get().library("libgpuinfo.so");
     m_gpuInfo = reinterpret_cast<void *>(mpvLibrary.resolve("vdp_Iter_decoderInfo"));
 }
 
@@ -175,24 +174,30 @@ void MpvProxy::firstInit()
 {
 #ifndef _LIBDMR_
 #ifdef __x86_64__
-    //第一次运行deepin-movie，检测是否支持硬解
-    QString procName = QCoreApplication::applicationFilePath();
-    QProcess proc;
-    proc.start(procName, QStringList() << "hwdec");
-    if (!proc.waitForFinished())
-              return;
-    //检测进程退出码
-    if(proc.exitCode() != QProcess::NormalExit)
-    {
-        CompositingManager::setCanHwdec(false);
-    } else {//检测进程日志输出
-        QByteArray result = proc.readAllStandardError();
-        qInfo() << "deepin-movie hwdec: " << result;
-        if(result.toLower().contains("not supported")) {
+    //检测是否支持硬解，结果记入硬解能力表，同一启动和驱动环境下不再启动检测进程
+    QVariant canHwdec;
+    if (HwdecProbe::get().lookupCapability("canHwdec", canHwdec)) {
+        CompositingManager::setCanHwdec(canHwdec.toBool());
+    } else {
+        QString procName = QCoreApplication::applicationFilePath();
+        QProcess proc;
+        proc.start(procName, QStringList() << "hwdec");
+        if (!proc.waitForFinished())
+                  return;
+        //检测进程退出码
+        if(proc.exitCode() != QProcess::NormalExit)
+        {
             CompositingManager::setCanHwdec(false);
-        } else {
-            CompositingManager::setCanHwdec(true);
+        } else {//检测进程日志输出
+            QByteArray result = proc.readAllStandardError();
+            qInfo() << "deepin-movie hwdec: " << result;
+            if(result.toLower().contains("not supported")) {
+                CompositingManager::setCanHwdec(false);
+            } else {
+                CompositingManager::setCanHwdec(true);
+            }
         }
+        HwdecProbe::get().storeCapability("canHwdec", CompositingManager::isCanHwdec());
     }
 #endif
 #endif
@@ -200,6 +205,10 @@ void MpvProxy::firstInit()
     initGpuInfoFuns();
     if (m_creat) {
         m_handle = MpvHandle::fromRawHandle(mpv_init());
+        m_pEventThread = new MpvEventThread(m_handle, m_waitEvent, m_wakeup, &m_mirror, this);
+        connect(m_pEventThread, &MpvEventThread::eventsReady, this, &MpvProxy::handle_mpv_events,
+                Qt::QueuedConnection);
+        m_pEventThread->start();
         if (CompositingManager::get().composited()) {
             m_pMpvGLwidget = new MpvGLWidget(this, m_handle);
             connect(this, &MpvProxy::stateChanged, this, &MpvProxy::slotStateChanged);
@@ -493,25 +502,18 @@ mpv_handle *MpvProxy::mpv_init()
     }
 #endif
 
-    //only to get notification without data
-    m_observeProperty(pHandle, 0, "time-pos", MPV_FORMAT_NONE); //playback-time ?
-    m_observeProperty(pHandle, 0, "pause", MPV_FORMAT_NONE);
-    m_observeProperty(pHandle, 0, "mute", MPV_FORMAT_NONE);
-    m_observeProperty(pHandle, 0, "volume", MPV_FORMAT_NONE); //ao-volume ?
-    m_observeProperty(pHandle, 0, "sid", MPV_FORMAT_NONE);
-    m_observeProperty(pHandle, 0, "aid", MPV_FORMAT_NODE);
-    m_observeProperty(pHandle, 0, "dwidth", MPV_FORMAT_NODE);
-    m_observeProperty(pHandle, 0, "dheight", MPV_FORMAT_NODE);
+    //界面读取的属性都以原生格式观察，值由事件写入镜像
+    m_mirror.reset();
+    for (int i = 0; i < MpvPropertyMirror::PropertyCount; i++) {
+        auto prop = static_cast<MpvPropertyMirror::Property>(i);
+        m_observeProperty(pHandle, MpvPropertyMirror::tag(prop),
+                          MpvPropertyMirror::name(prop), MpvPropertyMirror::format(prop));
+    }
 
     // because of vpu, we need to implement playlist w/o mpv
     //m_observeProperty(pHandle, 0, "playlist-pos", MPV_FORMAT_NONE);
     //m_observeProperty(pHandle, 0, "playlist-count", MPV_FORMAT_NONE);
-    m_observeProperty(pHandle, 0, "core-idle", MPV_FORMAT_NODE);
-    m_observeProperty(pHandle, 0, "paused-for-cache", MPV_FORMAT_NODE);
 
-    m_setWakeupCallback(pHandle, mpv_callback, this);
-    connect(this, &MpvProxy::has_mpv_events, this, &MpvProxy::handle_mpv_events,
-            Qt::DirectConnection);
     if (m_initialize(pHandle) < 0) {
         std::runtime_error("mpv init failed");
     }
@@ -554,12 +556,7 @@ mpv_handle *MpvProxy::mpv_init()
 
 void MpvProxy::setState(PlayState state)
 {
-    bool bRawFormat = false;
-
-    if (0 < dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->size()) {
-        PlayItemInfo currentInfo = dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->currentInfo();
-        bRawFormat = currentInfo.mi.isRawFormat();
-    }
+    bool bRawFormat = dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->currentIsRawFormat();
 
     if (_state != state) {
         _state = state;
@@ -574,33 +571,21 @@ void MpvProxy::setState(PlayState state)
     }
 }
 
-void MpvProxy::pollingEndOfPlayback()
+void MpvProxy::requestEndOfPlayback()
 {
-    if (_state != Backend::Stopped) {
-        m_bPolling = true;
-        blockSignals(true);
-        stop();
-        bool bIdel = my_get_property(m_handle, "idle-active").toBool();
-        if (bIdel) {
-            blockSignals(false);
-            setState(Backend::Stopped);
-            m_bPolling = false;
-            return;
-        }
-
-        while (_state != Backend::Stopped) {
-            mpv_event *pEvent = m_waitEvent(m_handle, 0.005);
-            if (pEvent->event_id == MPV_EVENT_NONE)
-                continue;
+    if (_state == Backend::Stopped || m_bPendingStop)
+        return;
 
-            if (pEvent->event_id == MPV_EVENT_END_FILE) {
-                blockSignals(false);
-                setState(Backend::Stopped);
-                break;
-            }
-        }
-        m_bPolling = false;
+    //没有加载文件时stop不会产生MPV_EVENT_END_FILE，直接切换状态
+    bool bIdle = my_get_property(m_handle, "idle-active").toBool();
+    if (bIdle) {
+        setState(Backend::Stopped);
+        emit stopCompleted();
+        return;
     }
+
+    m_bPendingStop = true;
+    stop();
 }
 
 const PlayingMovieInfo &MpvProxy::playingMovieInfo()
@@ -613,14 +598,20 @@ bool MpvProxy::isSurportHardWareDecode(const QString sDecodeName, const int &nVi
     bool isHardWare = true;//未安装探测工具默认支持硬解
     decoder_profile decoderValue = decoder_profile::UN_KNOW; //初始化支持解码值
     decoderValue = (decoder_profile)getDecodeProbeValue(sDecodeName); //根据视频格式获取解码值
-    if(decoderValue != decoder_profile::UN_KNOW ) {//开始探测是否支持硬解码
-        VDP_Decoder_t *probeDecode = new VDP_Decoder_t;
-        if(m_gpuInfo) {
+    if(decoderValue != decoder_profile::UN_KNOW && m_gpuInfo) {//开始探测是否支持硬解码
+        //各解码档次的支持情况和最大宽高记入硬解能力表，只在未记录时调用探测接口
+        const QString sKey = QString("vdpau-%1").arg(static_cast<int>(decoderValue));
+        QVariant value;
+        if (!HwdecProbe::get().lookupCapability(sKey, value)) {
+            VDP_Decoder_t *probeDecode = new VDP_Decoder_t;
             int nSurport =  ((gpu_decoderInfo)m_gpuInfo)(decoderValue, probeDecode);
-            isHardWare = (nSurport > 0 && probeDecode->max_width >= nVideoWidth
-                    &&  probeDecode->max_height >= nVideoHeight);//nSurport大于0表示支持，硬解码支持的最大宽高必须大于或等于视频的宽高
+            value = QVariantList() << nSurport << probeDecode->max_width << probeDecode->max_height;
+            delete probeDecode;
+            HwdecProbe::get().storeCapability(sKey, value);
         }
-        delete probeDecode;
+        const QVariantList listValue = value.toList();
+        isHardWare = (listValue.size() == 3 && listValue[0].toInt() > 0 && listValue[1].toInt() >= nVideoWidth
+                && listValue[2].toInt() >= nVideoHeight);//nSurport大于0表示支持，硬解码支持的最大宽高必须大于或等于视频的宽高
     }
     return isHardWare;
 }
@@ -641,48 +632,58 @@ int MpvProxy::getDecodeProbeValue(const QString sDecodeName)
 
 void MpvProxy::handle_mpv_events()
 {
+    if (!m_pEventThread)
+        return;
+
+    m_pEventThread->acknowledge();
+    QElapsedTimer timer;
+    timer.start();
+
+    MpvEventData event;
     if (utils::check_wayland_env() && CompositingManager::get().isTestFlag()) {
         qInfo() << "not handle mpv events!";
+        while (m_pEventThread->takeEvent(event)) {}
         return;
     }
-    while (1) {
-        mpv_event *pEvent = m_waitEvent(m_handle, 0.0005);
-        if (pEvent->event_id == MPV_EVENT_NONE)
-            break;
-
-        switch (pEvent->event_id) {
+    while (m_pEventThread->takeEvent(event)) {
+        switch (event.id) {
         case MPV_EVENT_LOG_MESSAGE:
-            processLogMessage(reinterpret_cast<mpv_event_log_message *>(pEvent->data));
+            processLogMessage(event);
             break;
 
         case MPV_EVENT_PROPERTY_CHANGE:
-            processPropertyChange(reinterpret_cast<mpv_event_property *>(pEvent->data));
+            processPropertyChange(event.prop);
             break;
 
         case MPV_EVENT_COMMAND_REPLY:
-            if (pEvent->error < 0) {
+            if (event.nError < 0) {
                 qInfo() << "command error";
             }
 
-            if (pEvent->reply_userdata == AsyncReplyTag::SEEK) {
+            //seek失败不会有MPV_EVENT_PLAYBACK_RESTART
+            if (event.nUserData == AsyncReplyTag::SEEK && event.nError < 0) {
                 m_bPendingSeek = false;
             }
             break;
 
         case MPV_EVENT_PLAYBACK_RESTART:
             // caused by seek or just playing
+            if (m_bPendingSeek) {
+                m_bPendingSeek = false;
+                emit seekCompleted();
+            }
             break;
 
 #if MPV_CLIENT_API_VERSION < MPV_MAKE_VERSION(2,0)
         case MPV_EVENT_TRACKS_CHANGED:
-            qInfo() << m_eventName(pEvent->event_id);
+            qInfo() << m_eventName(event.id);
             updatePlayingMovieInfo();
             emit tracksChanged();
             break;
 #endif
 
         case MPV_EVENT_FILE_LOADED: {
-            qInfo() << m_eventName(pEvent->event_id);
+            qInfo() << m_eventName(event.id);
 
             if (m_pMpvGLwidget) {
                 qInfo() << "hwdec-interop" << my_get_property(m_handle, "gpu-hwdec-interop")
@@ -736,63 +737,66 @@ void MpvProxy::handle_mpv_events()
         }
 
         case MPV_EVENT_END_FILE: {
+            qInfo() << m_eventName(event.id) <<
+                    "reason " << event.nEndReason;
+            m_bPendingSeek = false;
+
+            if (m_bPendingStop) {
+                //切换文件时_file已是下一个文件，不能清除其播放位置
+                m_bPendingStop = false;
+                setState(PlayState::Stopped);
+                emit stopCompleted();
+                break;
+            }
 #ifndef _LIBDMR_
             MovieConfiguration::get().updateUrl(this->_file,
                                                 ConfigKnownKey::StartPos, 0);
 #endif
-            mpv_event_end_file *ev_ef = reinterpret_cast<mpv_event_end_file *>(pEvent->data);
-            qInfo() << m_eventName(pEvent->event_id) <<
-                    "reason " << ev_ef->reason;
 
             setState(PlayState::Stopped);
             break;
         }
 
         case MPV_EVENT_IDLE:
-            qInfo() << m_eventName(pEvent->event_id);
+            qInfo() << m_eventName(event.id);
             setState(PlayState::Stopped);
             emit elapsedChanged();
             break;
 
         default:
-            qInfo() << m_eventName(pEvent->event_id);
+            qInfo() << m_eventName(event.id);
             break;
         }
     }
+
+    //统计由MpvEventThread::takeStatistics按需读取
+    m_pEventThread->addGuiTime(timer.nsecsElapsed());
 }
 
-void MpvProxy::processLogMessage(mpv_event_log_message *pEvent)
+void MpvProxy::processLogMessage(const MpvEventData &event)
 {
-    switch (pEvent->log_level) {
+    //日志已在事件线程输出，这里只通知界面
+    switch (event.logLevel) {
     case MPV_LOG_LEVEL_WARN:
-        qWarning() << QString("%1: %2").arg(pEvent->prefix).arg(pEvent->text);
-        emit mpvWarningLogsChanged(QString(pEvent->prefix), QString(pEvent->text));
+        emit mpvWarningLogsChanged(event.sPrefix, event.sText);
         break;
 
     case MPV_LOG_LEVEL_ERROR:
-    case MPV_LOG_LEVEL_FATAL: {
-        QString strError = pEvent->text;
-        if (strError.contains("Failed setup for format vdpau")) {
+    case MPV_LOG_LEVEL_FATAL:
+        if (event.sText.contains("Failed setup for format vdpau")) {
             m_bLastIsSpecficFormat = true;
         }
-        qCritical() << QString("%1: %2").arg(pEvent->prefix).arg(strError);
-        emit mpvErrorLogsChanged(QString(pEvent->prefix), strError);
-    }
-    break;
-
-    case MPV_LOG_LEVEL_INFO:
-        qInfo() << QString("%1: %2").arg(pEvent->prefix).arg(pEvent->text);
+        emit mpvErrorLogsChanged(event.sPrefix, event.sText);
         break;
 
     default:
-        qInfo() << QString("%1: %2").arg(pEvent->prefix).arg(pEvent->text);
         break;
     }
 }
 
-void MpvProxy::processPropertyChange(mpv_event_property *pEvent)
+void MpvProxy::processPropertyChange(MpvPropertyMirror::Property prop)
 {
-    QString sName = QString::fromUtf8(pEvent->name);
+    QString sName = QString::fromLatin1(MpvPropertyMirror::name(prop));
     if (sName != "time-pos") qInfo() << sName;
 
     if (sName == "time-pos") {
@@ -814,7 +818,10 @@ void MpvProxy::processPropertyChange(mpv_event_property *pEvent)
         //_hideSub = my_get_property(m_handle, "sub-visibility")
     } else if (sName == "pause") {
         auto idle = my_get_property(m_handle, "idle-active").toBool();
-        if (my_get_property(m_handle, "pause").toBool()) {
+        bool bPause = false;
+        if (!m_mirror.getFlag(MpvPropertyMirror::Pause, bPause))
+            bPause = my_get_property(m_handle, "pause").toBool();
+        if (bPause) {
             if (!idle)
                 setState(PlayState::Paused);
             else
@@ -826,8 +833,11 @@ void MpvProxy::processPropertyChange(mpv_event_property *pEvent)
         }
     } else if (sName == "core-idle") {
     } else if (sName == "paused-for-cache") {
-        qInfo() << "paused-for-cache" << my_get_property_variant(m_handle, "paused-for-cache");
-        emit urlpause(my_get_property_variant(m_handle, "paused-for-cache").toBool());
+        bool bPausedForCache = false;
+        if (!m_mirror.getFlag(MpvPropertyMirror::PausedForCache, bPausedForCache))
+            bPausedForCache = my_get_property_variant(m_handle, "paused-for-cache").toBool();
+        qInfo() << "paused-for-cache" << bPausedForCache;
+        emit urlpause(bPausedForCache);
     }
 }
 
@@ -854,6 +864,10 @@ bool MpvProxy::loadSubtitle(const QFileInfo &fileInfo)
 
 bool MpvProxy::isSubVisible()
 {
+    bool bVisible = false;
+    if (m_mirror.getFlag(MpvPropertyMirror::SubVisibility, bVisible))
+        return bVisible;
+
     return my_get_property(m_handle, "sub-visibility").toBool();
 }
 
@@ -867,6 +881,10 @@ void MpvProxy::setSubDelay(double dSecs)
 
 double MpvProxy::subDelay() const
 {
+    double dDelay = 0.0;
+    if (m_mirror.getDouble(MpvPropertyMirror::SubDelay, dDelay))
+        return dDelay;
+
     return my_get_property(m_handle, "sub-delay").toDouble();
 }
 
@@ -971,11 +989,19 @@ void MpvProxy::toggleSubtitle()
 
 int MpvProxy::aid() const
 {
+    qint64 nId = 0;
+    if (m_mirror.getInt64(MpvPropertyMirror::Aid, nId))
+        return static_cast<int>(nId);
+
     return my_get_property(m_handle, "aid").toInt();
 }
 
 int MpvProxy::sid() const
 {
+    qint64 nId = 0;
+    if (m_mirror.getInt64(MpvPropertyMirror::Sid, nId))
+        return static_cast<int>(nId);
+
     return my_get_property(m_handle, "sid").toInt();
 }
 
@@ -1028,15 +1054,23 @@ void MpvProxy::volumeDown()
 
 int MpvProxy::volume() const
 {
-    int nActualVol = my_get_property(m_handle, "volume").toInt();
+    int nActualVol = 0;
+    double dVolume = 0.0;
+    //镜像与同步读取都截断取整，与原来的toInt()结果保持一致
+    if (!m_mirror.getDouble(MpvPropertyMirror::Volume, dVolume)) {
+        dVolume = my_get_property(m_handle, "volume").toDouble();
+    }
+    nActualVol = static_cast<int>(dVolume);
     int nDispalyVol = static_cast<int>((nActualVol - 40) / 60.0 * 100.0);
     return nDispalyVol > 100 ? nActualVol : nDispalyVol;
 }
 
 int MpvProxy::videoRotation() const
 {
-    int nRotate = my_get_property(m_handle, "video-rotate").toInt();
-    return (nRotate + 360) % 360;
+    qint64 nRotate = 0;
+    if (!m_mirror.getInt64(MpvPropertyMirror::VideoRotate, nRotate))
+        nRotate = my_get_property(m_handle, "video-rotate").toInt();
+    return static_cast<int>((nRotate + 360) % 360);
 }
 
 void MpvProxy::setVideoRotation(int nDegree)
@@ -1051,11 +1085,19 @@ void MpvProxy::setVideoAspect(double dValue)
 
 double MpvProxy::videoAspect() const
 {
+    double dAspect = 0.0;
+    if (m_mirror.getDouble(MpvPropertyMirror::VideoAspect, dAspect))
+        return dAspect;
+
     return my_get_property(m_handle, "video-aspect").toDouble();
 }
 
 bool MpvProxy::muted() const
 {
+    bool bMute = false;
+    if (m_mirror.getFlag(MpvPropertyMirror::Mute, bMute))
+        return bMute;
+
     return my_get_property(m_handle, "mute").toBool();
 }
 
@@ -1088,21 +1130,15 @@ void MpvProxy::refreshDecode()
         //2.1 特殊格式
         bool isSoftCodec = false;
         if (0 < dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->size()) {
-            PlayItemInfo currentInfo = dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->currentInfo();
+            const PlayItemInfo &currentInfo = dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->currentInfo();
             auto codec = currentInfo.mi.videoCodec();
             auto name = _file.fileName();
             isSoftCodec = codec.toLower().contains("mpeg2video") || codec.toLower().contains("wmv") || name.toLower().contains("wmv");
 #if !defined(_loongarch) && !defined(__loongarch__) && !defined(__loongarch64)
             //去除9200显卡适配
-            QFileInfo jmfi("/dev/jmgpu");
-            bool jmflag =false;
-            if (jmfi.exists()) {
-                QDir jmdir(QLibraryInfo::location(QLibraryInfo::LibrariesPath) +QDir::separator() +"mwv207");
-                if(jmdir.exists())
-                {
-                    jmflag=true;
-                }
-            }
+            //设备和驱动目录运行期间不变，只检查一次
+            static const bool jmflag = QFileInfo("/dev/jmgpu").exists()
+                    && QDir(QLibraryInfo::location(QLibraryInfo::LibrariesPath) +QDir::separator() +"mwv207").exists();
             //探测硬解码
             if(!isSoftCodec && !CompositingManager::get().isZXIntgraphics() && !jmflag) {
                 isSoftCodec = !isSurportHardWareDecode(codec, currentInfo.mi.width, currentInfo.mi.height);
@@ -1193,15 +1229,15 @@ void MpvProxy::refreshDecode()
 
 void MpvProxy::initMember()
 {
-    m_nBurstStart = 0;
+    m_pBurstWorker = nullptr;
 
     m_pMpvGLwidget = nullptr;
     m_pParentWidget = nullptr;
+    m_pEventThread = nullptr;
 
     m_bInBurstShotting = false;
-    m_posBeforeBurst = false;
     m_bPendingSeek = false;
-    m_bPolling = false;
+    m_bPendingStop = false;
     m_bConnectStateChange = false;
     m_bPauseOnStart = false;
     m_bIsJingJia = false;
@@ -1225,7 +1261,7 @@ void MpvProxy::initMember()
     m_eventName = nullptr;
     m_creat = nullptr;
     m_requestLogMessage = nullptr;
-    m_setWakeupCallback = nullptr;
+    m_wakeup = nullptr;
     m_initialize = nullptr;
     m_freeNodecontents = nullptr;
     m_pConfig = nullptr;
@@ -1388,40 +1424,44 @@ void MpvProxy::burstScreenshot()
     if (state() == PlayState::Stopped)
         return;
 
-    //my_command(m_handle, QList<QVariant> {"revert-seek", "mark"});
-    m_posBeforeBurst = my_get_property(m_handle, "time-pos");
+    qint64 nTotal = duration();
+    if (nTotal < 35) {
+        emit notifyScreenshot(QImage(), 0);
+        stopBurstScreenshot();
+        return;
+    }
 
-    int nDuration = static_cast<int>(duration() / 15);
+    int nDuration = static_cast<int>(nTotal / 15);
 
     std::random_device rd;
     std::mt19937 g(rd());
     std::uniform_int_distribution<int> uniform_dist(0, nDuration);
     m_listBurstPoints.clear();
     for (int i = 0; i < 15; i++) {
-        m_listBurstPoints.append(nDuration * i + uniform_dist(g));
+        qint64 nPoint = nDuration * i + uniform_dist(g);
+        m_listBurstPoints.append(nPoint >= nTotal ? nTotal - 5 : nPoint);
     }
-    m_nBurstStart = 0;
 
-    if (duration() < 35) {
-        emit notifyScreenshot(QImage(), 0);
-        stopBurstScreenshot();
-        return;
-    }
-    qInfo() << "burst span " << m_nBurstStart;
-
-    if (!paused()) pauseResume();
+    //截图在独立的解码上下文中进行，主窗口继续播放
+    QString sFile = _file.isLocalFile() ? _file.toLocalFile() : _file.toString();
+    BurstScreenshotWorker *pWorker = new BurstScreenshotWorker(sFile, m_listBurstPoints, videoRotation(), this);
+    connect(pWorker, &BurstScreenshotWorker::frameReady, this, &MpvProxy::onBurstFrameReady);
+    connect(pWorker, &QThread::finished, pWorker, &QObject::deleteLater);
+    m_pBurstWorker = pWorker;
     m_bInBurstShotting = true;
-    QTimer::singleShot(0, this, &MpvProxy::stepBurstScreenshot);
+    pWorker->start();
 }
 
-qint64 MpvProxy::nextBurstShootPoint()
+void MpvProxy::onBurstFrameReady(const QImage &frame, qint64 nTime)
 {
-    auto next = m_listBurstPoints[static_cast<int>(m_nBurstStart++)];
-    if (next >= duration()) {
-        next = duration() - 5;
-    }
+    //停止后仍在队列中的帧直接丢弃
+    if (!m_bInBurstShotting || sender() != m_pBurstWorker.data())
+        return;
 
-    return next;
+    emit notifyScreenshot(frame, nTime);
+    if (frame.isNull()) {
+        stopBurstScreenshot();
+    }
 }
 
 int MpvProxy::volumeCorrection(int displayVol)
@@ -1475,6 +1515,8 @@ int MpvProxy::my_set_property(mpv_handle *pHandle, const QString &sName, const Q
 
     if (!m_setProperty) return 0;
     int res = m_setProperty(pHandle, sName.toUtf8().data(), MPV_FORMAT_NODE, node.node());
+    if (res >= 0)
+        refreshMirror(pHandle, sName);
     return res;
 }
 
@@ -1514,9 +1556,34 @@ QVariant MpvProxy::my_command(mpv_handle *pHandle, const QVariant &args)
         return QVariant::fromValue(ErrorReturn(nErr));
     auto variant = node_to_variant(&res);
     m_freeNodecontents(&res);
+
+    //cycle/set/add等命令会修改属性，同样需要刷新镜像
+    QList<QVariant> listArgs = args.toList();
+    if (listArgs.size() > 1) {
+        QString sCmd = listArgs[0].toString();
+        if (sCmd == "cycle" || sCmd == "set" || sCmd == "add" || sCmd == "cycle-values") {
+            refreshMirror(pHandle, listArgs[1].toString());
+        }
+    }
     return variant;
 }
 
+void MpvProxy::refreshMirror(mpv_handle *pHandle, const QString &sName)
+{
+    auto prop = MpvPropertyMirror::find(sName);
+    if (prop == MpvPropertyMirror::PropertyCount || !m_getProperty)
+        return;
+
+    //按原生格式读取，不经过mpv_node转换
+    union {
+        double dValue;
+        int64_t nValue;
+        int bFlag;
+    } value;
+    int nErr = m_getProperty(pHandle, MpvPropertyMirror::name(prop), MpvPropertyMirror::format(prop), &value);
+    m_mirror.store(prop, nErr >= 0 ? &value : nullptr);
+}
+
 QImage MpvProxy::takeOneScreenshot()
 {
     bool bNeedRotate = false;
@@ -1579,46 +1646,14 @@ QImage MpvProxy::takeOneScreenshot()
     return QImage();
 }
 
-void MpvProxy::stepBurstScreenshot()
-{
-    if (!m_bInBurstShotting) {
-        return;
-    }
-
-    auto pos = nextBurstShootPoint();
-    my_command(m_handle, QList<QVariant> {"seek", pos, "absolute"});
-//    int tries = 10;
-    while (true) {
-        mpv_event *pEvent = m_waitEvent(m_handle, 0.005);
-        if (pEvent->event_id == MPV_EVENT_NONE)
-            continue;
-
-        if (pEvent->event_id == MPV_EVENT_PLAYBACK_RESTART) {
-            qInfo() << "seek finished" << elapsed();
-            break;
-        }
-
-        if (pEvent->event_id == MPV_EVENT_END_FILE) {
-            qInfo() << "seek finished (end of file)" << elapsed();
-            break;
-        }
-    }
-
-    QImage img = takeOneScreenshot();
-    if (img.isNull()) {
-        emit notifyScreenshot(img, elapsed());
-        stopBurstScreenshot();
-        return;
-    }
-    emit notifyScreenshot(img, elapsed());
-    QTimer::singleShot(0, this, &MpvProxy::stepBurstScreenshot);
-}
-
 void MpvProxy::stopBurstScreenshot()
 {
     m_bInBurstShotting = false;
-    //my_command(m_handle, QList<QVariant> {"revert-seek", "mark"});
-    my_set_property(m_handle, "time-pos", m_posBeforeBurst);
+    if (m_pBurstWorker) {
+        disconnect(m_pBurstWorker, &BurstScreenshotWorker::frameReady, this, &MpvProxy::onBurstFrameReady);
+        m_pBurstWorker->stop();
+        m_pBurstWorker = nullptr;
+    }
 }
 
 void MpvProxy::seekForward(int nSecs)
@@ -1660,8 +1695,13 @@ void MpvProxy::seekAbsolute(int nPos)
 QSize MpvProxy::videoSize() const
 {
     if (state() == PlayState::Stopped) return QSize(-1, -1);
-    QSize size = QSize(my_get_property(m_handle, "dwidth").toInt(),
-                       my_get_property(m_handle, "dheight").toInt());
+    qint64 nWidth = 0;
+    qint64 nHeight = 0;
+    if (!m_mirror.getInt64(MpvPropertyMirror::DWidth, nWidth))
+        nWidth = my_get_property(m_handle, "dwidth").toInt();
+    if (!m_mirror.getInt64(MpvPropertyMirror::DHeight, nHeight))
+        nHeight = my_get_property(m_handle, "dheight").toInt();
+    QSize size = QSize(static_cast<int>(nWidth), static_cast<int>(nHeight));
 
     auto r = my_get_property(m_handle, "video-out-params/rotate").toInt();
     if (r == 90 || r == 270) {
@@ -1673,16 +1713,13 @@ QSize MpvProxy::videoSize() const
 
 qint64 MpvProxy::duration() const
 {
-    bool bRawFormat = false;
-
-    if (0 < dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->size()) {
-        PlayItemInfo currentInfo = dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->currentInfo();
-        bRawFormat = currentInfo.mi.isRawFormat();
-    }
-
-    if (bRawFormat) {     // 因为格式众多时长输出不同，这里做统一处理不显示时长
+    if (dynamic_cast<PlayerEngine *>(m_pParentWidget)->getplaylist()->currentIsRawFormat()) {     // 因为格式众多时长输出不同，这里做统一处理不显示时长
         return 0;
     } else {
+        double dDuration = 0.0;
+        //与直接读取属性时的转换一致，按整秒截断
+        if (m_mirror.getDouble(MpvPropertyMirror::Duration, dDuration))
+            return static_cast<qint64>(dDuration);
         return my_get_property(m_handle, "duration").value<qint64>();
     }
 }
@@ -1691,6 +1728,10 @@ qint64 MpvProxy::duration() const
 qint64 MpvProxy::elapsed() const
 {
     if (state() == PlayState::Stopped) return 0;
+
+    double dPos = 0.0;
+    if (m_mirror.getDouble(MpvPropertyMirror::TimePos, dPos))
+        return static_cast<qint64>(dPos);
     return  my_get_property(m_handle, "time-pos").value<qint64>();
 
 }
@@ -12,6 +12,8 @@
 #include <xcb/xproto.h>
 #undef Bool
 #include "../../vendor/qthelper.hpp"
+#include "mpv_property_mirror.h"
+#include "runtime_registry.h"
 
 typedef mpv_event *(*mpv_waitEvent)(mpv_handle *ctx, double timeout);
 typedef int (*mpv_set_optionString)(mpv_handle *ctx, const char *name, const char *data);
@@ -31,36 +33,18 @@ typedef mpv_handle *(*mpvCreate)(void);
 typedef int (*mpv_requestLog_messages)(mpv_handle *ctx, const char *min_level);
 typedef int (*mpv_observeProperty)(mpv_handle *mpv, uint64_t reply_userdata,
                                    const char *name, mpv_format format);
-typedef void (*mpv_setWakeup_callback)(mpv_handle *ctx, void (*cb)(void *d), void *d);
+typedef void (*mpv_wakeUp)(mpv_handle *ctx);
 typedef int (*mpvinitialize)(mpv_handle *ctx);
 typedef void (*mpv_freeNode_contents)(mpv_node *node);
 typedef void (*mpv_terminateDestroy)(mpv_handle *ctx);
 
-static QString libPath(const QString &sLib)
-{
-    QDir dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (sLib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(sLib)) {
-        return sLib;
-    } else {
-        list.sort();
-    }
-
-    if(list.size() > 0)
-        return list.last();
-    else
-        return QString();
-}
-
 class MpvHandle
 {
     struct container {
         explicit container(mpv_handle *pHandle) : m_pHandle(pHandle) {}
         ~container()
         {
-            mpv_terminateDestroy func = (mpv_terminateDestroy)QLibrary::resolve(libPath("libmpv.so."), "mpv_terminate_destroy");
+            mpv_terminateDestroy func = (mpv_terminateDestroy)RuntimeRegistry::get().resolve("libmpv.so.", "mpv_terminate_destroy");
             func(m_pHandle);
         }
         mpv_handle *m_pHandle;
@@ -92,6 +76,9 @@ public:
 namespace dmr {
 using namespace mpv::qt;
 class MpvGLWidget;
+class BurstScreenshotWorker;
+class MpvEventThread;
+struct MpvEventData;
 
 //解码模式
 enum DecodeMode {
@@ -118,8 +105,6 @@ class MpvProxy: public Backend
     };
 
 signals:
-    void has_mpv_events();
-
     /**
     * @brief 崩溃检测
     */
@@ -166,8 +151,11 @@ public:
     {
         return true;
     }
-    // polling until current playback ended
-    void pollingEndOfPlayback();
+    /**
+     * @brief 异步结束当前播放，不阻塞界面线程
+     * 在handle_mpv_events中收到MPV_EVENT_END_FILE后切换为Stopped并发出stopCompleted
+     */
+    void requestEndOfPlayback();
     // polling until current playback started
     void pollingStartOfPlayback();
     /**
@@ -384,18 +372,23 @@ protected:
     void showEvent(QShowEvent *pEvent) override;
 
 protected slots:
+    /**
+     * @brief 取出事件线程转换好的事件并处理，在界面线程运行
+     */
     void handle_mpv_events();
-    void stepBurstScreenshot();
+    /**
+     * @brief 连拍工作线程截取到一帧
+     */
+    void onBurstFrameReady(const QImage &frame, qint64 nTime);
     void slotStateChanged();
 
 private:
     mpv_handle *mpv_init();   //初始化mpv
-    void processPropertyChange(mpv_event_property *pEvent);
-    void processLogMessage(mpv_event_log_message *pEvent);
+    void processPropertyChange(MpvPropertyMirror::Property prop);
+    void processLogMessage(const MpvEventData &event);
     QImage takeOneScreenshot();
     void updatePlayingMovieInfo();
     void setState(PlayState state);
-    qint64 nextBurstShootPoint();
     int volumeCorrection(int);
 
     //add by heyi
@@ -406,6 +399,10 @@ private:
                               const QVariant &v, uint64_t tag);
     QVariant my_get_property_variant(mpv_handle *pHandle, const QString &sName);
     QVariant my_command(mpv_handle *pHandle, const QVariant &args);
+    /**
+     * @brief 设置属性后同步刷新镜像，避免设置后立即读取到旧值
+     */
+    void refreshMirror(mpv_handle *pHandle, const QString &sName);
 
 private:
     mpv_waitEvent m_waitEvent;
@@ -419,27 +416,28 @@ private:
     mpv_eventName m_eventName;
     mpvCreate m_creat;
     mpv_requestLog_messages m_requestLogMessage;
-    mpv_setWakeup_callback m_setWakeupCallback;
+    mpv_wakeUp m_wakeup;
     mpvinitialize m_initialize;
     mpv_freeNode_contents m_freeNodecontents;
     void *m_gpuInfo; //解码探测函数指针
 
 
     MpvHandle m_handle;                    //mpv句柄
+    MpvPropertyMirror m_mirror;            //观察属性的快照，读取时不访问mpv
+    MpvEventThread *m_pEventThread;        //mpv事件线程
     MpvGLWidget *m_pMpvGLwidget;           //opengl窗口
     QWidget *m_pParentWidget;
     PlayingMovieInfo m_movieInfo;          //播放过的影片的信息
 
     QString m_sInitVo;                     //初始vo方式
-    QVariant m_posBeforeBurst;             //截图前影片播放位置
     QList<qint64> m_listBurstPoints;       //存储连拍截图截图位置
 
-    qint64 m_nBurstStart;                  //记录连拍截图次数
+    QPointer<BurstScreenshotWorker> m_pBurstWorker; //连拍截图工作线程
 
-    bool m_bPendingSeek;
+    bool m_bPendingSeek;                   //seek已发出，等待MPV_EVENT_PLAYBACK_RESTART
     bool m_bInBurstShotting;               //是否停止连拍截图
 
-    bool m_bPolling;
+    bool m_bPendingStop;                   //停止已发出，等待MPV_EVENT_END_FILE
     bool m_bConnectStateChange;
     bool m_bPauseOnStart;                  //mpv是否在暂停中
     bool m_bIsJingJia;                     //是否在景嘉微平台上
@@ -5,8 +5,22 @@
 
 #include "hwdec_probe.h"
 #include "compositing_manager.h"
+#include "runtime_registry.h"
+#include "startup_scheduler.h"
+#include "media_probe.h"
+
+#define HWDEC_CAPS_FILE "hwdec_capabilities.ini"    //能力表缓存文件
+
 namespace dmr {
 
+/**
+ * @brief 默认的能力表缓存文件，单例构造时应用名尚未设置，使用时再取路径
+ */
+static QString defaultCapabilityFile()
+{
+    return QString("%1/%2").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).arg(HWDEC_CAPS_FILE);
+}
+
 HwdecProbe HwdecProbe::m_ffmpegProbe;
 
 HwdecProbe::HwdecProbe():m_hwDeviceCtx(nullptr)
@@ -25,83 +39,170 @@ HwdecProbe& HwdecProbe::get()
 bool HwdecProbe::isFileCanHwdec(const QUrl& url, QList<QString>& hwList)
 {
     hwList.clear();
-    AVFormatContext *input_ctx = nullptr;
-    int ret = 0;
-
-    // open the input file
-    if (m_avformatOpenInput(&input_ctx, url.toString().toStdString().c_str(), nullptr, nullptr) != 0) {// Cannot open input file
 
+    // 复用导入时的探测结果，不再重新打开文件
+    MediaProbeResultPtr pProbe = MediaProbe::get().probe(url);
+    if (!pProbe->opened || pProbe->hwdecTypes.isEmpty()) {
         return false;
     }
 
-    if (m_avformatFindStreamInfo(input_ctx, nullptr) < 0) { // Cannot find input stream information
-        m_avformatCloseInput(&input_ctx);
-        return false;
+    for (const MediaStreamInfo &stream : pProbe->streams) {
+        RESULT_CONTINUE((stream.type != AVMEDIA_TYPE_VIDEO || stream.codecpar.isNull()))
+
+        // 同类视频流直接使用能力表，未记录时才逐个硬解类型打开解码器
+        const QString sKey = streamCapabilityKey(stream);
+        QVariant value;
+        if (!lookupCapability(sKey, value)) {
+            value = probeStream(stream, pProbe->hwdecTypes);
+            storeCapability(sKey, value);
+        }
+
+        for (const QString &sType : value.toStringList()) {
+            if (!hwList.contains(sType))
+                hwList.push_back(sType);
+        }
     }
 
-    for (AVHWDeviceType type : m_hwTypeList) {
-        for (size_t i = 0; i < input_ctx->nb_streams; i++) {
+    return hwList.size() > 0;
+}
 
-            AVStream *stream = input_ctx->streams[i];
-            AVCodec *dec = m_avcodecFindDecoder(stream->codecpar->codec_id);
-            RESULT_CONTINUE((nullptr == dec))
+bool HwdecProbe::lookupCapability(const QString &sKey, QVariant &value)
+{
+    QMutexLocker lock(&m_capsMutex);
+    loadCapabilities();
 
-            RESULT_CONTINUE(!isTypeHaveHwdec(dec, type))
+    auto it = m_caps.constFind(sKey);
+    if (it == m_caps.constEnd())
+        return false;
 
-            AVCodecContext *codec_ctx = nullptr;
-            codec_ctx = m_avcodecAllocContext3(dec);
-            RESULT_CONTINUE((nullptr == codec_ctx)) // Failed to allocate the decoder context for stream
+    value = it.value();
+    return true;
+}
 
-            ret = m_avcodecParametersToContext(codec_ctx, stream->codecpar);
-            RESULT_CONTINUE((ret < 0)) // Failed to copy decoder parameters to input decoder context for stream
+void HwdecProbe::storeCapability(const QString &sKey, const QVariant &value)
+{
+    QMutexLocker lock(&m_capsMutex);
+    loadCapabilities();
+    m_caps.insert(sKey, value);
 
-            ret = hwDecoderInit(codec_ctx, type);
-            RESULT_CONTINUE((ret < 0))
+    QSettings settings(m_sCapsFile.isEmpty() ? defaultCapabilityFile() : m_sCapsFile, QSettings::IniFormat);
+    settings.setValue(QString("caps/%1").arg(sKey), value);
+}
 
-            if (codec_ctx->codec_type == AVMEDIA_TYPE_VIDEO) {
-                // Open decoder. we think it can decodec when oepn decoder success
-                ret = m_avcodecOpen2(codec_ctx, dec, nullptr);
-                RESULT_CONTINUE((ret < 0))
+QString HwdecProbe::capabilityFile()
+{
+    QMutexLocker lock(&m_capsMutex);
+    return m_sCapsFile.isEmpty() ? defaultCapabilityFile() : m_sCapsFile;
+}
 
-                hwList.push_back(m_avHwdeviceGetTypeName(type));
-                m_avcodecClose(codec_ctx);
-            }
-            m_avcodecFreeContext(&codec_ctx);
-        }
+void HwdecProbe::setCapabilityFile(const QString &sPath)
+{
+    QMutexLocker lock(&m_capsMutex);
+    m_sCapsFile = sPath;
+    m_caps.clear();
+    m_bCapsLoaded = false;
+}
+
+void HwdecProbe::loadCapabilities()
+{
+    if (m_bCapsLoaded)
+        return;
+    m_bCapsLoaded = true;
+
+    const QString sFingerprint = environmentFingerprint();
+    QSettings settings(m_sCapsFile.isEmpty() ? defaultCapabilityFile() : m_sCapsFile, QSettings::IniFormat);
+    if (settings.value("fingerprint").toString() != sFingerprint) {
+        qInfo() << "hwdec capabilities rebuilt for" << sFingerprint;
+        settings.clear();
+        settings.setValue("fingerprint", sFingerprint);
+        return;
     }
 
-    free(input_ctx->streams);
-    input_ctx->streams = nullptr;
-    input_ctx->nb_streams = 0;
-    m_avformatCloseInput(&input_ctx);
+    settings.beginGroup("caps");
+    for (const QString &sKey : settings.childKeys()) {
+        m_caps.insert(sKey, settings.value(sKey));
+    }
+    settings.endGroup();
+}
 
-    if(nullptr != m_hwDeviceCtx)
-        m_avBufferUnref(&m_hwDeviceCtx);
+QString HwdecProbe::environmentFingerprint()
+{
+    QStringList listPart;
+    // 每次启动变化，显卡热插拔、切换独显后重新探测
+    QFile bootId("/proc/sys/kernel/random/boot_id");
+    if (bootId.open(QIODevice::ReadOnly))
+        listPart << QString::fromUtf8(bootId.readAll()).simplified();
 
-    return hwList.size() > 0;
+    listPart << StartupScheduler::driverFingerprint();
+    // 解码库升级后接口和支持的格式都可能变化
+    listPart << CompositingManager::libPath("libavcodec.so") << CompositingManager::libPath("libgpuinfo.so");
+
+    return QString(QCryptographicHash::hash(listPart.join('|').toUtf8(), QCryptographicHash::Md5).toHex());
 }
 
-static QString libPath(const QString &sLib)
+QString HwdecProbe::streamCapabilityKey(const MediaStreamInfo &stream)
 {
-    QDir dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (sLib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(sLib)) {
-        return sLib;
-    } else {
-        list.sort();
+    // 分辨率按常见硬解上限归档，同档位的视频解码能力相同
+    const int nSide = qMax(stream.width, stream.height);
+    int nTier = 0;
+    for (int nLimit : {1920, 4096, 8192}) {
+        if (nSide <= nLimit) {
+            nTier = nLimit;
+            break;
+        }
+    }
+
+    return QString("stream-%1-%2-%3-%4").arg(stream.codecId).arg(stream.profile).arg(stream.format).arg(nTier);
+}
+
+QStringList HwdecProbe::probeStream(const MediaStreamInfo &stream, const QStringList &hwdecTypes)
+{
+    QStringList listType;
+    int ret = 0;
+
+    if (nullptr == m_avcodecFindDecoder) {
+        initffmpegInterface();
+        getHwTypes();
     }
 
-    Q_ASSERT(list.size() > 0);
-    return list.last();
+    AVCodec *dec = m_avcodecFindDecoder(stream.codecId);
+    if (nullptr == dec)
+        return listType;
+
+    for (AVHWDeviceType type : m_hwTypeList) {
+        RESULT_CONTINUE(!hwdecTypes.contains(m_avHwdeviceGetTypeName(type)))
+        RESULT_CONTINUE(!isTypeHaveHwdec(dec, type))
+
+        AVCodecContext *codec_ctx = nullptr;
+        codec_ctx = m_avcodecAllocContext3(dec);
+        RESULT_CONTINUE((nullptr == codec_ctx)) // Failed to allocate the decoder context for stream
+
+        ret = m_avcodecParametersToContext(codec_ctx, stream.codecpar.data());
+        if (ret >= 0) {
+            ret = hwDecoderInit(codec_ctx, type);
+        }
+        if (ret >= 0) {
+            // Open decoder. we think it can decodec when oepn decoder success
+            ret = m_avcodecOpen2(codec_ctx, dec, nullptr);
+            if (ret >= 0) {
+                listType.push_back(m_avHwdeviceGetTypeName(type));
+                m_avcodecClose(codec_ctx);
+            }
+        }
+        m_avcodecFreeContext(&codec_ctx);
+    }
+
+    if(nullptr != m_hwDeviceCtx)
+        m_avBufferUnref(&m_hwDeviceCtx);
+
+    return listType;
 }
 
 void HwdecProbe::initffmpegInterface()
 {
-    QLibrary avcodecLibrary(CompositingManager::libPath("libavcodec.so"));
-    QLibrary avformatLibrary(CompositingManager::libPath("libavformat.so"));
-    QLibrary avutilLibrary(CompositingManager::libPath("libavutil.so"));
+    QLibrary &avcodecLibrary = RuntimeRegistry::get().library("libavcodec.so");
+    QLibrary &avformatLibrary = RuntimeRegistry::get().library("libavformat.so");
+    QLibrary &avutilLibrary = RuntimeRegistry::get().library("libavutil.so");
 
     m_avHwdeviceCtxCreate  = reinterpret_cast<ffmAvHwdeviceCtxCreate>(avutilLibrary.resolve("av_hwdevice_ctx_create"));
     m_avHwdeviceIterateTypes = reinterpret_cast<ffmAvHwdeviceIterateTypes>(avutilLibrary.resolve("av_hwdevice_iterate_types"));
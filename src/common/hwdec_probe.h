@@ -19,6 +19,7 @@ extern "C"
 
 namespace dmr {
 
+    struct MediaStreamInfo;
 
     typedef int (*ffmAvHwdeviceCtxCreate)(AVBufferRef **device_ctx, enum AVHWDeviceType type,
                                            const char *device, AVDictionary *opts, int flags);
@@ -75,6 +76,8 @@ namespace dmr {
 
     /**
      * @file 用于硬解探测的单例类
+     * 解码能力只与编码格式、档次、像素格式和分辨率有关，探测结果记入持久化的能力表，
+     * 能力表在重启、内核或显卡驱动变化后失效重建，同类视频不再重复打开解码器
      */
     class HwdecProbe
     {
@@ -92,9 +95,57 @@ namespace dmr {
          * @return 是返回true,否则返回false
          */
         bool isFileCanHwdec(const QUrl& url, QList<QString>& hwList);
+
+        /**
+         * @brief 查询能力表，可在任意线程调用
+         * @param sKey 能力项
+         * @param out value 记录的探测结果
+         * @return 未记录时返回false
+         */
+        bool lookupCapability(const QString &sKey, QVariant &value);
+
+        /**
+         * @brief 记录探测结果并写入缓存文件
+         * @param sKey 能力项
+         * @param value 探测结果
+         */
+        void storeCapability(const QString &sKey, const QVariant &value);
+
+        /**
+         * @brief 能力表缓存文件
+         */
+        QString capabilityFile();
+
+        /**
+         * @brief 切换能力表缓存文件，之后的查询从新文件重新读取
+         */
+        void setCapabilityFile(const QString &sPath);
     private:
         HwdecProbe();
 
+        /**
+         * @brief 读取缓存文件，环境指纹不一致时清空
+         */
+        void loadCapabilities();
+
+        /**
+         * @brief 当前启动和显卡驱动环境的指纹
+         */
+        static QString environmentFingerprint();
+
+        /**
+         * @brief 视频流的能力项，分辨率按档位归并
+         */
+        static QString streamCapabilityKey(const MediaStreamInfo &stream);
+
+        /**
+         * @brief 逐个硬解类型打开解码器
+         * @param stream 视频流
+         * @param hwdecTypes 解码器声明支持的硬解类型
+         * @return 打开成功的硬解名字
+         */
+        QStringList probeStream(const MediaStreamInfo &stream, const QStringList &hwdecTypes);
+
         /**
          * @brief 初始化接口
          */
@@ -124,6 +175,14 @@ namespace dmr {
     private:
         //单例指针
         static HwdecProbe             m_ffmpegProbe;
+        //保护能力表
+        QMutex                          m_capsMutex;
+        //能力表是否已从缓存文件读取
+        bool                            m_bCapsLoaded {false};
+        //能力表缓存文件，为空时使用缓存目录下的默认文件
+        QString                         m_sCapsFile;
+        //能力项到探测结果
+        QHash<QString, QVariant>        m_caps;
         //硬解设备上下文
         AVBufferRef                     *m_hwDeviceCtx;
         //所有硬解类型
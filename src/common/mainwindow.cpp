@@ -28,6 +28,7 @@
 #include "vendor/presenter.h"
 #include "filefilter.h"
 #include "eventlogutils.h"
+#include "startup_scheduler.h"
 
 //#include <QtWidgets>
 #include <QtDBus>
@@ -894,8 +895,12 @@ MainWindow::MainWindow(QWidget *parent)
         loadPlayList();
     });
 
-    m_pDBus = new QDBusInterface("org.freedesktop.login1", "/org/freedesktop/login1", "org.freedesktop.login1.Manager", QDBusConnection::systemBus());
-    connect(m_pDBus, SIGNAL(PrepareForSleep(bool)), this, SLOT(sleepStateChanged(bool)));
+    //休眠、锁屏和会话状态的监听首帧不需要，窗口显示后再连接系统总线
+    QPointer<QWidget> pWindow(this);
+    StartupScheduler::get().defer("session-monitor", [this, pWindow] {
+        if (pWindow)
+            initSessionMonitor();
+    });
 
     QDBusConnection::sessionBus().connect("com.deepin.dde.shutdownFront", "/com/deepin/dde/lockFront",
                                           "com.deepin.dde.lockFront", "Visible", this,
@@ -909,18 +914,27 @@ MainWindow::MainWindow(QWidget *parent)
     connect(m_pToolbox, &ToolboxProxy::sigMircastState, this, &MainWindow::slotUpdateMircastState);
     connect(m_pMircastShowWidget, &MircastShowWidget::exitMircast, this, &MainWindow::slotExitMircast);
 
+    connect(dynamic_cast<MpvProxy *>(m_pEngine->getMpvProxy()),&MpvProxy::crashCheck,&Settings::get(),&Settings::crashCheck);
+    //解码初始化
+    decodeInit();
+}
+
+void MainWindow::initSessionMonitor()
+{
+    m_pDBus = new QDBusInterface("org.freedesktop.login1", "/org/freedesktop/login1", "org.freedesktop.login1.Manager", QDBusConnection::systemBus());
+    connect(m_pDBus, SIGNAL(PrepareForSleep(bool)), this, SLOT(sleepStateChanged(bool)));
+
     qDBusRegisterMetaType<SessionInfo>();
     qDBusRegisterMetaType<SessionInfoList>();
     QDBusPendingReply<SessionInfoList> reply = m_pDBus->call("ListSessions");
+    if (reply.value().isEmpty())
+        return;
     QString path = reply.value().last().sessionPath.path();
 
     QDBusConnection::systemBus().connect("org.freedesktop.login1", path,
                                          "org.freedesktop.DBus.Properties", "PropertiesChanged", this,
                                          SLOT(slotProperChanged(QString, QVariantMap, QStringList)));
     qInfo() << "session Path is :" << path;
-    connect(dynamic_cast<MpvProxy *>(m_pEngine->getMpvProxy()),&MpvProxy::crashCheck,&Settings::get(),&Settings::crashCheck);
-    //解码初始化
-    decodeInit();
 }
 
 void MainWindow::setupTitlebar()
@@ -2521,7 +2535,7 @@ void MainWindow::onBurstScreenshot(const QImage &frame, qint64 timestamp)
 
         if (frame.isNull()) {
             m_listBurstShoots.clear();
-            if (!m_bPausedBeforeBurst)
+            if (!m_bPausedBeforeBurst && m_pEngine->paused())
                 m_pEngine->pauseResume();
             return;
         }
@@ -2537,7 +2551,7 @@ void MainWindow::onBurstScreenshot(const QImage &frame, qint64 timestamp)
         qInfo() << "BurstScreenshot done";
 
         m_listBurstShoots.clear();
-        if (!m_bPausedBeforeBurst)
+        if (!m_bPausedBeforeBurst && m_pEngine->paused())
             m_pEngine->pauseResume();
 
         if (nRet == QDialog::Accepted) {
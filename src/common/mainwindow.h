@@ -501,6 +501,10 @@ private:
     * @brief 解码初始化
     */
     void decodeInit();
+    /**
+    * @brief 监听休眠和会话状态，首帧绘制后执行
+    */
+    void initSessionMonitor();
     void readSinkInputPath();
     void setAudioVolume(int);
     void setMusicMuted(bool bMuted);
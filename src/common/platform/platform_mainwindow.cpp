@@ -28,6 +28,7 @@
 #include "vendor/presenter.h"
 #include "filefilter.h"
 #include "eventlogutils.h"
+#include "startup_scheduler.h"
 
 //#include <QtWidgets>
 #include <QtDBus>
@@ -932,8 +933,12 @@ Platform_MainWindow::Platform_MainWindow(QWidget *parent)
         loadPlayList();
     });
 
-    m_pDBus = new QDBusInterface("org.freedesktop.login1", "/org/freedesktop/login1", "org.freedesktop.login1.Manager", QDBusConnection::systemBus());
-    connect(m_pDBus, SIGNAL(PrepareForSleep(bool)), this, SLOT(sleepStateChanged(bool)));
+    //休眠、锁屏和会话状态的监听首帧不需要，窗口显示后再连接系统总线
+    QPointer<QWidget> pWindow(this);
+    StartupScheduler::get().defer("session-monitor", [this, pWindow] {
+        if (pWindow)
+            initSessionMonitor();
+    });
 
     QDBusConnection::sessionBus().connect("com.deepin.dde.shutdownFront", "/com/deepin/dde/lockFront",
                                           "com.deepin.dde.lockFront", "Visible", this,
@@ -947,18 +952,27 @@ Platform_MainWindow::Platform_MainWindow(QWidget *parent)
     connect(m_pMircastShowWidget, &MircastShowWidget::exitMircast, this, &Platform_MainWindow::slotExitMircast);
     m_pMovieWidget->windowHandle()->installEventFilter(m_pEventListener);
 
+    connect(dynamic_cast<MpvProxy *>(m_pEngine->getMpvProxy()),&MpvProxy::crashCheck,&Settings::get(),&Settings::crashCheck);
+    //解码初始化
+    decodeInit();
+}
+
+void Platform_MainWindow::initSessionMonitor()
+{
+    m_pDBus = new QDBusInterface("org.freedesktop.login1", "/org/freedesktop/login1", "org.freedesktop.login1.Manager", QDBusConnection::systemBus());
+    connect(m_pDBus, SIGNAL(PrepareForSleep(bool)), this, SLOT(sleepStateChanged(bool)));
+
     qDBusRegisterMetaType<SessionInfo>();
     qDBusRegisterMetaType<SessionInfoList>();
     QDBusPendingReply<SessionInfoList> reply = m_pDBus->call("ListSessions");
+    if (reply.value().isEmpty())
+        return;
     QString path = reply.value().last().sessionPath.path();
 
     QDBusConnection::systemBus().connect("org.freedesktop.login1", path,
                                          "org.freedesktop.DBus.Properties", "PropertiesChanged", this,
                                          SLOT(slotProperChanged(QString, QVariantMap, QStringList)));
     qInfo() << "session Path is :" << path;
-    connect(dynamic_cast<MpvProxy *>(m_pEngine->getMpvProxy()),&MpvProxy::crashCheck,&Settings::get(),&Settings::crashCheck);
-    //解码初始化
-    decodeInit();
 }
 
 void Platform_MainWindow::setupTitlebar()
@@ -2573,7 +2587,7 @@ void Platform_MainWindow::onBurstScreenshot(const QImage &frame, qint64 timestam
 
         if (frame.isNull()) {
             m_listBurstShoots.clear();
-            if (!m_bPausedBeforeBurst)
+            if (!m_bPausedBeforeBurst && m_pEngine->paused())
                 m_pEngine->pauseResume();
             return;
         }
@@ -2589,7 +2603,7 @@ void Platform_MainWindow::onBurstScreenshot(const QImage &frame, qint64 timestam
         qInfo() << "BurstScreenshot done";
 
         m_listBurstShoots.clear();
-        if (!m_bPausedBeforeBurst)
+        if (!m_bPausedBeforeBurst && m_pEngine->paused())
             m_pEngine->pauseResume();
 
         if (nRet == QDialog::Accepted) {
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <dlfcn.h>
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 
 #define SIZE_THRESHOLD (10 * 1<<20)
 
@@ -86,25 +87,9 @@ Platform_ThumbnailWorker::Platform_ThumbnailWorker()
     m_pCharTime = (char *)malloc(20);
 }
 
-QString Platform_ThumbnailWorker::libPath(const QString &strlib)
-{
-    QDir  dir;
-    QString lib_path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(lib_path);
-    QStringList list = dir.entryList(QStringList() << (strlib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(strlib)) {
-        return strlib;
-    } else {
-        list.sort();
-    }
-
-    Q_ASSERT(list.size() > 0);
-    return list.last();
-}
-
 void Platform_ThumbnailWorker::initThumb()
 {
-    QLibrary library(CompositingManager::libPath("libffmpegthumbnailer.so"));
+    QLibrary &library = RuntimeRegistry::get().library("libffmpegthumbnailer.so");
     m_mvideo_thumbnailer = (mvideo_thumbnailer) library.resolve("video_thumbnailer_create");
     m_mvideo_thumbnailer_destroy = (mvideo_thumbnailer_destroy) library.resolve("video_thumbnailer_destroy");
     m_mvideo_thumbnailer_create_image_data = (mvideo_thumbnailer_create_image_data) library.resolve("video_thumbnailer_create_image_data");
@@ -68,7 +68,6 @@ private:
     void run() override;
     void runSingle(QPair<QUrl, int> w);
     QPixmap genThumb(const QUrl &url, int secs);
-    QString libPath(const QString &strlib);
 
 private:
     static std::atomic<Platform_ThumbnailWorker *> m_instance;
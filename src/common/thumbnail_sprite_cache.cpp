@@ -0,0 +1,361 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thumbnail_sprite_cache.h"
+#include "film_strip.h"
+#include "utils.h"
+
+#include <QSaveFile>
+#include <QBuffer>
+
+#define SPRITE_INTERVAL 10                  //预览图间隔(秒)
+#define SPRITE_BUDGET (256 * (1 << 20))     //缓存目录总大小上限
+#define SPRITE_QUALITY 80                   //JPEG压缩质量
+#define SPRITE_MAX_MAPS 4                   //同时映射的图集数量
+#define SPRITE_MAX_HASHES 1024              //缓存的文件哈希数量
+#define SPRITE_MAGIC 0x444d5350             //"DMSP"
+#define SPRITE_VERSION 1
+
+namespace dmr {
+
+/**
+ * @brief 图集文件头，其后是count个SpriteEntry索引和JPEG数据
+ */
+struct SpriteHeader {
+    quint32 nMagic;
+    quint32 nVersion;
+    qint32 nInterval;
+    qint32 nCount;
+};
+
+/**
+ * @brief 单张预览图在文件中的位置，nSize为0表示该时间点解码失败
+ */
+struct SpriteEntry {
+    quint32 nOffset;
+    quint32 nSize;
+};
+
+ThumbnailSpriteBuilder::ThumbnailSpriteBuilder(ThumbnailSpriteCache *pCache)
+    : m_pCache(pCache)
+{
+}
+
+void ThumbnailSpriteBuilder::run()
+{
+    setPriority(QThread::IdlePriority);
+
+    QUrl url;
+    QSize thumbSize;
+    while (m_pCache->takeRequest(url, thumbSize)) {
+        m_pCache->build(url, thumbSize);
+    }
+}
+
+ThumbnailSpriteCache &ThumbnailSpriteCache::get()
+{
+    static ThumbnailSpriteCache cache;
+    return cache;
+}
+
+ThumbnailSpriteCache::ThumbnailSpriteCache()
+{
+    m_sCacheDir = QString("%1/sprites").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+
+    //新生成的图集需要重新检查
+    connect(this, &ThumbnailSpriteCache::spriteReady, this, [ = ](const QUrl & url) {
+        m_missing.remove(url);
+    }, Qt::QueuedConnection);
+}
+
+ThumbnailSpriteCache::~ThumbnailSpriteCache()
+{
+    stop();
+    delete m_pBuilder;
+    for (SpriteMap &map : m_maps) {
+        closeSprite(map);
+    }
+}
+
+int ThumbnailSpriteCache::interval()
+{
+    return SPRITE_INTERVAL;
+}
+
+bool ThumbnailSpriteCache::lookup(const QUrl &url, int secs, QImage &img)
+{
+    if (!url.isLocalFile() || m_missing.contains(url))
+        return false;
+
+    const QString sHash = fileHash(url);
+    if (sHash.isEmpty()) {
+        m_missing.insert(url);
+        return false;
+    }
+
+    auto it = m_maps.find(sHash);
+    if (it == m_maps.end()) {
+        SpriteMap map;
+        bool bOpened = openSprite(spritePath(sHash), map);
+        {
+            //图集可能已被淘汰，允许重新生成
+            QMutexLocker lock(&m_mutex);
+            if (bOpened) {
+                m_built.insert(url);
+            } else {
+                m_built.remove(url);
+            }
+        }
+        if (!bOpened) {
+            m_missing.insert(url);
+            return false;
+        }
+
+        //关闭最久未使用的图集
+        if (m_maps.size() >= SPRITE_MAX_MAPS) {
+            const QString sOldest = m_listMapOrder.takeFirst();
+            closeSprite(m_maps[sOldest]);
+            m_maps.remove(sOldest);
+        }
+        //刷新修改时间作为最近使用时间，供淘汰时排序
+        map.pFile->setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+        it = m_maps.insert(sHash, map);
+    } else {
+        m_listMapOrder.removeOne(sHash);
+    }
+    m_listMapOrder.append(sHash);
+
+    const SpriteMap &map = it.value();
+    const int nIndex = qBound(0, qRound(static_cast<double>(secs) / SPRITE_INTERVAL), map.nCount - 1);
+    const SpriteEntry *pEntry = reinterpret_cast<const SpriteEntry *>(map.pData + sizeof(SpriteHeader)) + nIndex;
+    if (pEntry->nSize == 0 || static_cast<qint64>(pEntry->nOffset) + pEntry->nSize > map.nSize)
+        return false;
+
+    img = QImage::fromData(map.pData + pEntry->nOffset, static_cast<int>(pEntry->nSize), "JPG");
+    return !img.isNull();
+}
+
+void ThumbnailSpriteCache::prepare(const QList<QUrl> &listUrl, const QSize &thumbSize)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_quit.load())
+        return;
+
+    m_thumbSize = thumbSize;
+    //新请求的文件按顺序排到队首，已在队列中的文件移到前面，已生成或已映射的跳过
+    QList<QUrl> listQueue;
+    QSet<QUrl> setFront;
+    for (const QUrl &url : listUrl) {
+        if (!url.isLocalFile() || m_built.contains(url) || setFront.contains(url))
+            continue;
+        setFront.insert(url);
+        listQueue.append(url);
+    }
+    if (listQueue.isEmpty())
+        return;
+
+    for (const QUrl &url : m_listQueue) {
+        if (!setFront.contains(url))
+            listQueue.append(url);
+    }
+    m_listQueue = listQueue;
+
+    if (!m_pBuilder) {
+        m_pBuilder = new ThumbnailSpriteBuilder(this);
+        m_pBuilder->start();
+    }
+    m_cond.wakeOne();
+}
+
+void ThumbnailSpriteCache::stop()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_quit.store(1);
+        m_listQueue.clear();
+        m_cond.wakeAll();
+    }
+
+    if (m_pBuilder) {
+        m_pBuilder->wait();
+    }
+}
+
+QString ThumbnailSpriteCache::cacheDir() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_sCacheDir;
+}
+
+void ThumbnailSpriteCache::setCacheDir(const QString &sDir)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_sCacheDir = sDir;
+        m_built.clear();
+    }
+
+    for (SpriteMap &map : m_maps) {
+        closeSprite(map);
+    }
+    m_maps.clear();
+    m_listMapOrder.clear();
+    m_missing.clear();
+}
+
+QString ThumbnailSpriteCache::spritePath(const QString &sHash) const
+{
+    return QString("%1/%2.sprite").arg(cacheDir()).arg(sHash);
+}
+
+QString ThumbnailSpriteCache::fileHash(const QUrl &url)
+{
+    QFileInfo fi(url.toLocalFile());
+    if (!fi.exists())
+        return QString();
+
+    const QString sKey = QString("%1|%2|%3").arg(fi.absoluteFilePath()).arg(fi.size())
+                         .arg(fi.lastModified().toMSecsSinceEpoch());
+    auto it = m_hashes.find(sKey);
+    if (it == m_hashes.end()) {
+        if (m_hashes.size() >= SPRITE_MAX_HASHES)
+            m_hashes.clear();
+        it = m_hashes.insert(sKey, utils::FastFileHash(fi));
+    }
+    return it.value();
+}
+
+bool ThumbnailSpriteCache::openSprite(const QString &sPath, SpriteMap &map) const
+{
+    QFile *pFile = new QFile(sPath);
+    if (!pFile->open(QIODevice::ReadOnly) || pFile->size() < static_cast<qint64>(sizeof(SpriteHeader))) {
+        delete pFile;
+        return false;
+    }
+
+    const uchar *pData = pFile->map(0, pFile->size());
+    const SpriteHeader *pHeader = reinterpret_cast<const SpriteHeader *>(pData);
+    if (!pData || pHeader->nMagic != SPRITE_MAGIC || pHeader->nVersion != SPRITE_VERSION
+            || pHeader->nInterval != SPRITE_INTERVAL || pHeader->nCount <= 0
+            || static_cast<qint64>(sizeof(SpriteHeader) + sizeof(SpriteEntry) * static_cast<size_t>(pHeader->nCount)) > pFile->size()) {
+        delete pFile;
+        return false;
+    }
+
+    map.pFile = pFile;
+    map.pData = pData;
+    map.nSize = pFile->size();
+    map.nCount = pHeader->nCount;
+    return true;
+}
+
+void ThumbnailSpriteCache::closeSprite(SpriteMap &map) const
+{
+    //QFile析构时解除映射
+    delete map.pFile;
+    map = SpriteMap();
+}
+
+bool ThumbnailSpriteCache::takeRequest(QUrl &url, QSize &thumbSize)
+{
+    QMutexLocker lock(&m_mutex);
+    while (m_listQueue.isEmpty() && !m_quit.load()) {
+        m_cond.wait(lock.mutex());
+    }
+
+    if (m_quit.load())
+        return false;
+
+    url = m_listQueue.takeFirst();
+    thumbSize = m_thumbSize;
+    return true;
+}
+
+void ThumbnailSpriteCache::build(const QUrl &url, const QSize &thumbSize)
+{
+    QFileInfo fi(url.toLocalFile());
+    const QString sHash = fi.exists() ? utils::FastFileHash(fi) : QString();
+    if (sHash.isEmpty())
+        return;
+
+    const QString sPath = spritePath(sHash);
+    if (QFile::exists(sPath)) {
+        QMutexLocker lock(&m_mutex);
+        m_built.insert(url);
+        return;
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int nCount = 0;
+    QList<QByteArray> listTiles;
+    const int nDecoded = FilmStrip::get().walkKeyFrames(fi, [&nCount](double dDuration) {
+        QList<double> listSecs;
+        for (int i = 0; i * SPRITE_INTERVAL <= dDuration; i++) {
+            listSecs.append(i * SPRITE_INTERVAL);
+        }
+        nCount = listSecs.size();
+        return listSecs;
+    }, thumbSize, [&listTiles](int nIndex, const QImage &frame) {
+        while (listTiles.size() < nIndex) {
+            listTiles.append(QByteArray());
+        }
+        QByteArray bytes;
+        QBuffer buf(&bytes);
+        buf.open(QIODevice::WriteOnly);
+        frame.save(&buf, "JPG", SPRITE_QUALITY);
+        listTiles.append(bytes);
+        return true;
+    }, [this]() {
+        return m_quit.load() != 0;
+    });
+
+    if (nDecoded <= 0 || m_quit.load())
+        return;
+    while (listTiles.size() < nCount) {
+        listTiles.append(QByteArray());
+    }
+
+    QDir().mkpath(cacheDir());
+    QSaveFile file(sPath);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+
+    SpriteHeader header {SPRITE_MAGIC, SPRITE_VERSION, SPRITE_INTERVAL, nCount};
+    file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    quint32 nOffset = static_cast<quint32>(sizeof(SpriteHeader) + sizeof(SpriteEntry) * static_cast<size_t>(nCount));
+    for (const QByteArray &tile : listTiles) {
+        SpriteEntry entry {nOffset, static_cast<quint32>(tile.size())};
+        file.write(reinterpret_cast<const char *>(&entry), sizeof(entry));
+        nOffset += static_cast<quint32>(tile.size());
+    }
+    for (const QByteArray &tile : listTiles) {
+        file.write(tile);
+    }
+    if (!file.commit())
+        return;
+
+    qInfo() << "thumbnail sprite generated(ms):" << timer.elapsed() << "count:" << nCount << fi.fileName();
+    {
+        QMutexLocker lock(&m_mutex);
+        m_built.insert(url);
+    }
+    evict();
+    emit spriteReady(url);
+}
+
+void ThumbnailSpriteCache::evict()
+{
+    QDir dir(cacheDir());
+    QFileInfoList listSprite = dir.entryInfoList(QStringList() << "*.sprite", QDir::Files, QDir::Time);
+    qint64 nTotal = 0;
+    for (const QFileInfo &fi : listSprite) {
+        nTotal += fi.size();
+        if (nTotal > SPRITE_BUDGET) {
+            QFile::remove(fi.absoluteFilePath());
+        }
+    }
+}
+
+}
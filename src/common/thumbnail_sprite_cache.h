@@ -0,0 +1,126 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_THUMBNAIL_SPRITE_CACHE_H
+#define _DMR_THUMBNAIL_SPRITE_CACHE_H
+
+#include <QtCore>
+#include <QImage>
+
+namespace dmr {
+
+class ThumbnailSpriteCache;
+
+/**
+ * @brief The ThumbnailSpriteBuilder class
+ * 预生成线程，按队列顺序逐个文件生成预览图集
+ */
+class ThumbnailSpriteBuilder: public QThread
+{
+public:
+    explicit ThumbnailSpriteBuilder(ThumbnailSpriteCache *pCache);
+
+protected:
+    void run() override;
+
+private:
+    ThumbnailSpriteCache *m_pCache {nullptr};
+};
+
+/**
+ * @file 悬停预览图集的磁盘缓存
+ * 后台为每个文件按固定间隔生成一组预览图，JPEG压缩后连同索引写入缓存目录的一个文件，
+ * 以utils::FastFileHash为键，总大小超出预算时删除最久未使用的文件。
+ * 悬停查询通过内存映射直接读取对应的预览图，不再解码视频
+ */
+class ThumbnailSpriteCache: public QObject
+{
+    Q_OBJECT
+    friend class ThumbnailSpriteBuilder;
+public:
+    static ThumbnailSpriteCache &get();
+    ~ThumbnailSpriteCache();
+
+    /**
+     * @brief 预览图间隔(秒)
+     */
+    static int interval();
+    /**
+     * @brief 查询预览图，只能在界面线程调用
+     * @param url 文件路径
+     * @param secs 时间点，取最近的预览图
+     * @param img 输出的预览图
+     * @return 没有图集时返回false
+     */
+    bool lookup(const QUrl &url, int secs, QImage &img);
+    /**
+     * @brief 将文件加入预生成队列，已生成过图集或已映射的文件会跳过，只能在界面线程调用
+     * @param listUrl 本地文件，排在前面的先生成，调用方应只传入少量文件
+     * @param thumbSize 预览图像素尺寸
+     */
+    void prepare(const QList<QUrl> &listUrl, const QSize &thumbSize);
+    void stop();
+    /**
+     * @brief 图集缓存目录
+     */
+    QString cacheDir() const;
+    /**
+     * @brief 切换图集缓存目录，已映射的图集随之关闭
+     */
+    void setCacheDir(const QString &sDir);
+
+signals:
+    /**
+     * @brief 某个文件的图集生成完成
+     */
+    void spriteReady(const QUrl &url);
+
+private:
+    struct SpriteMap {
+        QFile *pFile {nullptr};
+        const uchar *pData {nullptr};
+        qint64 nSize {0};
+        int nCount {0};
+    };
+
+    ThumbnailSpriteCache();
+    QString spritePath(const QString &sHash) const;
+    /**
+     * @brief 文件的FastFileHash，按(路径, 大小, 修改时间)缓存，文件变化后重新计算
+     */
+    QString fileHash(const QUrl &url);
+    /**
+     * @brief 映射图集文件并校验文件头，失败返回false
+     */
+    bool openSprite(const QString &sPath, SpriteMap &map) const;
+    void closeSprite(SpriteMap &map) const;
+    /**
+     * @brief 预生成线程取下一个文件，队列为空时阻塞等待，退出时返回false
+     */
+    bool takeRequest(QUrl &url, QSize &thumbSize);
+    void build(const QUrl &url, const QSize &thumbSize);
+    /**
+     * @brief 按最近使用时间淘汰图集，直到总大小不超出预算
+     */
+    void evict();
+
+private:
+    mutable QMutex m_mutex;
+    QWaitCondition m_cond;
+    QList<QUrl> m_listQueue;
+    QSet<QUrl> m_built;                //已生成或已映射图集的文件，不再加入队列
+    QSize m_thumbSize;
+    QString m_sCacheDir;
+    QAtomicInt m_quit {0};
+    ThumbnailSpriteBuilder *m_pBuilder {nullptr};
+
+    QHash<QString, QString> m_hashes;  //(路径, 大小, 修改时间)对应的FastFileHash，界面线程使用
+    QHash<QString, SpriteMap> m_maps;  //以FastFileHash为键的已映射图集，界面线程使用
+    QList<QString> m_listMapOrder;     //已映射图集的使用顺序，最近使用的在末尾
+    QSet<QUrl> m_missing;              //没有图集的文件，避免每次悬停都访问磁盘
+};
+
+}
+
+#endif /* ifndef _DMR_THUMBNAIL_SPRITE_CACHE_H */
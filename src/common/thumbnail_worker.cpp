@@ -4,14 +4,19 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "thumbnail_worker.h"
+#include "thumbnail_sprite_cache.h"
 #include "player_engine.h"
 #include <QLibrary>
 #include <stdio.h>
 #include <stdlib.h>
 #include <dlfcn.h>
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 
-#define SIZE_THRESHOLD (10 * 1<<20)
+#define SIZE_THRESHOLD (32 * 1<<20)
+#define MAX_DECODERS 4
+#define BUCKET_SECS 2
+#define DECODER_STOP_TIMEOUT 2000   //等待解码线程退出的总时长(ms)
 
 namespace dmr {
 std::atomic<ThumbnailWorker *> ThumbnailWorker::m_instance(nullptr);
@@ -19,9 +24,34 @@ QMutex ThumbnailWorker::m_instLock;
 QMutex ThumbnailWorker::m_thumbLock;
 QWaitCondition ThumbnailWorker::m_cond;
 
+ThumbnailDecoder::ThumbnailDecoder(ThumbnailWorker *pWorker, video_thumbnailer *pThumbnailer)
+    : m_pWorker(pWorker), m_video_thumbnailer(pThumbnailer)
+{
+}
+
+ThumbnailDecoder::~ThumbnailDecoder()
+{
+    if (m_video_thumbnailer) {
+        m_pWorker->m_mvideo_thumbnailer_destroy(m_video_thumbnailer);
+    }
+}
+
+void ThumbnailDecoder::run()
+{
+    setPriority(QThread::IdlePriority);
+
+    ThumbnailWorker::ThumbRequest req;
+    while (m_pWorker->takeRequest(req)) {
+        auto pm = m_pWorker->genThumb(m_video_thumbnailer, m_seekTime, req.key.first, req.key.second);
+        m_pWorker->finishRequest(req, pm);
+    }
+}
+
 ThumbnailWorker::~ThumbnailWorker()
 {
-    free(m_pCharTime);
+    stop();
+    qDeleteAll(m_decoders);
+    m_decoders.clear();
     if (m_video_thumbnailer) {
         m_mvideo_thumbnailer_destroy(m_video_thumbnailer);
     }
@@ -39,13 +69,15 @@ ThumbnailWorker &ThumbnailWorker::get()
     return *m_instance;
 }
 
+int ThumbnailWorker::bucketOf(int secs)
+{
+    return secs - secs % BUCKET_SECS;
+}
+
 bool ThumbnailWorker::isThumbGenerated(const QUrl &url, int secs)
 {
     QMutexLocker lock(&m_thumbLock);
-    if (!_cache.contains(url)) return false;
-
-    const auto &l = _cache[url];
-    return l.contains(secs);
+    return _cache.contains(qMakePair(url, bucketOf(secs)));
 }
 
 QPixmap ThumbnailWorker::getThumb(const QUrl &url, int secs)
@@ -53,8 +85,10 @@ QPixmap ThumbnailWorker::getThumb(const QUrl &url, int secs)
     QMutexLocker lock(&m_thumbLock);
     QPixmap pm;
 
-    if (_cache.contains(url)) {
-        pm = _cache[url].value(secs);
+    //object()会刷新lru顺序
+    QPixmap *pCached = _cache.object(qMakePair(url, bucketOf(secs)));
+    if (pCached) {
+        pm = *pCached;
     }
 
     return pm;
@@ -65,46 +99,129 @@ void ThumbnailWorker::setPlayerEngine(PlayerEngine *pPlayerEngline)
     _engine = pPlayerEngline;
 }
 
-void ThumbnailWorker::requestThumb(const QUrl &url, int secs)
+/**
+ * @brief start 按cpu核数创建解码线程池
+ */
+void ThumbnailWorker::start()
 {
-    if(CompositingManager::get().platform() != Platform::Mips) {
-        if (m_thumbLock.tryLock()) {
-            _wq.push_front(qMakePair(url, secs));
-            m_cond.wakeOne();
-            m_thumbLock.unlock();
-        }
-    } else {
-        runSingle(qMakePair(url, secs));
+    if (!m_decoders.isEmpty() || !m_video_thumbnailer)
+        return;
+
+    int nCount = qBound(1, QThread::idealThreadCount() / 2, MAX_DECODERS);
+    for (int i = 0; i < nCount; i++) {
+        video_thumbnailer *pThumbnailer = createThumbnailer();
+        if (!pThumbnailer)
+            break;
+
+        ThumbnailDecoder *pDecoder = new ThumbnailDecoder(this, pThumbnailer);
+        m_decoders.append(pDecoder);
+        pDecoder->start();
     }
+    qInfo() << "thumbnail decoders:" << m_decoders.size();
 }
 
-ThumbnailWorker::ThumbnailWorker()
+void ThumbnailWorker::stop()
 {
-    initThumb();
-    m_video_thumbnailer->thumbnail_size = m_video_thumbnailer->thumbnail_size * qApp->devicePixelRatio();
+    {
+        QMutexLocker lock(&m_thumbLock);
+        _quit.store(1);
+        _wq.clear();
+        m_cond.wakeAll();
+    }
 
-    m_pCharTime = (char *)malloc(20);
+    //ffmpegthumbnailer的解码无法中断，超时仍未退出的线程不再等待，也不能删除，
+    //改为在其结束后自行释放。单例不会析构，这些线程仍可安全访问本对象
+    QElapsedTimer timer;
+    timer.start();
+    for (auto it = m_decoders.begin(); it != m_decoders.end();) {
+        ThumbnailDecoder *pDecoder = *it;
+        const qint64 nRemain = qMax<qint64>(0, DECODER_STOP_TIMEOUT - timer.elapsed());
+        if (pDecoder->wait(static_cast<unsigned long>(nRemain))) {
+            ++it;
+            continue;
+        }
+
+        qWarning() << "thumbnail decoder is still busy, detach it";
+        connect(pDecoder, &QThread::finished, pDecoder, &QObject::deleteLater);
+        if (pDecoder->isFinished())
+            pDecoder->deleteLater();
+        it = m_decoders.erase(it);
+    }
+    ThumbnailSpriteCache::get().stop();
 }
 
-QString ThumbnailWorker::libPath(const QString &strlib)
+/**
+ * @brief prepareSprites 后台为文件预生成悬停预览图集
+ */
+void ThumbnailWorker::prepareSprites(const QList<QUrl> &listUrl)
+{
+    ThumbnailSpriteCache::get().prepare(listUrl, thumbSize() * qApp->devicePixelRatio());
+}
+
+/**
+ * @brief requestThumb 请求缩略图，最新的请求优先处理
+ * 有预生成的图集时直接读取，否则切换文件时丢弃旧文件的请求，队列超过上限时丢弃最旧的请求
+ */
+void ThumbnailWorker::requestThumb(const QUrl &url, int secs)
 {
-    QDir  dir;
-    QString lib_path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(lib_path);
-    QStringList list = dir.entryList(QStringList() << (strlib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(strlib)) {
-        return strlib;
-    } else {
-        list.sort();
+    QImage img;
+    if (!isThumbGenerated(url, secs) && ThumbnailSpriteCache::get().lookup(url, secs, img)) {
+        auto dpr = qApp->devicePixelRatio();
+        QPixmap pm = QPixmap::fromImage(img);
+        pm.setDevicePixelRatio(dpr);
+        finishRequest({qMakePair(url, bucketOf(secs)), secs}, pm);
+        return;
+    }
+
+    if (m_decoders.isEmpty()) {
+        runSingle(url, secs);
+        return;
+    }
+
+    ThumbKey key = qMakePair(url, bucketOf(secs));
+
+    QMutexLocker lock(&m_thumbLock);
+    if (_quit.load())
+        return;
+
+    if (_cache.contains(key)) {
+        lock.unlock();
+        emit thumbGenerated(url, secs);
+        return;
+    }
+
+    for (auto it = _wq.begin(); it != _wq.end();) {
+        if (it->key.first != url || it->key == key) {
+            it = _wq.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (!_inflight.contains(key)) {
+        _wq.push_front({key, secs});
+    }
+
+    //一次hover移动只需要最近的若干个位置，更早的请求直接取消
+    while (_wq.size() > m_decoders.size() * 2) {
+        _wq.removeLast();
     }
 
-    Q_ASSERT(list.size() > 0);
-    return list.last();
+    m_cond.wakeOne();
 }
 
-void ThumbnailWorker::initThumb()
+ThumbnailWorker::ThumbnailWorker()
 {
-    QLibrary library(CompositingManager::libPath("libffmpegthumbnailer.so"));
+    _cache.setMaxCost(SIZE_THRESHOLD);
+
+    if (initThumb()) {
+        m_video_thumbnailer = createThumbnailer();
+    }
+}
+
+bool ThumbnailWorker::initThumb()
+{
+    QLibrary &library = RuntimeRegistry::get().library("libffmpegthumbnailer.so");
     m_mvideo_thumbnailer = (mvideo_thumbnailer) library.resolve("video_thumbnailer_create");
     m_mvideo_thumbnailer_destroy = (mvideo_thumbnailer_destroy) library.resolve("video_thumbnailer_destroy");
     m_mvideo_thumbnailer_create_image_data = (mvideo_thumbnailer_create_image_data) library.resolve("video_thumbnailer_create_image_data");
@@ -114,114 +231,97 @@ void ThumbnailWorker::initThumb()
     if (m_mvideo_thumbnailer == nullptr || m_mvideo_thumbnailer_destroy == nullptr
             || m_mvideo_thumbnailer_create_image_data == nullptr || m_mvideo_thumbnailer_destroy_image_data == nullptr
             || m_mvideo_thumbnailer_generate_thumbnail_to_buffer == nullptr) {
-        return;
+        return false;
     }
 
-    m_video_thumbnailer = m_mvideo_thumbnailer();
+    return true;
 }
 
-QPixmap ThumbnailWorker::genThumb(const QUrl &url, int secs)
+video_thumbnailer *ThumbnailWorker::createThumbnailer()
 {
-    auto dpr = qApp->devicePixelRatio();
-    QPixmap pm;
-    pm.setDevicePixelRatio(dpr);
+    if (!m_mvideo_thumbnailer)
+        return nullptr;
 
-    if (m_image_data == nullptr) {
-        m_image_data = m_mvideo_thumbnailer_create_image_data();
+    video_thumbnailer *pThumbnailer = m_mvideo_thumbnailer();
+    if (pThumbnailer) {
+        pThumbnailer->thumbnail_size = static_cast<int>(pThumbnailer->thumbnail_size * qApp->devicePixelRatio());
     }
+    return pThumbnailer;
+}
 
-    QTime d(0, 0, 0);
-    d = d.addSecs(secs);
-    //memset(m_pChTime,0,strlen(m_pChTime));
-    strcpy(m_pCharTime, d.toString("hh:mm:ss").toLatin1().data());
-    m_video_thumbnailer->seek_time = m_pCharTime;
-    auto file = QFileInfo(url.toLocalFile()).absoluteFilePath();
-    try {
-        m_mvideo_thumbnailer_generate_thumbnail_to_buffer(m_video_thumbnailer, file.toUtf8().data(),  m_image_data);
-        auto img = QImage::fromData(m_image_data->image_data_ptr, static_cast<int>(m_image_data->image_data_size), "png");
-
-        pm = QPixmap::fromImage(img.scaled(thumbSize() * dpr, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation));
-        pm.setDevicePixelRatio(dpr);
-    } catch (const std::logic_error &e) {
+bool ThumbnailWorker::takeRequest(ThumbRequest &req)
+{
+    QMutexLocker lock(&m_thumbLock);
+    while (_wq.isEmpty() && !_quit.load()) {
+        m_cond.wait(lock.mutex());
     }
 
-    m_mvideo_thumbnailer_destroy_image_data(m_image_data);
-    m_image_data = nullptr;
+    if (_quit.load())
+        return false;
 
-    return pm;
+    req = _wq.takeFirst();
+    _inflight.insert(req.key);
+    return true;
 }
 
-//cppcheck 误报
-void ThumbnailWorker::run()
+void ThumbnailWorker::finishRequest(const ThumbRequest &req, const QPixmap &pm)
 {
-    setPriority(QThread::IdlePriority);
-    while (!_quit.load()) {
-
-        QPair<QUrl, int> w;
-        {
-            QMutexLocker lock(&m_thumbLock);
-            while (_wq.isEmpty() && !_quit.load()) {
-                m_cond.wait(lock.mutex(), 40);
-            }
-
-            if (!_wq.isEmpty()) {
-                w = _wq.takeFirst();
-                _wq.clear();
-            }
-        }
+    {
+        QMutexLocker lock(&m_thumbLock);
+        _inflight.remove(req.key);
+        //QCache按cost逐个淘汰最久未使用的缩略图
+        int nCost = qMax(1, pm.width() * pm.height() * pm.depth() / 8);
+        _cache.insert(req.key, new QPixmap(pm), nCost);
+    }
 
-        if (_quit.load()) break;
+    QTime d(0, 0, 0);
+    d = d.addSecs(req.key.second);
+    qInfo() << "thumb for " << req.key.first << d.toString("hh:mm:ss");
 
-        {
-            QMutexLocker lock(&m_thumbLock);
-            //TODO: optimize: need a lru map
-            if (_cacheSize > SIZE_THRESHOLD) {
-                qInfo() << "thumb cache size exceeds maximum, clean up";
-                _cache.clear();
-                _cacheSize = 0;
-            }
-        }
+    emit thumbGenerated(req.key.first, req.secs);
+}
 
-        if (!isThumbGenerated(w.first, w.second)) {
-            auto pm = genThumb(w.first, w.second);
+QPixmap ThumbnailWorker::genThumb(video_thumbnailer *pThumbnailer, QByteArray &seekTime, const QUrl &url, int secs)
+{
+    auto dpr = qApp->devicePixelRatio();
+    QPixmap pm;
+    pm.setDevicePixelRatio(dpr);
 
-            QMutexLocker lock(&m_thumbLock);
-            _cache[w.first].insert(w.second, pm);
-            _cacheSize += pm.width() * pm.height() * (pm.hasAlpha() ? 4 : 3);
+    if (!pThumbnailer)
+        return pm;
 
-            QTime d(0, 0, 0);
-            d = d.addSecs(w.second);
-            qInfo() << "thumb for " << w.first << d.toString("hh:mm:ss");
-        }
+    image_data *pImageData = m_mvideo_thumbnailer_create_image_data();
+
+    QTime d(0, 0, 0);
+    d = d.addSecs(secs);
+    //seek_time只保存指针，生成期间需保证缓冲区有效
+    seekTime = d.toString("hh:mm:ss").toLatin1();
+    pThumbnailer->seek_time = seekTime.data();
+    auto file = QFileInfo(url.toLocalFile()).absoluteFilePath();
+    try {
+        m_mvideo_thumbnailer_generate_thumbnail_to_buffer(pThumbnailer, file.toUtf8().data(), pImageData);
+        auto img = QImage::fromData(pImageData->image_data_ptr, static_cast<int>(pImageData->image_data_size), "png");
 
-        emit thumbGenerated(w.first, w.second);
+        pm = QPixmap::fromImage(img.scaled(thumbSize() * dpr, Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation));
+        pm.setDevicePixelRatio(dpr);
+    } catch (const std::logic_error &e) {
     }
 
-    _wq.clear();
+    m_mvideo_thumbnailer_destroy_image_data(pImageData);
+
+    return pm;
 }
 
-void ThumbnailWorker::runSingle(QPair<QUrl, int> w)
+void ThumbnailWorker::runSingle(const QUrl &url, int secs)
 {
-    if (_cacheSize > SIZE_THRESHOLD) {
-        qInfo() << "thumb cache size exceeds maximum, clean up";
-        _cache.clear();
-        _cacheSize = 0;
-    }
+    ThumbRequest req {qMakePair(url, bucketOf(secs)), secs};
 
-    if (!isThumbGenerated(w.first, w.second)) {
-        auto pm = genThumb(w.first, w.second);
-
-        QMutexLocker lock(&m_thumbLock);
-        _cache[w.first].insert(w.second, pm);
-        _cacheSize += pm.width() * pm.height() * (pm.hasAlpha() ? 4 : 3);
-
-        QTime d(0, 0, 0);
-        d = d.addSecs(w.second);
-        qInfo() << "thumb for " << w.first << d.toString("hh:mm:ss");
+    if (!isThumbGenerated(url, secs)) {
+        auto pm = genThumb(m_video_thumbnailer, m_seekTime, req.key.first, req.key.second);
+        finishRequest(req, pm);
+        return;
     }
 
-    emit thumbGenerated(w.first, w.second);
+    emit thumbGenerated(url, secs);
 }
 }
-
-
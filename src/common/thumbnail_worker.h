@@ -22,10 +22,36 @@ namespace dmr {
 //using namespace ffmpegthumbnailer;
 
 class PlayerEngine;
+class ThumbnailWorker;
 
-class ThumbnailWorker: public QThread
+/**
+ * @brief ThumbKey 缩略图缓存键：文件url + 时间分桶
+ */
+using ThumbKey = QPair<QUrl, int>;
+
+/**
+ * @brief The ThumbnailDecoder class
+ * 解码线程，每个线程持有独立的ffmpegthumbnailer实例，从ThumbnailWorker的队列中取任务
+ */
+class ThumbnailDecoder: public QThread
+{
+public:
+    ThumbnailDecoder(ThumbnailWorker *pWorker, video_thumbnailer *pThumbnailer);
+    ~ThumbnailDecoder();
+
+protected:
+    void run() override;
+
+private:
+    ThumbnailWorker *m_pWorker {nullptr};
+    video_thumbnailer *m_video_thumbnailer {nullptr};
+    QByteArray m_seekTime;
+};
+
+class ThumbnailWorker: public QObject
 {
     Q_OBJECT
+    friend class ThumbnailDecoder;
 public:
     ~ThumbnailWorker();
     static ThumbnailWorker &get();
@@ -34,14 +60,20 @@ public:
     {
         return {178, 101};
     }
+    /**
+     * @brief bucketOf 将秒数映射到缓存分桶，同一分桶内的预览共用一张缩略图
+     */
+    static int bucketOf(int secs);
     bool isThumbGenerated(const QUrl &url, int secs);
     QPixmap getThumb(const QUrl &url, int secs);
-    void stop()
+    void start();
+    void stop();
+    void prepareSprites(const QList<QUrl> &listUrl);
+    void setPlayerEngine(PlayerEngine *pPlayerEngline);
+    int decoderCount() const
     {
-        _quit.store(1);
-        quit();
+        return m_decoders.size();
     }
-    void setPlayerEngine(PlayerEngine *pPlayerEngline);
 public slots:
     void requestThumb(const QUrl &url, int secs);
 
@@ -49,26 +81,35 @@ signals:
     void thumbGenerated(const QUrl &url, int secs);
 
 private:
-    QList<QPair<QUrl, int>> _wq;
-    QHash<QUrl, QMap<int, QPixmap>> _cache;
+    struct ThumbRequest {
+        ThumbKey key;
+        int secs;
+    };
+
+    QList<ThumbRequest> _wq;
+    QSet<ThumbKey> _inflight;
+    QCache<ThumbKey, QPixmap> _cache;
     QAtomicInt _quit{0};
-    qint64 _cacheSize {0};
-    video_thumbnailer *m_video_thumbnailer = nullptr;
-    image_data *m_image_data = nullptr;
     PlayerEngine *_engine {nullptr};
+    QList<ThumbnailDecoder *> m_decoders;
+    video_thumbnailer *m_video_thumbnailer = nullptr;
+    QByteArray m_seekTime;
     mvideo_thumbnailer m_mvideo_thumbnailer = nullptr;
     mvideo_thumbnailer_destroy m_mvideo_thumbnailer_destroy = nullptr;
     mvideo_thumbnailer_create_image_data m_mvideo_thumbnailer_create_image_data = nullptr;
     mvideo_thumbnailer_destroy_image_data m_mvideo_thumbnailer_destroy_image_data = nullptr;
     mvideo_thumbnailer_generate_thumbnail_to_buffer m_mvideo_thumbnailer_generate_thumbnail_to_buffer = nullptr;
-    char *m_pCharTime;
 
     ThumbnailWorker();
-    void initThumb();
-    void run() override;
-    void runSingle(QPair<QUrl, int> w);
-    QPixmap genThumb(const QUrl &url, int secs);
-    QString libPath(const QString &strlib);
+    bool initThumb();
+    video_thumbnailer *createThumbnailer();
+    /**
+     * @brief takeRequest 解码线程取下一个任务，队列为空时阻塞等待，退出时返回false
+     */
+    bool takeRequest(ThumbRequest &req);
+    void finishRequest(const ThumbRequest &req, const QPixmap &pm);
+    void runSingle(const QUrl &url, int secs);
+    QPixmap genThumb(video_thumbnailer *pThumbnailer, QByteArray &seekTime, const QUrl &url, int secs);
 
 private:
     static std::atomic<ThumbnailWorker *> m_instance;
@@ -7,6 +7,7 @@
 
 #include <QTcpSocket>
 #include <QHostAddress>
+#include <QTimer>
 
 #include "http_parser.h"
 #include "qhttprequest.h"
@@ -14,12 +15,16 @@
 
 /// @cond nodoc
 
+// Idle time after which a kept-alive connection is closed.
+static const int KEEP_ALIVE_TIMEOUT = 30 * 1000;
+
 QHttpConnection::QHttpConnection(QTcpSocket *socket, QObject *parent)
     : QObject(parent),
       m_socket(socket),
       m_parser(0),
       m_parserSettings(0),
       m_request(0),
+      m_idleTimer(0),
       m_transmitLen(0),
       m_transmitPos(0)
 {
@@ -40,6 +45,13 @@ QHttpConnection::QHttpConnection(QTcpSocket *socket, QObject *parent)
     connect(socket, SIGNAL(readyRead()), this, SLOT(parseRequest()));
     connect(socket, SIGNAL(disconnected()), this, SLOT(socketDisconnected()));
     connect(socket, SIGNAL(bytesWritten(qint64)), this, SLOT(updateWriteCount(qint64)));
+    connect(socket, SIGNAL(bytesWritten(qint64)), this, SIGNAL(bytesWritten(qint64)));
+
+    m_idleTimer = new QTimer(this);
+    m_idleTimer->setSingleShot(true);
+    m_idleTimer->setInterval(KEEP_ALIVE_TIMEOUT);
+    connect(m_idleTimer, SIGNAL(timeout()), this, SLOT(idleTimeout()));
+    m_idleTimer->start();
 }
 
 QHttpConnection::~QHttpConnection()
@@ -112,11 +124,28 @@ bool QHttpConnection::isWritable()
     return m_socket->isWritable();
 }
 
+qint64 QHttpConnection::bytesToWrite() const
+{
+    return m_socket->bytesToWrite();
+}
+
+qintptr QHttpConnection::socketDescriptor() const
+{
+    return m_socket->socketDescriptor();
+}
+
 void QHttpConnection::responseDone()
 {
     QHttpResponse *response = qobject_cast<QHttpResponse *>(QObject::sender());
     if (response->m_last)
         m_socket->disconnectFromHost();
+    else
+        m_idleTimer->start();
+}
+
+void QHttpConnection::idleTimeout()
+{
+    m_socket->disconnectFromHost();
 }
 
 /* URL Utilities */
@@ -167,6 +196,8 @@ int QHttpConnection::MessageBegin(http_parser *parser)
     theConnection->m_currentUrl.clear();
     theConnection->m_currentUrl.reserve(128);
 
+    theConnection->m_idleTimer->stop();
+
     // The QHttpRequest should not be parented to this, since it's memory
     // management is the responsibility of the user of the library.
     theConnection->m_request = new QHttpRequest(theConnection);
@@ -207,9 +238,13 @@ int QHttpConnection::HeadersComplete(http_parser *parser)
     QHttpResponse *response = new QHttpResponse(theConnection);
     if (parser->http_major < 1 || parser->http_minor < 1)
         response->m_keepAlive = false;
+    if (theConnection->m_currentHeaders.value("connection").compare("close", Qt::CaseInsensitive) == 0)
+        response->m_keepAlive = false;
 
     connect(theConnection, SIGNAL(destroyed()), response, SLOT(connectionClosed()));
     connect(response, SIGNAL(done()), theConnection, SLOT(responseDone()));
+    // A kept-alive connection carries many requests, release each one with its response.
+    connect(response, SIGNAL(done()), theConnection->m_request.data(), SLOT(deleteLater()));
 
     // we are good to go!
     Q_EMIT theConnection->newRequest(theConnection->m_request, response);
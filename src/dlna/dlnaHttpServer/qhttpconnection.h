@@ -10,6 +10,9 @@
 #include "qhttpserverfwd.h"
 
 #include <QObject>
+#include <QPointer>
+
+class QTimer;
 
 /// @cond nodoc
 
@@ -25,16 +28,20 @@ public:
     bool flush();
     void waitForBytesWritten(int msecs = 30000);
     bool isWritable();
+    qint64 bytesToWrite() const;
+    qintptr socketDescriptor() const;
 
 Q_SIGNALS:
     void newRequest(QHttpRequest *, QHttpResponse *);
     void allBytesWritten();
+    void bytesWritten(qint64);
 
 private Q_SLOTS:
     void parseRequest();
     void responseDone();
     void socketDisconnected();
     void updateWriteCount(qint64);
+    void idleTimeout();
 
 private:
     static int MessageBegin(http_parser *parser);
@@ -51,7 +58,11 @@ private:
     http_parser_settings *m_parserSettings;
 
     // Since there can only be one request at any time even with pipelining.
-    QHttpRequest *m_request;
+    // The request is released once its response is done.
+    QPointer<QHttpRequest> m_request;
+
+    // Closes a kept-alive connection once the client stays silent.
+    QTimer *m_idleTimer;
 
     QByteArray m_currentUrl;
     // The ones we are reading in from the parser
@@ -26,6 +26,7 @@ QHttpResponse::QHttpResponse(QHttpConnection *connection)
       m_finished(false)
 {
    connect(m_connection, SIGNAL(allBytesWritten()), this, SIGNAL(allBytesWritten()));
+   connect(m_connection, SIGNAL(bytesWritten(qint64)), this, SIGNAL(bytesWritten(qint64)));
 }
 
 QHttpResponse::~QHttpResponse()
@@ -121,6 +122,16 @@ bool QHttpResponse::isWritable()
     return m_connection->isWritable();
 }
 
+qint64 QHttpResponse::bytesToWrite()
+{
+    return m_connection->bytesToWrite();
+}
+
+qintptr QHttpResponse::socketDescriptor()
+{
+    return m_connection->socketDescriptor();
+}
+
 void QHttpResponse::writeHead(int status)
 {
     if (m_finished) {
@@ -135,7 +146,7 @@ void QHttpResponse::writeHead(int status)
     }
 
     m_connection->write(
-        QString("HTTP/1.1 %1 %2\r\n").arg(status).arg(STATUS_CODES[status]).toLatin1());
+        QString("HTTP/1.1 %1 %2\r\n").arg(status).arg(STATUS_CODES.value(status)).toLatin1());
 
     writeHeaders();
 
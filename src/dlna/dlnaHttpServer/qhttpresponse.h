@@ -71,6 +71,10 @@ public:
     bool isFinished();
     bool isHeaderWritten();
     bool isWritable();
+    /// Bytes still buffered in the socket, waiting to be sent.
+    qint64 bytesToWrite();
+    /// Native descriptor of the underlying socket, -1 if closed.
+    qintptr socketDescriptor();
 
     virtual ~QHttpResponse();
 
@@ -126,6 +130,9 @@ Q_SIGNALS:
         receiving this signal. */
     void allBytesWritten();
 
+    /// Emitted whenever the socket has transmitted a block of data
+    void bytesWritten(qint64);
+
     /// Emitted when the response is finished.
     /** You should <b>not</b> interact with this object
         after done() has been emitted as the object
@@ -11,11 +11,14 @@
 #include <QDebug>
 
 #include "qhttpconnection.h"
+#include "qhttpworker.h"
 
 QHash<int, QString> STATUS_CODES;
 
-QHttpServer::QHttpServer(QObject *parent) : QObject(parent), m_tcpServer(0)
+QHttpServer::QHttpServer(QObject *parent) : QObject(parent), m_tcpServer(0), m_workerCount(0)
 {
+    qRegisterMetaType<qintptr>("qintptr");
+
 #define STATUS_CODE(num, reason) STATUS_CODES.insert(num, reason);
     // {{{
     STATUS_CODE(100, "Continue")
@@ -75,6 +78,7 @@ QHttpServer::QHttpServer(QObject *parent) : QObject(parent), m_tcpServer(0)
 
 QHttpServer::~QHttpServer()
 {
+    close();
 }
 
 void QHttpServer::newConnection()
@@ -89,14 +93,38 @@ void QHttpServer::newConnection()
     }
 }
 
+void QHttpServer::newDescriptor(qintptr socketDescriptor)
+{
+    Q_ASSERT(!m_workers.isEmpty());
+
+    QHttpWorker *worker = m_workers.first();
+    foreach (QHttpWorker *candidate, m_workers) {
+        if (candidate->connectionCount() < worker->connectionCount())
+            worker = candidate;
+    }
+    QMetaObject::invokeMethod(worker, "addConnection", Qt::QueuedConnection,
+                              Q_ARG(qintptr, socketDescriptor));
+}
+
 bool QHttpServer::listen(const QHostAddress &address, quint16 port)
 {
     Q_ASSERT(!m_tcpServer);
-    m_tcpServer = new QTcpServer(this);
+    if (m_workerCount > 0) {
+        QHttpTcpServer *tcpServer = new QHttpTcpServer(this);
+        connect(tcpServer, SIGNAL(newDescriptor(qintptr)), this, SLOT(newDescriptor(qintptr)));
+        m_tcpServer = tcpServer;
+    } else {
+        m_tcpServer = new QTcpServer(this);
+    }
 
     bool couldBindToPort = m_tcpServer->listen(address, port);
     if (couldBindToPort) {
         connect(m_tcpServer, SIGNAL(newConnection()), this, SLOT(newConnection()));
+        for (int i = 0; i < m_workerCount; ++i) {
+            QHttpWorker *worker = new QHttpWorker(this);
+            worker->start();
+            m_workers.append(worker);
+        }
     } else {
         delete m_tcpServer;
         m_tcpServer = NULL;
@@ -109,8 +137,22 @@ bool QHttpServer::listen(quint16 port)
     return listen(QHostAddress::Any, port);
 }
 
+quint16 QHttpServer::serverPort() const
+{
+    return m_tcpServer ? m_tcpServer->serverPort() : 0;
+}
+
 void QHttpServer::close()
 {
     if (m_tcpServer)
         m_tcpServer->close();
+
+    qDeleteAll(m_workers);
+    m_workers.clear();
+}
+
+void QHttpServer::setWorkerCount(int count)
+{
+    Q_ASSERT(!m_tcpServer);
+    m_workerCount = qMax(0, count);
 }
@@ -15,6 +15,7 @@
 
 #include <QObject>
 #include <QHostAddress>
+#include <QList>
 
 /// Maps status codes to string reason phrases
 extern QHash<int, QString> STATUS_CODES;
@@ -62,21 +63,39 @@ public:
         @sa listen(const QHostAddress&, quint16) */
     bool listen(quint16 port);
 
+    /// Port the server is listening on, 0 when not listening.
+    /** Useful after listening on port 0 to get the port chosen by the system. */
+    quint16 serverPort() const;
+
     /// Stop the server and listening for new connections.
+    /** Connections served by worker threads are closed as well. */
     void close();
+
+    /// Serve connections on @c count worker threads.
+    /** Each accepted connection is handed to the worker with the fewest
+        connections, so slow clients do not hold back the others.
+        @note Must be called before listen(). 0, the default, serves every
+        connection on the thread of the server. */
+    void setWorkerCount(int count);
 Q_SIGNALS:
     /// Emitted when a client makes a new request to the server.
     /** The slot should use the given @c request and @c response
         objects to communicate with the client.
+        @note With worker threads the signal is emitted from the worker
+        thread that owns the connection. Connect with Qt::DirectConnection
+        and answer the request from that thread.
         @param request New incoming request.
         @param response Response object to the request. */
     void newRequest(QHttpRequest *request, QHttpResponse *response);
 
 private Q_SLOTS:
     void newConnection();
+    void newDescriptor(qintptr socketDescriptor);
 
 private:
     QTcpServer *m_tcpServer;
+    int m_workerCount;
+    QList<QHttpWorker *> m_workers;
 };
 
 #endif
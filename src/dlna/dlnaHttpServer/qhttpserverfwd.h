@@ -19,6 +19,7 @@ class QHttpServer;
 class QHttpConnection;
 class QHttpRequest;
 class QHttpResponse;
+class QHttpWorker;
 
 // Qt
 class QTcpServer;
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "qhttpworker.h"
+
+#include <QThread>
+#include <QTcpSocket>
+#include <QDebug>
+
+#include <unistd.h>
+
+#include "qhttpserver.h"
+#include "qhttpconnection.h"
+
+/// @cond nodoc
+
+QHttpTcpServer::QHttpTcpServer(QObject *parent) : QTcpServer(parent)
+{
+}
+
+void QHttpTcpServer::incomingConnection(qintptr socketDescriptor)
+{
+    Q_EMIT newDescriptor(socketDescriptor);
+}
+
+QHttpWorker::QHttpWorker(QHttpServer *server)
+    : QObject(0),
+      m_server(server),
+      m_thread(0),
+      m_connectionCount(0)
+{
+}
+
+QHttpWorker::~QHttpWorker()
+{
+    stop();
+}
+
+void QHttpWorker::start()
+{
+    if (m_thread)
+        return;
+
+    m_thread = new QThread;
+    moveToThread(m_thread);
+    m_thread->start();
+}
+
+void QHttpWorker::stop()
+{
+    if (!m_thread)
+        return;
+
+    Q_ASSERT(QThread::currentThread() != m_thread);
+    QMetaObject::invokeMethod(this, "closeConnections", Qt::BlockingQueuedConnection);
+    m_thread->quit();
+    m_thread->wait();
+    delete m_thread;
+    m_thread = 0;
+}
+
+int QHttpWorker::connectionCount() const
+{
+    return m_connectionCount.load();
+}
+
+void QHttpWorker::addConnection(qintptr socketDescriptor)
+{
+    QTcpSocket *socket = new QTcpSocket;
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qWarning() << "QHttpWorker::addConnection() Invalid socket descriptor" << socket->errorString();
+        delete socket;
+        ::close(static_cast<int>(socketDescriptor));
+        return;
+    }
+
+    QHttpConnection *connection = new QHttpConnection(socket, this);
+    m_connectionCount.ref();
+    connect(connection, SIGNAL(destroyed()), this, SLOT(connectionDestroyed()));
+    // Requests are answered on this thread, receivers must connect directly.
+    connect(connection, SIGNAL(newRequest(QHttpRequest *, QHttpResponse *)), m_server,
+            SIGNAL(newRequest(QHttpRequest *, QHttpResponse *)), Qt::DirectConnection);
+}
+
+void QHttpWorker::connectionDestroyed()
+{
+    m_connectionCount.deref();
+}
+
+void QHttpWorker::closeConnections()
+{
+    qDeleteAll(findChildren<QHttpConnection *>(QString(), Qt::FindDirectChildrenOnly));
+}
+
+/// @endcond
@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef Q_HTTP_WORKER
+#define Q_HTTP_WORKER
+
+#include "qhttpserverapi.h"
+#include "qhttpserverfwd.h"
+
+#include <QObject>
+#include <QAtomicInt>
+#include <QTcpServer>
+
+class QThread;
+
+/// @cond nodoc
+
+/// Hands accepted socket descriptors out instead of creating sockets
+/// on the listening thread.
+class QHTTPSERVER_API QHttpTcpServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    QHttpTcpServer(QObject *parent = 0);
+
+Q_SIGNALS:
+    void newDescriptor(qintptr socketDescriptor);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+};
+
+/// Owns the connections handed to one worker thread of a QHttpServer.
+/** The worker lives in its own thread. Connections are created in that
+    thread and their requests are emitted from it through
+    QHttpServer::newRequest(). */
+class QHTTPSERVER_API QHttpWorker : public QObject
+{
+    Q_OBJECT
+
+public:
+    QHttpWorker(QHttpServer *server);
+    virtual ~QHttpWorker();
+
+    /// Start the worker thread.
+    void start();
+
+    /// Close every connection of the worker and stop its thread.
+    /** Must not be called from the worker thread itself. */
+    void stop();
+
+    /// Number of connections currently served by this worker.
+    int connectionCount() const;
+
+public Q_SLOTS:
+    /// Take over an accepted socket descriptor.
+    void addConnection(qintptr socketDescriptor);
+
+private Q_SLOTS:
+    void connectionDestroyed();
+    void closeConnections();
+
+private:
+    QHttpServer *m_server;
+    QThread *m_thread;
+    QAtomicInt m_connectionCount;
+};
+
+/// @endcond
+
+#endif
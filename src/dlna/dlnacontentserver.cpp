@@ -4,15 +4,19 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "dlnacontentserver.h"
+#include "dlnastreamwriter.h"
 #include <QtDebug>
 #include <QHostAddress>
 #include <QThreadPool>
 #include <QTimer>
+#include <QFileInfo>
+#include <QUrl>
 
-static const qint64 qlen = 2048;
 const QString dlnaOrgOpFlagsSeekBytes{"DLNA.ORG_OP=01"};
 const QString dlnaOrgOpFlagsNoSeek{"DLNA.ORG_OP=00"};
 const QString dlnaOrgCiFlags{"DLNA.ORG_CI=0"};
+static const int minHttpWorkers = 2; // 电视会并发发起多个Range请求
+static const int maxHttpWorkers = 4;
 
 
 DlnaContentServer::DlnaContentServer(QObject *parent, int nPort) : QObject(parent)
@@ -51,16 +55,17 @@ bool DlnaContentServer::initializeHttpServer(int port)
     bool bServer = false;
     if(!m_httpServer) {
         m_httpServer = new QHttpServer(parent());
+        m_httpServer->setWorkerCount(qBound(minHttpWorkers, QThread::idealThreadCount(), maxHttpWorkers));
+        //请求在连接所属的工作线程中直接处理
         connect(m_httpServer, &QHttpServer::newRequest, this,
-                &DlnaContentServer::requestHandler);
+                &DlnaContentServer::requestHandler, Qt::DirectConnection);
         bServer = m_httpServer->listen(QHostAddress::Any, port);
         if(!bServer) {
             m_httpServer->deleteLater();
             m_httpServer = NULL;
             return bServer;
         }
-        connect(this, &DlnaContentServer::contSeqWriteData, this,
-                &DlnaContentServer::seqWriteData, Qt::QueuedConnection);
+        m_nServerPort = m_httpServer->serverPort();
         connect(this, &DlnaContentServer::closeServer, [=](){
             m_httpServer->close();
             m_httpServer->deleteLater();
@@ -76,10 +81,14 @@ bool DlnaContentServer::initializeHttpServer(int port)
  */
 void DlnaContentServer::requestHandler(QHttpRequest *req, QHttpResponse *resp)
 {
-    streamFile(m_sDlnaFileName, "", req, resp);
-    connect(this, &DlnaContentServer::closeServer, [=](){
-        req->end();
-    });
+    if(!req || !resp) return;
+    const QString sFile = findFile(req->path());
+    if (sFile.isEmpty()) {
+        qWarning() << "Unpublished path:" << req->path();
+        sendEmptyResponse(resp, 404);
+        return;
+    }
+    streamFile(sFile, "", req, resp);
 }
 /**
  * @brief streamFile 传输文件流数据
@@ -103,7 +112,6 @@ void DlnaContentServer::streamFile(const QString &path, const QString &mime,
 
     resp->setHeader("Content-Type", mime);
     resp->setHeader("Accept-Ranges", "bytes");
-    resp->setHeader("Connection", "close");
     resp->setHeader("Cache-Control", "no-cache");
     resp->setHeader("TransferMode.DLNA.ORG", "Streaming");
     resp->setHeader("contentFeatures.DLNA.ORG",
@@ -130,6 +138,7 @@ void DlnaContentServer::streamFileRange(std::shared_ptr<QFile> file,
     if (!range) {
         qWarning() << "Unable to read on invalid Range header";
         sendEmptyResponse(resp, 416);
+        return;
     }
 
     resp->setHeader("Content-Length", QString::number(range->rangeLength()));
@@ -138,8 +147,11 @@ void DlnaContentServer::streamFileRange(std::shared_ptr<QFile> file,
                                          "/" + QString::number(length));
 
     resp->writeHead(206);
-    file->seek(range->start);
-    seqWriteData(file, range->rangeLength(), resp);
+    if (req->method() == QHttpRequest::HTTP_HEAD) {
+        resp->end();
+        return;
+    }
+    seqWriteData(file, range->start, range->rangeLength(), resp);
 }
 /**
  * @brief streamFileNoRange 全部流
@@ -156,7 +168,11 @@ void DlnaContentServer::streamFileNoRange(std::shared_ptr<QFile> file,
     resp->setHeader("Content-Length", QString::number(length));
 
     resp->writeHead(200);
-    seqWriteData(file, length, resp);
+    if (req->method() == QHttpRequest::HTTP_HEAD) {
+        resp->end();
+        return;
+    }
+    seqWriteData(file, 0, length, resp);
 }
 
 std::optional<DlnaContentServer::Range> DlnaContentServer::Range::fromRange(
@@ -188,41 +204,16 @@ std::optional<DlnaContentServer::Range> DlnaContentServer::Range::fromRange(
 /**
  * @brief seqWriteData 请求传输文件数据
  * @param file Http请求文件
+ * @param offset 起始偏移
  * @param size Http请求文件大小
  * @param resp Http应答
  */
-void DlnaContentServer::seqWriteData(std::shared_ptr<QFile> file, qint64 size,
+void DlnaContentServer::seqWriteData(std::shared_ptr<QFile> file, qint64 offset, qint64 size,
                                        QHttpResponse *resp) {
-//    qInfo() << "Worker()" << "thread:" << QThread::currentThreadId();
     if(!resp) return;
-    if (resp->isFinished()) {
-        qWarning() << "Connection closed by server, so skiping data sending";
-    } else {
-        qint64 rlen = size;
-        const qint64 len =
-            rlen < qlen ? rlen : qlen;
-        // qDebug() << "Sending" << len << "of data";
-        QByteArray data;
-        data.resize(static_cast<int>(len));
-        auto cdata = data.data();
-        const auto count = static_cast<int>(file->read(cdata, len));
-        rlen = rlen - len;
-
-        if (count > 0) {
-            resp->write(data);
-            resp->waitForBytesWritten(1000);
-            if (rlen > 0) {
-                emit contSeqWriteData(file, rlen, resp);
-                return;
-            }
-        } else {
-            qWarning() << "No more data to read";
-        }
-
-        qDebug() << "All data sent, so ending connection";
-    }
-
-    resp->end();
+    //由套接字可写事件驱动发送，发送完成后自行释放；运行在工作线程中，不能以this为父对象
+    DlnaStreamWriter *pWriter = new DlnaStreamWriter(file, offset, size, resp);
+    pWriter->start();
 }
 /**
  * @brief dlnaContentFeaturesHeader 填充dlna传输头
@@ -295,12 +286,49 @@ void DlnaContentServer::setBaseUrl(const QString &baseUrl)
     m_sBaseUrl = baseUrl;
 }
 /**
- * @brief setDlnaFileName 设置传输文件名
- * @param fileName 传输文件名
+ * @brief publishFile 发布传输文件，可同时发布多个(如整个播放队列)
+ * @param fileName 本地文件
+ * @return 文件的Http地址，重复发布同一文件返回相同地址
  */
-void DlnaContentServer::setDlnaFileName(const QString &fileName)
+QString DlnaContentServer::publishFile(const QString &fileName)
 {
-    m_sDlnaFileName = fileName;
+    QWriteLocker locker(&m_fileLock);
+    int nId = m_mapPublishedFiles.key(fileName, 0);
+    if (nId == 0) {
+        nId = m_nNextFileId++;
+        m_mapPublishedFiles.insert(nId, fileName);
+    }
+    //地址中的文件名仅供渲染端识别格式，查找只依赖编号
+    return QString("%1%2/%3").arg(m_sBaseUrl).arg(nId)
+            .arg(QString::fromLatin1(QUrl::toPercentEncoding(QFileInfo(fileName).fileName())));
+}
+/**
+ * @brief unpublishFile 取消发布传输文件
+ * @param fileName 本地文件
+ */
+void DlnaContentServer::unpublishFile(const QString &fileName)
+{
+    QWriteLocker locker(&m_fileLock);
+    m_mapPublishedFiles.remove(m_mapPublishedFiles.key(fileName, 0));
+}
+/**
+ * @brief clearPublishedFiles 取消发布所有传输文件
+ */
+void DlnaContentServer::clearPublishedFiles()
+{
+    QWriteLocker locker(&m_fileLock);
+    m_mapPublishedFiles.clear();
+}
+/**
+ * @brief findFile 根据请求路径查找传输文件，未发布的路径返回空
+ * @param path 请求路径
+ */
+QString DlnaContentServer::findFile(const QString &path)
+{
+    QReadLocker locker(&m_fileLock);
+    bool bOk = false;
+    const int nId = path.section('/', 1, 1).toInt(&bOk);
+    return bOk ? m_mapPublishedFiles.value(nId) : QString();
 }
 /**
  * @brief getBaseUrl 获取Http视频连接地址
@@ -316,6 +344,13 @@ bool DlnaContentServer::getIsStartHttpServer()
 {
     return m_bStartHttpServer;
 }
+/**
+ * @brief serverPort Http服务实际监听的端口
+ */
+int DlnaContentServer::serverPort() const
+{
+    return m_nServerPort;
+}
 /**
  * @brief dlnaOrgPnFlags 视频格式转换为upnp标准
  * @param mime 视频格式
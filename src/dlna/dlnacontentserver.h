@@ -14,6 +14,8 @@
 #include <memory>
 #include <optional>
 #include <QThread>
+#include <QHash>
+#include <QReadWriteLock>
 
 class QHttpServer;
 class QHttpRequest;
@@ -57,6 +59,7 @@ public:
     ~DlnaContentServer();
     /**
      * @brief slotBaseMuteChanged 请求传输文件数据
+     * 在连接所属的工作线程中调用
      * @param req Http请求
      * @param resp Http应答
      */
@@ -119,10 +122,20 @@ public:
      */
     void setBaseUrl(const QString &baseUrl);
     /**
-     * @brief setDlnaFileName 设置传输文件名
-     * @param fileName 传输文件名
+     * @brief publishFile 发布传输文件，可同时发布多个(如整个播放队列)
+     * @param fileName 本地文件
+     * @return 文件的Http地址，重复发布同一文件返回相同地址
      */
-    void setDlnaFileName(const QString &fileName);
+    QString publishFile(const QString &fileName);
+    /**
+     * @brief unpublishFile 取消发布传输文件
+     * @param fileName 本地文件
+     */
+    void unpublishFile(const QString &fileName);
+    /**
+     * @brief clearPublishedFiles 取消发布所有传输文件
+     */
+    void clearPublishedFiles();
     /**
      * @brief getBaseUrl 获取Http视频连接地址
      */
@@ -131,24 +144,37 @@ public:
      * @brief getIsStartHttpServer Http服务是否启动
      */
     bool getIsStartHttpServer();
+    /**
+     * @brief serverPort Http服务实际监听的端口，以0端口启动时由系统分配
+     */
+    int serverPort() const;
+private:
+    /**
+     * @brief findFile 根据请求路径查找传输文件，未发布的路径返回空
+     * @param path 请求路径
+     */
+    QString findFile(const QString &path);
+
 private:
-    QString m_sDlnaFileName; // http传输文件
+    QHash<int, QString> m_mapPublishedFiles; // 已发布的传输文件，key为地址中的编号
+    int m_nNextFileId = 1; // 下一个发布编号
+    QReadWriteLock m_fileLock; // 工作线程读取传输文件时加锁
     QHttpServer *m_httpServer; // http服务
     QString m_sBaseUrl; // http url
     bool m_bStartHttpServer = false; // http 服务是否启动
+    int m_nServerPort = 0; // http 服务监听端口
     QThread *m_pThread; // http 服务线程
 signals:
-    void contSeqWriteData(std::shared_ptr<QFile> file, qint64 size,
-                          QHttpResponse *resp);
     void closeServer();
 public slots:
     /**
      * @brief seqWriteData 请求传输文件数据
      * @param file Http请求文件
+     * @param offset 起始偏移
      * @param size Http请求文件大小
      * @param resp Http应答
      */
-    void seqWriteData(std::shared_ptr<QFile> file, qint64 size,
+    void seqWriteData(std::shared_ptr<QFile> file, qint64 offset, qint64 size,
                       QHttpResponse *resp);
     /**
      * @brief initializeHttpServer 初始化HttpServer
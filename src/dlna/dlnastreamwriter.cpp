@@ -0,0 +1,197 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dlnastreamwriter.h"
+#include <dlna/dlnaHttpServer/qhttpresponse.h>
+#include <QtDebug>
+
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/sendfile.h>
+
+static const qint64 streamChunkSize = 512 * 1024;          // 缓冲写入块大小，页对齐
+static const qint64 streamHighWater = 4 * streamChunkSize; // 套接字缓冲上限
+static const qint64 sendfileChunkSize = 4 * 1024 * 1024;   // 单次sendfile长度
+static const qint64 sendfileRoundSize = 32 * 1024 * 1024;  // 单次事件处理最多发送量
+static const qint64 readAheadWindow = 8 * 1024 * 1024;     // 预读窗口
+
+DlnaStreamWriter::DlnaStreamWriter(std::shared_ptr<QFile> file, qint64 offset, qint64 length,
+                                   QHttpResponse *resp, QObject *parent)
+    : QObject(parent),
+      m_file(file),
+      m_resp(resp),
+      m_nOffset(offset),
+      m_nRemain(length),
+      m_nReadAheadPos(offset),
+      m_bZeroCopy(true),
+      m_bFinished(false),
+      m_pWriteNotifier(nullptr)
+{
+}
+
+DlnaStreamWriter::~DlnaStreamWriter()
+{
+}
+
+void DlnaStreamWriter::setZeroCopyEnabled(bool bEnabled)
+{
+    m_bZeroCopy = bEnabled;
+}
+
+void DlnaStreamWriter::start()
+{
+    if (!m_resp || m_resp->isFinished()) {
+        finish();
+        return;
+    }
+
+    connect(m_resp, &QHttpResponse::bytesWritten, this, &DlnaStreamWriter::pump);
+    connect(m_resp, &QHttpResponse::done, this, [=]() {
+        if (!m_bFinished) {
+            m_bFinished = true;
+            deleteLater();
+        }
+    });
+
+    posix_fadvise(m_file->handle(), m_nOffset, m_nRemain, POSIX_FADV_SEQUENTIAL);
+    if (m_bZeroCopy) {
+        m_pWriteNotifier = new QSocketNotifier(m_resp->socketDescriptor(), QSocketNotifier::Write, this);
+        m_pWriteNotifier->setEnabled(false);
+        connect(m_pWriteNotifier, &QSocketNotifier::activated, this, &DlnaStreamWriter::onSocketWritable);
+    } else {
+        m_file->seek(m_nOffset);
+    }
+
+    pump();
+}
+
+void DlnaStreamWriter::pump()
+{
+    if (m_bFinished)
+        return;
+
+    if (!m_resp || m_resp->isFinished()) {
+        qWarning() << "Connection closed by server, so skiping data sending";
+        finish();
+        return;
+    }
+
+    if (m_bZeroCopy) {
+        //应答头仍在套接字缓冲中，等待发送完后再绕过缓冲直接sendfile
+        if (m_resp->bytesToWrite() > 0)
+            return;
+        if (!sendZeroCopy())
+            return;
+    } else {
+        sendBuffered();
+    }
+
+    if (m_nRemain <= 0 && !m_bFinished) {
+        qDebug() << "All data sent, so ending connection";
+        finish();
+    }
+}
+
+void DlnaStreamWriter::onSocketWritable()
+{
+    m_pWriteNotifier->setEnabled(false);
+    pump();
+}
+
+bool DlnaStreamWriter::sendZeroCopy()
+{
+    int nSocket = static_cast<int>(m_resp->socketDescriptor());
+    int nFile = m_file->handle();
+    qint64 nRound = 0;
+
+    while (m_nRemain > 0) {
+        readAhead();
+
+        off_t offset = static_cast<off_t>(m_nOffset);
+        ssize_t nSent = ::sendfile(nSocket, nFile, &offset, static_cast<size_t>(qMin(m_nRemain, sendfileChunkSize)));
+        if (nSent > 0) {
+            m_nOffset += nSent;
+            m_nRemain -= nSent;
+            nRound += nSent;
+            //让出事件循环，避免长时间占用线程
+            if (nRound >= sendfileRoundSize && m_nRemain > 0) {
+                QMetaObject::invokeMethod(this, "pump", Qt::QueuedConnection);
+                return false;
+            }
+            continue;
+        }
+
+        if (nSent == 0) {
+            qWarning() << "No more data to read";
+            m_nRemain = 0;
+            break;
+        }
+
+        if (errno == EINTR)
+            continue;
+
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            m_pWriteNotifier->setEnabled(true);
+            return false;
+        }
+
+        //文件系统或套接字不支持sendfile，退回缓冲写入
+        qWarning() << "sendfile failed, fallback to buffered write:" << errno;
+        m_bZeroCopy = false;
+        m_file->seek(m_nOffset);
+        sendBuffered();
+        return true;
+    }
+
+    return true;
+}
+
+void DlnaStreamWriter::sendBuffered()
+{
+    if (m_buffer.size() != streamChunkSize)
+        m_buffer.resize(static_cast<int>(streamChunkSize));
+
+    while (m_nRemain > 0 && m_resp->bytesToWrite() < streamHighWater) {
+        readAhead();
+
+        const qint64 len = qMin(m_nRemain, streamChunkSize);
+        const qint64 count = m_file->read(m_buffer.data(), len);
+        if (count <= 0) {
+            qWarning() << "No more data to read";
+            m_nRemain = 0;
+            break;
+        }
+
+        m_resp->write(count == streamChunkSize ? m_buffer : m_buffer.left(static_cast<int>(count)));
+        m_nOffset += count;
+        m_nRemain -= count;
+    }
+}
+
+void DlnaStreamWriter::readAhead()
+{
+    //预读由内核异步完成，发送时数据已在页缓存中
+    const qint64 nEnd = m_nOffset + m_nRemain;
+    if (m_nReadAheadPos >= nEnd || m_nReadAheadPos - m_nOffset > readAheadWindow / 2)
+        return;
+
+    const qint64 nLen = qMin(readAheadWindow, nEnd - m_nReadAheadPos);
+    posix_fadvise(m_file->handle(), m_nReadAheadPos, nLen, POSIX_FADV_WILLNEED);
+    m_nReadAheadPos += nLen;
+}
+
+void DlnaStreamWriter::finish()
+{
+    if (m_bFinished)
+        return;
+
+    m_bFinished = true;
+    if (m_pWriteNotifier) {
+        m_pWriteNotifier->setEnabled(false);
+    }
+    if (m_resp && !m_resp->isFinished()) {
+        m_resp->end();
+    }
+    deleteLater();
+}
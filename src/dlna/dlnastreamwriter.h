@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DLNASTREAMWRITER_H
+#define DLNASTREAMWRITER_H
+
+#include <QObject>
+#include <QFile>
+#include <QPointer>
+#include <QSocketNotifier>
+#include <memory>
+
+class QHttpResponse;
+/**
+ * @brief DlnaStreamWriter 按套接字可写状态驱动的文件发送
+ * 套接字缓冲区为空时使用sendfile零拷贝发送，不支持时退回大块缓冲写入；
+ * 每次发送前通知内核预读后续数据，慢速磁盘上不阻塞发送
+ */
+class DlnaStreamWriter : public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @param file 已打开的文件
+     * @param offset 起始偏移
+     * @param length 发送长度
+     * @param resp Http应答，需已写入应答头
+     */
+    DlnaStreamWriter(std::shared_ptr<QFile> file, qint64 offset, qint64 length,
+                     QHttpResponse *resp, QObject *parent = nullptr);
+    ~DlnaStreamWriter();
+    /**
+     * @brief start 开始发送，完成或连接断开后自动释放
+     */
+    void start();
+    /**
+     * @brief setZeroCopyEnabled 是否允许使用sendfile
+     */
+    void setZeroCopyEnabled(bool bEnabled);
+
+private slots:
+    void pump();
+    void onSocketWritable();
+
+private:
+    /**
+     * @brief sendZeroCopy sendfile发送
+     * @return 需要等待套接字可写时返回false
+     */
+    bool sendZeroCopy();
+    /**
+     * @brief sendBuffered 缓冲写入，套接字缓冲达到上限后等待bytesWritten
+     */
+    void sendBuffered();
+    void readAhead();
+    void finish();
+
+private:
+    std::shared_ptr<QFile> m_file;  // 发送文件
+    QPointer<QHttpResponse> m_resp; // Http应答
+    qint64 m_nOffset;               // 下一个发送位置
+    qint64 m_nRemain;               // 剩余发送长度
+    qint64 m_nReadAheadPos;         // 已通知预读的位置
+    bool m_bZeroCopy;               // 是否使用sendfile
+    bool m_bFinished;
+    QByteArray m_buffer;            // 缓冲写入时复用的读缓冲
+    QSocketNotifier *m_pWriteNotifier; // sendfile返回EAGAIN后等待可写
+};
+
+#endif // DLNASTREAMWRITER_H
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "burst_screenshot_worker.h"
+#include "compositing_manager.h"
+#include "runtime_registry.h"
+
+#include <QLibrary>
+#include <QMatrix>
+
+namespace dmr {
+
+BurstScreenshotWorker::BurstScreenshotWorker(const QString &sFile, const QList<qint64> &listPoints,
+                                             int nRotation, QObject *parent)
+    : QThread(parent), m_sFile(sFile), m_listPoints(listPoints), m_nRotation(nRotation)
+{
+}
+
+BurstScreenshotWorker::~BurstScreenshotWorker()
+{
+    stop();
+    wait();
+}
+
+void BurstScreenshotWorker::stop()
+{
+    requestInterruption();
+}
+
+void BurstScreenshotWorker::run()
+{
+    QLibrary &library = RuntimeRegistry::get().library("libffmpegthumbnailer.so");
+    m_mvideo_thumbnailer = (mvideo_thumbnailer) library.resolve("video_thumbnailer_create");
+    m_mvideo_thumbnailer_destroy = (mvideo_thumbnailer_destroy) library.resolve("video_thumbnailer_destroy");
+    m_mvideo_thumbnailer_create_image_data = (mvideo_thumbnailer_create_image_data) library.resolve("video_thumbnailer_create_image_data");
+    m_mvideo_thumbnailer_destroy_image_data = (mvideo_thumbnailer_destroy_image_data) library.resolve("video_thumbnailer_destroy_image_data");
+    m_mvideo_thumbnailer_generate_thumbnail_to_buffer = (mvideo_thumbnailer_generate_thumbnail_to_buffer) library.resolve("video_thumbnailer_generate_thumbnail_to_buffer");
+
+    if (m_mvideo_thumbnailer == nullptr
+            || m_mvideo_thumbnailer_destroy == nullptr
+            || m_mvideo_thumbnailer_create_image_data == nullptr
+            || m_mvideo_thumbnailer_destroy_image_data == nullptr
+            || m_mvideo_thumbnailer_generate_thumbnail_to_buffer == nullptr) {
+        qWarning() << "burst screenshot: ffmpegthumbnailer unavailable";
+        emit frameReady(QImage(), 0);
+        return;
+    }
+
+    video_thumbnailer *pThumbnailer = m_mvideo_thumbnailer();
+    image_data *pImageData = m_mvideo_thumbnailer_create_image_data();
+    //0表示保持原始分辨率
+    pThumbnailer->thumbnail_size = 0;
+
+    for (qint64 nTime : m_listPoints) {
+        if (isInterruptionRequested())
+            break;
+
+        QImage img = grabFrame(pThumbnailer, pImageData, nTime);
+        emit frameReady(img, nTime);
+        if (img.isNull())
+            break;
+    }
+
+    m_mvideo_thumbnailer_destroy_image_data(pImageData);
+    m_mvideo_thumbnailer_destroy(pThumbnailer);
+}
+
+QImage BurstScreenshotWorker::grabFrame(video_thumbnailer *pThumbnailer, image_data *pImageData, qint64 nTime)
+{
+    QByteArray seekTime = QTime(0, 0, 0).addSecs(static_cast<int>(nTime)).toString("hh:mm:ss").toLatin1();
+    pThumbnailer->seek_time = seekTime.data();
+
+    QImage img;
+    try {
+        m_mvideo_thumbnailer_generate_thumbnail_to_buffer(pThumbnailer, m_sFile.toUtf8().data(), pImageData);
+        img = QImage::fromData(pImageData->image_data_ptr, static_cast<int>(pImageData->image_data_size), "png");
+    } catch (const std::logic_error &) {
+    }
+    pThumbnailer->seek_time = nullptr;
+
+    if (!img.isNull() && m_nRotation) {
+        QMatrix matrix;
+        matrix.rotate(m_nRotation);
+        img = img.transformed(matrix, Qt::SmoothTransformation);
+    }
+
+    return img;
+}
+
+}
@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_BURST_SCREENSHOT_WORKER_H
+#define _DMR_BURST_SCREENSHOT_WORKER_H
+
+#include <QtCore>
+#include <QImage>
+#include "playlist_model.h"
+
+namespace dmr {
+
+/**
+ * @file 连拍截图工作线程
+ * 使用独立的解码上下文(ffmpegthumbnailer)在后台逐个截取时间点的画面，
+ * 每个时间点只定位到附近关键帧并解码一帧，不影响主窗口的播放
+ */
+class BurstScreenshotWorker : public QThread
+{
+    Q_OBJECT
+
+public:
+    /**
+     * @param sFile 本地文件路径
+     * @param listPoints 截图时间点(秒)
+     * @param nRotation 用户设置的画面旋转角度
+     */
+    BurstScreenshotWorker(const QString &sFile, const QList<qint64> &listPoints,
+                          int nRotation, QObject *parent = nullptr);
+    ~BurstScreenshotWorker() override;
+
+    /**
+     * @brief 停止截图，已在解码的帧完成后退出
+     */
+    void stop();
+
+signals:
+    /**
+     * @brief 一帧截图完成，失败时frame为空并随即退出
+     */
+    void frameReady(const QImage &frame, qint64 nTime);
+
+protected:
+    void run() override;
+
+private:
+    QImage grabFrame(video_thumbnailer *pThumbnailer, image_data *pImageData, qint64 nTime);
+
+private:
+    QString m_sFile;
+    QList<qint64> m_listPoints;
+    int m_nRotation {0};
+
+    mvideo_thumbnailer m_mvideo_thumbnailer {nullptr};
+    mvideo_thumbnailer_destroy m_mvideo_thumbnailer_destroy {nullptr};
+    mvideo_thumbnailer_create_image_data m_mvideo_thumbnailer_create_image_data {nullptr};
+    mvideo_thumbnailer_destroy_image_data m_mvideo_thumbnailer_destroy_image_data {nullptr};
+    mvideo_thumbnailer_generate_thumbnail_to_buffer m_mvideo_thumbnailer_generate_thumbnail_to_buffer {nullptr};
+};
+
+}
+
+#endif /* ifndef _DMR_BURST_SCREENSHOT_WORKER_H */
@@ -6,12 +6,15 @@
 #include "config.h"
 #include "compositing_manager.h"
 #include "utils.h"
+#include "runtime_registry.h"
+#include "startup_scheduler.h"
 #ifndef _LIBDMR_
 #include "options.h"
 #endif
 
 #include <iostream>
 #include <unistd.h>
+#include <sys/utsname.h>
 #include <QtCore>
 #include <QtGui>
 #include <QX11Info>
@@ -45,33 +48,30 @@ public:
     PlatformChecker() {}
     Platform check()
     {
-        QProcess uname;
-        uname.start("uname -m");
-        if (uname.waitForStarted()) {
-            if (uname.waitForFinished()) {
-                auto data = uname.readAllStandardOutput();
-                string machine(data.trimmed().constData());
-                qInfo() << QString("machine: %1").arg(machine.c_str());
-
-                QRegExp re("x86.*|i?86|ia64", Qt::CaseInsensitive);
-                if (re.indexIn(C2Q(machine)) != -1) {
-                    qInfo() << "match x86";
-                    _pf = Platform::X86;
-
-                } else if (machine.find("alpha") != string::npos
-                           || machine.find("sw_64") != string::npos) {
-                    // shenwei
-                    qInfo() << "match shenwei";
-                    _pf = Platform::Alpha;
-
-                } else if (machine.find("mips") != string::npos
-                           || machine.find("loongarch64") != string::npos) { // loongson
-                    qInfo() << "match loongson";
-                    _pf = Platform::Mips;
-                } else if (machine.find("aarch64") != string::npos) { // ARM64
-                    qInfo() << "match arm";
-                    _pf = Platform::Arm64;
-                }
+        //直接取内核信息，不再启动uname进程
+        struct utsname name;
+        if (uname(&name) == 0) {
+            string machine(name.machine);
+            qInfo() << QString("machine: %1").arg(machine.c_str());
+
+            QRegExp re("x86.*|i?86|ia64", Qt::CaseInsensitive);
+            if (re.indexIn(C2Q(machine)) != -1) {
+                qInfo() << "match x86";
+                _pf = Platform::X86;
+
+            } else if (machine.find("alpha") != string::npos
+                       || machine.find("sw_64") != string::npos) {
+                // shenwei
+                qInfo() << "match shenwei";
+                _pf = Platform::Alpha;
+
+            } else if (machine.find("mips") != string::npos
+                       || machine.find("loongarch64") != string::npos) { // loongson
+                qInfo() << "match loongson";
+                _pf = Platform::Mips;
+            } else if (machine.find("aarch64") != string::npos) { // ARM64
+                qInfo() << "match arm";
+                _pf = Platform::Arm64;
             }
         }
 
@@ -111,7 +111,10 @@ CompositingManager::CompositingManager()
         qInfo() << __func__ << "Composited is " << _composited;
         return;
     }
-    softDecodeCheck();   //检测是否是kunpeng920（是否走软解码）
+    //检测是否是kunpeng920（是否走软解码），与下面的Xorg日志检查互不依赖，并发执行
+    QFuture<void> softDecode = StartupScheduler::get().run("soft-decode-check", [this] {
+        softDecodeCheck();
+    });
 
     _composited = false;
 //    QGSettings gsettings("com.deepin.deepin-movie", "/com/deepin/deepin-movie/");
@@ -165,6 +168,8 @@ CompositingManager::CompositingManager()
     {
         _composited = true;
     }
+    softDecode.waitForFinished();
+    StartupScheduler::get().mark("compositing-manager");
     qInfo() << __func__ << "Composited is " << _composited;
 }
 
@@ -237,20 +242,7 @@ bool CompositingManager::isCanHwdec()
 
 QString  CompositingManager::libPath(const QString &sLib)
 {
-    QDir dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (sLib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(sLib)) {
-        return (path+ QDir::separator() + sLib);
-    } else {
-        list.sort();
-    }
-
-    if(list.size() > 0)
-        return (path + QDir::separator() + list.last());
-    else
-        return QString();
+    return RuntimeRegistry::get().libPath(sLib);
 }
 
 void CompositingManager::setCanHwdec(bool bCanHwdec)
@@ -260,12 +252,16 @@ void CompositingManager::setCanHwdec(bool bCanHwdec)
 
 bool CompositingManager::isMpvExists()
 {
-    QString path  = libPath("libmpv.so.");
-    if (path.contains("libmpv.so.")) {
-        qInfo() << "curreng load mpv is :" << path;
-        return true;
-    }
-    return false;
+    //库是否存在在运行期间不变，只检查一次
+    static const bool bExists = [] {
+        QString path  = libPath("libmpv.so.");
+        if (path.contains("libmpv.so.")) {
+            qInfo() << "curreng load mpv is :" << path;
+            return true;
+        }
+        return false;
+    }();
+    return bExists;
 }
 
 bool CompositingManager::isZXIntgraphics() const
@@ -291,6 +287,17 @@ bool CompositingManager::runningOnNvidia()
 
 void CompositingManager::softDecodeCheck()
 {
+    //cpu型号、主板厂商和N卡驱动版本只在内核或驱动变化后重新检测
+    QVariant cached;
+    if (StartupScheduler::get().lookupProbe("softDecode", cached) && cached.toList().size() == 4) {
+        const QVariantList listValue = cached.toList();
+        m_cpuModelName = listValue[0].toString();
+        m_boardVendor = listValue[1].toString();
+        m_bOnlySoftDecode = listValue[2].toBool();
+        m_setSpecialControls = listValue[3].toBool();
+        return;
+    }
+
     //获取cpu型号
     QFile cpuInfo("/proc/cpuinfo");
     if (cpuInfo.open(QIODevice::ReadOnly)) {
@@ -345,6 +352,9 @@ void CompositingManager::softDecodeCheck()
         }
         nvidiaVersion.close();
     }
+
+    StartupScheduler::get().storeProbe("softDecode", QVariantList() << m_cpuModelName << m_boardVendor
+                                       << m_bOnlySoftDecode << m_setSpecialControls);
 }
 
 bool CompositingManager::isOnlySoftDecode()
@@ -414,6 +424,16 @@ void CompositingManager::detectOpenGLEarly()
 
 void CompositingManager::detectPciID()
 {
+    //lspci耗时较长，结果只在内核或驱动变化后重新检测
+    QVariant cached;
+    if (StartupScheduler::get().lookupProbe("pciNeedIHD", cached)) {
+        if (cached.toBool()) {
+            qputenv("LIBVA_DRIVER_NAME", "iHD");
+        }
+        return;
+    }
+
+    bool bNeedIHD = false;
     QProcess pcicheck;
     pcicheck.start("lspci -vn");
     if (pcicheck.waitForStarted() && pcicheck.waitForFinished()) {
@@ -430,10 +450,12 @@ void CompositingManager::detectPciID()
                 if (line.contains(QString("8086")) && line.contains(QString("1912"))) {
                     qInfo() << "CompositingManager::detectPciID():need to change to iHD";
                     qputenv("LIBVA_DRIVER_NAME", "iHD");
+                    bNeedIHD = true;
                     break;
                 }
             }
         }
+        StartupScheduler::get().storeProbe("pciNeedIHD", bNeedIHD);
     }
 }
 
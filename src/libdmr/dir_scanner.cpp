@@ -0,0 +1,278 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "dir_scanner.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define SCAN_MAX_THREADS 8          //扫描线程数上限，更多线程对同一块磁盘没有收益
+#define SCAN_POLL_INTERVAL 100      //等待时检查中止标志的间隔(ms)
+
+namespace dmr {
+
+DirScanWorker::DirScanWorker(DirScanner *pScanner, int nIndex)
+    : m_pScanner(pScanner), m_nIndex(nIndex)
+{
+}
+
+void DirScanWorker::run()
+{
+    DirScanner::ScanDir dir;
+    while (!m_pScanner->isStopped()) {
+        if (m_pScanner->takeDir(m_nIndex, dir)) {
+            m_pScanner->scanDir(m_nIndex, dir);
+            m_pScanner->finishDir();
+        } else if (!m_pScanner->waitForWork()) {
+            break;
+        }
+    }
+}
+
+DirScanner::DirScanner(const Filter &filter, const QAtomicInt *pStop)
+    : m_filter(filter), m_pStop(pStop)
+{
+}
+
+DirScanner::~DirScanner()
+{
+    qDeleteAll(m_queues);
+}
+
+QList<QUrl> DirScanner::scan(const QStringList &lstDir, const BatchHandler &onBatch)
+{
+    QList<QUrl> listAll;
+    const int nThreads = qBound(2, QThread::idealThreadCount(), SCAN_MAX_THREADS);
+    for (int i = 0; i < nThreads; i++) {
+        m_queues.append(new WorkQueue);
+    }
+
+    for (int i = 0; i < lstDir.size(); i++) {
+        ScanDir dir;
+        dir.sPath = QFile::encodeName(QDir(lstDir[i]).absolutePath());
+        dir.key << QByteArray::number(i).rightJustified(8, '0');
+        {
+            QMutexLocker lock(&m_mutex);
+            m_results.insert(dir.key, DirResult());
+        }
+        m_nPending++;
+        pushDir(i % nThreads, dir);
+    }
+    if (m_nPending == 0)
+        return listAll;
+
+    QList<DirScanWorker *> listWorker;
+    for (int i = 0; i < nThreads; i++) {
+        listWorker.append(new DirScanWorker(this, i));
+        listWorker.last()->start();
+    }
+
+    bool bDone = false;
+    while (!bDone) {
+        QList<QList<QUrl>> listReady;
+        {
+            QMutexLocker lock(&m_mutex);
+            listReady = takeOrderedResults();
+            while (listReady.isEmpty() && m_nPending > 0 && !isStopped()) {
+                m_resultCond.wait(&m_mutex, SCAN_POLL_INTERVAL);
+                listReady = takeOrderedResults();
+            }
+            //结果先于计数递减加入，计数为0时已取到全部结果
+            bDone = m_nPending == 0 || isStopped();
+            if (bDone)
+                listReady << takeOrderedResults();
+        }
+
+        for (const QList<QUrl> &listBatch : listReady) {
+            if (isStopped())
+                break;
+            listAll << listBatch;
+            if (onBatch)
+                onBatch(listBatch);
+        }
+    }
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_workCond.wakeAll();
+    }
+    for (DirScanWorker *pWorker : listWorker) {
+        pWorker->wait();
+        delete pWorker;
+    }
+
+    if (isStopped())
+        return QList<QUrl>();
+    return listAll;
+}
+
+bool DirScanner::isStopped() const
+{
+    return m_pStop && m_pStop->load();
+}
+
+void DirScanner::pushDir(int nIndex, const ScanDir &dir)
+{
+    {
+        QMutexLocker lock(&m_queues[nIndex]->mutex);
+        m_queues[nIndex]->dirs.append(dir);
+    }
+
+    QMutexLocker lock(&m_mutex);
+    m_workCond.wakeOne();
+}
+
+bool DirScanner::takeDir(int nIndex, ScanDir &dir)
+{
+    {
+        //自己的队列取最新加入的，深度优先，减少同时展开的文件夹
+        QMutexLocker lock(&m_queues[nIndex]->mutex);
+        if (!m_queues[nIndex]->dirs.isEmpty()) {
+            dir = m_queues[nIndex]->dirs.takeLast();
+            return true;
+        }
+    }
+
+    for (int i = 1; i < m_queues.size(); i++) {
+        //其他队列取最早加入的，通常是更上层、子文件夹更多的目录
+        WorkQueue *pQueue = m_queues[(nIndex + i) % m_queues.size()];
+        QMutexLocker lock(&pQueue->mutex);
+        if (!pQueue->dirs.isEmpty()) {
+            dir = pQueue->dirs.takeFirst();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DirScanner::waitForWork()
+{
+    QMutexLocker lock(&m_mutex);
+    while (m_nPending > 0 && !isStopped()) {
+        for (WorkQueue *pQueue : m_queues) {
+            QMutexLocker queueLock(&pQueue->mutex);
+            if (!pQueue->dirs.isEmpty())
+                return true;
+        }
+        m_workCond.wait(&m_mutex, SCAN_POLL_INTERVAL);
+    }
+    return false;
+}
+
+void DirScanner::scanDir(int nIndex, const ScanDir &dir)
+{
+    QList<QUrl> listFile;
+    QList<ScanDir> listChild;
+
+    //打不开或已扫描过的文件夹也要记为完成，否则后面的结果无法交出
+    int nFd = open(dir.sPath.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    DIR *pDir = nullptr;
+    if (nFd >= 0 && markVisited(nFd)) {
+        //fdopendir接管文件描述符，由closedir关闭
+        pDir = fdopendir(nFd);
+    }
+    if (!pDir) {
+        if (nFd >= 0)
+            close(nFd);
+        QMutexLocker lock(&m_mutex);
+        finishResult(dir.key, listFile, listChild);
+        return;
+    }
+
+    const QByteArray sPrefix = dir.sPath.endsWith('/') ? dir.sPath : dir.sPath + '/';
+    struct dirent *pEntry = nullptr;
+    while (!isStopped() && (pEntry = readdir(pDir)) != nullptr) {
+        //与QDir默认过滤一致，跳过隐藏文件及"."、".."
+        if (pEntry->d_name[0] == '.')
+            continue;
+
+        unsigned char nType = pEntry->d_type;
+        const bool bLink = nType == DT_LNK;
+        if (nType == DT_UNKNOWN || bLink) {
+            struct stat st;
+            if (fstatat(nFd, pEntry->d_name, &st, 0) != 0)
+                continue;
+            nType = S_ISDIR(st.st_mode) ? DT_DIR : (S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN);
+        }
+
+        const QByteArray sPath = sPrefix + pEntry->d_name;
+        if (nType == DT_DIR) {
+            ScanDir child;
+            child.sPath = sPath;
+            child.key = dir.key;
+            child.key << QByteArray(pEntry->d_name);
+            listChild.append(child);
+        } else if (nType == DT_REG) {
+            //软链接文件替换为真实路径，与FileFilter::fileTransfer一致
+            QString sFile = QFile::decodeName(sPath);
+            if (bLink)
+                sFile = QFileInfo(sFile).canonicalFilePath();
+            if (sFile.isEmpty() || (m_filter && !m_filter(sFile)))
+                continue;
+
+            listFile.append(QUrl::fromLocalFile(sFile));
+        }
+    }
+    closedir(pDir);
+
+    //子文件夹与本文件夹的结果同时登记，交出顺序不会越过尚未发现的子文件夹
+    {
+        QMutexLocker lock(&m_mutex);
+        finishResult(dir.key, listFile, listChild);
+    }
+    for (const ScanDir &child : listChild) {
+        m_nPending++;
+        pushDir(nIndex, child);
+    }
+}
+
+void DirScanner::finishResult(const DirKey &key, const QList<QUrl> &files, const QList<ScanDir> &listChild)
+{
+    for (const ScanDir &child : listChild) {
+        m_results.insert(child.key, DirResult());
+    }
+    DirResult &result = m_results[key];
+    result.bDone = true;
+    result.files = files;
+    m_resultCond.wakeAll();
+}
+
+QList<QList<QUrl>> DirScanner::takeOrderedResults()
+{
+    //未完成文件夹之后才可能出现新的文件夹，排在它之前的结果已是最终顺序
+    QList<QList<QUrl>> listReady;
+    while (!m_results.isEmpty() && m_results.first().bDone) {
+        const QList<QUrl> files = m_results.take(m_results.firstKey()).files;
+        if (!files.isEmpty())
+            listReady.append(files);
+    }
+    return listReady;
+}
+
+bool DirScanner::markVisited(int nFd)
+{
+    struct stat st;
+    if (fstat(nFd, &st) != 0)
+        return false;
+
+    QMutexLocker lock(&m_mutex);
+    const QPair<quint64, quint64> key(static_cast<quint64>(st.st_dev), static_cast<quint64>(st.st_ino));
+    if (m_visited.contains(key))
+        return false;
+    m_visited.insert(key);
+    return true;
+}
+
+void DirScanner::finishDir()
+{
+    if (--m_nPending == 0) {
+        QMutexLocker lock(&m_mutex);
+        m_workCond.wakeAll();
+        m_resultCond.wakeAll();
+    }
+}
+
+}
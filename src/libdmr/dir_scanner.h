@@ -0,0 +1,128 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_DIR_SCANNER_H
+#define _DMR_DIR_SCANNER_H
+
+#include <QtCore>
+
+#include <atomic>
+#include <functional>
+
+namespace dmr {
+
+class DirScanner;
+
+/**
+ * @brief The DirScanWorker class
+ * 扫描线程，优先处理自己队列中最新加入的文件夹，队列为空时从其他线程的队列头部窃取
+ */
+class DirScanWorker: public QThread
+{
+public:
+    DirScanWorker(DirScanner *pScanner, int nIndex);
+
+protected:
+    void run() override;
+
+private:
+    DirScanner *m_pScanner {nullptr};
+    int m_nIndex {0};
+};
+
+/**
+ * @file 并行文件夹扫描
+ * 直接用readdir遍历目录项，依靠d_type区分文件和文件夹，只有类型未知或软链接时才stat；
+ * 每个文件夹中的文件经过filter筛选后作为一批结果交给调用线程，调用线程可边扫描边处理。
+ * 各文件夹并行扫描，结果仍按固定顺序交出：先序遍历，同级文件夹按名字排序，与扫描快慢无关。
+ * 软链接指向的文件替换为真实路径，软链接指向的文件夹按设备号和inode去重避免循环
+ */
+class DirScanner
+{
+    friend class DirScanWorker;
+public:
+    /**
+     * @brief 文件筛选函数，在扫描线程中并发调用，参数为文件的真实路径
+     */
+    using Filter = std::function<bool(const QString &)>;
+    /**
+     * @brief 结果回调，在调用scan的线程中执行，参数为同一文件夹下筛选通过的全部文件，
+     * 按文件夹的先序遍历顺序调用
+     */
+    using BatchHandler = std::function<void(const QList<QUrl> &)>;
+
+    /**
+     * @param filter 为空时保留所有文件
+     * @param pStop 不为0时尽快结束扫描
+     */
+    DirScanner(const Filter &filter, const QAtomicInt *pStop);
+    ~DirScanner();
+
+    /**
+     * @brief 扫描文件夹，阻塞到全部完成或被中止
+     * @param lstDir 本地文件夹路径
+     * @param onBatch 每批结果的回调
+     * @return 全部筛选通过的文件
+     */
+    QList<QUrl> scan(const QStringList &lstDir, const BatchHandler &onBatch = nullptr);
+
+private:
+    /**
+     * @brief 文件夹的排序键，依次为起始文件夹序号和各级文件夹名，按键排序即为先序遍历顺序
+     */
+    using DirKey = QList<QByteArray>;
+    struct ScanDir {
+        QByteArray sPath;
+        DirKey key;
+    };
+    struct WorkQueue {
+        QMutex mutex;
+        QList<ScanDir> dirs;
+    };
+    struct DirResult {
+        bool bDone {false};
+        QList<QUrl> files;
+    };
+
+    bool isStopped() const;
+    void pushDir(int nIndex, const ScanDir &dir);
+    /**
+     * @brief 取下一个文件夹，自己的队列为空时窃取其他队列
+     */
+    bool takeDir(int nIndex, ScanDir &dir);
+    /**
+     * @brief 扫描线程空闲时等待新的文件夹，全部完成时返回false
+     */
+    bool waitForWork();
+    void scanDir(int nIndex, const ScanDir &dir);
+    /**
+     * @brief 记录文件夹扫描完成，同时登记其子文件夹，调用时需持有m_mutex
+     */
+    void finishResult(const DirKey &key, const QList<QUrl> &files, const QList<ScanDir> &listChild);
+    /**
+     * @brief 取出排在所有未完成文件夹之前的结果，调用时需持有m_mutex
+     */
+    QList<QList<QUrl>> takeOrderedResults();
+    /**
+     * @brief 记录已扫描的文件夹，重复时返回false
+     */
+    bool markVisited(int nFd);
+    void finishDir();
+
+private:
+    Filter m_filter;
+    const QAtomicInt *m_pStop {nullptr};
+    QList<WorkQueue *> m_queues;
+    std::atomic<int> m_nPending {0};        //已加入但未扫描完的文件夹数
+
+    QMutex m_mutex;                          //保护以下成员
+    QWaitCondition m_workCond;               //有新文件夹或全部完成
+    QWaitCondition m_resultCond;             //有新结果或全部完成
+    QMap<DirKey, DirResult> m_results;       //尚未交出的文件夹，包括已发现但未扫描完的
+    QSet<QPair<quint64, quint64>> m_visited; //已扫描文件夹的设备号和inode
+};
+
+}
+
+#endif /* ifndef _DMR_DIR_SCANNER_H */
@@ -5,6 +5,9 @@
 
 #include "filefilter.h"
 #include "compositing_manager.h"
+#include "media_probe.h"
+#include "dir_scanner.h"
+#include "gstutils.h"
 
 #include <iostream>
 #include <functional>
@@ -12,87 +15,27 @@ using namespace std;
 
 FileFilter* FileFilter::m_pFileFilter = new FileFilter;
 
-static mvideo_gst_discoverer_info_get_uri g_mvideo_gst_discoverer_info_get_uri = nullptr;
-static mvideo_gst_discoverer_info_get_result g_mvideo_gst_discoverer_info_get_result = nullptr;
-static mvideo_gst_discoverer_info_get_misc g_mvideo_gst_discoverer_info_get_misc = nullptr;
-static mvideo_gst_structure_to_string g_mvideo_gst_structure_to_string = nullptr;
-static mvideo_gst_discoverer_info_get_video_streams g_mvideo_gst_discoverer_info_get_video_streams = nullptr;
-static mvideo_gst_discoverer_info_get_audio_streams g_mvideo_gst_discoverer_info_get_audio_streams = nullptr;
-static mvideo_gst_discoverer_info_get_subtitle_streams g_mvideo_gst_discoverer_info_get_subtitle_streams = nullptr;
-
 FileFilter::FileFilter()
 {
     m_bMpvExists = dmr::CompositingManager::isMpvExists();
-    m_stopRunningThread = false;
-    m_pDiscoverer = nullptr;
-    m_pLoop = nullptr;
-    m_miType = MediaType::Other;
-
-    if (m_bMpvExists) {
-        QLibrary avformatLibrary(dmr::CompositingManager::libPath("libavformat.so"));
-
-        g_mvideo_avformat_open_input = (mvideo_avformat_open_input) avformatLibrary.resolve("avformat_open_input");
-        g_mvideo_avformat_find_stream_info = (mvideo_avformat_find_stream_info) avformatLibrary.resolve("avformat_find_stream_info");
-        g_mvideo_avformat_close_input = (mvideo_avformat_close_input) avformatLibrary.resolve("avformat_close_input");
-    } else {
-        QLibrary gstreamerLibrary(libPath("libgstreamer-1.0.so"));
-        QLibrary gstpbutilsLibrary(libPath("libgstpbutils-1.0.so"));
-
-        g_mvideo_gst_init = (mvideo_gst_init) gstreamerLibrary.resolve("gst_init");
-        g_mvideo_gst_discoverer_new = (mvideo_gst_discoverer_new) gstpbutilsLibrary.resolve("gst_discoverer_new");
-        g_mvideo_gst_discoverer_start = (mvideo_gst_discoverer_start) gstpbutilsLibrary.resolve("gst_discoverer_start");
-        g_mvideo_gst_discoverer_stop = (mvideo_gst_discoverer_stop) gstpbutilsLibrary.resolve("gst_discoverer_stop");
-        g_mvideo_gst_discoverer_discover_uri_async = (mvideo_gst_discoverer_discover_uri_async) gstpbutilsLibrary.resolve("gst_discoverer_discover_uri_async");
-
-        g_mvideo_gst_discoverer_info_get_uri = (mvideo_gst_discoverer_info_get_uri) gstpbutilsLibrary.resolve("gst_discoverer_info_get_uri");
-        g_mvideo_gst_discoverer_info_get_result = (mvideo_gst_discoverer_info_get_result) gstpbutilsLibrary.resolve("gst_discoverer_info_get_result");
-        g_mvideo_gst_discoverer_info_get_misc = (mvideo_gst_discoverer_info_get_misc) gstpbutilsLibrary.resolve("gst_discoverer_info_get_misc");
-        g_mvideo_gst_structure_to_string = (mvideo_gst_structure_to_string) gstreamerLibrary.resolve("gst_structure_to_string");
-        g_mvideo_gst_discoverer_info_get_video_streams = (mvideo_gst_discoverer_info_get_video_streams) gstpbutilsLibrary.resolve("gst_discoverer_info_get_video_streams");
-        g_mvideo_gst_discoverer_info_get_audio_streams = (mvideo_gst_discoverer_info_get_audio_streams) gstpbutilsLibrary.resolve("gst_discoverer_info_get_audio_streams");
-        g_mvideo_gst_discoverer_info_get_subtitle_streams = (mvideo_gst_discoverer_info_get_subtitle_streams) gstpbutilsLibrary.resolve("gst_discoverer_info_get_subtitle_streams");
-
-        g_mvideo_gst_init(nullptr, nullptr);
-
-        GError *pGErr = nullptr;
-        m_pDiscoverer = g_mvideo_gst_discoverer_new(5 * GST_SECOND, &pGErr);
-        m_pLoop = g_main_loop_new(nullptr, FALSE);
-
-        if (!m_pDiscoverer) {
-            qInfo() << "Error creating discoverer instance: " << pGErr->message;
-            g_clear_error (&pGErr);
+    m_stopRunningThread = 0;
+
+    //后缀表只在构造时生成，之后只读，扫描线程可并发查询
+    for (const QMimeType &mimeType : m_mimeDB.allMimeTypes()) {
+        const QString strName = mimeType.name();
+        if (strName.startsWith("audio/") || strName.startsWith("video/")) {
+            m_setMediaSuffix.unite(mimeType.suffixes().toSet());
+        } else if (strName.startsWith("image/") || strName.startsWith("text/") || strName.startsWith("font/")) {
+            m_setOtherSuffix.unite(mimeType.suffixes().toSet());
         }
-
-        g_signal_connect_data(m_pDiscoverer, "discovered", (GCallback)(discovered), &m_miType, nullptr, GConnectFlags(0));
-        g_signal_connect_data(m_pDiscoverer, "finished",  (GCallback)(finished), m_pLoop, nullptr, GConnectFlags(0));
-
-        g_mvideo_gst_discoverer_start(m_pDiscoverer);
     }
-}
-
-QString FileFilter::libPath(const QString &strlib)
-{
-    QDir  dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (strlib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(strlib)) {
-        return strlib;
-    } else {
-        list.sort();
-    }
-
-    if(list.size() > 0)
-        return list.last();
-    else
-        return QString();
+    //mime类型不在audio/、video/下的容器及裸流
+    m_setMediaSuffix << "rm" << "rmvb" << "ogg" << "ogx" << "asf" << "mxf" << "ts" << "m2ts" << "mts"
+                     << "264" << "h264" << "265" << "h265" << "hevc" << "ivf" << "y4m";
 }
 
 FileFilter::~FileFilter()
 {
-    g_mvideo_gst_discoverer_stop(m_pDiscoverer);
-    g_object_unref(m_pDiscoverer);
-    g_main_loop_unref(m_pLoop);
 }
 
 FileFilter *FileFilter::instance()
@@ -128,21 +71,84 @@ bool FileFilter::isMediaFile(QUrl url)
 
 QList<QUrl> FileFilter::filterDir(QDir dir)
 {
-    QList<QUrl> lstUrl;
-    QDir di(dir);
-
-    di.setFilter(QDir::AllEntries | QDir::NoDotAndDotDot);
-
-    for (QFileInfo fileInfo : di.entryInfoList()) {
-        if (fileInfo.isFile()) {
-            lstUrl.append(fileTransfer(fileInfo.filePath()));
-        } else if (fileInfo.isDir()) {
-            if (m_stopRunningThread)
-                return QList<QUrl>();
-            lstUrl << filterDir(fileInfo.absoluteFilePath());
+    dmr::DirScanner scanner(nullptr, &m_stopRunningThread);
+
+    return scanner.scan(QStringList() << dir.absolutePath());
+}
+
+QList<QUrl> FileFilter::filterMediaDirs(const QStringList &lstDir, const std::function<void(const QList<QUrl> &)> &onBatch)
+{
+    dmr::DirScanner scanner([this](const QString & strFile) {
+        return isMediaCandidate(strFile) && isMediaFile(QUrl::fromLocalFile(strFile));
+    }, &m_stopRunningThread);
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<QUrl> lstUrl = scanner.scan(lstDir, onBatch);
+    qInfo() << __func__ << "media files:" << lstUrl.size() << "elapsed(ms):" << timer.elapsed();
+
+    return lstUrl;
+}
+
+bool FileFilter::isMediaCandidate(const QString &strFile)
+{
+    const QString strSuffix = QFileInfo(strFile).suffix().toLower();
+
+    if (m_setMediaSuffix.contains(strSuffix)) {
+        return true;
+    }
+    if (m_setOtherSuffix.contains(strSuffix)) {
+        return false;
+    }
+
+    //未知后缀或无后缀的文件看文件头
+    return sniffMediaHeader(strFile);
+}
+
+bool FileFilter::sniffMediaHeader(const QString &strFile)
+{
+    QFile file(strFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    const QByteArray header = file.read(200);
+    if (header.size() < 4) {
+        return false;
+    }
+
+    const uchar *pData = reinterpret_cast<const uchar *>(header.constData());
+    static const char *const kMagics[] = {
+        "\x1a\x45\xdf\xa3",          // Matroska/WebM
+        "RIFF", "RF64", "FORM",       // AVI/WAV/AIFF
+        "OggS", "fLaC", "ID3", "FLV", ".RMF", "MAC ", "wvpk", "MPCK", "caff", "#!AMR", "DKIF", "YUV4MPEG2",
+        "\x30\x26\xb2\x75\x8e\x66\xcf\x11",  // ASF
+    };
+    for (const char *pMagic : kMagics) {
+        if (header.startsWith(pMagic)) {
+            return true;
         }
     }
-    return lstUrl;
+
+    // MP4/MOV的box类型
+    const QByteArray box = header.mid(4, 4);
+    if (box == "ftyp" || box == "moov" || box == "mdat" || box == "free" || box == "wide") {
+        return true;
+    }
+
+    // MPEG-PS/ES及H.264/H.265裸流的起始码
+    if (pData[0] == 0 && pData[1] == 0 && (pData[2] == 1 || (pData[2] == 0 && pData[3] == 1))) {
+        return true;
+    }
+
+    // MPEG-TS同步字节，M2TS每个包前有4字节时间戳
+    if ((header.size() > 188 && pData[0] == 0x47 && pData[188] == 0x47)
+            || (header.size() > 196 && pData[4] == 0x47 && pData[196] == 0x47)) {
+        return true;
+    }
+
+    // ADTS/MPEG音频帧同步
+    return pData[0] == 0xff && (pData[1] & 0xe0) == 0xe0;
 }
 
 QUrl FileFilter::fileTransfer(QString strFile)
@@ -211,172 +217,67 @@ bool FileFilter::isVideo(QUrl url)
 
 FileFilter::MediaType FileFilter::typeJudgeByFFmpeg(const QUrl &url)
 {
-    int nRet;
-    QString strFormatName;
-    bool bVCodec = false;
-    bool bACodec = false;
-    bool bSCodec = false;
     MediaType miType = MediaType::Other;
 
     QString strMimeType = m_mimeDB.mimeTypeForUrl(url).name();
 
-    AVFormatContext *av_ctx = nullptr;
-
-    nRet = g_mvideo_avformat_open_input(&av_ctx, url.toLocalFile().toUtf8().constData(), nullptr, nullptr);
-
-    if(nRet < 0)
-    {
+    //与播放列表、硬解探测共用同一次探测结果
+    dmr::MediaProbeResultPtr pProbe = dmr::MediaProbe::get().probe(url);
+    if (!pProbe->opened) {
         return MediaType::Other;
     }
-    if(g_mvideo_avformat_find_stream_info(av_ctx, nullptr) < 0)
-    {
-        return MediaType::Other;
-    }
-
-    strFormatName = av_ctx->iformat->long_name;
 
-    for (int i = 0; i < static_cast<int>(av_ctx->nb_streams); i++)
-     {
-         AVStream *in_stream = av_ctx->streams[i];
-
-         if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-             bVCodec = true;
-         } else if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) {
-             bACodec = true;
-         } else if (in_stream->codecpar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
-             bSCodec = true;
-         }
-    }
-
-    if (bVCodec) {
+    switch (pProbe->type) {
+    case dmr::MediaProbeResult::Video:
         miType = MediaType::Video;
-    } else if (bACodec) {
+        break;
+    case dmr::MediaProbeResult::Audio:
         miType = MediaType::Audio;
-    } else if (bSCodec) {
+        break;
+    case dmr::MediaProbeResult::Subtitle:
         miType = MediaType::Subtitle;
-    } else {
+        break;
+    default:
         miType = MediaType::Other;
+        break;
     }
+
     if (strMimeType.contains("x-7z")){ //7z压缩包中会检测出音频流
         miType = MediaType::Other;
     }
-    if(strFormatName.contains("Tele-typewriter") || strMimeType.startsWith("image/"))       // 排除文本文件，如果只用mimetype判断会遗漏部分原始格式文件如：h264裸流
+    if(pProbe->formatName.contains("Tele-typewriter") || strMimeType.startsWith("image/"))       // 排除文本文件，如果只用mimetype判断会遗漏部分原始格式文件如：h264裸流
         miType = MediaType::Other;
 
-    g_mvideo_avformat_close_input(&av_ctx);
-
     return  miType;
 }
 
 FileFilter::MediaType FileFilter::typeJudgeByGst(const QUrl &url)
 {
-    char *uri = nullptr;
-    uri = new char[200];
-
-    m_miType = MediaType::Other;
-
     QString strMimeType = m_mimeDB.mimeTypeForUrl(url).name();
 
     if (!strMimeType.startsWith("audio/") && !strMimeType.startsWith("video/")) {
-        delete []uri;
         return MediaType::Other;
     }
 
-    uri = strcpy(uri, url.toString().toUtf8().constData());
-
-    if (!g_mvideo_gst_discoverer_discover_uri_async (m_pDiscoverer, uri)) {
-      qInfo() << "Failed to start discovering URI " << uri;
-      g_object_unref (m_pDiscoverer);
-    }
-
-    g_main_loop_run(m_pLoop);
-
-    delete []uri;
-
-    return m_miType;
-}
-
-void FileFilter::stopThread()
-{
-    m_stopRunningThread = true;
-}
-
-void FileFilter::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GError *err, MediaType *miType)
-{
-    Q_UNUSED(discoverer);
-
-    GstDiscovererResult result;
-    const gchar *uri;
-    bool bVideo = false;
-    bool bAudio = false;
-    bool bSubtitle = false;
-
-    uri = g_mvideo_gst_discoverer_info_get_uri (info);
-    result = g_mvideo_gst_discoverer_info_get_result (info);
-
-    switch (result) {
-      case GST_DISCOVERER_URI_INVALID:
-        qInfo() << "Invalid URI " << uri;
-        break;
-      case GST_DISCOVERER_ERROR:
-        qInfo() << "Discoverer error: " << err->message;
-        break;
-      case GST_DISCOVERER_TIMEOUT:
-        qInfo() << "Timeout";
-        break;
-      case GST_DISCOVERER_BUSY:
-        qInfo() << "Busy";
-        break;
-      case GST_DISCOVERER_MISSING_PLUGINS:{
-        const GstStructure *s;
-        gchar *str;
-
-        s = g_mvideo_gst_discoverer_info_get_misc (info);
-        str = g_mvideo_gst_structure_to_string (s);
-
-        qInfo() << "Missing plugins: " << str;
-        g_free (str);
-        break;
-      }
-      case GST_DISCOVERER_OK:
-        qInfo() << "Discovered " << uri;
-        break;
-    }
-
-    if (result != GST_DISCOVERER_OK) {
-      qInfo() << "This URI cannot be played";
-      return;
-    }
-
-    GList *list;
-    list = g_mvideo_gst_discoverer_info_get_video_streams(info);
-    if (list) {
-       bVideo = true;
-    }
-    list = g_mvideo_gst_discoverer_info_get_audio_streams(info);
-    if (list) {
-        bAudio = true;
-    }
-    list = g_mvideo_gst_discoverer_info_get_subtitle_streams(info);
-    if(list) {
-        bSubtitle = true;
+    //与播放列表共用同一次探测结果，多个线程可同时探测
+    dmr::MediaProbeResultPtr pProbe = dmr::GstUtils::get()->discover(url).result();
+    if (!pProbe->opened) {
+        return MediaType::Other;
     }
 
-    if (bVideo) {
-        *miType = MediaType::Video;
-    } else if (bAudio) {
-        *miType = MediaType::Audio;
-    } else if (bSubtitle) {
-        *miType = MediaType::Subtitle;
-    } else {
-        *miType = MediaType::Other;
+    switch (pProbe->type) {
+    case dmr::MediaProbeResult::Video:
+        return MediaType::Video;
+    case dmr::MediaProbeResult::Audio:
+        return MediaType::Audio;
+    case dmr::MediaProbeResult::Subtitle:
+        return MediaType::Subtitle;
+    default:
+        return MediaType::Other;
     }
 }
 
-void FileFilter::finished(GstDiscoverer *discoverer, GMainLoop *loop)
+void FileFilter::stopThread()
 {
-    Q_UNUSED(discoverer);
-
-    g_main_loop_quit(loop);
+    m_stopRunningThread.store(1);
 }
-
@@ -13,35 +13,21 @@
 #include <QLibraryInfo>
 #include <QFileInfo>
 #include <QMap>
+#include <QSet>
 #include <QMimeDatabase>
 #include <QMimeType>
+#include <QAtomicInt>
 
-extern "C" {
-#include <libavformat/avformat.h>
-}
+#include <functional>
 
 extern "C" {
-#include <string.h>
-#include <gst/gst.h>
-#include <gst/pbutils/pbutils.h>
+#include <libavformat/avformat.h>
 }
 
 typedef int (*mvideo_avformat_open_input)(AVFormatContext **ps, const char *url, AVInputFormat *fmt, AVDictionary **options);
 typedef int (*mvideo_avformat_find_stream_info)(AVFormatContext *ic, AVDictionary **options);
 typedef void (*mvideo_avformat_close_input)(AVFormatContext **s);
 
-typedef void (*mvideo_gst_init)(int *argc, char **argv[]);
-typedef GstDiscoverer* (*mvideo_gst_discoverer_new)(GstClockTime timeout, GError **err);
-typedef void (*mvideo_gst_discoverer_start) (GstDiscoverer *discoverer);
-typedef void (*mvideo_gst_discoverer_stop) (GstDiscoverer *discoverer);
-typedef gboolean (*mvideo_gst_discoverer_discover_uri_async) (GstDiscoverer *discoverer, const gchar *uri);
-typedef gchar* (*mvideo_gst_discoverer_info_get_uri) (const GstDiscovererInfo* info);
-typedef GstDiscovererResult (*mvideo_gst_discoverer_info_get_result) (const GstDiscovererInfo* info);
-typedef const GstStructure* (*mvideo_gst_discoverer_info_get_misc) (const GstDiscovererInfo* info);
-typedef gchar* (*mvideo_gst_structure_to_string) (const GstStructure * structure);
-typedef GList* (*mvideo_gst_discoverer_info_get_video_streams) (GstDiscovererInfo *info);
-typedef GList* (*mvideo_gst_discoverer_info_get_audio_streams) (GstDiscovererInfo *info);
-typedef GList* (*mvideo_gst_discoverer_info_get_subtitle_streams) (GstDiscovererInfo *info);
 
 /**
  * @file 处理输入文件的公共类，对输入文件的路径做转换
@@ -74,6 +60,19 @@ public:
      * @return 返回url路径集合
      */
     QList<QUrl> filterDir(QDir dir);
+    /**
+     * @brief 并行扫描文件夹并筛选出多媒体文件，先按后缀和文件头排除，再完整探测
+     * @param 本地文件夹路径
+     * @param 每批结果的回调，在调用线程中执行
+     * @return 返回url路径集合，中止时为空
+     */
+    QList<QUrl> filterMediaDirs(const QStringList &lstDir, const std::function<void(const QList<QUrl> &)> &onBatch = nullptr);
+    /**
+     * @brief 不打开解码器，仅根据后缀和文件头判断是否可能是多媒体文件，可在任意线程调用
+     * @param 本地文件路径
+     * @return 明显不是多媒体文件时返回false
+     */
+    bool isMediaCandidate(const QString &strFile);
     /**
      * @brief 转化文件字符路径为url
      * @param 文件路径
@@ -105,41 +104,30 @@ public:
      */
     MediaType typeJudgeByFFmpeg(const QUrl& url);
     /**
-     * @brief 通过Qt判断文件类型
+     * @brief 通过gstreamer探测服务判断文件类型
      * @param 文件路径
      * @return 类型
      */
     MediaType typeJudgeByGst(const QUrl& url);
 
-    static void discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GError *err, MediaType *miType);
-
-    static void finished(GstDiscoverer *discoverer, GMainLoop *loop);
-
     void stopThread();
 private:
     FileFilter();
 
-    QString libPath(const QString &strlib);
+    /**
+     * @brief 读取文件头，匹配常见的音视频容器和裸流特征
+     */
+    bool sniffMediaHeader(const QString &strFile);
 
 private:
     static FileFilter* m_pFileFilter;
     QMap<QUrl, bool> m_mapCheckAudio;//检测播放文件中的音视频信息
-    mvideo_avformat_open_input g_mvideo_avformat_open_input = nullptr;
-    mvideo_avformat_find_stream_info g_mvideo_avformat_find_stream_info = nullptr;
-    mvideo_avformat_close_input g_mvideo_avformat_close_input = nullptr;
-
-    mvideo_gst_init g_mvideo_gst_init = nullptr;
-    mvideo_gst_discoverer_new g_mvideo_gst_discoverer_new = nullptr;
-    mvideo_gst_discoverer_start g_mvideo_gst_discoverer_start = nullptr;
-    mvideo_gst_discoverer_stop g_mvideo_gst_discoverer_stop = nullptr;
-    mvideo_gst_discoverer_discover_uri_async g_mvideo_gst_discoverer_discover_uri_async = nullptr;
 
     QMimeDatabase m_mimeDB;
+    QSet<QString> m_setMediaSuffix;      //音视频后缀
+    QSet<QString> m_setOtherSuffix;      //图片、文本等后缀
     bool m_bMpvExists;
-    bool m_stopRunningThread;
-    GstDiscoverer* m_pDiscoverer;
-    GMainLoop* m_pLoop;
-    MediaType m_miType;
+    QAtomicInt m_stopRunningThread;
 };
 
 #endif // FILEFILTER_H
@@ -0,0 +1,388 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "film_strip.h"
+#include "compositing_manager.h"
+#include "runtime_registry.h"
+#include "utils.h"
+
+#include <QLibrary>
+#include <QSaveFile>
+
+#define FILM_STRIP_CACHE_MAGIC 0x444d4653    //"DMFS"
+#define FILM_STRIP_CACHE_VERSION 1
+#define FILM_STRIP_CACHE_COUNT 32           //缓存目录中最多保留的胶片条数量
+#define FILM_STRIP_SEEK_PACKETS 512         //定位后查找关键帧最多读取的包数
+
+namespace dmr {
+
+enum DecodeResult {
+    DecodeFailed = 0,
+    DecodeSameKey,      //与上一张胶片落在同一关键帧，未解码
+    DecodeDone
+};
+
+FilmStrip &FilmStrip::get()
+{
+    static FilmStrip strip;
+    return strip;
+}
+
+FilmStrip::FilmStrip()
+{
+    m_sCacheDir = QString("%1/filmstrip").arg(QStandardPaths::writableLocation(QStandardPaths::CacheLocation));
+}
+
+QString FilmStrip::cacheDir() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_sCacheDir;
+}
+
+void FilmStrip::setCacheDir(const QString &sDir)
+{
+    QMutexLocker lock(&m_mutex);
+    m_sCacheDir = sDir;
+}
+
+void FilmStrip::initFFmpegInterface()
+{
+    QLibrary &avcodecLibrary = RuntimeRegistry::get().library("libavcodec.so");
+    QLibrary &avformatLibrary = RuntimeRegistry::get().library("libavformat.so");
+    QLibrary &avutilLibrary = RuntimeRegistry::get().library("libavutil.so");
+    QLibrary &swscaleLibrary = RuntimeRegistry::get().library("libswscale.so");
+
+    m_avformatOpenInput = reinterpret_cast<stripAvformatOpenInput>(avformatLibrary.resolve("avformat_open_input"));
+    m_avformatFindStreamInfo = reinterpret_cast<stripAvformatFindStreamInfo>(avformatLibrary.resolve("avformat_find_stream_info"));
+    m_avFindBestStream = reinterpret_cast<stripAvFindBestStream>(avformatLibrary.resolve("av_find_best_stream"));
+    m_avformatCloseInput = reinterpret_cast<stripAvformatCloseInput>(avformatLibrary.resolve("avformat_close_input"));
+    m_avSeekFrame = reinterpret_cast<stripAvSeekFrame>(avformatLibrary.resolve("av_seek_frame"));
+    m_avReadFrame = reinterpret_cast<stripAvReadFrame>(avformatLibrary.resolve("av_read_frame"));
+    m_avcodecAllocContext3 = reinterpret_cast<stripAvcodecAllocContext3>(avcodecLibrary.resolve("avcodec_alloc_context3"));
+    m_avcodecParametersToContext = reinterpret_cast<stripAvcodecParametersToContext>(avcodecLibrary.resolve("avcodec_parameters_to_context"));
+    m_avcodecOpen2 = reinterpret_cast<stripAvcodecOpen2>(avcodecLibrary.resolve("avcodec_open2"));
+    m_avcodecFreeContext = reinterpret_cast<stripAvcodecFreeContext>(avcodecLibrary.resolve("avcodec_free_context"));
+    m_avcodecSendPacket = reinterpret_cast<stripAvcodecSendPacket>(avcodecLibrary.resolve("avcodec_send_packet"));
+    m_avcodecReceiveFrame = reinterpret_cast<stripAvcodecReceiveFrame>(avcodecLibrary.resolve("avcodec_receive_frame"));
+    m_avcodecFlushBuffers = reinterpret_cast<stripAvcodecFlushBuffers>(avcodecLibrary.resolve("avcodec_flush_buffers"));
+    m_avPacketAlloc = reinterpret_cast<stripAvPacketAlloc>(avcodecLibrary.resolve("av_packet_alloc"));
+    m_avPacketFree = reinterpret_cast<stripAvPacketFree>(avcodecLibrary.resolve("av_packet_free"));
+    m_avPacketUnref = reinterpret_cast<stripAvPacketUnref>(avcodecLibrary.resolve("av_packet_unref"));
+    m_avFrameAlloc = reinterpret_cast<stripAvFrameAlloc>(avutilLibrary.resolve("av_frame_alloc"));
+    m_avFrameFree = reinterpret_cast<stripAvFrameFree>(avutilLibrary.resolve("av_frame_free"));
+    m_swsGetCachedContext = reinterpret_cast<stripSwsGetCachedContext>(swscaleLibrary.resolve("sws_getCachedContext"));
+    m_swsScale = reinterpret_cast<stripSwsScale>(swscaleLibrary.resolve("sws_scale"));
+    m_swsFreeContext = reinterpret_cast<stripSwsFreeContext>(swscaleLibrary.resolve("sws_freeContext"));
+
+    m_bInited = true;
+}
+
+QImage FilmStrip::generate(const QFileInfo &fi, int nCount, const QSize &sliceSize,
+                           const std::function<bool()> &interrupted)
+{
+    if (nCount <= 0 || sliceSize.isEmpty() || !fi.exists()) {
+        return QImage();
+    }
+
+    const QString sCache = cachePath(fi, nCount, sliceSize);
+    if (!sCache.isEmpty()) {
+        QImage strip = readCache(sCache);
+        if (!strip.isNull()) {
+            return strip;
+        }
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    const int nSliceWidth = sliceSize.width();
+    const int nSliceHeight = sliceSize.height();
+    QImage strip(nSliceWidth * nCount, nSliceHeight, QImage::Format_RGB32);
+    strip.fill(Qt::black);
+
+    //取每段的中间时刻，解出的画面取中间部分拼接
+    const int nDecoded = walkKeyFrames(fi, [nCount](double dDuration) {
+        QList<double> listSecs;
+        for (int i = 0; i < nCount; i++) {
+            listSecs.append(dDuration * (i + 0.5) / nCount);
+        }
+        return listSecs;
+    }, sliceSize, [&](int nIndex, const QImage &frame) {
+        const int nOffsetX = (frame.width() - nSliceWidth) / 2;
+        const int nOffsetY = (frame.height() - nSliceHeight) / 2;
+        for (int y = 0; y < nSliceHeight; y++) {
+            memcpy(strip.scanLine(y) + nIndex * nSliceWidth * 4, frame.constScanLine(y + nOffsetY) + nOffsetX * 4,
+                   static_cast<size_t>(nSliceWidth * 4));
+        }
+        return true;
+    }, interrupted);
+
+    if (nDecoded <= 0 || (interrupted && interrupted())) {
+        return QImage();
+    }
+    qInfo() << "film strip generated(ms):" << timer.elapsed() << "count:" << nCount;
+
+    if (!sCache.isEmpty()) {
+        writeCache(sCache, strip);
+    }
+
+    return strip;
+}
+
+int FilmStrip::walkKeyFrames(const QFileInfo &fi, const std::function<QList<double>(double)> &targets,
+                             const QSize &coverSize, const std::function<bool(int, const QImage &)> &frameReady,
+                             const std::function<bool()> &interrupted)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_bInited) {
+            initFFmpegInterface();
+        }
+    }
+
+    if (!m_avformatOpenInput || !m_avformatFindStreamInfo || !m_avFindBestStream || !m_avformatCloseInput
+            || !m_avSeekFrame || !m_avReadFrame || !m_avcodecAllocContext3 || !m_avcodecParametersToContext
+            || !m_avcodecOpen2 || !m_avcodecFreeContext || !m_avcodecSendPacket || !m_avcodecReceiveFrame
+            || !m_avcodecFlushBuffers || !m_avPacketAlloc || !m_avPacketFree || !m_avPacketUnref
+            || !m_avFrameAlloc || !m_avFrameFree || !m_swsGetCachedContext || !m_swsScale || !m_swsFreeContext) {
+        return -1;
+    }
+    if (coverSize.isEmpty()) {
+        return -1;
+    }
+
+    AVFormatContext *pFormatCtx = nullptr;
+    if (m_avformatOpenInput(&pFormatCtx, fi.filePath().toUtf8().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "avformat: could not open input";
+        return -1;
+    }
+    if (m_avformatFindStreamInfo(pFormatCtx, nullptr) < 0) {
+        qWarning() << "av_find_stream_info failed";
+        m_avformatCloseInput(&pFormatCtx);
+        return -1;
+    }
+
+    AVCodec *pCodec = nullptr;
+    const int nStream = m_avFindBestStream(pFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, &pCodec, 0);
+    if (nStream < 0 || !pCodec) {
+        m_avformatCloseInput(&pFormatCtx);
+        return -1;
+    }
+
+    AVStream *pStream = pFormatCtx->streams[nStream];
+    const double dTimeBase = av_q2d(pStream->time_base);
+    double dDuration = 0;
+    if (pStream->duration != AV_NOPTS_VALUE) {
+        dDuration = pStream->duration * dTimeBase;
+    } else if (pFormatCtx->duration != AV_NOPTS_VALUE) {
+        dDuration = static_cast<double>(pFormatCtx->duration) / AV_TIME_BASE;
+    }
+    const int64_t nStartPts = pStream->start_time != AV_NOPTS_VALUE ? pStream->start_time : 0;
+    if (dDuration <= 0 || dTimeBase <= 0) {
+        m_avformatCloseInput(&pFormatCtx);
+        return -1;
+    }
+
+    AVCodecContext *pCodecCtx = m_avcodecAllocContext3(pCodec);
+    if (!pCodecCtx || m_avcodecParametersToContext(pCodecCtx, pStream->codecpar) < 0) {
+        m_avcodecFreeContext(&pCodecCtx);
+        m_avformatCloseInput(&pFormatCtx);
+        return -1;
+    }
+    //只解关键帧，解码器支持时按缩小后仍不低于目标尺寸选择低分辨率解码
+    int nLowres = 0;
+    while (nLowres < pCodec->max_lowres
+            && (pCodecCtx->height >> (nLowres + 1)) >= coverSize.height()
+            && (pCodecCtx->width >> (nLowres + 1)) >= coverSize.width()) {
+        nLowres++;
+    }
+    pCodecCtx->lowres = nLowres;
+    pCodecCtx->skip_frame = AVDISCARD_NONKEY;
+    pCodecCtx->skip_loop_filter = AVDISCARD_ALL;
+    pCodecCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+    if (m_avcodecOpen2(pCodecCtx, pCodec, nullptr) < 0) {
+        qWarning() << "avcodec: could not open decoder";
+        m_avcodecFreeContext(&pCodecCtx);
+        m_avformatCloseInput(&pFormatCtx);
+        return -1;
+    }
+
+    AVPacket *pPacket = m_avPacketAlloc();
+    AVFrame *pFrame = m_avFrameAlloc();
+    SwsContext *pSwsCtx = nullptr;
+    QImage scaled;
+
+    const QList<double> listSecs = targets(dDuration);
+    int nDecoded = 0;
+    int64_t nLastKeyPts = AV_NOPTS_VALUE;
+    for (int i = 0; i < listSecs.size() && pPacket && pFrame; i++) {
+        if (interrupted && interrupted()) {
+            break;
+        }
+
+        //按关键帧索引向前定位
+        const int64_t nTarget = nStartPts + static_cast<int64_t>(listSecs[i] / dTimeBase);
+        if (m_avSeekFrame(pFormatCtx, nStream, nTarget, AVSEEK_FLAG_BACKWARD) < 0) {
+            continue;
+        }
+        m_avcodecFlushBuffers(pCodecCtx);
+
+        int64_t nKeyPts = AV_NOPTS_VALUE;
+        const int nResult = decodeKeyFrame(pFormatCtx, pCodecCtx, nStream, pPacket, pFrame, nLastKeyPts, nKeyPts);
+        if (nResult == DecodeSameKey && !scaled.isNull()) {
+            nDecoded++;
+            if (!frameReady(i, scaled)) {
+                break;
+            }
+            continue;
+        }
+        if (nResult != DecodeDone) {
+            continue;
+        }
+
+        //按显示宽高比缩放到刚好覆盖目标尺寸
+        double dAspect = pFrame->height > 0 ? static_cast<double>(pFrame->width) / pFrame->height : 1.0;
+        if (pFrame->sample_aspect_ratio.num > 0 && pFrame->sample_aspect_ratio.den > 0) {
+            dAspect *= av_q2d(pFrame->sample_aspect_ratio);
+        }
+        QSize scaledSize(qRound(coverSize.height() * dAspect), coverSize.height());
+        if (scaledSize.width() < coverSize.width()) {
+            scaledSize = QSize(coverSize.width(), qRound(coverSize.width() / dAspect));
+        }
+        pSwsCtx = m_swsGetCachedContext(pSwsCtx, pFrame->width, pFrame->height, static_cast<AVPixelFormat>(pFrame->format),
+                                        scaledSize.width(), scaledSize.height(), AV_PIX_FMT_RGB32, SWS_BILINEAR,
+                                        nullptr, nullptr, nullptr);
+        if (!pSwsCtx) {
+            continue;
+        }
+        if (scaled.size() != scaledSize) {
+            scaled = QImage(scaledSize, QImage::Format_RGB32);
+        }
+        uint8_t *pDst[4] = {scaled.bits(), nullptr, nullptr, nullptr};
+        int nDstStride[4] = {scaled.bytesPerLine(), 0, 0, 0};
+        m_swsScale(pSwsCtx, pFrame->data, pFrame->linesize, 0, pFrame->height, pDst, nDstStride);
+
+        nLastKeyPts = nKeyPts;
+        nDecoded++;
+        if (!frameReady(i, scaled)) {
+            break;
+        }
+    }
+
+    m_swsFreeContext(pSwsCtx);
+    m_avFrameFree(&pFrame);
+    m_avPacketFree(&pPacket);
+    m_avcodecFreeContext(&pCodecCtx);
+    m_avformatCloseInput(&pFormatCtx);
+
+    return nDecoded;
+}
+
+int FilmStrip::decodeKeyFrame(AVFormatContext *pFormatCtx, AVCodecContext *pCodecCtx, int nStream,
+                              AVPacket *pPacket, AVFrame *pFrame, int64_t nLastKeyPts, int64_t &nKeyPts)
+{
+    bool bSent = false;
+    for (int i = 0; i < FILM_STRIP_SEEK_PACKETS; i++) {
+        if (m_avReadFrame(pFormatCtx, pPacket) < 0) {
+            break;
+        }
+        if (pPacket->stream_index != nStream || (!bSent && !(pPacket->flags & AV_PKT_FLAG_KEY))) {
+            m_avPacketUnref(pPacket);
+            continue;
+        }
+
+        if (!bSent) {
+            nKeyPts = pPacket->pts != AV_NOPTS_VALUE ? pPacket->pts : pPacket->dts;
+            if (nKeyPts != AV_NOPTS_VALUE && nKeyPts == nLastKeyPts) {
+                m_avPacketUnref(pPacket);
+                return DecodeSameKey;
+            }
+            bSent = true;
+        }
+
+        const int nRet = m_avcodecSendPacket(pCodecCtx, pPacket);
+        m_avPacketUnref(pPacket);
+        if (nRet < 0 && nRet != AVERROR(EAGAIN)) {
+            return DecodeFailed;
+        }
+        if (m_avcodecReceiveFrame(pCodecCtx, pFrame) == 0) {
+            return DecodeDone;
+        }
+    }
+
+    //已到文件结尾，取出解码器中缓存的帧
+    if (bSent && m_avcodecSendPacket(pCodecCtx, nullptr) >= 0 && m_avcodecReceiveFrame(pCodecCtx, pFrame) == 0) {
+        return DecodeDone;
+    }
+
+    return DecodeFailed;
+}
+
+QString FilmStrip::cachePath(const QFileInfo &fi, int nCount, const QSize &sliceSize) const
+{
+    const QString sHash = utils::FastFileHash(fi);
+    if (sHash.isEmpty()) {
+        return QString();
+    }
+
+    return QString("%1/%2-%3-%4-%5x%6")
+           .arg(cacheDir())
+           .arg(sHash).arg(fi.size()).arg(nCount)
+           .arg(sliceSize.width()).arg(sliceSize.height());
+}
+
+QImage FilmStrip::readCache(const QString &sPath) const
+{
+    QFile file(sPath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QImage();
+    }
+
+    QDataStream stream(&file);
+    quint32 nMagic = 0;
+    quint32 nVersion = 0;
+    qint32 nWidth = 0;
+    qint32 nHeight = 0;
+    stream >> nMagic >> nVersion >> nWidth >> nHeight;
+    if (nMagic != FILM_STRIP_CACHE_MAGIC || nVersion != FILM_STRIP_CACHE_VERSION || nWidth <= 0 || nHeight <= 0) {
+        return QImage();
+    }
+
+    //RGB32的行宽没有填充，像素数据整块读入
+    QImage strip(nWidth, nHeight, QImage::Format_RGB32);
+    const qint64 nSize = static_cast<qint64>(strip.bytesPerLine()) * strip.height();
+    if (file.bytesAvailable() != nSize
+            || file.read(reinterpret_cast<char *>(strip.bits()), nSize) != nSize) {
+        return QImage();
+    }
+
+    //刷新修改时间作为最近使用时间，供淘汰时排序
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    return strip;
+}
+
+void FilmStrip::writeCache(const QString &sPath, const QImage &strip) const
+{
+    QFileInfo fi(sPath);
+    QDir dir = fi.absoluteDir();
+    dir.mkpath(".");
+
+    //超出数量时删除最久未使用的胶片条
+    QFileInfoList listOld = dir.entryInfoList(QDir::Files, QDir::Time);
+    for (int i = FILM_STRIP_CACHE_COUNT - 1; i < listOld.size(); i++) {
+        QFile::remove(listOld[i].absoluteFilePath());
+    }
+
+    QSaveFile file(sPath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream << quint32(FILM_STRIP_CACHE_MAGIC) << quint32(FILM_STRIP_CACHE_VERSION)
+           << qint32(strip.width()) << qint32(strip.height());
+    file.write(reinterpret_cast<const char *>(strip.constBits()), static_cast<qint64>(strip.bytesPerLine()) * strip.height());
+    file.commit();
+}
+
+}
@@ -0,0 +1,135 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_FILM_STRIP_H
+#define _DMR_FILM_STRIP_H
+
+#include <QtCore>
+#include <QImage>
+
+#include <functional>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libswscale/swscale.h>
+}
+
+namespace dmr {
+
+typedef int (*stripAvformatOpenInput)(AVFormatContext **ps, const char *url, AVInputFormat *fmt, AVDictionary **options);
+typedef int (*stripAvformatFindStreamInfo)(AVFormatContext *ic, AVDictionary **options);
+typedef int (*stripAvFindBestStream)(AVFormatContext *ic, enum AVMediaType type, int wanted_stream_nb, int related_stream, AVCodec **decoder_ret, int flags);
+typedef void (*stripAvformatCloseInput)(AVFormatContext **s);
+typedef int (*stripAvSeekFrame)(AVFormatContext *s, int stream_index, int64_t timestamp, int flags);
+typedef int (*stripAvReadFrame)(AVFormatContext *s, AVPacket *pkt);
+typedef AVCodecContext *(*stripAvcodecAllocContext3)(const AVCodec *codec);
+typedef int (*stripAvcodecParametersToContext)(AVCodecContext *codec, const AVCodecParameters *par);
+typedef int (*stripAvcodecOpen2)(AVCodecContext *avctx, const AVCodec *codec, AVDictionary **options);
+typedef void (*stripAvcodecFreeContext)(AVCodecContext **avctx);
+typedef int (*stripAvcodecSendPacket)(AVCodecContext *avctx, const AVPacket *avpkt);
+typedef int (*stripAvcodecReceiveFrame)(AVCodecContext *avctx, AVFrame *frame);
+typedef void (*stripAvcodecFlushBuffers)(AVCodecContext *avctx);
+typedef AVPacket *(*stripAvPacketAlloc)(void);
+typedef void (*stripAvPacketFree)(AVPacket **pkt);
+typedef void (*stripAvPacketUnref)(AVPacket *pkt);
+typedef AVFrame *(*stripAvFrameAlloc)(void);
+typedef void (*stripAvFrameFree)(AVFrame **frame);
+typedef SwsContext *(*stripSwsGetCachedContext)(SwsContext *context, int srcW, int srcH, enum AVPixelFormat srcFormat,
+                                                int dstW, int dstH, enum AVPixelFormat dstFormat, int flags,
+                                                SwsFilter *srcFilter, SwsFilter *dstFilter, const double *param);
+typedef int (*stripSwsScale)(SwsContext *c, const uint8_t *const srcSlice[], const int srcStride[],
+                             int srcSliceY, int srcSliceH, uint8_t *const dst[], const int dstStride[]);
+typedef void (*stripSwsFreeContext)(SwsContext *swsContext);
+
+/**
+ * @file 胶片进度条图像生成
+ * 每个文件只打开一次，按关键帧索引定位，解码器只解关键帧并使用低分辨率解码，
+ * 直接缩放为RGB拼接成一张胶片条；结果按文件内容和尺寸保存在缓存目录，再次打开时直接读取。
+ * 关键帧遍历也供预览图集生成使用
+ */
+class FilmStrip
+{
+public:
+    static FilmStrip &get();
+
+    /**
+     * @brief 生成胶片条，可在任意线程调用
+     * @param fi 本地视频文件
+     * @param nCount 胶片张数
+     * @param sliceSize 单张胶片的像素尺寸，取画面中间部分
+     * @param interrupted 返回true时放弃生成
+     * @return nCount张胶片横向拼接的图像，失败或中止时返回空图像
+     */
+    QImage generate(const QFileInfo &fi, int nCount, const QSize &sliceSize,
+                    const std::function<bool()> &interrupted = nullptr);
+
+    /**
+     * @brief 依次定位到各时间点前最近的关键帧并解码，可在任意线程调用
+     * @param fi 本地视频文件
+     * @param targets 根据视频时长(秒)返回升序的时间点(秒)
+     * @param coverSize 解出的画面保持宽高比缩放到刚好覆盖该尺寸
+     * @param frameReady 时间点解码完成时调用，参数为时间点序号和画面，返回false时停止
+     * @param interrupted 返回true时停止
+     * @return 解码成功的时间点数量，无法打开文件时返回-1
+     */
+    int walkKeyFrames(const QFileInfo &fi, const std::function<QList<double>(double)> &targets,
+                      const QSize &coverSize, const std::function<bool(int, const QImage &)> &frameReady,
+                      const std::function<bool()> &interrupted = nullptr);
+
+    /**
+     * @brief 胶片条缓存目录
+     */
+    QString cacheDir() const;
+    /**
+     * @brief 切换胶片条缓存目录
+     */
+    void setCacheDir(const QString &sDir);
+
+private:
+    FilmStrip();
+    void initFFmpegInterface();
+    /**
+     * @brief 解码定位后遇到的第一个关键帧
+     * @param nLastKeyPts 上一张胶片使用的关键帧时间戳，相同时不再解码
+     * @param nKeyPts 输出该关键帧的时间戳
+     * @return DecodeResult
+     */
+    int decodeKeyFrame(AVFormatContext *pFormatCtx, AVCodecContext *pCodecCtx, int nStream,
+                       AVPacket *pPacket, AVFrame *pFrame, int64_t nLastKeyPts, int64_t &nKeyPts);
+    QString cachePath(const QFileInfo &fi, int nCount, const QSize &sliceSize) const;
+    QImage readCache(const QString &sPath) const;
+    void writeCache(const QString &sPath, const QImage &strip) const;
+
+private:
+    mutable QMutex m_mutex;
+    bool m_bInited {false};
+    QString m_sCacheDir;
+
+    stripAvformatOpenInput m_avformatOpenInput {nullptr};
+    stripAvformatFindStreamInfo m_avformatFindStreamInfo {nullptr};
+    stripAvFindBestStream m_avFindBestStream {nullptr};
+    stripAvformatCloseInput m_avformatCloseInput {nullptr};
+    stripAvSeekFrame m_avSeekFrame {nullptr};
+    stripAvReadFrame m_avReadFrame {nullptr};
+    stripAvcodecAllocContext3 m_avcodecAllocContext3 {nullptr};
+    stripAvcodecParametersToContext m_avcodecParametersToContext {nullptr};
+    stripAvcodecOpen2 m_avcodecOpen2 {nullptr};
+    stripAvcodecFreeContext m_avcodecFreeContext {nullptr};
+    stripAvcodecSendPacket m_avcodecSendPacket {nullptr};
+    stripAvcodecReceiveFrame m_avcodecReceiveFrame {nullptr};
+    stripAvcodecFlushBuffers m_avcodecFlushBuffers {nullptr};
+    stripAvPacketAlloc m_avPacketAlloc {nullptr};
+    stripAvPacketFree m_avPacketFree {nullptr};
+    stripAvPacketUnref m_avPacketUnref {nullptr};
+    stripAvFrameAlloc m_avFrameAlloc {nullptr};
+    stripAvFrameFree m_avFrameFree {nullptr};
+    stripSwsGetCachedContext m_swsGetCachedContext {nullptr};
+    stripSwsScale m_swsScale {nullptr};
+    stripSwsFreeContext m_swsFreeContext {nullptr};
+};
+
+}
+
+#endif /* ifndef _DMR_FILM_STRIP_H */
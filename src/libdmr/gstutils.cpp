@@ -5,8 +5,14 @@
 
 #include "gstutils.h"
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 
 #include <QDebug>
+#include <QCoreApplication>
+
+#define DISCOVER_TIMEOUT 5          //单个文件探测超时(秒)
+#define DISCOVER_MAX_LANES 4        //探测线程数上限
+#define DISCOVER_CACHE_SIZE 512     //缓存的探测结果数量
 
 namespace dmr {
 
@@ -16,6 +22,8 @@ static mvideo_gst_discoverer_info_get_misc g_mvideo_gst_discoverer_info_get_misc
 static mvideo_gst_structure_to_string g_mvideo_gst_structure_to_string = nullptr;
 static mvideo_gst_discoverer_info_get_video_streams g_mvideo_gst_discoverer_info_get_video_streams = nullptr;
 static mvideo_gst_discoverer_info_get_audio_streams g_mvideo_gst_discoverer_info_get_audio_streams = nullptr;
+static mvideo_gst_discoverer_info_get_subtitle_streams g_mvideo_gst_discoverer_info_get_subtitle_streams = nullptr;
+static mvideo_gst_discoverer_stream_info_list_free g_mvideo_gst_discoverer_stream_info_list_free = nullptr;
 static mvideo_gst_discoverer_video_info_get_width g_mvideo_gst_discoverer_video_info_get_width = nullptr;
 static mvideo_gst_discoverer_video_info_get_height g_mvideo_gst_discoverer_video_info_get_height = nullptr;
 static mvideo_gst_discoverer_video_info_get_framerate_num g_mvideo_gst_discoverer_video_info_get_framerate_num = nullptr;
@@ -27,13 +35,12 @@ static mvideo_gst_discoverer_audio_info_get_bitrate g_mvideo_gst_discoverer_audi
 static mvideo_gst_discoverer_audio_info_get_channels g_mvideo_gst_discoverer_audio_info_get_channels = nullptr;
 static mvideo_gst_discoverer_audio_info_get_depth g_mvideo_gst_discoverer_audio_info_get_depth = nullptr;
 
-MovieInfo GstUtils::m_movieInfo = MovieInfo();
 GstUtils* GstUtils::m_pGstUtils = new GstUtils;
 
 GstUtils::GstUtils()
 {
-    QLibrary gstreamerLibrary(CompositingManager::libPath("libgstreamer-1.0.so"));
-    QLibrary gstpbutilsLibrary(CompositingManager::libPath("libgstpbutils-1.0.so"));
+    QLibrary &gstreamerLibrary = RuntimeRegistry::get().library("libgstreamer-1.0.so");
+    QLibrary &gstpbutilsLibrary = RuntimeRegistry::get().library("libgstpbutils-1.0.so");
 
     g_mvideo_gst_init = (mvideo_gst_init) gstreamerLibrary.resolve("gst_init");
     g_mvideo_gst_discoverer_new = (mvideo_gst_discoverer_new) gstpbutilsLibrary.resolve("gst_discoverer_new");
@@ -47,6 +54,8 @@ GstUtils::GstUtils()
     g_mvideo_gst_structure_to_string = (mvideo_gst_structure_to_string) gstreamerLibrary.resolve("gst_structure_to_string");
     g_mvideo_gst_discoverer_info_get_video_streams = (mvideo_gst_discoverer_info_get_video_streams) gstpbutilsLibrary.resolve("gst_discoverer_info_get_video_streams");
     g_mvideo_gst_discoverer_info_get_audio_streams = (mvideo_gst_discoverer_info_get_audio_streams) gstpbutilsLibrary.resolve("gst_discoverer_info_get_audio_streams");
+    g_mvideo_gst_discoverer_info_get_subtitle_streams = (mvideo_gst_discoverer_info_get_subtitle_streams) gstpbutilsLibrary.resolve("gst_discoverer_info_get_subtitle_streams");
+    g_mvideo_gst_discoverer_stream_info_list_free = (mvideo_gst_discoverer_stream_info_list_free) gstpbutilsLibrary.resolve("gst_discoverer_stream_info_list_free");
     g_mvideo_gst_discoverer_video_info_get_width = (mvideo_gst_discoverer_video_info_get_width) gstpbutilsLibrary.resolve("gst_discoverer_video_info_get_width");
     g_mvideo_gst_discoverer_video_info_get_height = (mvideo_gst_discoverer_video_info_get_height) gstpbutilsLibrary.resolve("gst_discoverer_video_info_get_height");
     g_mvideo_gst_discoverer_audio_info_get_bitrate = (mvideo_gst_discoverer_audio_info_get_bitrate) gstpbutilsLibrary.resolve("gst_discoverer_audio_info_get_bitrate");
@@ -58,29 +67,191 @@ GstUtils::GstUtils()
     g_mvideo_gst_discoverer_video_info_get_bitrate = (mvideo_gst_discoverer_video_info_get_bitrate) gstpbutilsLibrary.resolve("gst_discoverer_video_info_get_bitrate");
     g_mvideo_gst_discoverer_audio_info_get_sample_rate = (mvideo_gst_discoverer_audio_info_get_sample_rate) gstpbutilsLibrary.resolve("gst_discoverer_audio_info_get_sample_rate");
 
-    memset(&m_gstData, 0, sizeof(m_gstData));
+    m_cache.setMaxCost(DISCOVER_CACHE_SIZE);
 
+    //discoverer在探测线程中按需创建
     g_mvideo_gst_init(nullptr, nullptr);
+}
+
+/**
+ * @brief 在指定context中排队执行，探测线程尚未运行时也不会在调用线程中执行
+ */
+static void invokeIn(GMainContext *pContext, GSourceFunc func, gpointer data)
+{
+    GSource *pSource = g_idle_source_new();
+    g_source_set_callback(pSource, func, data, nullptr);
+    g_source_attach(pSource, pContext);
+    g_source_unref(pSource);
+}
+
+GstDiscoveryLane::GstDiscoveryLane(GstUtils *pUtils)
+    : m_pUtils(pUtils)
+{
+    m_pContext = g_main_context_new();
+    m_pLoop = g_main_loop_new(m_pContext, FALSE);
+}
+
+GstDiscoveryLane::~GstDiscoveryLane()
+{
+    stop();
+    g_main_loop_unref(m_pLoop);
+    g_main_context_unref(m_pContext);
+}
+
+void GstDiscoveryLane::submit(const QByteArray &uri, const QString &sKey, QFutureInterface<MediaProbeResultPtr> iface)
+{
+    QMutexLocker lock(&m_mutex);
+    if (m_bQuit) {
+        iface.reportResult(MediaProbeResultPtr(new MediaProbeResult));
+        iface.reportFinished();
+        return;
+    }
+
+    auto it = m_pending.find(uri);
+    if (it != m_pending.end()) {
+        //同一uri正在探测，共用结果
+        it.value().append(iface);
+        return;
+    }
+    m_pending.insert(uri, QList<QFutureInterface<MediaProbeResultPtr>>() << iface);
+    m_keys.insert(uri, sKey);
+    m_listToStart.append(uri);
+
+    //在探测线程中把uri交给discoverer
+    if (m_listToStart.size() == 1) {
+        invokeIn(m_pContext, startPending, this);
+    }
+}
+
+int GstDiscoveryLane::queued() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_pending.size();
+}
+
+void GstDiscoveryLane::stop()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_bQuit)
+            return;
+        m_bQuit = true;
+    }
+
+    if (isRunning()) {
+        invokeIn(m_pContext, quitLoop, this);
+        wait();
+    }
+
+    //未完成的请求返回空结果，避免调用方一直等待
+    QHash<QByteArray, QList<QFutureInterface<MediaProbeResultPtr>>> pending;
+    QHash<QByteArray, QString> keys;
+    {
+        QMutexLocker lock(&m_mutex);
+        pending.swap(m_pending);
+        keys.swap(m_keys);
+        m_listToStart.clear();
+    }
+    for (const QString &sKey : keys) {
+        m_pUtils->dropInflight(sKey);
+    }
+    for (auto &listIface : pending) {
+        for (auto &iface : listIface) {
+            iface.reportResult(MediaProbeResultPtr(new MediaProbeResult));
+            iface.reportFinished();
+        }
+    }
+}
+
+void GstDiscoveryLane::run()
+{
+    g_main_context_push_thread_default(m_pContext);
 
     GError *pGErr = nullptr;
-    m_gstData.discoverer = g_mvideo_gst_discoverer_new(5 * GST_SECOND, &pGErr);
-    m_gstData.loop = g_main_loop_new (nullptr, FALSE);
+    m_pDiscoverer = m_pUtils->g_mvideo_gst_discoverer_new(DISCOVER_TIMEOUT * GST_SECOND, &pGErr);
+    if (!m_pDiscoverer) {
+        qInfo() << "Error creating discoverer instance: " << (pGErr ? pGErr->message : "");
+        g_clear_error(&pGErr);
+    } else {
+        g_signal_connect_data(m_pDiscoverer, "discovered", (GCallback)discovered, this, nullptr, GConnectFlags(0));
+        //discoverer挂在当前线程默认的context上
+        m_pUtils->g_mvideo_gst_discoverer_start(m_pDiscoverer);
+    }
 
-    if (!m_gstData.discoverer) {
-        qInfo() << "Error creating discoverer instance: " << pGErr->message;
-        g_clear_error (&pGErr);
+    //启动前提交的uri已在context中排队
+    g_main_loop_run(m_pLoop);
+
+    if (m_pDiscoverer) {
+        m_pUtils->g_mvideo_gst_discoverer_stop(m_pDiscoverer);
+        g_object_unref(m_pDiscoverer);
+        m_pDiscoverer = nullptr;
     }
+    g_main_context_pop_thread_default(m_pContext);
+}
 
-    g_signal_connect_data (m_gstData.discoverer, "discovered", (GCallback)discovered, &m_gstData, nullptr, GConnectFlags(0));
-    g_signal_connect_data (m_gstData.discoverer, "finished",  (GCallback)(finished), &m_gstData, nullptr, GConnectFlags(0));
+gboolean GstDiscoveryLane::startPending(gpointer data)
+{
+    GstDiscoveryLane *pLane = static_cast<GstDiscoveryLane *>(data);
+
+    QList<QByteArray> listUri;
+    {
+        QMutexLocker lock(&pLane->m_mutex);
+        listUri.swap(pLane->m_listToStart);
+    }
+
+    for (const QByteArray &uri : listUri) {
+        if (!pLane->m_pDiscoverer || !pLane->m_pUtils->g_mvideo_gst_discoverer_discover_uri_async(pLane->m_pDiscoverer, uri.constData())) {
+            qInfo() << "Failed to start discovering URI " << uri;
+            pLane->finish(uri, MediaProbeResultPtr(new MediaProbeResult));
+        }
+    }
+    return G_SOURCE_REMOVE;
+}
 
-    g_mvideo_gst_discoverer_start(m_gstData.discoverer);
+gboolean GstDiscoveryLane::quitLoop(gpointer data)
+{
+    GstDiscoveryLane *pLane = static_cast<GstDiscoveryLane *>(data);
+    g_main_loop_quit(pLane->m_pLoop);
+    return G_SOURCE_REMOVE;
 }
 
-void GstUtils::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GError *err, CustomData *data)
+void GstDiscoveryLane::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GError *err, GstDiscoveryLane *pLane)
 {
     Q_UNUSED(discoverer);
-    Q_UNUSED(data);
+
+    const QByteArray uri(g_mvideo_gst_discoverer_info_get_uri(info));
+    pLane->finish(uri, GstUtils::parseInfo(info, err));
+}
+
+void GstDiscoveryLane::finish(const QByteArray &uri, const MediaProbeResultPtr &pResult)
+{
+    QList<QFutureInterface<MediaProbeResultPtr>> listIface;
+    QString sKey;
+    {
+        QMutexLocker lock(&m_mutex);
+        listIface = m_pending.take(uri);
+        sKey = m_keys.take(uri);
+    }
+
+    if (!sKey.isEmpty()) {
+        m_pUtils->cacheResult(sKey, pResult);
+    }
+    for (auto &iface : listIface) {
+        iface.reportResult(pResult);
+        iface.reportFinished();
+    }
+}
+
+static void freeStreamList(GList *list)
+{
+    if (g_mvideo_gst_discoverer_stream_info_list_free)
+        g_mvideo_gst_discoverer_stream_info_list_free(list);
+}
+
+MediaProbeResultPtr GstUtils::parseInfo(GstDiscovererInfo *info, GError *err)
+{
+    MediaProbeResult *pResult = new MediaProbeResult;
+    MovieInfo &mi = pResult->mi;
 
     GstDiscovererResult result;
     const gchar *uri;
@@ -88,15 +259,15 @@ void GstUtils::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GE
     uri = g_mvideo_gst_discoverer_info_get_uri (info);
     result = g_mvideo_gst_discoverer_info_get_result (info);
 
-    m_movieInfo.valid = false;
-    m_movieInfo.duration = 0;
+    mi.valid = false;
+    mi.duration = 0;
 
     switch (result) {
       case GST_DISCOVERER_URI_INVALID:
         qInfo() << "Invalid URI " << uri;
         break;
       case GST_DISCOVERER_ERROR:
-        qInfo() << "Discoverer error: " << err->message;
+        qInfo() << "Discoverer error: " << (err ? err->message : "");
         break;
       case GST_DISCOVERER_TIMEOUT:
         qInfo() << "Timeout";
@@ -122,17 +293,20 @@ void GstUtils::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GE
 
     if (result != GST_DISCOVERER_OK) {
       qInfo() << "This URI cannot be played";
-      return;
+      return MediaProbeResultPtr(pResult);
     }
 
-    m_movieInfo.valid = true;
-    m_movieInfo.duration = g_mvideo_gst_discoverer_info_get_duration (info) / GST_SECOND;
+    pResult->opened = true;
+    pResult->miValid = true;
+    mi.valid = true;
+    mi.duration = g_mvideo_gst_discoverer_info_get_duration (info) / GST_SECOND;
 
     // 如果没有时长就当做原始视频格式处理
-    if(m_movieInfo.duration == 0) {
+    if(mi.duration == 0) {
 #ifdef _MOVIE_USE_
-        m_movieInfo.strFmtName = "raw";
+        mi.strFmtName = "raw";
 #endif
+        pResult->formatName = "raw";
     }
 
     GList *list;
@@ -141,12 +315,14 @@ void GstUtils::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GE
     {
         GstDiscovererVideoInfo *vInfo = (GstDiscovererVideoInfo *)list->data;
 
-        m_movieInfo.width = static_cast<int>(g_mvideo_gst_discoverer_video_info_get_width(vInfo));
-        m_movieInfo.height = static_cast<int>(g_mvideo_gst_discoverer_video_info_get_height(vInfo));
-        m_movieInfo.fps = static_cast<int>(g_mvideo_gst_discoverer_video_info_get_framerate_num(vInfo) / g_mvideo_gst_discoverer_video_info_get_framerate_denom(vInfo));
-        m_movieInfo.vCodeRate = g_mvideo_gst_discoverer_video_info_get_bitrate(vInfo);
-        m_movieInfo.proportion = m_movieInfo.height == 0 ? 0 : (float)m_movieInfo.width / m_movieInfo.height;
-        m_movieInfo.resolution = QString::number(m_movieInfo.width) + "x" + QString::number(m_movieInfo.height);
+        mi.width = static_cast<int>(g_mvideo_gst_discoverer_video_info_get_width(vInfo));
+        mi.height = static_cast<int>(g_mvideo_gst_discoverer_video_info_get_height(vInfo));
+        mi.fps = static_cast<int>(g_mvideo_gst_discoverer_video_info_get_framerate_num(vInfo) / qMax(1u, g_mvideo_gst_discoverer_video_info_get_framerate_denom(vInfo)));
+        mi.vCodeRate = g_mvideo_gst_discoverer_video_info_get_bitrate(vInfo);
+        mi.proportion = mi.height == 0 ? 0 : (float)mi.width / mi.height;
+        mi.resolution = QString::number(mi.width) + "x" + QString::number(mi.height);
+        pResult->type = MediaProbeResult::Video;
+        freeStreamList(list);
     }
 
     list = g_mvideo_gst_discoverer_info_get_audio_streams(info);
@@ -154,25 +330,51 @@ void GstUtils::discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GE
     {
         GstDiscovererAudioInfo *aInfo = (GstDiscovererAudioInfo *)list->data;
 
-        m_movieInfo.sampling = static_cast<int>(g_mvideo_gst_discoverer_audio_info_get_sample_rate(aInfo));
-        m_movieInfo.aCodeRate = g_mvideo_gst_discoverer_audio_info_get_bitrate(aInfo);
-        m_movieInfo.channels = static_cast<int>(g_mvideo_gst_discoverer_audio_info_get_channels(aInfo));
-        m_movieInfo.aDigit = static_cast<int>(g_mvideo_gst_discoverer_audio_info_get_depth(aInfo));
+        mi.sampling = static_cast<int>(g_mvideo_gst_discoverer_audio_info_get_sample_rate(aInfo));
+        mi.aCodeRate = g_mvideo_gst_discoverer_audio_info_get_bitrate(aInfo);
+        mi.channels = static_cast<int>(g_mvideo_gst_discoverer_audio_info_get_channels(aInfo));
+        mi.aDigit = static_cast<int>(g_mvideo_gst_discoverer_audio_info_get_depth(aInfo));
+        if (pResult->type == MediaProbeResult::Other)
+            pResult->type = MediaProbeResult::Audio;
+        freeStreamList(list);
     }
+
+    if (pResult->type == MediaProbeResult::Other && g_mvideo_gst_discoverer_info_get_subtitle_streams) {
+        list = g_mvideo_gst_discoverer_info_get_subtitle_streams(info);
+        if (list) {
+            pResult->type = MediaProbeResult::Subtitle;
+            freeStreamList(list);
+        }
+    }
+
+    return MediaProbeResultPtr(pResult);
 }
 
-void GstUtils::finished(GstDiscoverer *discoverer, CustomData *data)
+GstUtils::~GstUtils()
 {
-    Q_UNUSED(discoverer);
+    shutdown();
+}
 
-    g_main_loop_quit (data->loop);
+void GstUtils::shutdown()
+{
+    QList<GstDiscoveryLane *> listLane;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_bQuit = true;
+        listLane.swap(m_lanes);
+    }
+
+    //探测线程退出时会回调dropInflight，不能持有m_mutex
+    for (GstDiscoveryLane *pLane : listLane) {
+        pLane->stop();
+        delete pLane;
+    }
 }
 
-GstUtils::~GstUtils()
+void GstUtils::shutdownLanes()
 {
-    g_mvideo_gst_discoverer_stop(m_gstData.discoverer);
-    g_object_unref(m_gstData.discoverer);
-    g_main_loop_unref (m_gstData.loop);
+    if (m_pGstUtils)
+        m_pGstUtils->shutdown();
 }
 
 GstUtils* GstUtils::get()
@@ -184,33 +386,105 @@ GstUtils* GstUtils::get()
     return m_pGstUtils;
 }
 
-MovieInfo GstUtils:: parseFileByGst(const QFileInfo &fi)
+QString GstUtils::cacheKey(const QUrl &url) const
+{
+    if (!url.isLocalFile())
+        return QString();
+
+    QFileInfo fi(url.toLocalFile());
+    if (!fi.exists())
+        return QString();
+    return QString("%1|%2|%3").arg(fi.absoluteFilePath()).arg(fi.size()).arg(fi.lastModified().toMSecsSinceEpoch());
+}
+
+void GstUtils::cacheResult(const QString &sKey, const MediaProbeResultPtr &pResult)
+{
+    QMutexLocker lock(&m_mutex);
+    m_cache.insert(sKey, new MediaProbeResultPtr(pResult));
+    m_inflight.remove(sKey);
+}
+
+void GstUtils::dropInflight(const QString &sKey)
 {
-    char *uri = nullptr;
-    uri = new char[200];
+    QMutexLocker lock(&m_mutex);
+    m_inflight.remove(sKey);
+}
 
-    m_movieInfo = MovieInfo();
+QFuture<MediaProbeResultPtr> GstUtils::discover(const QUrl &url)
+{
+    QFutureInterface<MediaProbeResultPtr> iface;
+    iface.reportStarted();
+    QFuture<MediaProbeResultPtr> future = iface.future();
 
-    m_movieInfo.title = fi.fileName();
-    m_movieInfo.filePath = fi.canonicalFilePath();
-    m_movieInfo.creation = fi.created().toString();
-    m_movieInfo.fileSize = fi.size();
-    m_movieInfo.fileType = fi.suffix();
+    const QString sKey = cacheKey(url);
+    GstDiscoveryLane *pLane = nullptr;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_bQuit) {
+            iface.reportResult(MediaProbeResultPtr(new MediaProbeResult));
+            iface.reportFinished();
+            return future;
+        }
+        if (!sKey.isEmpty()) {
+            if (MediaProbeResultPtr *pCached = m_cache.object(sKey)) {
+                iface.reportResult(*pCached);
+                iface.reportFinished();
+                return future;
+            }
+            //同一文件正在某个探测线程中探测，直接共用
+            auto it = m_inflight.constFind(sKey);
+            if (it != m_inflight.constEnd())
+                return it.value();
+            m_inflight.insert(sKey, future);
+        }
+
+        //按需创建探测线程，交给排队最少的线程
+        const int nMaxLanes = qBound(1, QThread::idealThreadCount() / 2, DISCOVER_MAX_LANES);
+        int nMinQueued = INT_MAX;
+        for (GstDiscoveryLane *pExist : m_lanes) {
+            const int nQueued = pExist->queued();
+            if (nQueued < nMinQueued) {
+                nMinQueued = nQueued;
+                pLane = pExist;
+            }
+        }
+        if (!pLane || (nMinQueued > 0 && m_lanes.size() < nMaxLanes)) {
+            if (!m_bShutdownRegistered) {
+                //程序退出时停止并等待探测线程
+                qAddPostRoutine(shutdownLanes);
+                m_bShutdownRegistered = true;
+            }
+            pLane = new GstDiscoveryLane(this);
+            pLane->start();
+            m_lanes.append(pLane);
+        }
+        //持锁提交，shutdown不会在此期间删除探测线程
+        pLane->submit(url.toString().toUtf8(), sKey, iface);
+    }
 
-    uri = strcpy(uri, QUrl::fromLocalFile(fi.filePath()).toString().toUtf8().constData());
+    return future;
+}
 
-    if (!g_mvideo_gst_discoverer_discover_uri_async (m_gstData.discoverer, uri)) {
-      qInfo() << "Failed to start discovering URI " << uri;
-      g_object_unref (m_gstData.discoverer);
-      return m_movieInfo;
+QList<QFuture<MediaProbeResultPtr>> GstUtils::discover(const QList<QUrl> &urls)
+{
+    QList<QFuture<MediaProbeResultPtr>> listFuture;
+    for (const QUrl &url : urls) {
+        listFuture.append(discover(url));
     }
+    return listFuture;
+}
 
-    g_main_loop_run (m_gstData.loop);
+MovieInfo GstUtils::parseFileByGst(const QFileInfo &fi)
+{
+    MovieInfo mi = discover(QUrl::fromLocalFile(fi.filePath())).result()->mi;
 
-    delete []uri;
+    mi.title = fi.fileName();
+    mi.filePath = fi.canonicalFilePath();
+    mi.creation = fi.created().toString();
+    mi.fileSize = fi.size();
+    mi.fileType = fi.suffix();
 
-    return m_movieInfo;
+    return mi;
 }
 
 }
-
@@ -8,7 +8,10 @@
 
 #include <QString>
 #include <QObject>
+#include <QFuture>
+#include <QFutureInterface>
 #include "playlist_model.h"
+#include "media_probe.h"
 
 extern "C" {
 #include <string.h>
@@ -29,6 +32,8 @@ typedef const GstStructure* (*mvideo_gst_discoverer_info_get_misc) (const GstDis
 typedef gchar* (*mvideo_gst_structure_to_string) (const GstStructure * structure);
 typedef GList* (*mvideo_gst_discoverer_info_get_video_streams) (GstDiscovererInfo *info);
 typedef GList* (*mvideo_gst_discoverer_info_get_audio_streams) (GstDiscovererInfo *info);
+typedef GList* (*mvideo_gst_discoverer_info_get_subtitle_streams) (GstDiscovererInfo *info);
+typedef void (*mvideo_gst_discoverer_stream_info_list_free) (GList *infos);
 typedef guint (*mvideo_gst_discoverer_video_info_get_width) (const GstDiscovererVideoInfo* info);
 typedef guint (*mvideo_gst_discoverer_video_info_get_height) (const GstDiscovererVideoInfo* info);
 typedef guint (*mvideo_gst_discoverer_video_info_get_framerate_num) (const GstDiscovererVideoInfo* info);
@@ -40,36 +45,111 @@ typedef guint (*mvideo_gst_discoverer_audio_info_get_bitrate) (const GstDiscover
 typedef guint (*mvideo_gst_discoverer_audio_info_get_channels) (const GstDiscovererAudioInfo* info);
 typedef guint (*mvideo_gst_discoverer_audio_info_get_depth) (const GstDiscovererAudioInfo* info);
 
-typedef struct CustomData {
-  GstDiscoverer *discoverer;
-  GMainLoop *loop;
-} CustomData;
+class GstUtils;
 
-class GstUtils
+/**
+ * @brief The GstDiscoveryLane class
+ * 一个探测线程，拥有独立的GMainContext和GstDiscoverer，
+ * 提交的uri在discoverer内部排队连续探测，超时由discoverer处理
+ */
+class GstDiscoveryLane : public QThread
 {
+public:
+    explicit GstDiscoveryLane(GstUtils *pUtils);
+    ~GstDiscoveryLane();
+
+    /**
+     * @brief 提交探测，可在任意线程调用
+     */
+    void submit(const QByteArray &uri, const QString &sKey, QFutureInterface<MediaProbeResultPtr> iface);
+    /**
+     * @brief 已提交但未完成的uri数量
+     */
+    int queued() const;
+    void stop();
+
+protected:
+    void run() override;
 
+private:
+    static gboolean startPending(gpointer data);
+    static gboolean quitLoop(gpointer data);
+    static void discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GError *err, GstDiscoveryLane *pLane);
+    void finish(const QByteArray &uri, const MediaProbeResultPtr &pResult);
+
+private:
+    GstUtils *m_pUtils {nullptr};
+    GMainContext *m_pContext {nullptr};
+    GMainLoop *m_pLoop {nullptr};
+    GstDiscoverer *m_pDiscoverer {nullptr};
+
+    mutable QMutex m_mutex;                 //保护以下成员
+    QList<QByteArray> m_listToStart;        //尚未交给discoverer的uri
+    QHash<QByteArray, QList<QFutureInterface<MediaProbeResultPtr>>> m_pending;
+    QHash<QByteArray, QString> m_keys;      //uri对应的缓存键
+    bool m_bQuit {false};
+};
+
+/**
+ * @file 无mpv时的gstreamer探测服务
+ * 多个探测线程各自运行一个discoverer，调用方提交后拿到QFuture，不再逐个文件阻塞在主循环中；
+ * 结果与MediaProbe使用相同的结构和(路径, 大小, 修改时间)缓存键，FileFilter与播放列表共用同一次探测
+ */
+class GstUtils
+{
+    friend class GstDiscoveryLane;
 public:
     ~GstUtils();
 
     static GstUtils* get();
 
-    static void discovered(GstDiscoverer *discoverer, GstDiscovererInfo *info, GError *err, CustomData *data);
-
-    static void finished(GstDiscoverer *discoverer, CustomData *data);
+    /**
+     * @brief 异步探测，同一文件正在探测时共用结果，可在任意线程调用
+     * @param url 本地文件或网络地址
+     * @return 探测结果，不会为空指针
+     */
+    QFuture<MediaProbeResultPtr> discover(const QUrl &url);
+    /**
+     * @brief 批量提交探测，分散到各探测线程
+     */
+    QList<QFuture<MediaProbeResultPtr>> discover(const QList<QUrl> &urls);
     /**
      * @brief 使用gstreamer获取影片信息
      * @param 文件信息
      * @return 影片信息
      */
     MovieInfo parseFileByGst(const QFileInfo &fi);
+    /**
+     * @brief 停止并等待探测线程退出，未完成和之后的请求返回空结果
+     */
+    void shutdown();
 
 private:
     GstUtils();
+    QString cacheKey(const QUrl &url) const;
+    /**
+     * @brief 探测完成，缓存结果并结束该文件的进行中记录
+     */
+    void cacheResult(const QString &sKey, const MediaProbeResultPtr &pResult);
+    /**
+     * @brief 探测被放弃，只结束进行中记录
+     */
+    void dropInflight(const QString &sKey);
+    static void shutdownLanes();
+    /**
+     * @brief 从discoverer结果中取出流信息
+     */
+    static MediaProbeResultPtr parseInfo(GstDiscovererInfo *info, GError *err);
 
 private:
-    static MovieInfo m_movieInfo;
     static GstUtils* m_pGstUtils;
-    CustomData m_gstData;
+
+    QMutex m_mutex;                                 //保护以下成员
+    QList<GstDiscoveryLane *> m_lanes;
+    QCache<QString, MediaProbeResultPtr> m_cache;
+    QHash<QString, QFuture<MediaProbeResultPtr>> m_inflight;   //正在探测的文件，不论分到哪个探测线程都共用结果
+    bool m_bQuit {false};
+    bool m_bShutdownRegistered {false};
 
     mvideo_gst_init g_mvideo_gst_init = nullptr;
     mvideo_gst_discoverer_new g_mvideo_gst_discoverer_new = nullptr;
@@ -0,0 +1,486 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "media_info_store.h"
+
+#include <QtSql>
+
+#define RECORD_VERSION 1
+#define MAX_RECORDS 20000
+#define ACCESS_GRANULARITY (24 * 3600 * 1000LL)  //读取时刷新使用时间的最小间隔(ms)
+#define LEGACY_EXPIRE_DAYS 30                     //未迁移的旧缓存文件保留天数
+
+namespace dmr {
+
+#define CHECKED_EXEC(q) do { \
+    if (!(q).exec()) { \
+        qCritical() << (q).lastError(); \
+    } \
+} while (0)
+
+/**
+ * @brief 定长记录，字符串字段由文件信息推导或单独成列
+ */
+struct MediaRecord {
+    quint32 version;
+    qint32 raw_rotate;
+    qint32 width;
+    qint32 height;
+    qint32 vCodecID;
+    qint32 fps;
+    qint32 aCodeID;
+    qint32 aDigit;
+    qint32 channels;
+    qint32 sampling;
+    float proportion;
+    qint64 fileSize;
+    qint64 duration;
+    qint64 vCodeRate;
+    qint64 aCodeRate;
+};
+
+static QByteArray encodeRecord(const MovieInfo &mi)
+{
+    MediaRecord rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.version = RECORD_VERSION;
+    rec.raw_rotate = mi.raw_rotate;
+    rec.width = mi.width;
+    rec.height = mi.height;
+    rec.vCodecID = mi.vCodecID;
+    rec.fps = mi.fps;
+    rec.aCodeID = mi.aCodeID;
+    rec.aDigit = mi.aDigit;
+    rec.channels = mi.channels;
+    rec.sampling = mi.sampling;
+    rec.proportion = mi.proportion;
+    rec.fileSize = mi.fileSize;
+    rec.duration = mi.duration;
+    rec.vCodeRate = mi.vCodeRate;
+    rec.aCodeRate = mi.aCodeRate;
+
+    return QByteArray(reinterpret_cast<const char *>(&rec), sizeof(rec));
+}
+
+static bool decodeRecord(const QByteArray &bytes, MovieInfo &mi)
+{
+    if (bytes.size() != static_cast<int>(sizeof(MediaRecord)))
+        return false;
+
+    MediaRecord rec;
+    memcpy(&rec, bytes.constData(), sizeof(rec));
+    if (rec.version != RECORD_VERSION)
+        return false;
+
+    mi.raw_rotate = rec.raw_rotate;
+    mi.width = rec.width;
+    mi.height = rec.height;
+    mi.vCodecID = rec.vCodecID;
+    mi.fps = rec.fps;
+    mi.aCodeID = rec.aCodeID;
+    mi.aDigit = rec.aDigit;
+    mi.channels = rec.channels;
+    mi.sampling = rec.sampling;
+    mi.proportion = rec.proportion;
+    mi.fileSize = rec.fileSize;
+    mi.duration = rec.duration;
+    mi.vCodeRate = rec.vCodeRate;
+    mi.aCodeRate = rec.aCodeRate;
+    mi.resolution = QString("%1x%2").arg(mi.width).arg(mi.height);
+    mi.valid = true;
+
+    return true;
+}
+
+static QByteArray pixmapToBytes(const QPixmap &pm)
+{
+    QByteArray bytes;
+    if (pm.isNull())
+        return bytes;
+
+    QBuffer buf(&bytes);
+    buf.open(QIODevice::WriteOnly);
+    pm.save(&buf, "PNG");
+    return bytes;
+}
+
+static QByteArray imageToBytes(const QImage &img)
+{
+    QByteArray bytes;
+    if (img.isNull())
+        return bytes;
+
+    QBuffer buf(&bytes);
+    buf.open(QIODevice::WriteOnly);
+    img.save(&buf, "PNG");
+    return bytes;
+}
+
+/**
+ * @brief 按旧版本的字段顺序读取影片信息
+ */
+static void readLegacyInfo(QDataStream &st, MovieInfo &mi)
+{
+    st >> mi.valid;
+    st >> mi.title;
+    st >> mi.fileType;
+    st >> mi.resolution;
+    st >> mi.filePath;
+    st >> mi.creation;
+    st >> mi.raw_rotate;
+    st >> mi.fileSize;
+    st >> mi.duration;
+    st >> mi.width;
+    st >> mi.height;
+    st >> mi.vCodecID;
+    st >> mi.vCodeRate;
+    st >> mi.fps;
+    st >> mi.proportion;
+    st >> mi.aCodeID;
+    st >> mi.aCodeRate;
+    st >> mi.aDigit;
+    st >> mi.channels;
+    st >> mi.sampling;
+#ifdef _MOVIE_USE_
+    st >> mi.strFmtName;
+#endif
+}
+
+/**
+ * @brief 线程独占的数据库连接名，线程结束时移除连接
+ * 线程id会被之后的线程复用，连接名使用进程内递增的序号
+ */
+class ThreadConnection
+{
+public:
+    ThreadConnection()
+        : m_sName(QString("mediainfo_%1").arg(m_nNext.fetchAndAddRelaxed(1)))
+        , m_bMainThread(qApp && QThread::currentThread() == qApp->thread())
+    {
+    }
+    ~ThreadConnection()
+    {
+        //主线程的连接随进程退出，此时连接表可能已经析构
+        if (!m_bMainThread) {
+            QSqlDatabase::removeDatabase(m_sName);
+        }
+    }
+
+    const QString &name() const
+    {
+        return m_sName;
+    }
+
+private:
+    static QAtomicInt m_nNext;
+    QString m_sName;
+    bool m_bMainThread;
+};
+
+QAtomicInt ThreadConnection::m_nNext(0);
+static QThreadStorage<ThreadConnection *> s_connections;
+
+MediaInfoStore &MediaInfoStore::get()
+{
+    static MediaInfoStore store;
+    return store;
+}
+
+MediaInfoStore::MediaInfoStore()
+{
+    auto db_dir = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+
+    QDir d;
+    d.mkpath(db_dir);
+    m_sDbPath = QString("%1/mediainfo.db").arg(db_dir);
+
+    //旧版本按url分别保存的信息和缩略图文件，命中时迁入数据库
+    m_sLegacyDir = QString("%1/%2/%3/%4")
+                   .arg(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation))
+                   .arg(qApp->organizationName())
+                   .arg(qApp->applicationName());
+}
+
+QString MediaInfoStore::dbPath()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_sDbPath;
+}
+
+void MediaInfoStore::setDbPath(const QString &sPath)
+{
+    QMutexLocker lock(&m_mutex);
+    m_sDbPath = sPath;
+    m_bTablesReady = false;
+}
+
+QSqlDatabase MediaInfoStore::database()
+{
+    if (!s_connections.hasLocalData()) {
+        s_connections.setLocalData(new ThreadConnection);
+    }
+    const QString sName = s_connections.localData()->name();
+    const QString sPath = dbPath();
+    QSqlDatabase db;
+    if (QSqlDatabase::contains(sName)) {
+        db = QSqlDatabase::database(sName, false);
+        if (db.isOpen() && db.databaseName() == sPath)
+            return db;
+        //数据库文件已切换，重新打开
+        db.close();
+    } else {
+        db = QSqlDatabase::addDatabase("QSQLITE", sName);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=2000");
+    }
+
+    db.setDatabaseName(sPath);
+    if (!db.open()) {
+        qCritical() << "open the media info database error";
+        return db;
+    }
+
+    QMutexLocker lock(&m_mutex);
+    if (!m_bTablesReady) {
+        initTables(db);
+        prune(db);
+        pruneLegacy();
+        m_bTablesReady = true;
+    }
+
+    return db;
+}
+
+void MediaInfoStore::initTables(QSqlDatabase &db)
+{
+    QSqlQuery q(db);
+    if (!q.exec("pragma journal_mode = WAL")) {
+        qCritical() << q.lastError();
+    }
+    if (!q.exec("create table if not exists media (path TEXT primary key, size INTEGER, "
+                "mtime INTEGER, updated INTEGER, record BLOB, creation TEXT, fmt_name TEXT)")) {
+        qCritical() << q.lastError();
+    }
+    if (!q.exec("create index if not exists media_updated on media (updated)")) {
+        qCritical() << q.lastError();
+    }
+    if (!q.exec("create table if not exists thumbs (path TEXT primary key, size INTEGER, "
+                "mtime INTEGER, thumb BLOB, thumb_dark BLOB)")) {
+        qCritical() << q.lastError();
+    }
+}
+
+void MediaInfoStore::prune(QSqlDatabase &db)
+{
+    QSqlQuery q(db);
+    if (!q.exec("select count(*) from media") || !q.next())
+        return;
+
+    int nExtra = q.value(0).toInt() - MAX_RECORDS;
+    if (nExtra <= 0)
+        return;
+
+    //updated为最近一次读写时间，淘汰最久未使用的记录
+    qInfo() << "prune media info records:" << nExtra;
+    if (db.transaction()) {
+        QSqlQuery qDel(db);
+        if (qDel.prepare("delete from media where path in "
+                         "(select path from media order by updated limit ?)")) {
+            qDel.addBindValue(nExtra);
+            CHECKED_EXEC(qDel);
+        }
+        QSqlQuery qThumb(db);
+        if (!qThumb.exec("delete from thumbs where path not in (select path from media)")) {
+            qCritical() << qThumb.lastError();
+        }
+        if (!db.commit()) {
+            qCritical() << db.lastError();
+        }
+    }
+}
+
+bool MediaInfoStore::lookup(const QFileInfo &fi, MovieInfo &mi)
+{
+    if (!fi.exists())
+        return false;
+
+    QSqlDatabase db = database();
+    QSqlQuery q(db);
+    if (!q.prepare("select record, creation, fmt_name, updated from media where path = ? and size = ? and mtime = ?"))
+        return false;
+
+    q.addBindValue(fi.absoluteFilePath());
+    q.addBindValue(fi.size());
+    q.addBindValue(fi.lastModified().toMSecsSinceEpoch());
+    if (!q.exec() || !q.next())
+        return migrateLegacy(fi, mi);
+
+    MovieInfo info;
+    if (!decodeRecord(q.value(0).toByteArray(), info))
+        return false;
+
+    //刷新使用时间供淘汰排序，间隔较短时跳过以免每次读取都写库
+    const qint64 nNow = QDateTime::currentMSecsSinceEpoch();
+    if (nNow - q.value(3).toLongLong() > ACCESS_GRANULARITY) {
+        QSqlQuery qTouch(db);
+        if (qTouch.prepare("update media set updated = ? where path = ?")) {
+            qTouch.addBindValue(nNow);
+            qTouch.addBindValue(fi.absoluteFilePath());
+            CHECKED_EXEC(qTouch);
+        }
+    }
+
+    info.title = fi.fileName();
+    info.filePath = fi.canonicalFilePath();
+    info.fileType = fi.suffix();
+    info.creation = q.value(1).toString();
+#ifdef _MOVIE_USE_
+    info.strFmtName = q.value(2).toString();
+#endif
+    mi = info;
+
+    return true;
+}
+
+bool MediaInfoStore::lookupThumb(const QFileInfo &fi, QPixmap &thumb, QPixmap &thumbDark)
+{
+    if (!fi.exists())
+        return false;
+
+    QSqlDatabase db = database();
+    QSqlQuery q(db);
+    if (!q.prepare("select thumb, thumb_dark from thumbs where path = ? and size = ? and mtime = ?"))
+        return false;
+
+    q.addBindValue(fi.absoluteFilePath());
+    q.addBindValue(fi.size());
+    q.addBindValue(fi.lastModified().toMSecsSinceEpoch());
+    if (!q.exec() || !q.next())
+        return false;
+
+    thumb.loadFromData(q.value(0).toByteArray(), "PNG");
+    thumbDark.loadFromData(q.value(1).toByteArray(), "PNG");
+    thumb.setDevicePixelRatio(qApp->devicePixelRatio());
+    thumbDark.setDevicePixelRatio(qApp->devicePixelRatio());
+
+    return !thumb.isNull() || !thumbDark.isNull();
+}
+
+void MediaInfoStore::save(const QFileInfo &fi, const MovieInfo &mi)
+{
+    if (!fi.exists() || !mi.valid)
+        return;
+
+    QSqlDatabase db = database();
+    QSqlQuery q(db);
+    if (q.prepare("replace into media (path, size, mtime, updated, record, creation, fmt_name) "
+                  "values (?, ?, ?, ?, ?, ?, ?)")) {
+        q.addBindValue(fi.absoluteFilePath());
+        q.addBindValue(fi.size());
+        q.addBindValue(fi.lastModified().toMSecsSinceEpoch());
+        q.addBindValue(QDateTime::currentMSecsSinceEpoch());
+        q.addBindValue(encodeRecord(mi));
+        q.addBindValue(mi.creation);
+#ifdef _MOVIE_USE_
+        q.addBindValue(mi.strFmtName);
+#else
+        q.addBindValue(QString());
+#endif
+        CHECKED_EXEC(q);
+    }
+}
+
+void MediaInfoStore::saveThumb(const QFileInfo &fi, const QPixmap &thumb, const QPixmap &thumbDark)
+{
+    saveThumbData(fi, pixmapToBytes(thumb), pixmapToBytes(thumbDark));
+}
+
+void MediaInfoStore::saveThumbData(const QFileInfo &fi, const QByteArray &thumb, const QByteArray &thumbDark)
+{
+    if (!fi.exists())
+        return;
+
+    QSqlDatabase db = database();
+    QSqlQuery q(db);
+    if (q.prepare("replace into thumbs (path, size, mtime, thumb, thumb_dark) values (?, ?, ?, ?, ?)")) {
+        q.addBindValue(fi.absoluteFilePath());
+        q.addBindValue(fi.size());
+        q.addBindValue(fi.lastModified().toMSecsSinceEpoch());
+        q.addBindValue(thumb);
+        q.addBindValue(thumbDark);
+        CHECKED_EXEC(q);
+    }
+}
+
+void MediaInfoStore::remove(const QFileInfo &fi)
+{
+    QSqlDatabase db = database();
+    QSqlQuery q(db);
+    if (q.prepare("delete from media where path = ?")) {
+        q.addBindValue(fi.absoluteFilePath());
+        CHECKED_EXEC(q);
+    }
+    if (q.prepare("delete from thumbs where path = ?")) {
+        q.addBindValue(fi.absoluteFilePath());
+        CHECKED_EXEC(q);
+    }
+}
+
+bool MediaInfoStore::migrateLegacy(const QFileInfo &fi, MovieInfo &mi)
+{
+    //旧版本以url的sha256为文件名
+    const QString sHash = QCryptographicHash::hash(QUrl::fromLocalFile(fi.absoluteFilePath()).toEncoded(),
+                                                   QCryptographicHash::Sha256).toHex();
+    QFile infoFile(QString("%1/%2").arg(m_sLegacyDir.arg("cacheinfo")).arg(sHash));
+    if (!infoFile.exists() || !infoFile.open(QIODevice::ReadOnly))
+        return false;
+
+    MovieInfo info;
+    QDataStream ds(&infoFile);
+    readLegacyInfo(ds, info);
+    infoFile.close();
+    infoFile.remove();
+    //旧文件没有修改时间，只能按大小判断是否仍然有效
+    if (ds.status() != QDataStream::Ok || !info.valid || info.fileSize != fi.size())
+        return false;
+
+    //QPixmap与QImage的序列化格式相同，工作线程中只能使用QImage
+    QFile thumbFile(QString("%1/%2").arg(m_sLegacyDir.arg("thumbs")).arg(sHash));
+    if (thumbFile.open(QIODevice::ReadOnly)) {
+        QImage thumb;
+        QImage thumbDark;
+        QDataStream dsThumb(&thumbFile);
+        dsThumb >> thumb >> thumbDark;
+        thumbFile.close();
+        if (dsThumb.status() == QDataStream::Ok && (!thumb.isNull() || !thumbDark.isNull()))
+            saveThumbData(fi, imageToBytes(thumb), imageToBytes(thumbDark));
+    }
+    thumbFile.remove();
+
+    info.title = fi.fileName();
+    info.filePath = fi.canonicalFilePath();
+    info.fileType = fi.suffix();
+    save(fi, info);
+    mi = info;
+
+    return true;
+}
+
+void MediaInfoStore::pruneLegacy()
+{
+    const QDateTime expire = QDateTime::currentDateTime().addDays(-LEGACY_EXPIRE_DAYS);
+    for (const QString &sName : {QString("cacheinfo"), QString("thumbs")}) {
+        QDir dir(m_sLegacyDir.arg(sName));
+        if (!dir.exists())
+            continue;
+
+        for (const QFileInfo &fi : dir.entryInfoList(QDir::Files)) {
+            if (fi.lastModified() < expire)
+                QFile::remove(fi.absoluteFilePath());
+        }
+        //全部迁移或过期后删除目录
+        dir.rmdir(dir.absolutePath());
+    }
+}
+
+}
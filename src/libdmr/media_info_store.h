@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_MEDIA_INFO_STORE_H
+#define _DMR_MEDIA_INFO_STORE_H
+
+#include <QtCore>
+#include <QPixmap>
+#include <QSqlDatabase>
+#include "playlist_model.h"
+
+namespace dmr {
+
+/**
+ * @file 影片信息持久化存储
+ * 以sqlite保存每个文件的MovieInfo与缩略图，按(路径, 大小, 修改时间)校验，
+ * 文件变化后记录自动失效；缩略图单独成表，只在需要时读取。
+ * 记录数超出上限时淘汰最久未读写的记录，旧版本的缓存文件在命中时迁入数据库，其余的过期删除
+ */
+class MediaInfoStore
+{
+public:
+    static MediaInfoStore &get();
+
+    /**
+     * @brief 读取缓存的影片信息，不读取缩略图
+     * @param fi 文件信息
+     * @param mi 输出影片信息
+     * @return 命中且文件未改变时返回true
+     */
+    bool lookup(const QFileInfo &fi, MovieInfo &mi);
+    /**
+     * @brief 读取缓存的缩略图
+     * @return 命中且文件未改变时返回true
+     */
+    bool lookupThumb(const QFileInfo &fi, QPixmap &thumb, QPixmap &thumbDark);
+
+    void save(const QFileInfo &fi, const MovieInfo &mi);
+    void saveThumb(const QFileInfo &fi, const QPixmap &thumb, const QPixmap &thumbDark);
+    void remove(const QFileInfo &fi);
+
+    /**
+     * @brief 数据库文件
+     */
+    QString dbPath();
+    /**
+     * @brief 切换数据库文件，各线程之后的读写使用新文件
+     */
+    void setDbPath(const QString &sPath);
+
+private:
+    MediaInfoStore();
+    /**
+     * @brief 每个线程使用独立的数据库连接
+     */
+    QSqlDatabase database();
+    void initTables(QSqlDatabase &db);
+    void prune(QSqlDatabase &db);
+    void saveThumbData(const QFileInfo &fi, const QByteArray &thumb, const QByteArray &thumbDark);
+    /**
+     * @brief 从旧版本按url保存的缓存文件读取影片信息和缩略图，写入数据库后删除旧文件
+     * @return 有旧文件且与当前文件大小一致时返回true
+     */
+    bool migrateLegacy(const QFileInfo &fi, MovieInfo &mi);
+    /**
+     * @brief 删除长期未迁移的旧版本缓存文件
+     */
+    void pruneLegacy();
+
+private:
+    QString m_sDbPath;
+    QString m_sLegacyDir;  //旧版本缓存目录模板，%1为cacheinfo或thumbs
+    QMutex m_mutex;
+    bool m_bTablesReady {false};
+};
+
+}
+
+#endif /* ifndef _DMR_MEDIA_INFO_STORE_H */
@@ -0,0 +1,256 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "media_probe.h"
+#include "compositing_manager.h"
+#include "runtime_registry.h"
+
+#include <QLibrary>
+
+#define PROBE_CACHE_SIZE 512
+
+namespace dmr {
+
+MediaProbe &MediaProbe::get()
+{
+    static MediaProbe probe;
+    return probe;
+}
+
+MediaProbe::MediaProbe()
+{
+    m_cache.setMaxCost(PROBE_CACHE_SIZE);
+}
+
+void MediaProbe::initFFmpegInterface()
+{
+    QLibrary &avcodecLibrary = RuntimeRegistry::get().library("libavcodec.so");
+    QLibrary &avformatLibrary = RuntimeRegistry::get().library("libavformat.so");
+    QLibrary &avutilLibrary = RuntimeRegistry::get().library("libavutil.so");
+
+    m_avformatOpenInput = reinterpret_cast<probeAvformatOpenInput>(avformatLibrary.resolve("avformat_open_input"));
+    m_avformatFindStreamInfo = reinterpret_cast<probeAvformatFindStreamInfo>(avformatLibrary.resolve("avformat_find_stream_info"));
+    m_avFindBestStream = reinterpret_cast<probeAvFindBestStream>(avformatLibrary.resolve("av_find_best_stream"));
+    m_avformatCloseInput = reinterpret_cast<probeAvformatCloseInput>(avformatLibrary.resolve("avformat_close_input"));
+    m_avDictGet = reinterpret_cast<probeAvDictGet>(avutilLibrary.resolve("av_dict_get"));
+    m_avcodecFindDecoder = reinterpret_cast<probeAvcodecFindDecoder>(avcodecLibrary.resolve("avcodec_find_decoder"));
+    m_avcodecGetHwConfig = reinterpret_cast<probeAvcodecGetHwConfig>(avcodecLibrary.resolve("avcodec_get_hw_config"));
+    m_avHwdeviceGetTypeName = reinterpret_cast<probeAvHwdeviceGetTypeName>(avutilLibrary.resolve("av_hwdevice_get_type_name"));
+    m_avcodecParametersAlloc = reinterpret_cast<probeAvcodecParametersAlloc>(avcodecLibrary.resolve("avcodec_parameters_alloc"));
+    m_avcodecParametersCopy = reinterpret_cast<probeAvcodecParametersCopy>(avcodecLibrary.resolve("avcodec_parameters_copy"));
+    m_avcodecParametersFree = reinterpret_cast<probeAvcodecParametersFree>(avcodecLibrary.resolve("avcodec_parameters_free"));
+
+    m_bInited = true;
+}
+
+QString MediaProbe::cacheKey(const QFileInfo &fi) const
+{
+    return QString("%1|%2|%3").arg(fi.absoluteFilePath()).arg(fi.size())
+           .arg(fi.lastModified().toMSecsSinceEpoch());
+}
+
+MediaProbeResultPtr MediaProbe::probe(const QUrl &url)
+{
+    if (url.isLocalFile()) {
+        return probe(QFileInfo(url.toLocalFile()));
+    }
+
+    //网络流内容可能变化，没有可用的缓存键
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_bInited) {
+            initFFmpegInterface();
+        }
+    }
+    return MediaProbeResultPtr(doProbe(url.toString(), QFileInfo()));
+}
+
+MediaProbeResultPtr MediaProbe::probe(const QFileInfo &fi)
+{
+    if (!fi.exists()) {
+        return MediaProbeResultPtr(new MediaProbeResult);
+    }
+
+    QString sKey = cacheKey(fi);
+    {
+        QMutexLocker lock(&m_mutex);
+        if (MediaProbeResultPtr *pCached = m_cache.object(sKey)) {
+            return *pCached;
+        }
+        if (!m_bInited) {
+            initFFmpegInterface();
+        }
+    }
+
+    //探测过程不加锁，允许多个线程同时探测不同文件
+    MediaProbeResultPtr pResult(doProbe(fi.filePath(), fi));
+
+    QMutexLocker lock(&m_mutex);
+    m_cache.insert(sKey, new MediaProbeResultPtr(pResult));
+    return pResult;
+}
+
+void MediaProbe::invalidate(const QUrl &url)
+{
+    QString sPrefix = QFileInfo(url.toLocalFile()).absoluteFilePath() + "|";
+
+    QMutexLocker lock(&m_mutex);
+    for (const QString &sKey : m_cache.keys()) {
+        if (sKey.startsWith(sPrefix)) {
+            m_cache.remove(sKey);
+        }
+    }
+}
+
+MediaProbeResult *MediaProbe::doProbe(const QString &sPath, const QFileInfo &fi)
+{
+    MediaProbeResult *pResult = new MediaProbeResult;
+    MovieInfo &mi = pResult->mi;
+    AVFormatContext *av_ctx = nullptr;
+
+    if (!m_avformatOpenInput || !m_avformatFindStreamInfo || !m_avformatCloseInput || !m_avFindBestStream) {
+        qWarning() << "avformat: missing symbols, probe skipped";
+        return pResult;
+    }
+
+    if (m_avformatOpenInput(&av_ctx, sPath.toUtf8().constData(), nullptr, nullptr) < 0) {
+        qWarning() << "avformat: could not open input";
+        return pResult;
+    }
+
+    if (m_avformatFindStreamInfo(av_ctx, nullptr) < 0) {
+        qWarning() << "av_find_stream_info failed";
+        m_avformatCloseInput(&av_ctx);
+        return pResult;
+    }
+
+    pResult->opened = true;
+    pResult->formatName = av_ctx->iformat->long_name;
+
+    bool bVCodec = false;
+    bool bACodec = false;
+    bool bSCodec = false;
+    for (unsigned int i = 0; i < av_ctx->nb_streams; i++) {
+        AVCodecParameters *pPar = av_ctx->streams[i]->codecpar;
+
+        MediaStreamInfo stream;
+        stream.type = pPar->codec_type;
+        stream.codecId = pPar->codec_id;
+        stream.profile = pPar->profile;
+        stream.format = pPar->format;
+        stream.width = pPar->width;
+        stream.height = pPar->height;
+        if (m_avcodecParametersAlloc && m_avcodecParametersCopy && m_avcodecParametersFree) {
+            AVCodecParameters *pCopy = m_avcodecParametersAlloc();
+            if (pCopy && m_avcodecParametersCopy(pCopy, pPar) >= 0) {
+                probeAvcodecParametersFree freeFunc = m_avcodecParametersFree;
+                stream.codecpar = QSharedPointer<AVCodecParameters>(pCopy, [freeFunc](AVCodecParameters * p) {
+                    freeFunc(&p);
+                });
+            } else if (pCopy) {
+                m_avcodecParametersFree(&pCopy);
+            }
+        }
+        pResult->streams.append(stream);
+
+        if (pPar->codec_type == AVMEDIA_TYPE_VIDEO) {
+            bVCodec = true;
+
+            //只检查解码器是否声明了硬解配置，不创建设备
+            const AVCodec *pDec = m_avcodecFindDecoder ? m_avcodecFindDecoder(pPar->codec_id) : nullptr;
+            for (int j = 0; pDec && m_avcodecGetHwConfig && m_avHwdeviceGetTypeName; j++) {
+                const AVCodecHWConfig *pConfig = m_avcodecGetHwConfig(pDec, j);
+                if (!pConfig)
+                    break;
+                if (pConfig->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX) {
+                    QString sType = m_avHwdeviceGetTypeName(pConfig->device_type);
+                    if (!pResult->hwdecTypes.contains(sType))
+                        pResult->hwdecTypes.append(sType);
+                }
+            }
+        } else if (pPar->codec_type == AVMEDIA_TYPE_AUDIO) {
+            bACodec = true;
+        } else if (pPar->codec_type == AVMEDIA_TYPE_SUBTITLE) {
+            bSCodec = true;
+        }
+    }
+
+    if (bVCodec) {
+        pResult->type = MediaProbeResult::Video;
+    } else if (bACodec) {
+        pResult->type = MediaProbeResult::Audio;
+    } else if (bSCodec) {
+        pResult->type = MediaProbeResult::Subtitle;
+    }
+
+    int videoRet = -1;
+    int audioRet = -1;
+    if (av_ctx->nb_streams > 0) {
+        videoRet = m_avFindBestStream(av_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
+        audioRet = m_avFindBestStream(av_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
+    }
+    if (videoRet < 0 && audioRet < 0) {
+        m_avformatCloseInput(&av_ctx);
+        return pResult;
+    }
+
+    if (videoRet >= 0) {
+        AVStream *videoStream = av_ctx->streams[videoRet];
+        AVCodecParameters *video_dec_ctx = videoStream->codecpar;
+
+        mi.width = video_dec_ctx->width;
+        mi.height = video_dec_ctx->height;
+        mi.vCodecID = video_dec_ctx->codec_id;
+        mi.vCodeRate = video_dec_ctx->bit_rate;
+
+        if (videoStream->r_frame_rate.den != 0) {
+            mi.fps = videoStream->r_frame_rate.num / videoStream->r_frame_rate.den;
+        } else {
+            mi.fps = 0;
+        }
+        if (mi.height != 0) {
+            mi.proportion = static_cast<float>(mi.width) / static_cast<float>(mi.height);
+        } else {
+            mi.proportion = 0;
+        }
+    }
+    if (audioRet >= 0) {
+        AVCodecParameters *audio_dec_ctx = av_ctx->streams[audioRet]->codecpar;
+
+        mi.aCodeID = audio_dec_ctx->codec_id;
+        mi.aCodeRate = audio_dec_ctx->bit_rate;
+        mi.aDigit = audio_dec_ctx->format;
+        mi.channels = audio_dec_ctx->channels;
+        mi.sampling = audio_dec_ctx->sample_rate;
+    }
+
+    auto duration = av_ctx->duration == AV_NOPTS_VALUE ? 0 : av_ctx->duration;
+    duration = duration + (duration <= INT64_MAX - 5000 ? 5000 : 0);
+    mi.duration = duration / AV_TIME_BASE;
+    mi.resolution = QString("%1x%2").arg(mi.width).arg(mi.height);
+    mi.title = fi.fileName();
+    mi.filePath = fi.canonicalFilePath();
+    mi.creation = fi.created().toString();
+    mi.fileSize = fi.size();
+    mi.fileType = fi.suffix();
+#ifdef _MOVIE_USE_
+    mi.strFmtName = pResult->formatName;
+#endif
+    AVDictionaryEntry *tag = nullptr;
+    while (m_avDictGet && (tag = m_avDictGet(av_ctx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX)) != nullptr) {
+        if (tag->key && strcmp(tag->key, "creation_time") == 0) {
+            auto dt = QDateTime::fromString(tag->value, Qt::ISODate);
+            mi.creation = dt.toString();
+            break;
+        }
+    }
+
+    m_avformatCloseInput(&av_ctx);
+    mi.valid = true;
+    pResult->miValid = true;
+
+    return pResult;
+}
+
+}
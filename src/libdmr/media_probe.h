@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_MEDIA_PROBE_H
+#define _DMR_MEDIA_PROBE_H
+
+#include <QtCore>
+#include "playlist_model.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/dict.h>
+#include <libavutil/hwcontext.h>
+}
+
+namespace dmr {
+
+typedef int (*probeAvformatOpenInput)(AVFormatContext **ps, const char *url, AVInputFormat *fmt, AVDictionary **options);
+typedef int (*probeAvformatFindStreamInfo)(AVFormatContext *ic, AVDictionary **options);
+typedef int (*probeAvFindBestStream)(AVFormatContext *ic, enum AVMediaType type, int wanted_stream_nb, int related_stream, AVCodec **decoder_ret, int flags);
+typedef void (*probeAvformatCloseInput)(AVFormatContext **s);
+typedef AVDictionaryEntry *(*probeAvDictGet)(const AVDictionary *m, const char *key, const AVDictionaryEntry *prev, int flags);
+typedef AVCodec *(*probeAvcodecFindDecoder)(enum AVCodecID id);
+typedef const AVCodecHWConfig *(*probeAvcodecGetHwConfig)(const AVCodec *codec, int index);
+typedef const char *(*probeAvHwdeviceGetTypeName)(enum AVHWDeviceType type);
+typedef AVCodecParameters *(*probeAvcodecParametersAlloc)(void);
+typedef int (*probeAvcodecParametersCopy)(AVCodecParameters *dst, const AVCodecParameters *src);
+typedef void (*probeAvcodecParametersFree)(AVCodecParameters **par);
+
+/**
+ * @brief 单条流的编码参数
+ */
+struct MediaStreamInfo {
+    AVMediaType type {AVMEDIA_TYPE_UNKNOWN};
+    AVCodecID codecId {AV_CODEC_ID_NONE};
+    int profile {-1};
+    int format {-1};
+    int width {0};
+    int height {0};
+    //完整的编码参数副本，供打开解码器使用
+    QSharedPointer<AVCodecParameters> codecpar;
+};
+
+/**
+ * @brief 一次探测的合并结果，供FileFilter、PlaylistModel、HwdecProbe共用
+ */
+struct MediaProbeResult {
+    enum MediaType {
+        Audio = 0,
+        Video,
+        Subtitle,
+        Other
+    };
+
+    bool opened {false};        // 文件可打开且能找到流信息
+    MediaType type {Other};
+    QString formatName;         // 封装格式全称
+    bool miValid {false};       // 对应parseFromFile的ok返回值
+    MovieInfo mi;
+    QList<MediaStreamInfo> streams;
+    QStringList hwdecTypes;     // 视频解码器声明支持的硬解设备类型
+};
+
+using MediaProbeResultPtr = QSharedPointer<const MediaProbeResult>;
+
+/**
+ * @file 媒体文件单次探测服务
+ * 每个文件只打开一次并执行一次avformat_find_stream_info，结果按(路径, 大小, 修改时间)缓存
+ */
+class MediaProbe
+{
+public:
+    static MediaProbe &get();
+
+    /**
+     * @brief 探测文件，本地文件命中缓存时直接返回，网络地址每次重新打开且不缓存
+     * @param url 文件路径或网络地址
+     * @return 探测结果，不会返回空指针
+     */
+    MediaProbeResultPtr probe(const QUrl &url);
+    MediaProbeResultPtr probe(const QFileInfo &fi);
+    /**
+     * @brief 移除某个文件的缓存结果
+     */
+    void invalidate(const QUrl &url);
+
+private:
+    MediaProbe();
+    void initFFmpegInterface();
+    /**
+     * @param sPath 传给avformat_open_input的路径
+     * @param fi 本地文件信息，网络地址时为空
+     */
+    MediaProbeResult *doProbe(const QString &sPath, const QFileInfo &fi);
+    QString cacheKey(const QFileInfo &fi) const;
+
+private:
+    QMutex m_mutex;
+    QCache<QString, MediaProbeResultPtr> m_cache;
+    bool m_bInited {false};
+
+    probeAvformatOpenInput m_avformatOpenInput {nullptr};
+    probeAvformatFindStreamInfo m_avformatFindStreamInfo {nullptr};
+    probeAvFindBestStream m_avFindBestStream {nullptr};
+    probeAvformatCloseInput m_avformatCloseInput {nullptr};
+    probeAvDictGet m_avDictGet {nullptr};
+    probeAvcodecFindDecoder m_avcodecFindDecoder {nullptr};
+    probeAvcodecGetHwConfig m_avcodecGetHwConfig {nullptr};
+    probeAvHwdeviceGetTypeName m_avHwdeviceGetTypeName {nullptr};
+    probeAvcodecParametersAlloc m_avcodecParametersAlloc {nullptr};
+    probeAvcodecParametersCopy m_avcodecParametersCopy {nullptr};
+    probeAvcodecParametersFree m_avcodecParametersFree {nullptr};
+};
+
+}
+
+#endif /* ifndef _DMR_MEDIA_PROBE_H */
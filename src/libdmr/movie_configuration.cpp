@@ -20,16 +20,233 @@ static QMutex _instLock;
     } \
 } while (0)
 
+#define CONFIG_WRITE_DELAY 500      //写入合并等待时间(ms)
+#define CONFIG_CACHE_URLS 64        //内存中缓存的url数量
+
+/**
+ * @brief 数据库线程执行的操作，Load和Flush由调用线程阻塞等待
+ */
+struct ConfigOp {
+    enum Type {
+        Update,
+        Remove,
+        Clear,
+        Load,
+        Flush
+    };
+
+    Type type {Update};
+    QUrl url;
+    QString key;
+    QVariant val;
+    QMap<QString, QVariant> *pResult {nullptr};
+    bool *pDone {nullptr};
+};
+
 // storage as a database:
 // table 1: urls
 // url md5 timestamp
 // md5 is local file's md5, if url is networked, md5 == 0
 // table 2: infos (stores info about every url)
 // url key value
-class MovieConfigurationBackend: public QObject
+//
+// 数据库只在专用线程中访问，写入先进入队列，短时间内同一url同一key的多次写入合并为一次，
+// 一批写入在同一个事务中提交；读取优先使用内存中最近访问的url，未缓存时排在已有写入之后读取
+class MovieConfigurationBackend: public QThread
 {
 public:
-    explicit MovieConfigurationBackend(MovieConfiguration *cfg): QObject(cfg)
+    MovieConfigurationBackend()
+    {
+        m_cache.setMaxCost(CONFIG_CACHE_URLS);
+    }
+
+    ~MovieConfigurationBackend() override
+    {
+        stop();
+    }
+
+    void deleteUrl(const QUrl &url)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_cache.insert(url, new QMap<QString, QVariant>);
+        m_loading.remove(url);
+        ConfigOp op;
+        op.type = ConfigOp::Remove;
+        op.url = url;
+        enqueue(op, true);
+    }
+
+    bool urlExists(const QUrl &url)
+    {
+        //info和url成对写入删除，有info即有url记录
+        return !queryByUrl(url).isEmpty();
+    }
+
+    void clear()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_cache.clear();
+        m_loading.clear();
+        ConfigOp op;
+        op.type = ConfigOp::Clear;
+        enqueue(op, true);
+    }
+
+    void updateUrl(const QUrl &url, const QString &key, const QVariant &val)
+    {
+        qInfo() << url << key << val;
+
+        QMutexLocker lock(&m_mutex);
+        if (QMap<QString, QVariant> *pInfos = m_cache.object(url)) {
+            pInfos->insert(key, val);
+        }
+        //正在读取的结果不包含这次写入，不能放入缓存
+        m_loading.remove(url);
+
+        //同一url同一key尚未写入时直接替换，只写最后的值
+        const QPair<QUrl, QString> pendingKey(url, key);
+        auto it = m_pending.constFind(pendingKey);
+        if (it != m_pending.constEnd()) {
+            m_ops[it.value()].val = val;
+            return;
+        }
+
+        ConfigOp op;
+        op.type = ConfigOp::Update;
+        op.url = url;
+        op.key = key;
+        op.val = val;
+        m_pending.insert(pendingKey, m_ops.size());
+        enqueue(op, m_bWriteThrough);
+
+        if (m_bWriteThrough) {
+            ConfigOp flushOp;
+            flushOp.type = ConfigOp::Flush;
+            enqueueAndWait(flushOp, lock);
+        }
+    }
+
+    QVariant queryValueByUrlKey(const QUrl &url, const QString &key)
+    {
+        return queryByUrl(url).value(key);
+    }
+
+    QMap<QString, QVariant> queryByUrl(const QUrl &url)
+    {
+        QMutexLocker lock(&m_mutex);
+        if (QMap<QString, QVariant> *pInfos = m_cache.object(url)) {
+            return *pInfos;
+        }
+
+        QMap<QString, QVariant> res;
+        ConfigOp op;
+        op.type = ConfigOp::Load;
+        op.url = url;
+        op.pResult = &res;
+        m_loading.insert(url);
+        if (enqueueAndWait(op, lock) && m_loading.contains(url)) {
+            m_cache.insert(url, new QMap<QString, QVariant>(res));
+        }
+        m_loading.remove(url);
+        return res;
+    }
+
+    /**
+     * @brief 等待队列中的写入全部提交，之后的写入不再合并，立即提交
+     */
+    void flush()
+    {
+        QMutexLocker lock(&m_mutex);
+        m_bWriteThrough = true;
+        ConfigOp op;
+        op.type = ConfigOp::Flush;
+        enqueueAndWait(op, lock);
+    }
+
+    void stop()
+    {
+        {
+            QMutexLocker lock(&m_mutex);
+            m_bQuit = true;
+            m_cond.wakeAll();
+        }
+        //退出前写完队列中的记录
+        wait();
+    }
+
+protected:
+    void run() override
+    {
+        openDatabase();
+
+        QElapsedTimer timer;
+        while (true) {
+            QList<ConfigOp> ops;
+            {
+                QMutexLocker lock(&m_mutex);
+                while (m_ops.isEmpty() && !m_bQuit) {
+                    m_cond.wait(&m_mutex);
+                }
+
+                //只有写入时等待一段时间，合并连续的写入
+                timer.start();
+                while (!m_bUrgent && !m_bQuit && timer.elapsed() < CONFIG_WRITE_DELAY) {
+                    m_cond.wait(&m_mutex, static_cast<unsigned long>(CONFIG_WRITE_DELAY - timer.elapsed()));
+                }
+
+                ops.swap(m_ops);
+                m_pending.clear();
+                m_bUrgent = false;
+                if (ops.isEmpty() && m_bQuit)
+                    break;
+            }
+
+            execute(ops);
+        }
+
+        //先释放语句，连接不再被使用后才能移除
+        m_selectUrl = m_insertUrl = m_replaceInfo = m_selectInfos = m_deleteInfos = m_deleteUrl = QSqlQuery();
+        m_db.close();
+        const QString sName = m_db.connectionName();
+        m_db = QSqlDatabase();
+        QSqlDatabase::removeDatabase(sName);
+    }
+
+private:
+    /**
+     * @brief 加入操作队列，调用时需持有m_mutex
+     * @param bUrgent 为true时数据库线程不再等待合并，立即执行
+     */
+    void enqueue(const ConfigOp &op, bool bUrgent)
+    {
+        if (op.type != ConfigOp::Update) {
+            //删除、清空和读取之前的写入不能与之后的写入合并
+            m_pending.clear();
+        }
+        m_ops.append(op);
+        m_bUrgent = m_bUrgent || bUrgent;
+        m_cond.wakeAll();
+    }
+
+    /**
+     * @brief 加入操作队列并阻塞到执行完成，调用时需持有m_mutex
+     * @return 数据库线程已退出时返回false
+     */
+    bool enqueueAndWait(ConfigOp &op, QMutexLocker &lock)
+    {
+        if (m_bQuit || !isRunning())
+            return false;
+
+        bool bDone = false;
+        op.pDone = &bDone;
+        enqueue(op, true);
+        while (!bDone) {
+            m_doneCond.wait(lock.mutex());
+        }
+        return true;
+    }
+
+    void openDatabase()
     {
         auto db_dir = QString("%1/%2/%3")
                       .arg(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation))
@@ -40,16 +257,20 @@ public:
         d.mkpath(db_dir);
 
         auto db_path = QString("%1/movies.db").arg(db_dir);
-        _db = QSqlDatabase::addDatabase("QSQLITE");
-        _db.setDatabaseName(db_path);
-        if(!_db.open()) {
+        m_db = QSqlDatabase::addDatabase("QSQLITE", "movie_configuration");
+        m_db.setDatabaseName(db_path);
+        if(!m_db.open()) {
             qCritical() << "open the movies database error";
             return;
         }
 
-        auto ts = _db.tables(QSql::Tables);
+        QSqlQuery q(m_db);
+        if (!q.exec("pragma journal_mode = WAL") || !q.exec("pragma synchronous = NORMAL")) {
+            qCritical() << q.lastError();
+        }
+
+        auto ts = m_db.tables(QSql::Tables);
         if (!ts.contains("urls") || !ts.contains("infos")) {
-            QSqlQuery q(_db);
             if (!q.exec("create table if not exists urls (url TEXT primary key, "
                         "md5 TEXT, timestamp DATETIME)")) {
                 qCritical() << q.lastError();
@@ -60,152 +281,153 @@ public:
                 qCritical() << q.lastError();
             }
         }
-    }
-
-    void deleteUrl(const QUrl &url)
-    {
-        if(_db.transaction()) {
-            QSqlQuery q(_db);
-            if(q.prepare("delete from infos where url = ?")) {
-                q.addBindValue(url);
-                if (!q.exec()) {
-                    if(!_db.commit()) {
-                        qCritical() << _db.lastError();
-                    }
-                    return;
-                }
-            }
-
-            if (q.numRowsAffected() > 0) {
-                QSqlQuery q_l(_db);
-                if(q_l.prepare("delete from urls where url = ?")) {
-                    q_l.addBindValue(url);
-                    CHECKED_EXEC(q_l);
-                }
-            }
-        }
-    }
-
-    bool urlExists(const QUrl &url)
-    {
-        QSqlQuery q(_db);
-        if(q.prepare("select url from urls where url = ? limit 1")) {
-            q.addBindValue(url);
-            CHECKED_EXEC(q);
-        }
 
-        return q.first();
+        //语句只准备一次，之后每次只绑定参数
+        m_selectUrl = QSqlQuery(m_db);
+        m_selectUrl.prepare("select url from urls where url = ? limit 1");
+        m_insertUrl = QSqlQuery(m_db);
+        m_insertUrl.prepare("insert into urls (url, md5, timestamp) values (?, ?, ?)");
+        m_replaceInfo = QSqlQuery(m_db);
+        m_replaceInfo.prepare("replace into infos (url, key, value) values (?, ?, ?)");
+        m_selectInfos = QSqlQuery(m_db);
+        m_selectInfos.prepare("select key, value from infos where url = ?");
+        m_deleteInfos = QSqlQuery(m_db);
+        m_deleteInfos.prepare("delete from infos where url = ?");
+        m_deleteUrl = QSqlQuery(m_db);
+        m_deleteUrl.prepare("delete from urls where url = ?");
     }
 
-    void clear()
+    void execute(const QList<ConfigOp> &ops)
     {
-        if(_db.transaction()) {
-            QSqlQuery q(_db);
-            if (q.exec("delete from infos")) {
-                if (q.exec("delete from urls")) {
-                    if(!_db.commit()) {
-                        qCritical() << _db.lastError();
-                    }
-                    return;
+        bool bTransaction = false;
+        for (const ConfigOp &op : ops) {
+            if (op.type == ConfigOp::Load || op.type == ConfigOp::Flush) {
+                //先提交之前的写入，读取结果包含这些写入
+                if (bTransaction && !m_db.commit()) {
+                    qCritical() << m_db.lastError();
                 }
+                bTransaction = false;
+
+                QMap<QString, QVariant> res;
+                if (op.type == ConfigOp::Load)
+                    res = loadUrl(op.url);
+
+                QMutexLocker lock(&m_mutex);
+                if (op.pResult)
+                    *op.pResult = res;
+                *op.pDone = true;
+                m_doneCond.wakeAll();
+                continue;
             }
 
-            if(!_db.rollback()) {
-                qCritical() << _db.lastError();
-            }
-        }
-    }
-
-    void updateUrl(const QUrl &url, const QString &key, const QVariant &val)
-    {
-        qInfo() << url << key << val;
+            if (!bTransaction)
+                bTransaction = m_db.transaction();
 
-        if(_db.transaction()) {
-            if (!urlExists(url)) {
-                QString md5;
-                if (url.isLocalFile()) {
-                    md5 = utils::FastFileHash(QFileInfo(url.toLocalFile()));
-                } else {
-                    md5 = QString(QCryptographicHash::hash(url.toString().toUtf8(), QCryptographicHash::Md5).toHex());
+            switch (op.type) {
+            case ConfigOp::Update:
+                if (ensureUrl(op.url)) {
+                    m_replaceInfo.addBindValue(op.url);
+                    m_replaceInfo.addBindValue(op.key);
+                    m_replaceInfo.addBindValue(op.val);
+                    CHECKED_EXEC(m_replaceInfo);
                 }
-
-                QSqlQuery q(_db);
-                if(q.prepare("insert into urls (url, md5, timestamp) values (?, ?, ?)")) {
-                    q.addBindValue(url);
-                    q.addBindValue(md5);
-                    q.addBindValue(QDateTime::currentDateTimeUtc());
-                    if (!q.exec()) {
-                        if(!_db.rollback()) {
-                            qCritical() << _db.lastError();
-                        }
-                        return;
-                    }
+                break;
+            case ConfigOp::Remove:
+                m_knownUrls.remove(op.url);
+                m_deleteInfos.addBindValue(op.url);
+                CHECKED_EXEC(m_deleteInfos);
+                m_deleteUrl.addBindValue(op.url);
+                CHECKED_EXEC(m_deleteUrl);
+                break;
+            case ConfigOp::Clear: {
+                m_knownUrls.clear();
+                QSqlQuery q(m_db);
+                if (!q.exec("delete from infos") || !q.exec("delete from urls")) {
+                    qCritical() << q.lastError();
                 }
+                break;
             }
-
-            QSqlQuery q(_db);
-            if(q.prepare("replace into infos (url, key, value) values (?, ?, ?)")) {
-                q.addBindValue(url);
-                q.addBindValue(key);
-                q.addBindValue(val);
-                CHECKED_EXEC(q);
-                if(!_db.commit()) {
-                    qCritical() << _db.lastError();
-                }
+            default:
+                break;
             }
         }
+
+        if (bTransaction && !m_db.commit()) {
+            qCritical() << m_db.lastError();
+        }
     }
 
-    QVariant queryValueByUrlKey(const QUrl &url, const QString &key)
+    /**
+     * @brief 确保urls表中有该url，新url在这里计算md5
+     */
+    bool ensureUrl(const QUrl &url)
     {
-        if (!urlExists(url))
-            return {};
-
-        QSqlQuery q(_db);
-        if(q.prepare("select value from infos where url = ? and key = ?")) {
-            q.addBindValue(url);
-            q.addBindValue(key);
-            CHECKED_EXEC(q);
+        if (m_knownUrls.contains(url))
+            return true;
+
+        m_selectUrl.addBindValue(url);
+        CHECKED_EXEC(m_selectUrl);
+        const bool bExists = m_selectUrl.first();
+        m_selectUrl.finish();
+
+        if (!bExists) {
+            QString md5;
+            if (url.isLocalFile()) {
+                md5 = utils::FastFileHash(QFileInfo(url.toLocalFile()));
+            } else {
+                md5 = QString(QCryptographicHash::hash(url.toString().toUtf8(), QCryptographicHash::Md5).toHex());
+            }
 
-            if (q.next()) {
-                return q.value(0);
+            m_insertUrl.addBindValue(url);
+            m_insertUrl.addBindValue(md5);
+            m_insertUrl.addBindValue(QDateTime::currentDateTimeUtc());
+            if (!m_insertUrl.exec()) {
+                qCritical() << m_insertUrl.lastError();
+                return false;
             }
         }
 
-        return QVariant();
+        m_knownUrls.insert(url);
+        return true;
     }
 
-    QMap<QString, QVariant> queryByUrl(const QUrl &url)
+    QMap<QString, QVariant> loadUrl(const QUrl &url)
     {
-        if (!urlExists(url))
-            return {};
-
-        QSqlQuery q(_db);
-        if(q.prepare("select key, value from infos where url = ?")) {
-            q.addBindValue(url);
-            CHECKED_EXEC(q);
-        }
+        m_selectInfos.addBindValue(url);
+        CHECKED_EXEC(m_selectInfos);
 
         QMap<QString, QVariant> res;
-        while (q.next()) {
-            res.insert(q.value(0).toString(), q.value(1));
+        while (m_selectInfos.next()) {
+            res.insert(m_selectInfos.value(0).toString(), m_selectInfos.value(1));
         }
+        m_selectInfos.finish();
 
         return res;
     }
 
-    ~MovieConfigurationBackend();
-
 private:
-    QSqlDatabase _db;
+    QMutex m_mutex;                                  //保护以下成员
+    QWaitCondition m_cond;                           //有新操作或退出
+    QWaitCondition m_doneCond;                       //阻塞的操作执行完成
+    QList<ConfigOp> m_ops;
+    QHash<QPair<QUrl, QString>, int> m_pending;      //可合并的写入在m_ops中的位置
+    QCache<QUrl, QMap<QString, QVariant>> m_cache;   //最近访问的url的全部记录
+    QSet<QUrl> m_loading;                            //正在读取且期间没有写入的url
+    bool m_bUrgent {false};
+    bool m_bWriteThrough {false};
+    bool m_bQuit {false};
+
+    //以下成员只在数据库线程中使用
+    QSqlDatabase m_db;
+    QSqlQuery m_selectUrl;
+    QSqlQuery m_insertUrl;
+    QSqlQuery m_replaceInfo;
+    QSqlQuery m_selectInfos;
+    QSqlQuery m_deleteInfos;
+    QSqlQuery m_deleteUrl;
+    QSet<QUrl> m_knownUrls;                          //已确认在urls表中的url
 };
 
-MovieConfigurationBackend::~MovieConfigurationBackend()
-{
-    _db.close();
-    QSqlDatabase::removeDatabase(_db.connectionName());
-}
-
 MovieConfiguration &MovieConfiguration::get()
 {
     if (_instance == nullptr) {
@@ -340,7 +562,15 @@ static void _backend_test()
 
 void MovieConfiguration::init()
 {
-    _backend = new MovieConfigurationBackend(this);
+    if (_backend)
+        return;
+
+    _backend = new MovieConfigurationBackend;
+    _backend->start();
+    //主窗口析构时仍会保存播放位置，退出流程开始后写入立即提交
+    connect(qApp, &QCoreApplication::aboutToQuit, this, [ = ] {
+        _backend->flush();
+    });
 #ifdef SQL_TEST
     _backend_test();
 #endif
@@ -143,6 +143,10 @@ Q_SIGNALS:
     void volumeChanged();
     void sidChanged();
     void aidChanged();
+    //requestEndOfPlayback请求的停止完成
+    void stopCompleted();
+    //seek完成，播放已从新位置重新开始
+    void seekCompleted();
 
     //emit during burst screenshotting
     void notifyScreenshot(const QImage &frame, qint64 time);
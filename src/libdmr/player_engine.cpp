@@ -62,6 +62,8 @@ PlayerEngine::PlayerEngine(QWidget *parent)
         connect(_current, &Backend::volumeChanged, this, &PlayerEngine::volumeChanged);
         connect(_current, &Backend::sidChanged, this, &PlayerEngine::sidChanged);
         connect(_current, &Backend::aidChanged, this, &PlayerEngine::aidChanged);
+        connect(_current, &Backend::stopCompleted, this, &PlayerEngine::lastPlaybackEnded);
+        connect(_current, &Backend::seekCompleted, this, &PlayerEngine::seekCompleted);
         connect(_current, &Backend::videoSizeChanged, this, &PlayerEngine::videoSizeChanged);
         connect(_current, &Backend::notifyScreenshot, this, &PlayerEngine::notifyScreenshot);
         connect(_current, &Backend::mpvErrorLogsChanged, this, &PlayerEngine::mpvErrorLogsChanged);
@@ -181,12 +183,12 @@ void PlayerEngine::updateSubStyles()
 #endif
 }
 
-void PlayerEngine::waitLastEnd()
+void PlayerEngine::requestLastEnd()
 {
     if (MpvProxy *mpv = dynamic_cast<MpvProxy *>(_current)) {
-        mpv->pollingEndOfPlayback();
+        mpv->requestEndOfPlayback();
     }else if (QtPlayerProxy *qtPlayer = dynamic_cast<QtPlayerProxy *>(_current)) {
-        qtPlayer->pollingEndOfPlayback();
+        qtPlayer->requestEndOfPlayback();
     }
 }
 
@@ -733,45 +735,62 @@ bool PlayerEngine::addPlayFile(const QUrl &url)
     return true;
 }
 
-QList<QUrl> PlayerEngine::addPlayDir(const QDir &dir)
-{
-    QList<QUrl> valids = FileFilter::instance()->filterDir(dir);
-
-    struct {
-        bool operator()(const QUrl& fi1, const QUrl& fi2) const {
-            static QRegExp rd("\\d+");
-            int pos = 0;
-            QString fileName1 = QFileInfo(fi1.toLocalFile()).fileName();
-            QString fileName2 = QFileInfo(fi2.toLocalFile()).fileName();
-            while ((pos = rd.indexIn(fileName1, pos)) != -1) {
-                auto inc = rd.matchedLength();
-                auto id1 = fileName1.midRef(pos, inc);
-
-                auto pos2 = rd.indexIn(fileName2, pos);
-                if (pos == pos2) {
-                    auto id2 = fileName2.midRef(pos, rd.matchedLength());
-                    //qInfo() << "id compare " << id1 << id2;
-                    if (id1 != id2) {
-                        bool ok1, ok2;
-                        bool v = id1.toInt(&ok1) < id2.toInt(&ok2);
-                        if (ok1 && ok2) return v;
-                        return id1.localeAwareCompare(id2) < 0;
-                    }
-                }
-
-                pos += inc;
+/**
+ * @brief 按文件名中的数字排序，如“第2集”排在“第10集”之前
+ */
+static bool compareByDigits(const QUrl &fi1, const QUrl &fi2)
+{
+    static QRegExp rd("\\d+");
+    int pos = 0;
+    QString fileName1 = QFileInfo(fi1.toLocalFile()).fileName();
+    QString fileName2 = QFileInfo(fi2.toLocalFile()).fileName();
+    while ((pos = rd.indexIn(fileName1, pos)) != -1) {
+        auto inc = rd.matchedLength();
+        auto id1 = fileName1.midRef(pos, inc);
+
+        auto pos2 = rd.indexIn(fileName2, pos);
+        if (pos == pos2) {
+            auto id2 = fileName2.midRef(pos, rd.matchedLength());
+            //qInfo() << "id compare " << id1 << id2;
+            if (id1 != id2) {
+                bool ok1, ok2;
+                bool v = id1.toInt(&ok1) < id2.toInt(&ok2);
+                if (ok1 && ok2) return v;
+                return id1.localeAwareCompare(id2) < 0;
             }
-            return fileName1.localeAwareCompare(fileName2) < 0;
         }
-    } SortByDigits;
 
-    std::sort(valids.begin(), valids.end(), SortByDigits);
-    valids = addPlayFiles(valids);
-    _playlist->appendAsync(valids);
+        pos += inc;
+    }
+    return fileName1.localeAwareCompare(fileName2) < 0;
+}
+
+QList<QUrl> PlayerEngine::addPlayDir(const QDir &dir)
+{
+    QList<QUrl> valids = addPlayDirs(QStringList() << dir.absolutePath());
+
+    std::sort(valids.begin(), valids.end(), compareByDigits);
 
     return valids;
 }
 
+QList<QUrl> PlayerEngine::addPlayDirs(const QStringList &lstDir)
+{
+    // 扫描线程已完成探测，每批是一个文件夹的全部文件，按文件夹先序遍历的顺序交出，
+    // 排序后直接加入播放列表，不必等整个目录树扫描完
+    // 回调运行在扫描线程，播放列表的追加记录只在界面线程维护，排队交给界面线程
+    return FileFilter::instance()->filterMediaDirs(lstDir, [this](const QList<QUrl> &urls) {
+        if (m_stopRunningThread)
+            return;
+        QList<QUrl> batch = urls;
+        std::sort(batch.begin(), batch.end(), compareByDigits);
+        PlaylistModel *pPlaylist = _playlist;
+        QMetaObject::invokeMethod(pPlaylist, [pPlaylist, batch]() {
+            pPlaylist->appendAsync(batch);
+        }, Qt::QueuedConnection);
+    });
+}
+
 QList<QUrl> PlayerEngine::addPlayFiles(const QList<QUrl> &urls)
 {
     qInfo() << __func__;
@@ -793,42 +812,50 @@ QList<QUrl> PlayerEngine::addPlayFiles(const QList<QString> &lstFile)
 {
     qInfo() << __func__;
     QList<QUrl> valids;
+    QStringList lstDir;
     QUrl realUrl;
 
     for (QString strFile : lstFile) {
           realUrl = FileFilter::instance()->fileTransfer(strFile);
           if (QFileInfo(realUrl.path()).isDir()) {
               if (realUrl.isLocalFile())          // 保证不是网络路径
-                  valids << FileFilter::instance()->filterDir(QDir(realUrl.path()));
+                  lstDir << realUrl.path();
           } else {
               valids << realUrl;
           }
     }
 
-    return addPlayFiles(valids);
+    valids = addPlayFiles(valids);
+    if (!lstDir.isEmpty())
+        valids << addPlayDirs(lstDir);
+
+    return valids;
 }
 
 void PlayerEngine::addPlayFs(const QList<QString> &lstFile)
 {
     qInfo() << __func__;
     QList<QUrl> valids;
+    QStringList lstDir;
     QUrl realUrl;
 
     for (QString strFile : lstFile) {
           realUrl = FileFilter::instance()->fileTransfer(strFile);
           if (QFileInfo(realUrl.path()).isDir()) {
               if (realUrl.isLocalFile())          // 保证不是网络路径
-                  valids << FileFilter::instance()->filterDir(QDir(realUrl.path()));
+                  lstDir << realUrl.path();
           } else {
               valids << realUrl;
           }
     }
 
-    if (valids.isEmpty()) {
+    if (valids.isEmpty() && lstDir.isEmpty()) {
         blockSignals(false);
         return;
     }
     QList<QUrl> addFiles = addPlayFiles(valids);
+    if (!lstDir.isEmpty())
+        addFiles << addPlayDirs(lstDir);
     blockSignals(false);
     emit finishedAddFiles(addFiles);
 }
@@ -949,7 +976,7 @@ bool PlayerEngine::currFileIsAudio()
     }
 
     if (CompositingManager::isMpvExists()) {
-        bAudio = pif.thumbnail.isNull() && pif.url.isLocalFile();
+        bAudio = pif.thumbnail().isNull() && pif.url.isLocalFile();
     } else {
         bAudio = isAudioFile(pif.url.toString());
     }
@@ -46,10 +46,11 @@ public:
     const static QStringList subtitle_suffixs;
 
     /* backend like mpv will asynchronously report end of playback.
-     * there are situations when we need to see the end-event before
-     * proceed (e.g playlist next)
+     * request the end without waiting for it, the backend reports Stopped
+     * (and lastPlaybackEnded) once the end-event is dispatched, so the
+     * next item can be requested right away (e.g playlist next)
      */
-    void waitLastEnd();
+    void requestLastEnd();
 
     friend class PlaylistModel;
 
@@ -78,6 +79,12 @@ public:
      * @param 文件集合
      */
     void addPlayFs(const QList<QString> &lstFile);
+    /**
+     * @brief addPlayDirs 并行扫描文件夹，边扫描边添加到播放列表
+     * @param 本地文件夹集合
+     * @return 返回已添加的文件，中止时为空
+     */
+    QList<QUrl> addPlayDirs(const QStringList &lstDir);
     /**
      * @brief isPlayableFile 判断一个文件是否可以播放
      * @param url 文件url
@@ -173,6 +180,8 @@ signals:
     void sidChanged();
     void aidChanged();
     void subCodepageChanged();
+    void lastPlaybackEnded();
+    void seekCompleted();
 
     void loadOnlineSubtitlesFinished(const QUrl &url, bool success);
     //add by heyi mpv函数加载完毕
@@ -11,7 +11,10 @@
 #endif
 #include "dvd_utils.h"
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 #include "gstutils.h"
+#include "media_probe.h"
+#include "media_info_store.h"
 
 #include <QSvgRenderer>
 
@@ -47,207 +50,15 @@ mvideo_avcodec_alloc_context3 g_mvideo_avcodec_alloc_context3 = nullptr;
 mvideo_avcodec_parameters_to_context g_mvideo_avcodec_parameters_to_context = nullptr;
 
 namespace dmr {
-QDataStream &operator<< (QDataStream &st, const MovieInfo &mi)
-{
-    st << mi.valid;
-    st << mi.title;
-    st << mi.fileType;
-    st << mi.resolution;
-    st << mi.filePath;
-    st << mi.creation;
-    st << mi.raw_rotate;
-    st << mi.fileSize;
-    st << mi.duration;
-    st << mi.width;
-    st << mi.height;
-    st << mi.vCodecID;
-    st << mi.vCodeRate;
-    st << mi.fps;
-    st << mi.proportion;
-    st << mi.aCodeID;
-    st << mi.aCodeRate;
-    st << mi.aDigit;
-    st << mi.channels;
-    st << mi.sampling;
-#ifdef _MOVIE_USE_
-    st << mi.strFmtName;
-#endif
-    return st;
-}
-
-QDataStream &operator>> (QDataStream &st, MovieInfo &mi)
-{
-    st >> mi.valid;
-    st >> mi.title;
-    st >> mi.fileType;
-    st >> mi.resolution;
-    st >> mi.filePath;
-    st >> mi.creation;
-    st >> mi.raw_rotate;
-    st >> mi.fileSize;
-    st >> mi.duration;
-    st >> mi.width;
-    st >> mi.height;
-    st >> mi.vCodecID;
-    st >> mi.vCodeRate;
-    st >> mi.fps;
-    st >> mi.proportion;
-    st >> mi.aCodeID;
-    st >> mi.aCodeRate;
-    st >> mi.aDigit;
-    st >> mi.channels;
-    st >> mi.sampling;
-#ifdef _MOVIE_USE_
-    st >> mi.strFmtName;
-#endif
-    return st;
-}
-
-static class PersistentManager *_persistentManager = nullptr;
-
-static QString hashUrl(const QUrl &url)
+static QUrl normalizedUrl(const QUrl &url)
 {
-    return QString(QCryptographicHash::hash(url.toEncoded(), QCryptographicHash::Sha256).toHex());
+    return url.adjusted(QUrl::NormalizePathSegments);
 }
 
-//TODO: clean cache periodically
-class PersistentManager: public QObject
-{
-    Q_OBJECT
-public:
-    static PersistentManager &get()
-    {
-        if (!_persistentManager) {
-            _persistentManager = new PersistentManager;
-        }
-        return *_persistentManager;
-    }
-
-    struct CacheInfo {
-        struct MovieInfo mi;
-        QPixmap thumb;
-        QPixmap thumb_dark;
-        bool mi_valid {false};
-        bool thumb_valid {false};
-//        char m_padding [6];//占位符
-        CacheInfo() {
-            thumb = QPixmap();
-            thumb_dark = QPixmap();
-            mi_valid = false;
-            thumb_valid = false;
-        }
-    };
-
-    CacheInfo loadFromCache(const QUrl &url)
-    {
-        auto h = hashUrl(url);
-        CacheInfo ci;
-
-        {
-            auto filename = QString("%1/%2").arg(_cacheInfoPath).arg(h);
-            QFile f(filename);
-            if (!f.exists()) return ci;
-
-            if (f.open(QIODevice::ReadOnly)) {
-                QDataStream ds(&f);
-                ds >> ci.mi;
-                ci.mi_valid = ci.mi.valid;
-            } else {
-                qWarning() << f.errorString();
-            }
-            f.close();
-        }
-
-        if (ci.mi_valid) {
-            auto filename = QString("%1/%2").arg(_pixmapCachePath).arg(h);
-            QFile f(filename);
-            if (!f.exists()) return ci;
-
-            if (f.open(QIODevice::ReadOnly)) {
-                QDataStream ds(&f);
-                ds >> ci.thumb;
-                ds >> ci.thumb_dark;
-                ci.thumb.setDevicePixelRatio(qApp->devicePixelRatio());
-                ci.thumb_dark.setDevicePixelRatio(qApp->devicePixelRatio());
-                if (DGuiApplicationHelper::DarkType == DGuiApplicationHelper::instance()->themeType()) {
-                    ci.thumb_valid = !ci.thumb_dark.isNull();
-                } else {
-                    ci.thumb_valid = !ci.thumb.isNull();
-                }
-            } else {
-                qWarning() << f.errorString();
-            }
-            f.close();
-        }
-
-        return ci;
-    }
-
-    void save(const PlayItemInfo &pif)
-    {
-        auto h = hashUrl(pif.url);
-
-        bool mi_saved = false;
-
-        {
-            auto filename = QString("%1/%2").arg(_cacheInfoPath).arg(h);
-            QFile f(filename);
-            if (f.open(QIODevice::WriteOnly)) {
-                QDataStream ds(&f);
-                ds << pif.mi;
-                mi_saved = true;
-                qInfo() << "cache" << pif.url << "->" << h;
-            } else {
-                qWarning() << f.errorString();
-            }
-            f.close();
-        }
-
-        if (mi_saved) {
-            auto filename = QString("%1/%2").arg(_pixmapCachePath).arg(h);
-            QFile f(filename);
-            if (f.open(QIODevice::WriteOnly)) {
-                QDataStream ds(&f);
-                ds << pif.thumbnail;
-                ds << pif.thumbnail_dark;
-            } else {
-                qWarning() << f.errorString();
-            }
-            f.close();
-        }
-    }
-
-private:
-    PersistentManager()
-    {
-        auto tmpl = QString("%1/%2/%3/%4")
-                    .arg(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation))
-                    .arg(qApp->organizationName())
-                    .arg(qApp->applicationName());
-        {
-            _cacheInfoPath = tmpl.arg("cacheinfo");
-            QDir d;
-            d.mkpath(_cacheInfoPath);
-        }
-        {
-            _pixmapCachePath = tmpl.arg("thumbs");
-            QDir d;
-            d.mkpath(_pixmapCachePath);
-        }
-    }
-
-    QString _pixmapCachePath;
-    QString _cacheInfoPath;
-
-};
-
 struct MovieInfo PlaylistModel::parseFromFile(const QFileInfo &fi, bool *ok)
 {
     struct MovieInfo mi;
     mi.valid = false;
-    AVFormatContext *av_ctx = nullptr;
-    AVCodecParameters *video_dec_ctx = nullptr;
-    AVCodecParameters *audio_dec_ctx = nullptr;
 
     if (!CompositingManager::isMpvExists()) {
         return parseFromFileByQt(fi, ok);
@@ -258,104 +69,20 @@ struct MovieInfo PlaylistModel::parseFromFile(const QFileInfo &fi, bool *ok)
         return mi;
     }
 
-    auto ret = g_mvideo_avformat_open_input(&av_ctx, fi.filePath().toUtf8().constData(), nullptr, nullptr);
-    if (ret < 0) {
-        qWarning() << "avformat: could not open input";
-        if (ok) *ok = false;
-        return mi;
-    }
-
-    if (g_mvideo_avformat_find_stream_info(av_ctx, nullptr) < 0) {
-        qWarning() << "av_find_stream_info failed";
-        if (ok) *ok = false;
-        return mi;
-    }
-
-    if (av_ctx->nb_streams == 0) {
-        if (ok) *ok = false;
-        return mi;
-    }
-
-    int videoRet = -1;
-    int audioRet = -1;
-    AVStream *videoStream = nullptr;
-    AVStream *audioStream = nullptr;
-    videoRet = g_mvideo_av_find_best_stream(av_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
-    audioRet = g_mvideo_av_find_best_stream(av_ctx, AVMEDIA_TYPE_AUDIO, -1, -1, nullptr, 0);
-    if (videoRet < 0 && audioRet < 0) {
+    //导入时isPlayableFile已探测过该文件，这里直接复用结果
+    MediaProbeResultPtr pProbe = MediaProbe::get().probe(fi);
+    if (!pProbe->miValid) {
         if (ok) *ok = false;
         return mi;
     }
 
-    if (videoRet >= 0) {
-        int video_stream_index = -1;
-        video_stream_index = videoRet;
-        videoStream = av_ctx->streams[video_stream_index];
-        video_dec_ctx = videoStream->codecpar;
-
-        mi.width = video_dec_ctx->width;
-        mi.height = video_dec_ctx->height;
-        mi.vCodecID = video_dec_ctx->codec_id;
-        mi.vCodeRate = video_dec_ctx->bit_rate;
-#ifdef _MOVIE_USE_
-        mi.strFmtName = av_ctx->iformat->long_name;
-#endif
-
-        if (videoStream->r_frame_rate.den != 0) {
-            mi.fps = videoStream->r_frame_rate.num / videoStream->r_frame_rate.den;
-        } else {
-            mi.fps = 0;
-        }
-        if (mi.height != 0) {
-            mi.proportion = static_cast<float>(mi.width) / static_cast<float>(mi.height);
-        } else {
-            mi.proportion = 0;
-        }
-    }
-    if (audioRet >= 0) {
-        int audio_stream_index = -1;
-        audio_stream_index = audioRet;
-        audioStream = av_ctx->streams[audio_stream_index];
-        audio_dec_ctx = audioStream->codecpar;
-
-        mi.aCodeID = audio_dec_ctx->codec_id;
-        mi.aCodeRate = audio_dec_ctx->bit_rate;
-        mi.aDigit = audio_dec_ctx->format;
-        mi.channels = audio_dec_ctx->channels;
-        mi.sampling = audio_dec_ctx->sample_rate;
-
+    mi = pProbe->mi;
 #ifdef USE_TEST
+    if (mi.aCodeID != -1) {
         QPixmap musicimage;
         getMusicPix(fi, musicimage);
-#endif
     }
-
-    auto duration = av_ctx->duration == AV_NOPTS_VALUE ? 0 : av_ctx->duration;
-    duration = duration + (duration <= INT64_MAX - 5000 ? 5000 : 0);
-    mi.duration = duration / AV_TIME_BASE;
-    mi.resolution = QString("%1x%2").arg(mi.width).arg(mi.height);
-    mi.title = fi.fileName(); //FIXME this
-    mi.filePath = fi.canonicalFilePath();
-    qInfo() << __func__ << "created:" << fi.created() << "       toString:" << fi.created().toString();
-    mi.creation = fi.created().toString();
-    mi.fileSize = fi.size();
-    mi.fileType = fi.suffix();
-#ifdef _MOVIE_USE_
-    mi.strFmtName = av_ctx->iformat->long_name;
 #endif
-    AVDictionaryEntry *tag = nullptr;
-    while ((tag = g_mvideo_av_dict_get(av_ctx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX)) != nullptr) {
-        if (tag->key && strcmp(tag->key, "creation_time") == 0) {
-            auto dt = QDateTime::fromString(tag->value, Qt::ISODate);
-            mi.creation = dt.toString();
-            qInfo() << __func__ << dt.toString();
-            break;
-        }
-        qInfo() << "tag:" << tag->key << tag->value;
-    }
-
-    g_mvideo_avformat_close_input(&av_ctx);
-    mi.valid = true;
 
     if (ok) *ok = true;
     return mi;
@@ -374,6 +101,27 @@ MovieInfo PlaylistModel::parseFromFileByQt(const QFileInfo &fi, bool *ok)
     return mi;
 }
 
+const QPixmap &PlayItemInfo::thumbnail() const
+{
+    static const QPixmap empty;
+    return thumb ? thumb->thumbnail : empty;
+}
+
+const QPixmap &PlayItemInfo::thumbnailDark() const
+{
+    static const QPixmap empty;
+    return thumb ? thumb->thumbnail_dark : empty;
+}
+
+void PlayItemInfo::setThumbnail(const QPixmap &pm, const QPixmap &dark_pm)
+{
+    if (pm.isNull() && dark_pm.isNull()) {
+        thumb.clear();
+        return;
+    }
+    thumb = PlayItemThumbPtr(new PlayItemThumb {pm, dark_pm});
+}
+
 bool PlayItemInfo::refresh()
 {
     if (url.isLocalFile()) {
@@ -419,6 +167,14 @@ void PlaylistModel::slotStateChanged()
     }
 }
 
+void PlaylistModel::slotLastPlaybackEnded()
+{
+    if (_releaseRequestOnEnd) {
+        _releaseRequestOnEnd = false;
+        _userRequestingItem = false;
+    }
+}
+
 PlaylistModel::PlaylistModel(PlayerEngine *e)
     : _engine(e)
 {
@@ -430,8 +186,21 @@ PlaylistModel::PlaylistModel(PlayerEngine *e)
                     .arg(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation))
                     .arg(qApp->organizationName())
                     .arg(qApp->applicationName());
+    _journalFile = _playlistFile + ".journal";
+
+    m_pSaveTimer = new QTimer(this);
+    m_pSaveTimer->setSingleShot(true);
+    m_pSaveTimer->setInterval(1000);
+    connect(m_pSaveTimer, &QTimer::timeout, this, &PlaylistModel::savePlaylist);
+
+    qRegisterMetaType<QList<PlayItemInfo>>("QList<PlayItemInfo>");
+
+    //解析线程池在界面线程创建，追加请求都转到界面线程后再提交；单核时也至少有一个解析线程
+    m_pProbePool = new PlayInfoProbePool(this);
+    connect(m_pProbePool, &PlayInfoProbePool::resultsReady, this, &PlaylistModel::onAsyncUpdate);
 
     connect(e, &PlayerEngine::stateChanged, this, &PlaylistModel::slotStateChanged);
+    connect(e, &PlayerEngine::lastPlaybackEnded, this, &PlaylistModel::slotLastPlaybackEnded);
 
     stop();
 
@@ -447,26 +216,9 @@ PlaylistModel::PlaylistModel(PlayerEngine *e)
 #endif
 }
 
-QString PlaylistModel::libPath(const QString &strlib)
-{
-    QDir  dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (strlib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(strlib)) {
-        return strlib;
-    } else {
-        list.sort();
-    }
-    if (list.size()>0)
-        return list.last();
-    else
-        return QString();
-}
-
 void PlaylistModel::initThumb()
 {
-    QLibrary library(CompositingManager::libPath("libffmpegthumbnailer.so"));
+    QLibrary &library = RuntimeRegistry::get().library("libffmpegthumbnailer.so");
     m_mvideo_thumbnailer = (mvideo_thumbnailer) library.resolve("video_thumbnailer_create");
     m_mvideo_thumbnailer_destroy = (mvideo_thumbnailer_destroy) library.resolve("video_thumbnailer_destroy");
     m_mvideo_thumbnailer_create_image_data = (mvideo_thumbnailer_create_image_data) library.resolve("video_thumbnailer_create_image_data");
@@ -490,9 +242,9 @@ void PlaylistModel::initThumb()
 
 void PlaylistModel::initFFmpeg()
 {
-    QLibrary avcodecLibrary(CompositingManager::libPath("libavcodec.so"));
-    QLibrary avformatLibrary(CompositingManager::libPath("libavformat.so"));
-    QLibrary avutilLibrary(CompositingManager::libPath("libavutil.so"));
+    QLibrary &avcodecLibrary = RuntimeRegistry::get().library("libavcodec.so");
+    QLibrary &avformatLibrary = RuntimeRegistry::get().library("libavformat.so");
+    QLibrary &avutilLibrary = RuntimeRegistry::get().library("libavutil.so");
 
     g_mvideo_avformat_open_input = (mvideo_avformat_open_input) avformatLibrary.resolve("avformat_open_input");
     g_mvideo_avformat_find_stream_info = (mvideo_avformat_find_stream_info) avformatLibrary.resolve("avformat_find_stream_info");
@@ -551,14 +303,19 @@ qint64 PlaylistModel::getUrlFileTotalSize(QUrl url, int tryTimes) const
 
 void PlaylistModel::clearPlaylist()
 {
+    m_pSaveTimer->stop();
     QSettings cfg(_playlistFile, QSettings::NativeFormat);
     cfg.beginGroup("playlist");
     cfg.remove("");
     cfg.endGroup();
+
+    QFile::remove(_journalFile);
+    m_nJournalCount = 0;
 }
 
 void PlaylistModel::savePlaylist()
 {
+    m_pSaveTimer->stop();
     QSettings cfg(_playlistFile, QSettings::NativeFormat);
     cfg.beginGroup("playlist");
     cfg.remove("");
@@ -566,10 +323,46 @@ void PlaylistModel::savePlaylist()
     for (int i = 0; i < count(); ++i) {
         const auto &pif = _infos[i];
         cfg.setValue(QString::number(i), pif.url);
-        qInfo() << "save " << pif.url;
     }
     cfg.endGroup();
     cfg.sync();
+    qInfo() << __func__ << count();
+
+    //完整列表已包含日志中的条目
+    QFile::remove(_journalFile);
+    m_nJournalCount = 0;
+}
+
+void PlaylistModel::scheduleSavePlaylist()
+{
+    m_pSaveTimer->start();
+}
+
+void PlaylistModel::appendToJournal(const QList<PlayItemInfo> &pil)
+{
+    if (pil.isEmpty())
+        return;
+
+    QFile file(_journalFile);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "open playlist journal failed" << file.errorString();
+        scheduleSavePlaylist();
+        return;
+    }
+
+    QByteArray data;
+    for (const auto &pif : pil) {
+        data.append(pif.url.toEncoded());
+        data.append('\n');
+    }
+    file.write(data);
+    file.close();
+
+    //日志过长时合并回完整列表
+    m_nJournalCount += pil.size();
+    if (m_nJournalCount >= 1000) {
+        scheduleSavePlaylist();
+    }
 }
 
 void PlaylistModel::loadPlaylist()
@@ -581,32 +374,119 @@ void PlaylistModel::loadPlaylist()
         initThumb();
     }
     QList<QUrl> urls;
+    QList<QUrl> lazyUrls;
+    QList<PlayItemInfo> restored;
 
+    QList<QUrl> savedUrls;
     QSettings cfg(_playlistFile, QSettings::NativeFormat);
     cfg.beginGroup("playlist");
     auto keys = cfg.childKeys();
     for (int i = 0; i < keys.size(); ++i) {
-        auto url = cfg.value(QString::number(i)).toUrl();
-        if (indexOf(url) >= 0) continue;
-        urls.append(url);
+        savedUrls.append(cfg.value(QString::number(i)).toUrl());
     }
     cfg.endGroup();
-    delayedAppendAsync(urls);
-}
 
-bool PlaylistModel::getThumanbilRunning()
-{
-    if (m_getThumanbil) {
-        if (m_getThumanbil->isRunning()) {
-            return true;
+    //上次退出前未合并的追加日志
+    QFile journal(_journalFile);
+    if (journal.open(QIODevice::ReadOnly)) {
+        while (!journal.atEnd()) {
+            QByteArray line = journal.readLine().trimmed();
+            if (!line.isEmpty()) {
+                savedUrls.append(QUrl::fromEncoded(line));
+            }
+        }
+        journal.close();
+        scheduleSavePlaylist();
+    }
+
+    for (const QUrl &url : savedUrls) {
+        if (indexOf(url) >= 0 || m_lazyThumbUrls.contains(url)) continue;
+
+        //信息已缓存的文件直接恢复，缩略图稍后在后台生成
+        MovieInfo mi;
+        QFileInfo fi(url.toLocalFile());
+        if (url.isLocalFile() && MediaInfoStore::get().lookup(fi, mi)) {
+            restored.append(PlayItemInfo {true, true, url, fi, PlayItemThumbPtr(), mi});
+            lazyUrls.append(url);
+            m_lazyThumbUrls.insert(url);
+            m_loadFile.insert(normalizedUrl(url));
         } else {
-            return false;
+            urls.append(url);
+        }
+    }
+    qInfo() << __func__ << "restored" << restored.size() << "pending" << urls.size();
+
+    if (!restored.isEmpty()) {
+        int nOldCount = _infos.size();
+        _infos += restored;
+        indexUrls(nOldCount);
+        reshuffle();
+        emit itemsAppended();
+        emit countChanged();
+        emit asyncAppendFinished(restored);
+
+        if (!m_lazyThumbLoader) {
+            m_lazyThumbLoader = new LazyThumbLoader(this);
+            connect(m_lazyThumbLoader, &LazyThumbLoader::thumbLoaded, this, &PlaylistModel::onLazyThumbLoaded);
+            m_lazyThumbLoader->start(QThread::LowestPriority);
         }
+        m_lazyThumbLoader->appendUrls(lazyUrls);
+    }
+
+    if (urls.isEmpty()) {
+        _firstLoad = false;
     } else {
-        return false;
+        delayedAppendAsync(urls);
     }
 }
 
+void PlaylistModel::prioritizeItems(int first, int last)
+{
+    if (!m_lazyThumbLoader || m_lazyThumbUrls.isEmpty())
+        return;
+
+    QList<QUrl> urls;
+    for (int i = qMax(first, 0); i <= last && i < _infos.size(); i++) {
+        if (m_lazyThumbUrls.contains(_infos[i].url))
+            urls.append(_infos[i].url);
+    }
+    if (!urls.isEmpty())
+        m_lazyThumbLoader->prioritize(urls);
+}
+
+void PlaylistModel::onLazyThumbLoaded(const QUrl &url, const QPixmap &pm, const QPixmap &dark_pm)
+{
+    if (!m_lazyThumbUrls.remove(url))
+        return;
+
+    int pos = indexOf(url);
+    if (pos < 0)
+        return;
+
+    _infos[pos].setThumbnail(pm, dark_pm);
+    emit itemInfoUpdated(pos);
+}
+
+void PlaylistModel::ensureThumbLoaded(int pos)
+{
+    auto &pif = _infos[pos];
+    if (!m_lazyThumbUrls.remove(pif.url))
+        return;
+
+    //播放前需要缩略图判断是否为音频，不再等待后台线程
+    if (m_lazyThumbLoader)
+        m_lazyThumbLoader->removeUrl(pif.url);
+    QPixmap pm;
+    QPixmap dark_pm;
+    loadThumb(pif.url, pif.info, pif.mi, pm, dark_pm);
+    pif.setThumbnail(pm, dark_pm);
+}
+
+bool PlaylistModel::getThumanbilRunning()
+{
+    return m_pProbePool && m_pProbePool->isBusy();
+}
+
 MovieInfo PlaylistModel::getMovieInfo(const QUrl &url, bool *is)
 {
     if (url.isLocalFile()) {
@@ -639,6 +519,7 @@ QImage PlaylistModel::getMovieCover(const QUrl &url)
         return QImage();
     }
 
+    QMutexLocker lock(&m_thumbMutex);
     m_video_thumbnailer->thumbnail_size = static_cast<int>(THUMBNAIL_SIZE);
     m_video_thumbnailer->seek_time = const_cast<char*>(SEEK_TIME);
     m_image_data = m_mvideo_thumbnailer_create_image_data();
@@ -687,8 +568,18 @@ void PlaylistModel::reshuffle()
 void PlaylistModel::clear()
 {
     _infos.clear();
+    m_urlIndex.clear();
+    m_lazyThumbUrls.clear();
+    if (m_lazyThumbLoader) {
+        m_lazyThumbLoader->clear();
+    }
+    if (m_pProbePool) {
+        for (const QUrl &url : m_pProbePool->cancelAll()) {
+            m_loadFile.remove(normalizedUrl(url));
+        }
+    }
     _engine->stop();
-    _engine->waitLastEnd();
+    _engine->requestLastEnd();
 
     _current = -1;
     _last = -1;
@@ -704,16 +595,25 @@ void PlaylistModel::remove(int pos)
 
     _userRequestingItem = true;
 
-    m_loadFile.removeOne(_infos[pos].url);
+    m_loadFile.remove(normalizedUrl(_infos[pos].url));
+    if (m_lazyThumbUrls.remove(_infos[pos].url)) {
+        m_lazyThumbLoader->removeUrl(_infos[pos].url);
+    }
+    if (m_pProbePool) {
+        m_pProbePool->cancel(_infos[pos].url);
+    }
     _infos.removeAt(pos);
+    rebuildUrlIndex();
     reshuffle();
 
     _last = _current;
+    bool bEnding = false;
     if (_engine->state() != PlayerEngine::Idle) {
         if (_current == pos) {
             _current = -1;
             _last = _current;
-            _engine->waitLastEnd();
+            _engine->requestLastEnd();
+            bEnding = true;
 
         } else if (pos < _current) {
             _current--;
@@ -723,7 +623,7 @@ void PlaylistModel::remove(int pos)
         if (_current == pos) {
             _current = -1;
             _last = _current;
-            _engine->waitLastEnd();
+            _engine->requestLastEnd();
         }
     }
 
@@ -737,8 +637,13 @@ void PlaylistModel::remove(int pos)
 
 
     qInfo() << _last << _current;
-    _userRequestingItem = false;
-    savePlaylist();
+    //停止是异步的，等停止完成后再结束请求
+    if (bEnding && _engine->state() != PlayerEngine::Idle) {
+        _releaseRequestOnEnd = true;
+    } else {
+        _userRequestingItem = false;
+    }
+    scheduleSavePlaylist();
 }
 
 void PlaylistModel::stop()
@@ -750,6 +655,8 @@ void PlaylistModel::stop()
 void PlaylistModel::tryPlayCurrent(bool next)
 {
     qInfo() << __func__;
+    _releaseRequestOnEnd = false;
+    ensureThumbLoaded(_current);
     auto &pif = _infos[_current];
     if (pif.refresh()) {
         qInfo() << pif.url.fileName() << "changed";
@@ -808,7 +715,7 @@ void PlaylistModel::playNext(bool fromUser)
             if (_last + 1 >= count()) {
                 _last = -1;
             }
-            _engine->waitLastEnd();
+            _engine->requestLastEnd();
             _current = _last + 1;
             _last = _current;
             tryPlayCurrent(true);
@@ -826,7 +733,7 @@ void PlaylistModel::playNext(bool fromUser)
                 if (_last + 1 >= count()) {
                     _last = -1;
                 }
-                _engine->waitLastEnd();
+                _engine->requestLastEnd();
                 _current = _last + 1;
                 _last = _current;
                 tryPlayCurrent(true);
@@ -850,7 +757,7 @@ void PlaylistModel::playNext(bool fromUser)
         }
         _shufflePlayed++;
         qInfo() << "shuffle next " << _shufflePlayed - 1;
-        _engine->waitLastEnd();
+        _engine->requestLastEnd();
         _last = _current = _playOrder[_shufflePlayed - 1];
         tryPlayCurrent(true);
         break;
@@ -867,7 +774,7 @@ void PlaylistModel::playNext(bool fromUser)
             }
         }
 
-        _engine->waitLastEnd();
+        _engine->requestLastEnd();
         _current = _last;
         tryPlayCurrent(true);
         break;
@@ -879,7 +786,7 @@ void PlaylistModel::playNext(bool fromUser)
             _last = 0;
         }
 
-        _engine->waitLastEnd();
+        _engine->requestLastEnd();
         _current = _last;
         tryPlayCurrent(true);
         break;
@@ -900,7 +807,7 @@ void PlaylistModel::playPrev(bool fromUser)
             if (_last - 1 < 0) {
                 _last = count();
             }
-            _engine->waitLastEnd();
+            _engine->requestLastEnd();
             _current = _last - 1;
             _last = _current;
             tryPlayCurrent(false);
@@ -917,7 +824,7 @@ void PlaylistModel::playPrev(bool fromUser)
                 if (_last - 1 < 0) {
                     _last = count();
                 }
-                _engine->waitLastEnd();
+                _engine->requestLastEnd();
                 _current = _last - 1;
                 _last = _current;
                 tryPlayCurrent(false);
@@ -941,7 +848,7 @@ void PlaylistModel::playPrev(bool fromUser)
         }
         _shufflePlayed--;
         qInfo() << "shuffle prev " << _shufflePlayed - 1;
-        _engine->waitLastEnd();
+        _engine->requestLastEnd();
         _last = _current = _playOrder[_shufflePlayed - 1];
         tryPlayCurrent(false);
         break;
@@ -953,7 +860,7 @@ void PlaylistModel::playPrev(bool fromUser)
             _last = count() - 1;
         }
 
-        _engine->waitLastEnd();
+        _engine->requestLastEnd();
         _current = _last;
         tryPlayCurrent(false);
         break;
@@ -965,7 +872,7 @@ void PlaylistModel::playPrev(bool fromUser)
             _last = count() - 1;
         }
 
-        _engine->waitLastEnd();
+        _engine->requestLastEnd();
         _current = _last;
         tryPlayCurrent(false);
         break;
@@ -991,6 +898,7 @@ void PlaylistModel::appendSingle(const QUrl &url)
         auto pif = calculatePlayInfo(url, fi);
         if (!pif.valid) return;
         _infos.append(pif);
+        indexUrls(_infos.size() - 1);
 
 #ifndef _LIBDMR_
         if (Settings::get().isSet(Settings::AutoSearchSimilar)) {
@@ -1000,8 +908,10 @@ void PlaylistModel::appendSingle(const QUrl &url)
                 auto url = QUrl::fromLocalFile(fi.absoluteFilePath());
                 if (indexOf(url) < 0 && _engine->isPlayableFile(fi.absoluteFilePath())) {
                     auto playitem_info = calculatePlayInfo(url, fi);
-                    if (playitem_info.valid)
+                    if (playitem_info.valid) {
                         _infos.append(playitem_info);
+                        indexUrls(_infos.size() - 1);
+                    }
                 }
             });
         }
@@ -1009,6 +919,7 @@ void PlaylistModel::appendSingle(const QUrl &url)
     } else {
         auto pif = calculatePlayInfo(url, QFileInfo(), true);
         _infos.append(pif);
+        indexUrls(_infos.size() - 1);
     }
 }
 
@@ -1016,12 +927,12 @@ void PlaylistModel::collectionJob(const QList<QUrl> &urls, QList<QUrl> &inputUrl
 {
     for (const auto &url : urls) {
         int aa = indexOf(url);
-        if (m_loadFile.contains(url))
+        if (m_loadFile.contains(normalizedUrl(url)))
             continue;
-        if (!url.isValid() || indexOf(url) >= 0 || _urlsInJob.contains(url.toLocalFile()))
+        if (!url.isValid() || aa >= 0 || _urlsInJob.contains(url.toLocalFile()))
             continue;
 
-        m_loadFile.append(url);
+        m_loadFile.insert(normalizedUrl(url));
         qInfo() << __func__ << _infos.size() << "index is" << aa << url;
 
         if(url.isLocalFile()) {
@@ -1073,8 +984,35 @@ void PlaylistModel::collectionJob(const QList<QUrl> &urls, QList<QUrl> &inputUrl
             << "_pendingJob: " << _pendingJob.size();
 }
 
+/**
+ * @brief 相似文件排序，文件不存在的排在最前
+ */
+static bool SimilarFileLess(const QUrl &url1, bool bValid1, const QUrl &url2, bool bValid2)
+{
+    //sort names by digits inside, take care of such a possible:
+    //S01N04, S02N05, S01N12, S02N04, etc...
+    if (bValid1 != bValid2)
+        return !bValid1;
+
+    QString fileName1 = url1.fileName();
+    QString fileName2 = url2.fileName();
+
+    if (utils::IsNamesSimilar(fileName1, fileName2)) {
+        return utils::CompareNames(fileName1, fileName2);
+    }
+    return fileName1.localeAwareCompare(fileName2) < 0;
+}
+
 void PlaylistModel::appendAsync(const QList<QUrl> &urls)
 {
+    //扫描和加载线程也会追加文件，请求记录只在界面线程维护
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, urls]() {
+            appendAsync(urls);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
     if (!m_initFFmpeg) {
         initFFmpeg();
     }
@@ -1086,6 +1024,13 @@ void PlaylistModel::appendAsync(const QList<QUrl> &urls)
 
 void PlaylistModel::delayedAppendAsync(const QList<QUrl> &urls)
 {
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, [this, urls]() {
+            delayedAppendAsync(urls);
+        }, Qt::QueuedConnection);
+        return;
+    }
+
     if (_pendingJob.size() > 0) {
         //TODO: may be automatically schedule later
         qWarning() << "there is a pending append going on, enqueue";
@@ -1115,59 +1060,43 @@ void PlaylistModel::delayedAppendAsync(const QList<QUrl> &urls)
     };
 
     qInfo() << "not wayland";
-    if (QThread::idealThreadCount() > 1) {
-        if (!m_getThumanbil) {
-            m_getThumanbil = new GetThumanbil(this, t_urls);
-            connect(m_getThumanbil, &GetThumanbil::finished, this, &PlaylistModel::onAsyncFinished);
-            connect(m_getThumanbil, &GetThumanbil::updateItem, this, &PlaylistModel::onAsyncUpdate, Qt::BlockingQueuedConnection);
-            m_getThumanbil->start();
-        } else {
-            if (m_getThumanbil->isRunning()) {
-                m_tempList.append(t_urls);
-            } else {
-                m_getThumanbil->setUrls(t_urls);
-                m_getThumanbil->start();
-            }
+    //解析结果按提交顺序分批送出，排序放在提交前，保证播放列表顺序与整批解析完再排序时一致
+    if (!_firstLoad) {
+        std::stable_sort(_pendingJob.begin(), _pendingJob.end(), [](const AppendJob &a1, const AppendJob &a2) {
+            return SimilarFileLess(a1.first, a1.second.exists() || !a1.first.isLocalFile(),
+                                   a2.first, a2.second.exists() || !a2.first.isLocalFile());
+        });
+    }
+
+    //请求中第一个文件通常马上要播放，其余用户选择的文件次之，相似文件最后
+    const QSet<QUrl> setInput = urls.toSet();
+    int nUserJob = 0;
+    for (int i = 0; i < _pendingJob.size(); i++) {
+        if (_pendingJob[i].first == urls.value(0)) {
+            nUserJob = i;
+            break;
         }
-        _pendingJob.clear();
-        _urlsInJob.clear();
-    } else {
-        PlayItemInfoList pil;
-        for (const auto &a : _pendingJob) {
-            qInfo() << "sync mapping " << a.first.fileName();
-            pil.append(calculatePlayInfo(a.first, a.second));
-            if (m_ploadThread && m_ploadThread->isRunning()) {
-                m_ploadThread->msleep(10);
-            }
+    }
+    QList<int> priorities;
+    for (int i = 0; i < _pendingJob.size(); i++) {
+        if (i == nUserJob) {
+            priorities.append(PlayInfoProbePool::UserPriority);
+        } else if (setInput.contains(_pendingJob[i].first)) {
+            priorities.append(PlayInfoProbePool::ExplicitPriority);
+        } else {
+            priorities.append(PlayInfoProbePool::SiblingPriority);
         }
-        _pendingJob.clear();
-        _urlsInJob.clear();
-        handleAsyncAppendResults(pil);
     }
+    m_pProbePool->submit(_pendingJob, priorities);
+    _pendingJob.clear();
+    _urlsInJob.clear();
 }
 
 static QList<PlayItemInfo> &SortSimilarFiles(QList<PlayItemInfo> &fil)
 {
-    //sort names by digits inside, take care of such a possible:
-    //S01N04, S02N05, S01N12, S02N04, etc...
-    struct {
-        bool operator()(const PlayItemInfo &fi1, const PlayItemInfo &fi2) const
-        {
-            if (!fi1.valid)
-                return true;
-            if (!fi2.valid)
-                return false;
-
-            QString fileName1 = fi1.url.fileName();
-            QString fileName2 = fi2.url.fileName();
-
-            if (utils::IsNamesSimilar(fileName1, fileName2)) {
-                return utils::CompareNames(fileName1, fileName2);
-            }
-            return fileName1.localeAwareCompare(fileName2) < 0;
-        }
-    } SortByDigits;
-    std::sort(fil.begin(), fil.end(), SortByDigits);
+    std::sort(fil.begin(), fil.end(), [](const PlayItemInfo &fi1, const PlayItemInfo &fi2) {
+        return SimilarFileLess(fi1.url, fi1.valid, fi2.url, fi2.valid);
+    });
 
     return fil;
 }
@@ -1184,32 +1113,19 @@ static QList<PlayItemInfo> &SortSimilarFiles(QList<PlayItemInfo> &fil)
     //handleAsyncAppendResults(fil);
 }*/
 
-void PlaylistModel::onAsyncFinished()
-{
-    //qInfo() << fil.size();
-    m_getThumanbil->clearItem();
-    //handleAsyncAppendResults(fil);
-    if (!m_tempList.isEmpty()) {
-        m_getThumanbil->setUrls(m_tempList);
-        m_tempList.clear();
-        m_getThumanbil->start();
-    }
-}
-
-void PlaylistModel::onAsyncUpdate(PlayItemInfo fil)
+void PlaylistModel::onAsyncUpdate(const QList<PlayItemInfo> &pil)
 {
-    QList<PlayItemInfo> fils;
-    fils.append(fil);
+    QList<PlayItemInfo> fils = pil;
     //since _infos are modified only at the same thread, the lock is not necessary
     auto last = std::remove_if(fils.begin(), fils.end(), [](const PlayItemInfo & pif) {
         return !pif.mi.valid;
     });
     fils.erase(last, fils.end());
 
-    if (!_firstLoad)
-        _infos += SortSimilarFiles(fils);
-    else
-        _infos += fils;
+    //解析线程池已按提交前排好的顺序送出，这里不再排序
+    int nOldCount = _infos.size();
+    _infos += fils;
+    indexUrls(nOldCount);
     reshuffle();
     _firstLoad = false;
     emit itemsAppended();
@@ -1221,7 +1137,7 @@ void PlaylistModel::onAsyncUpdate(PlayItemInfo fil)
         auto job = _pendingAppendReq.dequeue();
         delayedAppendAsync(job);
     }
-    savePlaylist();
+    appendToJournal(fils);
 }
 
 void PlaylistModel::handleAsyncAppendResults(QList<PlayItemInfo> &fil)
@@ -1237,12 +1153,14 @@ void PlaylistModel::handleAsyncAppendResults(QList<PlayItemInfo> &fil)
 
     qInfo() << "collected items" << fil.count();
     if (fil.size()) {
+        int nOldCount = _infos.size();
         if (!_firstLoad)
             _infos += SortSimilarFiles(fil);
         else
             _infos += fil;
+        indexUrls(nOldCount);
         reshuffle();
-        savePlaylist();
+        appendToJournal(fil);
         _firstLoad = false;
         emit itemsAppended();
         emit countChanged();
@@ -1250,13 +1168,12 @@ void PlaylistModel::handleAsyncAppendResults(QList<PlayItemInfo> &fil)
     _firstLoad = false;
     emit asyncAppendFinished(fil);
 
-    QTimer::singleShot(0, [&]() {
+    QTimer::singleShot(0, this, [&]() {
         if (_pendingAppendReq.size()) {
             auto job = _pendingAppendReq.dequeue();
             delayedAppendAsync(job);
         }
     });
-    savePlaylist();
 }
 
 /*bool PlaylistModel::hasPendingAppends()
@@ -1269,9 +1186,10 @@ void PlaylistModel::append(const QUrl &url)
 {
     if (!url.isValid()) return;
 
+    int nOldCount = _infos.size();
     appendSingle(url);
     reshuffle();
-    savePlaylist();
+    appendToJournal(_infos.mid(nOldCount));
     emit itemsAppended();
     emit countChanged();
 }
@@ -1294,7 +1212,7 @@ void PlaylistModel::changeCurrent(int pos)
 
     _userRequestingItem = true;
 
-    _engine->waitLastEnd();
+    _engine->requestLastEnd();
     _current = pos;
     _last = _current;
     tryPlayCurrent(true);
@@ -1306,6 +1224,7 @@ void PlaylistModel::switchPosition(int src, int target)
     //Q_ASSERT_X(0, "playlist", "not implemented");
     Q_ASSERT(src < _infos.size() && target < _infos.size());
     _infos.move(src, target);
+    rebuildUrlIndex();
 
     int min = qMin(src, target);
     int max = qMax(src, target);
@@ -1349,6 +1268,18 @@ const PlayItemInfo &PlaylistModel::currentInfo() const
     return _infos[_current];
 }
 
+bool PlaylistModel::currentIsRawFormat() const
+{
+    //与非const版本的currentInfo取同一条目
+    if (_infos.isEmpty())
+        return false;
+    if (_current >= 0)
+        return _infos[_current].mi.isRawFormat();
+    if (_last >= 0 && _last < _infos.size())
+        return _infos[_last].mi.isRawFormat();
+    return _infos[0].mi.isRawFormat();
+}
+
 int PlaylistModel::count() const
 {
     return _infos.count();
@@ -1380,7 +1311,7 @@ bool PlaylistModel::getMusicPix(const QFileInfo &fi, QPixmap &rImg)
         return false;
     }
 
-    QLibrary library(CompositingManager::libPath("libavformat.so"));
+    QLibrary &library = RuntimeRegistry::get().library("libavformat.so");
     mvideo_avformat_open_input g_mvideo_avformat_open_input_temp = (mvideo_avformat_open_input) library.resolve("avformat_open_input");
     mvideo_avformat_close_input g_mvideo_avformat_close_input = (mvideo_avformat_close_input) library.resolve("avformat_close_input");
     mvideo_avformat_find_stream_info g_mvideo_avformat_find_stream_info_temp = (mvideo_avformat_find_stream_info) library.resolve("avformat_find_stream_info");
@@ -1408,13 +1339,62 @@ bool PlaylistModel::getMusicPix(const QFileInfo &fi, QPixmap &rImg)
     return false;
 }
 
+bool PlaylistModel::loadThumb(const QUrl &url, const QFileInfo &fi, const MovieInfo &mi, QPixmap &pm, QPixmap &dark_pm)
+{
+    if (url.isLocalFile() && MediaInfoStore::get().lookupThumb(fi, pm, dark_pm)) {
+        qInfo() << "load cached thumb" << url;
+        return true;
+    }
+
+    try {
+        //如果打开的是音乐就读取音乐缩略图
+        bool isMusic = false;
+        foreach (QString sf, _engine->audio_filetypes) {
+            if (sf.right(sf.size() - 2) == mi.fileType) {
+                isMusic = true;
+            }
+        }
+
+        //此处判断导致非播放状态下导入无视频流视频加载缩略图错误
+        //暂时去掉，后期如有异常请排查此处逻辑
+        //by xxxx
+        if (/*_engine->state() != dmr::PlayerEngine::Idle && */mi.width < 0 || mi.height < 0) { //如果没有视频流，就当做音乐播放
+            isMusic = true;
+        }
+
+        if (isMusic == false && m_mvideo_thumbnailer_generate_thumbnail_to_buffer && m_video_thumbnailer) {
+            QMutexLocker lock(&m_thumbMutex);
+            if (!m_image_data) {
+                m_image_data = m_mvideo_thumbnailer_create_image_data();
+            }
+            m_mvideo_thumbnailer_generate_thumbnail_to_buffer(m_video_thumbnailer, fi.canonicalFilePath().toUtf8().data(),  m_image_data);
+            auto img = QImage::fromData(m_image_data->image_data_ptr, static_cast<int>(m_image_data->image_data_size), "png");
+            pm = QPixmap::fromImage(img);
+            dark_pm = pm;
+        }
+        pm.setDevicePixelRatio(qApp->devicePixelRatio());
+        dark_pm.setDevicePixelRatio(qApp->devicePixelRatio());
+    } catch (const std::logic_error &) {
+    }
+
+    if (url.isLocalFile() && !pm.isNull()) {
+        MediaInfoStore::get().saveThumb(fi, pm, dark_pm);
+    }
+    return !pm.isNull();
+}
+
 struct PlayItemInfo PlaylistModel::calculatePlayInfo(const QUrl &url, const QFileInfo &fi, bool isDvd)
 {
     bool ok = false;
     struct MovieInfo mi;
-    auto ci = PersistentManager::get().loadFromCache(url);
 
-    mi = parseFromFile(fi, &ok);
+    //文件大小与修改时间未变化时直接使用数据库中的信息，不再解析文件
+    bool bInfoCached = url.isLocalFile() && MediaInfoStore::get().lookup(fi, mi);
+    if (bInfoCached) {
+        ok = true;
+    } else {
+        mi = parseFromFile(fi, &ok);
+    }
     if (isDvd && url.scheme().startsWith("dvd")) {
         QString dev = url.path();
         if (dev.isEmpty()) dev = "/dev/sr0";
@@ -1434,44 +1414,15 @@ struct PlayItemInfo PlaylistModel::calculatePlayInfo(const QUrl &url, const QFil
 
     QPixmap pm = QPixmap();
     QPixmap dark_pm = QPixmap();
-    if (ci.thumb_valid) {
-        pm = ci.thumb;
-        dark_pm = ci.thumb_dark;
-
-        qInfo() << "load cached thumb" << url;
-    } else if (ok) {
-        try {
-            //如果打开的是音乐就读取音乐缩略图
-            bool isMusic = false;
-            foreach (QString sf, _engine->audio_filetypes) {
-                if (sf.right(sf.size() - 2) == mi.fileType) {
-                    isMusic = true;
-                }
-            }
-
-            //此处判断导致非播放状态下导入无视频流视频加载缩略图错误
-            //暂时去掉，后期如有异常请排查此处逻辑
-            //by xxxx
-            if (/*_engine->state() != dmr::PlayerEngine::Idle && */mi.width < 0 || mi.height < 0) { //如果没有视频流，就当做音乐播放
-                isMusic = true;
-            }
-
-            if (isMusic == false && m_mvideo_thumbnailer_generate_thumbnail_to_buffer) {
-                m_mvideo_thumbnailer_generate_thumbnail_to_buffer(m_video_thumbnailer, fi.canonicalFilePath().toUtf8().data(),  m_image_data);
-                auto img = QImage::fromData(m_image_data->image_data_ptr, static_cast<int>(m_image_data->image_data_size), "png");
-                pm = QPixmap::fromImage(img);
-                dark_pm = pm;
-            }
-            pm.setDevicePixelRatio(qApp->devicePixelRatio());
-            dark_pm.setDevicePixelRatio(qApp->devicePixelRatio());
-        } catch (const std::logic_error &) {
-        }
+    if (ok) {
+        loadThumb(url, fi, mi, pm, dark_pm);
     }
 
-    PlayItemInfo pif { fi.exists() || !url.isLocalFile(), ok, url, fi, pm, dark_pm, mi };
+    PlayItemInfo pif { fi.exists() || !url.isLocalFile(), ok, url, fi, PlayItemThumbPtr(), mi };
+    pif.setThumbnail(pm, dark_pm);
 
-    if (ok && url.isLocalFile() && (!ci.mi_valid || !ci.thumb_valid)) {
-        PersistentManager::get().save(pif);
+    if (ok && url.isLocalFile() && !bInfoCached) {
+        MediaInfoStore::get().save(fi, pif.mi);
     }
     if (!url.isLocalFile() && !url.scheme().startsWith("dvd") && CompositingManager::isMpvExists()) {
         pif.mi.filePath = pif.url.path();
@@ -1493,12 +1444,25 @@ struct PlayItemInfo PlaylistModel::calculatePlayInfo(const QUrl &url, const QFil
 
 int PlaylistModel::indexOf(const QUrl &url)
 {
-    auto p = std::find_if(_infos.begin(), _infos.end(), [&](const PlayItemInfo & pif) {
-        return pif.url == url;
-    });
+    return m_urlIndex.value(normalizedUrl(url), -1);
+}
 
-    if (p == _infos.end()) return -1;
-    return static_cast<int>(std::distance(_infos.begin(), p));
+void PlaylistModel::indexUrls(int from)
+{
+    for (int i = from; i < _infos.size(); i++) {
+        QUrl key = normalizedUrl(_infos[i].url);
+        //存在重复url时与线性查找一致，指向第一次出现的行
+        if (!m_urlIndex.contains(key)) {
+            m_urlIndex.insert(key, i);
+        }
+    }
+}
+
+void PlaylistModel::rebuildUrlIndex()
+{
+    m_urlIndex.clear();
+    m_urlIndex.reserve(_infos.size());
+    indexUrls(0);
 }
 
 PlaylistModel::~PlaylistModel()
@@ -1507,17 +1471,22 @@ PlaylistModel::~PlaylistModel()
 
     delete m_pdataMutex;
 
+    if (m_pSaveTimer->isActive()) {
+        savePlaylist();
+    }
 #ifndef _LIBDMR_
     if (Settings::get().isSet(Settings::ClearWhenQuit)) {
         clearPlaylist();
     }
 #endif
-    if (m_getThumanbil) {
-        if (m_getThumanbil->isRunning()) {
-            m_getThumanbil->stop();
-        }
-        m_getThumanbil->deleteLater();
-        m_getThumanbil = nullptr;
+    if (m_pProbePool) {
+        //解析线程会使用模型和缩略图库，需等待其退出
+        delete m_pProbePool;
+        m_pProbePool = nullptr;
+    }
+    if (m_lazyThumbLoader) {
+        delete m_lazyThumbLoader;
+        m_lazyThumbLoader = nullptr;
     }
     if (m_video_thumbnailer != nullptr) {
         m_mvideo_thumbnailer_destroy(m_video_thumbnailer);
@@ -1547,6 +1516,258 @@ void LoadThread::run()
         _pModel->delayedAppendAsync(_urls);
     }
 }
+
+void LazyThumbLoader::run()
+{
+    forever {
+        QUrl url;
+        {
+            QMutexLocker lock(&m_mutex);
+            //队列为空时等待而不退出，追加条目时不必判断线程是否还在运行
+            while (!m_stop && m_urls.isEmpty()) {
+                m_cond.wait(&m_mutex);
+            }
+            if (m_stop)
+                break;
+            url = m_urls.takeFirst();
+        }
+
+        QFileInfo fi(url.toLocalFile());
+        MovieInfo mi;
+        QPixmap pm;
+        QPixmap dark_pm;
+        if (MediaInfoStore::get().lookup(fi, mi)) {
+            m_model->loadThumb(url, fi, mi, pm, dark_pm);
+        }
+        //无论是否取得缩略图都通知模型，避免条目一直处于待加载状态
+        emit thumbLoaded(url, pm, dark_pm);
+    }
+}
+
+void PlayInfoProbeWorker::run()
+{
+    ProbeJob job;
+    while (m_pool->takeJob(job)) {
+        PlayItemInfo pif = m_pool->m_pModel->calculatePlayInfo(job.url, job.fi, false);
+        m_pool->finishJob(job, pif);
+    }
+}
+
+PlayInfoProbePool::PlayInfoProbePool(PlaylistModel *model)
+    : QObject(model), m_pModel(model)
+{
+    m_deliverTimer.setSingleShot(true);
+    connect(&m_deliverTimer, &QTimer::timeout, this, &PlayInfoProbePool::deliverResults);
+}
+
+PlayInfoProbePool::~PlayInfoProbePool()
+{
+    stop();
+}
+
+void PlayInfoProbePool::submit(const QList<AppendJob> &jobs, const QList<int> &priorities)
+{
+    if (jobs.isEmpty())
+        return;
+
+    QMutexLocker lock(&m_mutex);
+    if (m_bQuit)
+        return;
+
+    const int nRequest = m_nNextRequest++;
+    m_requestSize.insert(nRequest, jobs.size());
+    m_nextSeq.insert(nRequest, 0);
+
+    for (int i = 0; i < jobs.size(); i++) {
+        ProbeJob job;
+        job.url = jobs[i].first;
+        job.fi = jobs[i].second;
+        job.nPriority = qBound(0, priorities.value(i, SiblingPriority), PriorityCount - 1);
+        job.nId = m_nNextJob++;
+        job.nRequest = nRequest;
+        job.nSeq = i;
+        m_queues[job.nPriority].enqueue(job);
+    }
+
+    //按需启动，最多与核心数一致
+    const int nMaxWorkers = qMax(1, QThread::idealThreadCount());
+    int nQueued = 0;
+    for (const QQueue<ProbeJob> &queue : m_queues) {
+        nQueued += queue.size();
+    }
+    while (m_workers.size() < nMaxWorkers && m_workers.size() < nQueued + m_running.size()) {
+        PlayInfoProbeWorker *pWorker = new PlayInfoProbeWorker(this);
+        m_workers.append(pWorker);
+        pWorker->start();
+    }
+    m_cond.wakeAll();
+}
+
+bool PlayInfoProbePool::cancel(const QUrl &url)
+{
+    QMutexLocker lock(&m_mutex);
+    bool bCancelled = false;
+    for (QQueue<ProbeJob> &queue : m_queues) {
+        for (int i = queue.size() - 1; i >= 0; i--) {
+            if (queue[i].url != url)
+                continue;
+            //以空结果占位，后续条目不必等待
+            ProbeJob job = queue.takeAt(i);
+            job.bCancelled = true;
+            m_finished.append(qMakePair(job, PlayItemInfo()));
+            bCancelled = true;
+        }
+    }
+    for (auto it = m_running.constBegin(); it != m_running.constEnd(); ++it) {
+        if (it.value() == url) {
+            m_cancelled.insert(it.key());
+            bCancelled = true;
+        }
+    }
+
+    if (bCancelled && !m_bDeliverPosted) {
+        m_bDeliverPosted = true;
+        QMetaObject::invokeMethod(this, "onJobFinished", Qt::QueuedConnection);
+    }
+    return bCancelled;
+}
+
+QList<QUrl> PlayInfoProbePool::cancelAll()
+{
+    QList<QUrl> listUrl;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (QQueue<ProbeJob> &queue : m_queues) {
+            for (const ProbeJob &job : queue) {
+                listUrl.append(job.url);
+            }
+            queue.clear();
+        }
+        for (auto it = m_running.constBegin(); it != m_running.constEnd(); ++it) {
+            listUrl.append(it.value());
+            m_cancelled.insert(it.key());
+        }
+        m_finished.clear();
+    }
+
+    //不再跟踪的请求，之后完成的结果直接丢弃
+    m_requestSize.clear();
+    m_nextSeq.clear();
+    m_reorder.clear();
+    m_deliverTimer.stop();
+    return listUrl;
+}
+
+bool PlayInfoProbePool::isBusy() const
+{
+    return !m_requestSize.isEmpty();
+}
+
+void PlayInfoProbePool::stop()
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_bQuit = true;
+        for (QQueue<ProbeJob> &queue : m_queues) {
+            queue.clear();
+        }
+        m_cond.wakeAll();
+    }
+
+    for (PlayInfoProbeWorker *pWorker : m_workers) {
+        pWorker->wait();
+        delete pWorker;
+    }
+    m_workers.clear();
+}
+
+bool PlayInfoProbePool::takeJob(ProbeJob &job)
+{
+    QMutexLocker lock(&m_mutex);
+    forever {
+        if (m_bQuit)
+            return false;
+        for (QQueue<ProbeJob> &queue : m_queues) {
+            if (!queue.isEmpty()) {
+                job = queue.dequeue();
+                m_running.insert(job.nId, job.url);
+                return true;
+            }
+        }
+        m_cond.wait(&m_mutex);
+    }
+}
+
+void PlayInfoProbePool::finishJob(const ProbeJob &job, const PlayItemInfo &pif)
+{
+    QMutexLocker lock(&m_mutex);
+    m_running.remove(job.nId);
+    if (m_cancelled.remove(job.nId)) {
+        ProbeJob cancelled = job;
+        cancelled.bCancelled = true;
+        m_finished.append(qMakePair(cancelled, PlayItemInfo()));
+    } else {
+        m_finished.append(qMakePair(job, pif));
+    }
+
+    //界面线程取走之前只投递一次
+    if (!m_bDeliverPosted) {
+        m_bDeliverPosted = true;
+        QMetaObject::invokeMethod(this, "onJobFinished", Qt::QueuedConnection);
+    }
+}
+
+void PlayInfoProbePool::onJobFinished()
+{
+    if (m_deliverTimer.isActive())
+        return;
+
+    //距上次送出不足一个间隔时延后合并，避免列表频繁刷新
+    if (m_lastDeliver.isValid() && m_lastDeliver.elapsed() < APPEND_BATCH_INTERVAL) {
+        m_deliverTimer.start(static_cast<int>(APPEND_BATCH_INTERVAL - m_lastDeliver.elapsed()));
+    } else {
+        deliverResults();
+    }
+}
+
+void PlayInfoProbePool::deliverResults()
+{
+    QList<QPair<ProbeJob, PlayItemInfo>> listFinished;
+    {
+        QMutexLocker lock(&m_mutex);
+        listFinished.swap(m_finished);
+        m_bDeliverPosted = false;
+    }
+
+    for (const auto &result : listFinished) {
+        const ProbeJob &job = result.first;
+        if (!m_requestSize.contains(job.nRequest))
+            continue;
+        m_reorder[job.nRequest].insert(job.nSeq, job.bCancelled ? PlayItemInfo() : result.second);
+    }
+
+    //最早的请求送完后才送下一个，分多次提交的文件夹按提交顺序进入播放列表
+    QList<PlayItemInfo> pil;
+    while (!m_requestSize.isEmpty()) {
+        const int nRequest = m_requestSize.firstKey();
+        QMap<int, PlayItemInfo> &reorder = m_reorder[nRequest];
+        int &nNext = m_nextSeq[nRequest];
+        while (!reorder.isEmpty() && reorder.firstKey() == nNext) {
+            PlayItemInfo pif = reorder.take(nNext++);
+            if (!pif.url.isEmpty())
+                pil.append(pif);
+        }
+        if (nNext < m_requestSize.first())
+            break;
+        m_requestSize.remove(nRequest);
+        m_nextSeq.remove(nRequest);
+        m_reorder.remove(nRequest);
+    }
+
+    m_lastDeliver.restart();
+    if (!pil.isEmpty())
+        emit resultsReady(pil);
+}
 #ifdef _LIBDMR_
 static int open_codec_context(int *stream_idx,
                               AVCodecParameters **dec_ctx, AVFormatContext *fmt_ctx, enum AVMediaType type)
@@ -1732,5 +1953,4 @@ MovieInfo MovieInfo::parseFromFile(const QFileInfo &fi, bool *ok)
 #endif
 }
 
-#include "playlist_model.moc"
 
@@ -17,6 +17,8 @@
 
 #define THUMBNAIL_SIZE 500
 #define SEEK_TIME "00:00:01"
+#define APPEND_BATCH_COUNT 64       // 异步追加时每批最多条目数
+#define APPEND_BATCH_INTERVAL 100   // 异步追加时两批之间的最短间隔(ms)
 
 using namespace Dtk::Gui;
 
@@ -31,7 +33,8 @@ typedef int (*mvideo_thumbnailer_generate_thumbnail_to_buffer)(video_thumbnailer
 namespace dmr {
 class PlayerEngine;
 class LoadThread;
-class GetThumanbil;
+class PlayInfoProbePool;
+class LazyThumbLoader;
 
 struct MovieInfo {
     bool valid;
@@ -133,16 +136,27 @@ struct MovieInfo {
 };
 
 
+/**
+ * @brief 缩略图只在列表显示和判断音频时使用，放在共享数据中，复制条目时不再复制图片
+ */
+struct PlayItemThumb {
+    QPixmap thumbnail;
+    QPixmap thumbnail_dark;
+};
+using PlayItemThumbPtr = QSharedPointer<const PlayItemThumb>;
+
 struct PlayItemInfo {
     bool valid;
     bool loaded;  // if url is network, this is false until playback started
     QUrl url;
     QFileInfo info;
-    QPixmap thumbnail;
-    QPixmap thumbnail_dark;
+    PlayItemThumbPtr thumb;
     struct MovieInfo mi;
 
     bool refresh();
+    const QPixmap &thumbnail() const;
+    const QPixmap &thumbnailDark() const;
+    void setThumbnail(const QPixmap &pm, const QPixmap &dark_pm);
 };
 
 using AppendJob = QPair<QUrl, QFileInfo>; // async job
@@ -158,6 +172,7 @@ class PlaylistModel: public QObject
 
 public:
     friend class PlayerEngine;
+    friend class LazyThumbLoader;
     enum PlayMode {
         OrderPlay,
         ShufflePlay,
@@ -206,7 +221,15 @@ public:
     int current() const;
     const PlayItemInfo &currentInfo() const;
     PlayItemInfo &currentInfo();
+    /**
+     * @brief currentIsRawFormat 当前条目是否为裸流，播放进度刷新时频繁调用，不复制条目
+     */
+    bool currentIsRawFormat() const;
     int size() const;
+    /**
+     * @brief indexOf 通过哈希索引查找url所在行
+     * @return 不在列表中时返回-1
+     */
     int indexOf(const QUrl &url);
 
     void switchPosition(int p1, int p2);
@@ -215,15 +238,29 @@ public:
     void handleAsyncAppendResults(QList<PlayItemInfo> &pil);
     struct PlayItemInfo calculatePlayInfo(const QUrl &, const QFileInfo &fi, bool isDvd = false);
     bool getthreadstate();
+    /**
+     * @brief savePlaylist 立即写入完整的播放列表并清空追加日志
+     */
     void savePlaylist();
     void clearPlaylist();
     QList<QUrl> getLoadList()
     {
-        return m_loadFile;
+        return m_loadFile.values();
     };
+    /**
+     * @brief loadPlaylist 恢复上次的播放列表
+     * 已缓存信息的文件直接加入列表，缩略图由后台线程延迟生成；
+     * 未缓存的文件仍走异步解析流程
+     */
     void loadPlaylist();
     /**
-     * @brief getThumanbilRunning 获取加载线程是否运行
+     * @brief prioritizeItems 优先为指定范围内的条目生成缩略图
+     * @param first 起始行
+     * @param last 结束行（包含）
+     */
+    void prioritizeItems(int first, int last);
+    /**
+     * @brief getThumanbilRunning 获取是否还有未完成的异步解析
      * @return 返回是否正在运行
      */
     bool getThumanbilRunning();
@@ -242,9 +279,13 @@ public slots:
 
 private slots:
 //    void onAsyncAppendFinished();
-    void onAsyncFinished();
-    void onAsyncUpdate(PlayItemInfo);
+    void onAsyncUpdate(const QList<PlayItemInfo> &);
+    void onLazyThumbLoaded(const QUrl &url, const QPixmap &pm, const QPixmap &dark_pm);
     void slotStateChanged();
+    /**
+     * @brief slotLastPlaybackEnded 异步停止完成，删除当前项时在此结束用户请求
+     */
+    void slotLastPlaybackEnded();
 
 
 signals:
@@ -264,7 +305,25 @@ private:
     bool getMusicPix(const QFileInfo &fi, QPixmap &rImg);
     struct MovieInfo parseFromFile(const QFileInfo &fi, bool *ok = nullptr);
     struct MovieInfo parseFromFileByQt(const QFileInfo &fi, bool *ok = nullptr);
-    QString libPath(const QString &strlib);
+    /**
+     * @brief scheduleSavePlaylist 延迟写入完整播放列表，短时间内多次修改只写一次
+     */
+    void scheduleSavePlaylist();
+    /**
+     * @brief appendToJournal 新增条目只追加到日志文件，不重写整个列表
+     */
+    void appendToJournal(const QList<PlayItemInfo> &pil);
+    /**
+     * @brief indexUrls 将from之后的行加入url索引
+     */
+    void indexUrls(int from);
+    void rebuildUrlIndex();
+    /**
+     * @brief loadThumb 读取或生成缩略图，可在任意线程调用
+     * @return 是否取得了缩略图（音频文件没有缩略图）
+     */
+    bool loadThumb(const QUrl &url, const QFileInfo &fi, const MovieInfo &mi, QPixmap &pm, QPixmap &dark_pm);
+    void ensureThumbLoaded(int pos);
     // when app starts, and the first time to load playlist
     bool _firstLoad {true};
     int _count {0};
@@ -273,6 +332,7 @@ private:
     bool _hasNormalVideo{false};
     PlayMode _playMode {PlayMode::OrderPlay};
     QList<PlayItemInfo> _infos;
+    QHash<QUrl, int> m_urlIndex; // 规范化url到行号，与_infos保持同步
 
     QList<int> _playOrder; // for shuffle mode
     int _shufflePlayed {0}; // count currently played items in shuffle mode
@@ -284,6 +344,7 @@ private:
     QQueue<UrlList> _pendingAppendReq;
 
     bool _userRequestingItem {false};
+    bool _releaseRequestOnEnd {false}; // 停止完成后才结束用户请求，避免删除当前项后自动播放下一项
 
     video_thumbnailer *m_video_thumbnailer = nullptr;
     image_data *m_image_data = nullptr;
@@ -297,13 +358,18 @@ private:
     PlayerEngine *_engine {nullptr};
 
     QString _playlistFile;
+    QString _journalFile;
+    int m_nJournalCount {0};    // 上次完整写入后日志中的条目数
+    QTimer *m_pSaveTimer {nullptr};
 
     LoadThread *m_ploadThread;
-    GetThumanbil *m_getThumanbil {nullptr};
+    PlayInfoProbePool *m_pProbePool {nullptr};
+    LazyThumbLoader *m_lazyThumbLoader {nullptr};
+    QSet<QUrl> m_lazyThumbUrls; // 已恢复但尚未加载缩略图的条目
+    QMutex m_thumbMutex; // 保护m_video_thumbnailer与m_image_data
     QMutex *m_pdataMutex;
     bool m_brunning;
-    QList<QUrl> m_tempList;
-    QList<QUrl> m_loadFile;
+    QSet<QUrl> m_loadFile;
     bool m_initFFmpeg {false};
     bool m_bInitThumb {false};
 
@@ -332,66 +398,178 @@ private:
     QSet<QString> _urlsInJob;  // url list
 };
 
-class GetThumanbil : public QThread
+/**
+ * @brief 异步解析任务，同一次追加请求内按nSeq顺序送出结果
+ */
+struct ProbeJob {
+    quint64 nId {0};        //任务编号，取消按编号进行，重新添加同一文件不受之前取消的影响
+    QUrl url;
+    QFileInfo fi;
+    int nPriority {0};
+    int nRequest {0};
+    int nSeq {0};
+    bool bCancelled {false};
+};
+
+class PlayInfoProbeWorker : public QThread
+{
+public:
+    explicit PlayInfoProbeWorker(PlayInfoProbePool *pool): m_pool(pool) {}
+
+protected:
+    void run() override;
+
+private:
+    PlayInfoProbePool *m_pool;
+};
+
+/**
+ * @brief 播放条目解析线程池，线程数与核心数一致
+ * 用户直接打开的文件优先解析，自动搜索到的相似文件最后解析；
+ * 结果合并后以非阻塞方式送回界面线程，条目保持提交顺序，先提交的请求先送出
+ */
+class PlayInfoProbePool : public QObject
 {
     Q_OBJECT
+    friend class PlayInfoProbeWorker;
 public:
-    GetThumanbil(PlaylistModel *model, const QList<QUrl> &urls): m_model(model), m_urls(urls)
-    {
-//        m_model = model;
-//        m_urls = urls;
-        m_mutex = new QMutex;
+    enum Priority {
+        UserPriority = 0,    // 请求中的第一个文件，通常马上要播放
+        ExplicitPriority,    // 用户选择的其他文件
+        SiblingPriority,     // 自动搜索到的相似文件
+        PriorityCount
     };
-    ~GetThumanbil()
+
+    explicit PlayInfoProbePool(PlaylistModel *model);
+    ~PlayInfoProbePool();
+
+    /**
+     * @brief submit 提交一次追加请求
+     * @param jobs 待解析的文件
+     * @param priorities 与jobs一一对应的优先级
+     */
+    void submit(const QList<AppendJob> &jobs, const QList<int> &priorities);
+    /**
+     * @brief cancel 取消指定文件的解析，正在解析的结果会被丢弃
+     * @return 是否有被取消的任务
+     */
+    bool cancel(const QUrl &url);
+    /**
+     * @brief cancelAll 取消全部请求
+     * @return 被取消的文件
+     */
+    QList<QUrl> cancelAll();
+    bool isBusy() const;
+    void stop();
+
+signals:
+    void resultsReady(const QList<PlayItemInfo> &);
+
+private slots:
+    void onJobFinished();
+    void deliverResults();
+
+private:
+    /**
+     * @brief 工作线程取下一个任务，没有任务时阻塞等待，退出时返回false
+     */
+    bool takeJob(ProbeJob &job);
+    void finishJob(const ProbeJob &job, const PlayItemInfo &pif);
+
+private:
+    PlaylistModel *m_pModel;
+    QList<PlayInfoProbeWorker *> m_workers;
+
+    mutable QMutex m_mutex;                      // 保护以下成员
+    QWaitCondition m_cond;
+    QQueue<ProbeJob> m_queues[PriorityCount];   // 按优先级分开的待解析任务
+    quint64 m_nNextJob {0};
+    QHash<quint64, QUrl> m_running;              // 正在解析的任务 -> 文件
+    QSet<quint64> m_cancelled;                   // 正在解析但已取消的任务，任务结束时移除
+    QList<QPair<ProbeJob, PlayItemInfo>> m_finished;
+    bool m_bDeliverPosted {false};
+    bool m_bQuit {false};
+
+    // 以下成员只在界面线程使用
+    int m_nNextRequest {0};
+    QMap<int, int> m_requestSize;                // 请求 -> 任务数，按提交顺序
+    QHash<int, int> m_nextSeq;                   // 请求 -> 下一个要送出的序号
+    QHash<int, QMap<int, PlayItemInfo>> m_reorder; // 请求 -> 先完成的结果
+    QTimer m_deliverTimer;
+    QElapsedTimer m_lastDeliver;
+};
+
+/**
+ * @brief 启动恢复播放列表后在后台补全缩略图，可见行优先
+ */
+class LazyThumbLoader : public QThread
+{
+    Q_OBJECT
+public:
+    explicit LazyThumbLoader(PlaylistModel *model): m_model(model) {}
+    ~LazyThumbLoader()
     {
-        m_stop = true;
-        delete m_mutex;
-        m_mutex = nullptr;
-    };
-    //QList<PlayItemInfo> getInfoList() {return m_itemInfo;}
+        stop();
+        wait();
+    }
+
+    /**
+     * @brief 结束线程，只在析构时使用
+     */
     void stop()
     {
+        QMutexLocker lock(&m_mutex);
         m_stop = true;
-    };
-    void setUrls(QList<QUrl> urls)
-    {
-        m_mutex->lock();
-        m_urls = urls;
-        m_mutex->unlock();
-    };
-    void clearItem()
+        m_urls.clear();
+        m_cond.wakeAll();
+    }
+    /**
+     * @brief 丢弃未加载的条目，线程继续等待新的条目
+     */
+    void clear()
     {
-        m_mutex->lock();
-        //m_itemInfo.clear();
+        QMutexLocker lock(&m_mutex);
         m_urls.clear();
-        m_mutex->unlock();
-    };
-
-    void run()
+    }
+    void appendUrls(const QList<QUrl> &urls)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_urls.append(urls);
+        m_cond.wakeOne();
+    }
+    /**
+     * @brief 将指定条目移到队首
+     */
+    void prioritize(const QList<QUrl> &urls)
     {
-        m_mutex->lock();
-        QList<QUrl> urls = m_urls;
-        m_mutex->unlock();
-        foreach (QUrl url, urls) {
-            QFileInfo info(url.path());
-            //m_itemInfo.append();
-            emit updateItem(m_model->calculatePlayInfo(url, info, false));
-            if (m_stop)
-                break;
+        QMutexLocker lock(&m_mutex);
+        for (int i = urls.size() - 1; i >= 0; i--) {
+            if (m_urls.removeOne(urls[i]))
+                m_urls.prepend(urls[i]);
         }
     }
+    void removeUrl(const QUrl &url)
+    {
+        QMutexLocker lock(&m_mutex);
+        m_urls.removeOne(url);
+    }
+
+    void run() override;
 
 signals:
-    void updateItem(PlayItemInfo);
+    void thumbLoaded(const QUrl &url, const QPixmap &pm, const QPixmap &dark_pm);
+
 private:
     PlaylistModel *m_model;
     QList<QUrl> m_urls;
-    //QList<PlayItemInfo> m_itemInfo;
-    QMutex *m_mutex;
+    QMutex m_mutex;
+    QWaitCondition m_cond;
     bool m_stop {false};
 };
 
 }
 
+Q_DECLARE_METATYPE(dmr::PlayItemInfo)
+
 #endif /* ifndef _DMR_PLAYLIST_MODEL_H */
 
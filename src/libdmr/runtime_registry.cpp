@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "runtime_registry.h"
+
+namespace dmr {
+
+RuntimeRegistry &RuntimeRegistry::get()
+{
+    static RuntimeRegistry registry;
+    return registry;
+}
+
+RuntimeRegistry::RuntimeRegistry()
+{
+}
+
+RuntimeRegistry::~RuntimeRegistry()
+{
+    //不卸载库，退出时其他静态对象可能仍在使用其中的函数
+    qDeleteAll(m_libs);
+}
+
+qint64 RuntimeRegistry::warmUp()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    QMutexLocker lock(&m_mutex);
+    if (m_bScanned)
+        return timer.elapsed();
+
+    scanLibraries();
+    const QStringList listCommon = QStringList() << "libmpv.so." << "libavcodec.so" << "libavformat.so"
+                                   << "libavutil.so" << "libswscale.so" << "libffmpegthumbnailer.so"
+                                   << "libgstreamer-1.0.so" << "libgstpbutils-1.0.so" << "libgpuinfo.so";
+    for (const QString &sLib : listCommon) {
+        findLibrary(sLib);
+    }
+
+    qInfo() << "runtime registry ready(ms):" << timer.elapsed() << "libraries:" << m_listFile.size();
+    return timer.elapsed();
+}
+
+QString RuntimeRegistry::libPath(const QString &sLib)
+{
+    QMutexLocker lock(&m_mutex);
+    return findLibrary(sLib);
+}
+
+bool RuntimeRegistry::hasLibrary(const QString &sLib)
+{
+    return !libPath(sLib).isEmpty();
+}
+
+QLibrary &RuntimeRegistry::library(const QString &sLib)
+{
+    QMutexLocker lock(&m_mutex);
+    return *loadLibrary(sLib);
+}
+
+QFunctionPointer RuntimeRegistry::resolve(const QString &sLib, const char *pSymbol)
+{
+    QMutexLocker lock(&m_mutex);
+    const QString sKey = sLib + '|' + QLatin1String(pSymbol);
+    auto it = m_symbols.constFind(sKey);
+    if (it != m_symbols.constEnd())
+        return it.value();
+
+    QFunctionPointer pFunc = loadLibrary(sLib)->resolve(pSymbol);
+    m_symbols.insert(sKey, pFunc);
+    return pFunc;
+}
+
+void RuntimeRegistry::scanLibraries()
+{
+    m_bScanned = true;
+    m_sLibDir = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
+    m_listFile = QDir(m_sLibDir).entryList(QDir::NoDotAndDotDot | QDir::Files);
+    m_listFile.sort();
+}
+
+QString RuntimeRegistry::findLibrary(const QString &sLib)
+{
+    auto it = m_paths.constFind(sLib);
+    if (it != m_paths.constEnd())
+        return it.value();
+
+    if (!m_bScanned)
+        scanLibraries();
+
+    //与原先按"sLib*"过滤库目录的规则一致：完全匹配优先，否则取排序后的最后一个
+    QString sFile;
+    for (const QString &sName : m_listFile) {
+        if (sName == sLib) {
+            sFile = sName;
+            break;
+        }
+        if (sName.startsWith(sLib))
+            sFile = sName;
+    }
+
+    const QString sPath = sFile.isEmpty() ? QString() : m_sLibDir + QDir::separator() + sFile;
+    m_paths.insert(sLib, sPath);
+    return sPath;
+}
+
+QLibrary *RuntimeRegistry::loadLibrary(const QString &sLib)
+{
+    auto it = m_libs.constFind(sLib);
+    if (it != m_libs.constEnd())
+        return it.value();
+
+    //QLibrary只在第一次load时修改自身状态，库不存在也先load一次，之后的resolve可在多个线程中同时调用
+    QLibrary *pLibrary = new QLibrary(findLibrary(sLib));
+    if (!pLibrary->load() && !pLibrary->fileName().isEmpty()) {
+        qWarning() << "failed to load" << pLibrary->fileName() << pLibrary->errorString();
+    }
+    m_libs.insert(sLib, pLibrary);
+    return pLibrary;
+}
+
+}
@@ -0,0 +1,73 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_RUNTIME_REGISTRY_H
+#define _DMR_RUNTIME_REGISTRY_H
+
+#include <QtCore>
+
+namespace dmr {
+
+/**
+ * @file 运行时库和函数的注册表
+ * 库目录只扫描一次，库路径、加载后的库和解析出的函数按名字缓存，
+ * mpv、ffmpeg、ffmpegthumbnailer和GStreamer的各个模块共用，不再各自扫描目录、重复加载
+ */
+class RuntimeRegistry
+{
+public:
+    static RuntimeRegistry &get();
+
+    /**
+     * @brief 扫描库目录并记录常用库的路径，重复调用直接返回
+     * @return 本次调用的耗时(ms)
+     */
+    qint64 warmUp();
+    /**
+     * @brief 库的完整路径，可在任意线程调用
+     * @param sLib 库文件名或文件名前缀，有多个版本时取最新的
+     * @return 找不到时返回空
+     */
+    QString libPath(const QString &sLib);
+    /**
+     * @brief 库是否存在
+     */
+    bool hasLibrary(const QString &sLib);
+    /**
+     * @brief 已加载的库，整个进程只加载一次，库不存在时返回文件名为空的对象
+     * 返回前已在锁内完成加载，之后各线程对它调用resolve只查找符号，不再修改对象状态
+     */
+    QLibrary &library(const QString &sLib);
+    /**
+     * @brief 解析库中的函数，结果缓存
+     * @return 库或函数不存在时返回nullptr
+     */
+    QFunctionPointer resolve(const QString &sLib, const char *pSymbol);
+
+private:
+    RuntimeRegistry();
+    ~RuntimeRegistry();
+    /**
+     * @brief 列出库目录，调用时需持有m_mutex
+     */
+    void scanLibraries();
+    QString findLibrary(const QString &sLib);
+    /**
+     * @brief 创建并加载库，调用时需持有m_mutex
+     */
+    QLibrary *loadLibrary(const QString &sLib);
+
+private:
+    QMutex m_mutex;
+    bool m_bScanned {false};
+    QString m_sLibDir;
+    QStringList m_listFile;                      //库目录中的文件，已排序
+    QHash<QString, QString> m_paths;             //库名到完整路径
+    QHash<QString, QLibrary *> m_libs;           //库名到已加载的库
+    QHash<QString, QFunctionPointer> m_symbols;  //"库名|函数名"到函数
+};
+
+}
+
+#endif /* ifndef _DMR_RUNTIME_REGISTRY_H */
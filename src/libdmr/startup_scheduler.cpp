@@ -0,0 +1,218 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "startup_scheduler.h"
+
+#include <QWidget>
+#include <QtConcurrent>
+
+#define FIRST_FRAME_TIMEOUT 3000    //未收到绘制事件时最长等待时间(ms)
+
+namespace dmr {
+
+static QString probeCachePath()
+{
+    //探测可能早于应用对象创建，不能依赖应用名
+    return QString("%1/deepin/deepin-movie/startup_probes.ini")
+           .arg(QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation));
+}
+
+StartupScheduler &StartupScheduler::get()
+{
+    static StartupScheduler scheduler;
+    return scheduler;
+}
+
+StartupScheduler::StartupScheduler()
+{
+    m_timer.start();
+    m_sProbeFile = probeCachePath();
+}
+
+void StartupScheduler::mark(const QString &sPhase)
+{
+    const double dMs = m_timer.nsecsElapsed() / 1000000.0;
+    {
+        QMutexLocker lock(&m_mutex);
+        m_trace.append(qMakePair(sPhase, dMs));
+    }
+    qInfo() << "startup phase:" << sPhase << QString::number(dMs, 'f', 1) << "ms";
+}
+
+QFuture<void> StartupScheduler::run(const QString &sPhase, const std::function<void()> &task)
+{
+    return QtConcurrent::run([this, sPhase, task] {
+        task();
+        mark(sPhase);
+    });
+}
+
+void StartupScheduler::defer(const QString &sPhase, const std::function<void()> &task)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        if (!m_bShown) {
+            m_deferred.append(qMakePair(sPhase, task));
+            return;
+        }
+    }
+
+    QTimer::singleShot(0, this, [this, sPhase, task] {
+        task();
+        mark(sPhase);
+    });
+}
+
+void StartupScheduler::watchFirstFrame(QWidget *pWindow)
+{
+    pWindow->installEventFilter(this);
+    QPointer<QWidget> pGuard(pWindow);
+    //窗口被遮挡或最小化时收不到绘制事件，超时后同样执行推迟的任务
+    QTimer::singleShot(FIRST_FRAME_TIMEOUT, this, [this, pGuard] {
+        if (pGuard)
+            pGuard->removeEventFilter(this);
+        firstFrameShown();
+    });
+}
+
+QList<QPair<QString, double>> StartupScheduler::trace()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_trace;
+}
+
+bool StartupScheduler::eventFilter(QObject *pObject, QEvent *pEvent)
+{
+    if (pEvent->type() == QEvent::Paint) {
+        pObject->removeEventFilter(this);
+        //本次绘制完成后再执行
+        QTimer::singleShot(0, this, &StartupScheduler::firstFrameShown);
+    }
+    return false;
+}
+
+void StartupScheduler::firstFrameShown()
+{
+    QList<QPair<QString, std::function<void()>>> listTask;
+    {
+        QMutexLocker lock(&m_mutex);
+        if (m_bShown)
+            return;
+        m_bShown = true;
+        listTask.swap(m_deferred);
+    }
+    mark("first-frame");
+
+    for (const auto &task : listTask) {
+        task.second();
+        mark(task.first);
+    }
+
+    writeTrace();
+}
+
+void StartupScheduler::writeTrace()
+{
+    const QString sPath = QString::fromLocal8Bit(qgetenv("DMR_STARTUP_TRACE"));
+    if (sPath.isEmpty())
+        return;
+
+    QJsonArray phases;
+    for (const auto &item : trace()) {
+        QJsonObject obj;
+        obj.insert("phase", item.first);
+        obj.insert("ms", item.second);
+        phases.append(obj);
+    }
+
+    QSaveFile file(sPath);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(QJsonDocument(QJsonObject {{"phases", phases}}).toJson());
+        file.commit();
+    }
+}
+
+bool StartupScheduler::lookupProbe(const QString &sKey, QVariant &value)
+{
+    QMutexLocker lock(&m_mutex);
+    loadProbes();
+
+    auto it = m_probes.constFind(sKey);
+    if (it == m_probes.constEnd())
+        return false;
+
+    value = it.value();
+    return true;
+}
+
+void StartupScheduler::storeProbe(const QString &sKey, const QVariant &value)
+{
+    QMutexLocker lock(&m_mutex);
+    loadProbes();
+    m_probes.insert(sKey, value);
+
+    QSettings settings(m_sProbeFile, QSettings::IniFormat);
+    settings.setValue(QString("probes/%1").arg(sKey), value);
+}
+
+QString StartupScheduler::probeFile()
+{
+    QMutexLocker lock(&m_mutex);
+    return m_sProbeFile;
+}
+
+void StartupScheduler::setProbeFile(const QString &sPath)
+{
+    QMutexLocker lock(&m_mutex);
+    m_sProbeFile = sPath;
+    m_probes.clear();
+    m_bProbesLoaded = false;
+}
+
+void StartupScheduler::loadProbes()
+{
+    if (m_bProbesLoaded)
+        return;
+    m_bProbesLoaded = true;
+
+    const QString sFingerprint = driverFingerprint();
+    QSettings settings(m_sProbeFile, QSettings::IniFormat);
+    if (settings.value("fingerprint").toString() != sFingerprint) {
+        settings.clear();
+        settings.setValue("fingerprint", sFingerprint);
+        return;
+    }
+
+    settings.beginGroup("probes");
+    for (const QString &sKey : settings.childKeys()) {
+        m_probes.insert(sKey, settings.value(sKey));
+    }
+    settings.endGroup();
+}
+
+QString StartupScheduler::driverFingerprint()
+{
+    auto readFile = [](const QString &sPath) {
+        QFile file(sPath);
+        return file.open(QIODevice::ReadOnly) ? QString::fromUtf8(file.readAll()).simplified() : QString();
+    };
+
+    QStringList listPart;
+    listPart << readFile("/proc/sys/kernel/osrelease");
+    listPart << readFile("/proc/driver/nvidia/version");
+
+    //显卡驱动模块及其版本
+    QDir drmDir("/sys/class/drm");
+    for (const QString &sCard : drmDir.entryList(QStringList() << "card?", QDir::Dirs | QDir::System)) {
+        const QString sDriver = QFileInfo(drmDir.filePath(sCard + "/device/driver")).canonicalFilePath().section('/', -1);
+        if (sDriver.isEmpty())
+            continue;
+        listPart << sDriver << readFile(QString("/sys/module/%1/version").arg(sDriver))
+                 << readFile(QString("/sys/module/%1/srcversion").arg(sDriver));
+    }
+
+    return QString(QCryptographicHash::hash(listPart.join('|').toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+}
@@ -0,0 +1,91 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef _DMR_STARTUP_SCHEDULER_H
+#define _DMR_STARTUP_SCHEDULER_H
+
+#include <QtCore>
+
+#include <functional>
+
+class QWidget;
+
+namespace dmr {
+
+/**
+ * @file 启动调度和启动耗时记录
+ * 互不依赖的探测放到线程池并发执行，首帧不需要的初始化推迟到窗口首次绘制后执行。
+ * 各阶段相对main开始的时间记入启动记录，环境变量DMR_STARTUP_TRACE为文件路径时，
+ * 首帧绘制后把记录写入该文件，供持续集成统计冷启动耗时。
+ * 显卡、驱动相关的探测结果跨进程缓存，内核或显卡驱动变化后失效
+ */
+class StartupScheduler: public QObject
+{
+    Q_OBJECT
+public:
+    static StartupScheduler &get();
+
+    /**
+     * @brief 记录阶段完成的时间，可在任意线程调用
+     */
+    void mark(const QString &sPhase);
+    /**
+     * @brief 在线程池中执行，完成时记录阶段
+     */
+    QFuture<void> run(const QString &sPhase, const std::function<void()> &task);
+    /**
+     * @brief 首帧绘制后在界面线程执行，已绘制时排到事件循环中执行
+     */
+    void defer(const QString &sPhase, const std::function<void()> &task);
+    /**
+     * @brief 监视主窗口的首次绘制，之后执行推迟的任务并写出启动记录
+     */
+    void watchFirstFrame(QWidget *pWindow);
+    /**
+     * @brief 启动记录，每项为阶段名和毫秒数
+     */
+    QList<QPair<QString, double>> trace();
+
+    /**
+     * @brief 查询缓存的探测结果
+     * @return 未缓存或内核、显卡驱动已变化时返回false
+     */
+    bool lookupProbe(const QString &sKey, QVariant &value);
+    void storeProbe(const QString &sKey, const QVariant &value);
+    /**
+     * @brief 探测结果的缓存文件
+     */
+    QString probeFile();
+    /**
+     * @brief 切换探测结果的缓存文件，之后的查询从新文件重新读取
+     */
+    void setProbeFile(const QString &sPath);
+    /**
+     * @brief 内核版本和显卡驱动的指纹
+     */
+    static QString driverFingerprint();
+
+protected:
+    bool eventFilter(QObject *pObject, QEvent *pEvent) override;
+
+private:
+    StartupScheduler();
+    void firstFrameShown();
+    void writeTrace();
+    void loadProbes();
+
+private:
+    QElapsedTimer m_timer;
+    QMutex m_mutex;                                     //保护以下成员
+    QList<QPair<QString, double>> m_trace;
+    QList<QPair<QString, std::function<void()>>> m_deferred;
+    bool m_bShown {false};
+    bool m_bProbesLoaded {false};
+    QString m_sProbeFile;
+    QHash<QString, QVariant> m_probes;
+};
+
+}
+
+#endif /* ifndef _DMR_STARTUP_SCHEDULER_H */
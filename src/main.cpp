@@ -22,6 +22,8 @@
 #include "platform/platform_mainwindow.h"
 #include "platform/platform_dbus_adpator.h"
 #include "compositing_manager.h"
+#include "runtime_registry.h"
+#include "startup_scheduler.h"
 #include "dbus_adpator.h"
 #include "utils.h"
 #include "movie_configuration.h"
@@ -89,6 +91,8 @@ void checkIsCanHwdec(int argc, char *argv[])
 
 int main(int argc, char *argv[])
 {
+    //启动耗时从这里开始计算
+    StartupScheduler::get().mark("main");
     //for qt5platform-plugins load DPlatformIntegration or DPlatformIntegrationParent
     if (!QString(qgetenv("XDG_CURRENT_DESKTOP")).toLower().startsWith("deepin")){
         setenv("XDG_CURRENT_DESKTOP", "Deepin", 1);
@@ -120,6 +124,9 @@ int main(int argc, char *argv[])
 #if defined(STATIC_LIB)
     DWIDGET_INIT_RESOURCE();
 #endif
+    //提前扫描一次库目录，之后各模块查询库路径、加载库都使用缓存
+    RuntimeRegistry::get().warmUp();
+    StartupScheduler::get().mark("runtime-registry");
     QFileInfo fi("/dev/mwv206_0");
     QFileInfo jmfi("/dev/jmgpu");
     if ((fi.exists() || jmfi.exists()) && !CompositingManager::isMpvExists()) {
@@ -140,6 +147,8 @@ int main(int argc, char *argv[])
     app = DApplication::globalApplication(argc, argv);
 #endif
 
+    StartupScheduler::get().mark("application");
+
     QAccessible::installFactory(accessibleFactory);
     // required by mpv
     setlocale(LC_NUMERIC, "C");
@@ -214,6 +223,7 @@ int main(int argc, char *argv[])
     app->setAttribute(Qt::AA_DontCreateNativeWidgetSiblings, true);
 
     MovieConfiguration::get().init();
+    StartupScheduler::get().mark("configuration");
 
     QRegExp url_re("\\w+://");
 
@@ -221,6 +231,7 @@ int main(int argc, char *argv[])
         dmr::MainWindow mw;
         Presenter *presenter = new Presenter(&mw);
         mw.setPresenter(presenter);
+        StartupScheduler::get().mark("window-created");
         if (CompositingManager::isPadSystem()) {
             ///平板模式下全屏显示
             mw.showMaximized();
@@ -229,6 +240,8 @@ int main(int argc, char *argv[])
             Dtk::Widget::moveToCenter(&mw);
             mw.show();
         }
+        StartupScheduler::get().mark("window-shown");
+        StartupScheduler::get().watchFirstFrame(&mw);
         mw.setOpenFiles(toOpenFiles);
 
         if (!QDBusConnection::sessionBus().isConnected()) {
@@ -244,6 +257,7 @@ int main(int argc, char *argv[])
         dmr::Platform_MainWindow platform_mw;
         Presenter *presenter = new Presenter(&platform_mw);
         platform_mw.setPresenter(presenter);
+        StartupScheduler::get().mark("window-created");
         if (CompositingManager::isPadSystem()) {
             ///平板模式下全屏显示
             platform_mw.showMaximized();
@@ -252,6 +266,8 @@ int main(int argc, char *argv[])
             Dtk::Widget::moveToCenter(&platform_mw);
             platform_mw.show();
         }
+        StartupScheduler::get().mark("window-shown");
+        StartupScheduler::get().watchFirstFrame(&platform_mw);
 
         platform_mw.setOpenFiles(toOpenFiles);
 
@@ -467,9 +467,14 @@ void MircastWidget::startDlnaTp(ItemWidget *item)
         return;
     } else {
         dmr::PlayerEngine *pEngine = static_cast<dmr::PlayerEngine *>(m_pEngine);
-        if(pEngine && pEngine->playlist().currentInfo().url.isLocalFile()) {
-            m_dlnaContentServer->setDlnaFileName(pEngine->playlist().currentInfo().url.toLocalFile());
-            m_sLocalUrl = m_dlnaContentServer->getBaseUrl()  + QFileInfo(pEngine->playlist().currentInfo().url.toLocalFile()).fileName().toLatin1();
+        //切换投屏文件时取消发布上一个文件，渲染端不能再读取
+        const QString sFile = pEngine && pEngine->playlist().currentInfo().url.isLocalFile()
+                              ? pEngine->playlist().currentInfo().url.toLocalFile() : QString();
+        if (!m_sPublishedFile.isEmpty() && m_sPublishedFile != sFile)
+            m_dlnaContentServer->unpublishFile(m_sPublishedFile);
+        m_sPublishedFile = sFile;
+        if (!sFile.isEmpty()) {
+            m_sLocalUrl = m_dlnaContentServer->publishFile(sFile);
         } else {
             m_sLocalUrl = pEngine->playlist().currentInfo().url.toString();
         }
@@ -542,6 +547,10 @@ void MircastWidget::seekDlnaTp(int nSeek)
 void MircastWidget::stopDlnaTP()
 {
     m_nPlayStatus = MircastWidget::Stop;
+    if (m_dlnaContentServer && !m_sPublishedFile.isEmpty()) {
+        m_dlnaContentServer->unpublishFile(m_sPublishedFile);
+        m_sPublishedFile.clear();
+    }
     if (m_ControlURLPro.isNull() || m_ControlURLPro.isEmpty()) return;
     m_pDlnaSoapPost->SoapOperPost(DLNA_Stop, m_ControlURLPro, m_URLAddrPro, m_sLocalUrl);
     m_ControlURLPro.clear();
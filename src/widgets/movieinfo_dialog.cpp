@@ -190,12 +190,12 @@ MovieInfoDialog::MovieInfoDialog(const struct PlayItemInfo &pif ,QWidget *parent
 
     qreal pixelRatio = qApp->devicePixelRatio();
     QPixmap cover;
-    if (pif.thumbnail.isNull()) {
+    if (pif.thumbnail().isNull()) {
         cover = (utils::LoadHiDPIPixmap(LOGO_BIG));
     } else {
         QSize sz(220, 128);
         sz *= pixelRatio;
-        auto img = pif.thumbnail.scaledToWidth(sz.width(), Qt::SmoothTransformation);
+        auto img = pif.thumbnail().scaledToWidth(sz.width(), Qt::SmoothTransformation);
         cover = img.copy(0, (img.height() - sz.height()) / 2, sz.width(), sz.height());
         cover.setDevicePixelRatio(pixelRatio);
     }
@@ -10,7 +10,7 @@
 #include <DIconButton>
 #include <DToolButton>
 #include <DFloatingButton>
-#include <DListWidget>
+#include <DListView>
 #include <DApplicationHelper>
 #include <DFontSizeManager>
 #include <QBrush>
@@ -33,52 +33,8 @@ namespace dmr {
 
 class PlayerEngine;
 class Platform_MainWindow;
-class Platform_ListPic: public QLabel
-{
-    Q_OBJECT
-public:
-    Platform_ListPic(QPixmap pic, QWidget *parent): QLabel(parent)
-    {
-        setFixedSize(QSize(42, 24));
-        _pic = pic;
-    }
-    void setPic(QPixmap pic)
-    {
-        _pic = pic;
-    }
-protected:
-    void paintEvent(QPaintEvent *pe) override
-    {
-        QPainter painter(this);
-        painter.setRenderHints(QPainter::HighQualityAntialiasing | QPainter::SmoothPixmapTransform |
-                               QPainter::Antialiasing);
-        QSize size(_pic.size());
-        QBitmap mask(size);
-        QPainter painter1(&mask);
-        painter1.setRenderHints(QPainter::Antialiasing | QPainter::SmoothPixmapTransform);
-        painter1.fillRect(mask.rect(), Qt::white);
-        painter1.setBrush(QColor(0, 0, 0));
-        painter1.drawRoundedRect(mask.rect(), 5, 5);
-        QPixmap image = _pic;
-        image.setMask(mask);
-
-        painter.setClipping(true);
-        QPainterPath bg0;
-        bg0.addRoundedRect(rect(), 5, 5);   //使用5个像素点，圆角效果更好
-        painter.setClipPath(bg0);
-
-        painter.drawPixmap(rect(), image);
-
-        painter.setPen(
-            QPen(DGuiApplicationHelper::instance()->applicationPalette().frameBorder().color(), 2));
-        painter.setBrush(Qt::NoBrush);
-        painter.drawRoundedRect(rect(), 5, 5);
-    };
-private:
-    QPixmap _pic;
-};
-
-class Platform_PlayItemWidget;
+class PlaylistItemModel;
+class Tip;
 
 class Platform_PlaylistWidget: public QWidget
 {
@@ -100,7 +56,7 @@ public:
     {
         return _toggling;
     }
-    DListWidget *get_playlist()
+    DListView *get_playlist()
     {
         return _playlist;
     }
@@ -133,9 +89,8 @@ public slots:
     void showItemInfo();
     void removeClickedItem(bool isShortcut);
     void slotCloseTimeTimeOut();
-    void slotCloseItem(QWidget *w);
-    void slotDoubleClickedItem(QWidget *w);
-    void slotRowsMoved();
+    void slotCloseItem();
+    void slotDoubleClickedItem(int nRow);
 
 protected:
     void contextMenuEvent(QContextMenuEvent *cme) override;
@@ -149,28 +104,37 @@ protected:
 
 protected slots:
     void updateItemStates();
-    void updateItemInfo(int);
     void appendItems();
     void removeItem(int);
-    void slotShowSelectItem(QListWidgetItem *);
-    void OnItemChanged(QListWidgetItem *current, QListWidgetItem *previous);
+    /**
+     * @brief prioritizeVisibleItems 让可见行的缩略图优先加载
+     */
+    void prioritizeVisibleItems();
+    void slotShowSelectItem(const QModelIndex &index);
+    void OnItemChanged(const QModelIndex &current, const QModelIndex &previous);
+    /**
+     * @brief updateCloseButton 关闭按钮移到鼠标悬停的行，没有时移到选中的行
+     */
+    void updateCloseButton();
 
 private:
     PlayerEngine *_engine {nullptr};
     Platform_MainWindow *_mw {nullptr};
-    QWidget *_mouseItem {nullptr};
-    QWidget *_clickedItem {nullptr};
-    QSignalMapper *_closeMapper {nullptr};
-    QSignalMapper *_activateMapper {nullptr};
-    DListWidget *_playlist {nullptr};
+    int _mouseRow {-1};                     ///右键菜单所在的行
+    int _clickedRow {-1};                   ///待删除的行
+    int _closeRow {-1};                     ///关闭按钮所在的行
+    DListView *_playlist {nullptr};
+    PlaylistItemModel *_model {nullptr};
+    DFloatingButton *_closeBtn {nullptr};   ///各行共用的关闭按钮
+    Tip *_tip {nullptr};                    ///各行共用的文件名提示
     State _state {Closed};
     DLabel *_num {nullptr};
     DLabel *_title {nullptr};
-    /// < original row, data>
-    QPair<int, Platform_PlayItemWidget *> _lastDragged {-1, nullptr};
     int _index {0};
-    Platform_PlayItemWidget *pSelectItemWgt;
-    void batchUpdateSizeHints();
+    /**
+     * @brief activateRow 双击或平板模式下单击，文件存在时播放
+     */
+    void activateRow(int nRow);
 
     QPropertyAnimation *paOpen ;
     QPropertyAnimation *paClose ;
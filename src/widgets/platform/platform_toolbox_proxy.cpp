@@ -8,6 +8,7 @@
 #include "platform_toolbox_proxy.h"
 #include "platform/platform_mainwindow.h"
 #include "compositing_manager.h"
+#include "runtime_registry.h"
 #include "player_engine.h"
 #include "toolbutton.h"
 #include "dmr_settings.h"
@@ -17,6 +18,7 @@
 #include "tip.h"
 #include "utils.h"
 #include "filefilter.h"
+#include "progress_refresher.h"
 
 //#include <QtWidgets>
 #include <DImageButton>
@@ -707,25 +709,9 @@ private:
     bool m_bIsWM{false};
 };
 
-static QString libPath(const QString &strlib)
-{
-    QDir  dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (strlib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(strlib)) {
-        return strlib;
-    } else {
-        list.sort();
-    }
-
-    Q_ASSERT(list.size() > 0);
-    return list.last();
-}
-
 void Platform_viewProgBarLoad::initThumb()
 {
-    QLibrary library(CompositingManager::libPath("libffmpegthumbnailer.so"));
+    QLibrary &library = RuntimeRegistry::get().library("libffmpegthumbnailer.so");
     m_mvideo_thumbnailer = (mvideo_thumbnailer) library.resolve("video_thumbnailer_create");
     m_mvideo_thumbnailer_destroy = (mvideo_thumbnailer_destroy) library.resolve("video_thumbnailer_destroy");
     m_mvideo_thumbnailer_create_image_data = (mvideo_thumbnailer_create_image_data) library.resolve("video_thumbnailer_create_image_data");
@@ -1179,8 +1165,15 @@ void Platform_ToolboxProxy::setup()
     connect(m_pEngine, &PlayerEngine::stateChanged, this, &Platform_ToolboxProxy::updatePlayState);
     connect(m_pEngine, &PlayerEngine::stateChanged, this, &Platform_ToolboxProxy::updateButtonStates);   // 控件状态变化由updateButtonStates统一处理
     connect(m_pEngine, &PlayerEngine::fileLoaded, this, &Platform_ToolboxProxy::slotFileLoaded);
-    connect(m_pEngine, &PlayerEngine::elapsedChanged, this, &Platform_ToolboxProxy::slotElapsedChanged);
-    connect(m_pEngine, &PlayerEngine::updateDuration, this, &Platform_ToolboxProxy::slotElapsedChanged);
+    //播放进度每帧都会变化，由刷新调度合并后按显示需要的频率更新时间和进度条
+    m_pProgressRefresher = new ProgressRefresher(this, m_pEngine);
+    connect(m_pProgressRefresher, &ProgressRefresher::timeChanged, this, &Platform_ToolboxProxy::slotElapsedChanged);
+    connect(m_pProgressRefresher, &ProgressRefresher::progressChanged, this, [ = ](qint64 nDuration, qint64 nElapsed) {
+        //投屏时进度条跟随投屏设备，不使用本地播放进度
+        if(m_mircastWidget->getMircastState() != MircastWidget::Idel)
+            return;
+        updateMovieProgress(nDuration, nElapsed);
+    });
 
     connect(window()->windowHandle(), &QWindow::windowStateChanged, this, &Platform_ToolboxProxy::updateFullState);
 
@@ -1260,6 +1253,7 @@ void Platform_ToolboxProxy::initMember()
     m_pListBtnTip = nullptr;
 
     m_pWorker = nullptr;
+    m_pProgressRefresher = nullptr;
     m_pPaOpen = nullptr;
     m_pPaClose = nullptr;
 
@@ -1492,6 +1486,8 @@ void Platform_ToolboxProxy::slotSliderPressed()
 void Platform_ToolboxProxy::slotSliderReleased()
 {
     m_bMousePree = false;
+    //拖动期间进度条未随播放更新，下个周期强制刷新
+    m_pProgressRefresher->invalidate();
     if (m_mircastWidget->getMircastState() == MircastWidget::Screening)
         m_mircastWidget->slotSeekMircast(m_pProgBar->slider()->sliderPosition());
     else
@@ -1588,16 +1584,15 @@ void Platform_ToolboxProxy::slotFileLoaded()
     m_mircastWidget->playNext();
 }
 
-void Platform_ToolboxProxy::slotElapsedChanged()
+void Platform_ToolboxProxy::slotElapsedChanged(qint64 nDuration, qint64 nElapsed)
 {
     if(m_mircastWidget->getMircastState() != MircastWidget::Idel)
         return;
     quint64 url = static_cast<quint64>(-1);
     if (m_pEngine->playlist().current() != -1) {
-        url = static_cast<quint64>(m_pEngine->duration());
+        url = static_cast<quint64>(nDuration);
     }
-    updateTimeInfo(static_cast<qint64>(url), m_pEngine->elapsed(), m_pTimeLabel, m_pTimeLabelend, true);
-    updateMovieProgress();
+    updateTimeInfo(static_cast<qint64>(url), nElapsed, m_pTimeLabel, m_pTimeLabelend, true);
 }
 
 void Platform_ToolboxProxy::slotApplicationStateChanged(Qt::ApplicationState e)
@@ -1844,11 +1839,16 @@ void Platform_ToolboxProxy::updateTimeVisible(bool visible)
 }
 
 void Platform_ToolboxProxy::updateMovieProgress()
+{
+    updateMovieProgress(m_pEngine->duration(), m_pEngine->elapsed());
+}
+
+void Platform_ToolboxProxy::updateMovieProgress(qint64 nDuration, qint64 nElapsed)
 {
     if (m_bMousePree == true)
         return ;
-    auto d = m_pEngine->duration();
-    auto e = m_pEngine->elapsed();
+    auto d = nDuration;
+    auto e = nElapsed;
     if (d > m_pProgBar->maximum()) {
         d = m_pProgBar->maximum();
     }
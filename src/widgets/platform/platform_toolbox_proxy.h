@@ -41,6 +41,7 @@ DWIDGET_USE_NAMESPACE
 
 namespace dmr {
 class PlayerEngine;
+class ProgressRefresher;
 class VolumeButton;
 class ToolButton;
 class Platform_MainWindow;
@@ -429,6 +430,12 @@ protected slots:
      * @brief updateMovieProgress 更新影片进度条
      */
     void updateMovieProgress();
+    /**
+     * @brief updateMovieProgress 按给定的时长和播放时间更新影片进度条
+     * @param nDuration 视频总时长
+     * @param nElapsed 当前播放的时间点
+     */
+    void updateMovieProgress(qint64 nDuration, qint64 nElapsed);
     /**
      * @brief updateButtonStates
      */
@@ -484,9 +491,11 @@ protected slots:
      */
     void slotFileLoaded();
     /**
-     * @brief slotElapsedChanged 当前播放时长变化槽函数
+     * @brief slotElapsedChanged 当前播放时长变化槽函数，由刷新调度按固定频率调用
+     * @param nDuration 视频总时长
+     * @param nElapsed 当前播放的时间点
      */
-    void slotElapsedChanged();
+    void slotElapsedChanged(qint64 nDuration, qint64 nElapsed);
     /**
      * @brief slotApplicationStateChanged 应用状态变化才敢三个月
      * @param e 状态
@@ -578,6 +587,7 @@ private:
 
     Platform_MainWindow *m_pMainWindow;          ///主窗口
     PlayerEngine *m_pEngine;            ///播放引擎
+    ProgressRefresher *m_pProgressRefresher; ///播放进度刷新调度
     Platform_PlaylistWidget *m_pPlaylist;        ///播放列表窗口
 
     DWidget *m_pProgBarspec;             ///空白进度条窗口
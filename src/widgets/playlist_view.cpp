@@ -0,0 +1,279 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "playlist_view.h"
+#include "playlist_model.h"
+#include "utils.h"
+
+#include <DApplicationHelper>
+#include <DFontSizeManager>
+#include <QPainter>
+#include <QPainterPath>
+
+#define PLAYITEM_WIDTH 324
+#define PLAYITEM_HEIGHT 40
+#define ELIDED_CACHE_SIZE 2048      //缓存的省略文件名条数
+
+DWIDGET_USE_NAMESPACE
+
+namespace dmr {
+
+PlaylistItemModel::PlaylistItemModel(PlaylistModel *pPlaylist, QObject *pParent)
+    : QAbstractListModel(pParent), m_pPlaylist(pPlaylist)
+{
+    m_nCount = m_pPlaylist->count();
+    m_nCurrent = m_pPlaylist->current();
+
+    connect(m_pPlaylist, &PlaylistModel::emptied, this, &PlaylistItemModel::reload);
+    connect(m_pPlaylist, &PlaylistModel::itemsAppended, this, &PlaylistItemModel::onItemsAppended);
+    connect(m_pPlaylist, &PlaylistModel::itemRemoved, this, &PlaylistItemModel::onItemRemoved);
+    connect(m_pPlaylist, &PlaylistModel::currentChanged, this, &PlaylistItemModel::onCurrentChanged);
+    connect(m_pPlaylist, &PlaylistModel::itemInfoUpdated, this, &PlaylistItemModel::onItemInfoUpdated);
+}
+
+int PlaylistItemModel::rowCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : m_nCount;
+}
+
+QVariant PlaylistItemModel::data(const QModelIndex &index, int role) const
+{
+    const int nRow = index.row();
+    if (!index.isValid() || nRow >= m_nCount || nRow >= m_pPlaylist->count())
+        return QVariant();
+
+    const PlayItemInfo &pif = m_pPlaylist->items()[nRow];
+    switch (role) {
+    case Qt::DisplayRole:
+    case Qt::ToolTipRole:
+        return pif.mi.title;
+    case DurationRole:
+        //沿用列表项控件的翻译
+        return pif.valid ? pif.mi.durationStr()
+               : QCoreApplication::translate("dmr::PlayItemWidget", "The file does not exist");
+    case ValidRole:
+        return pif.valid;
+    case PlayingRole:
+        return nRow == m_nCurrent;
+    case SelectedRole:
+        return nRow == m_nSelected;
+    case HoveredRole:
+        return nRow == m_nHovered;
+    default:
+        return QVariant();
+    }
+}
+
+Qt::ItemFlags PlaylistItemModel::flags(const QModelIndex &index) const
+{
+    Q_UNUSED(index);
+
+    return Qt::ItemIsEnabled;
+}
+
+const PlayItemInfo &PlaylistItemModel::itemInfo(int nRow) const
+{
+    return m_pPlaylist->items()[nRow];
+}
+
+bool PlaylistItemModel::refreshItem(int nRow)
+{
+    PlayItemInfo &pif = m_pPlaylist->items()[nRow];
+    const bool bValid = pif.valid;
+    pif.refresh();
+    if (bValid != pif.valid)
+        updateRow(nRow);
+
+    return !pif.url.isLocalFile() || pif.info.exists();
+}
+
+void PlaylistItemModel::reload()
+{
+    beginResetModel();
+    m_nCount = m_pPlaylist->count();
+    m_nCurrent = m_pPlaylist->current();
+    m_nSelected = -1;
+    m_nHovered = -1;
+    endResetModel();
+}
+
+void PlaylistItemModel::setSelectedRow(int nRow)
+{
+    if (m_nSelected == nRow)
+        return;
+
+    const int nOld = m_nSelected;
+    m_nSelected = nRow;
+    updateRow(nOld);
+    updateRow(nRow);
+}
+
+void PlaylistItemModel::setHoveredRow(int nRow)
+{
+    if (m_nHovered == nRow)
+        return;
+
+    const int nOld = m_nHovered;
+    m_nHovered = nRow;
+    updateRow(nOld);
+    updateRow(nRow);
+}
+
+void PlaylistItemModel::onItemsAppended()
+{
+    const int nCount = m_pPlaylist->count();
+    if (nCount < m_nCount) {
+        reload();
+        return;
+    }
+    if (nCount == m_nCount)
+        return;
+
+    beginInsertRows(QModelIndex(), m_nCount, nCount - 1);
+    m_nCount = nCount;
+    endInsertRows();
+}
+
+void PlaylistItemModel::onItemRemoved(int nRow)
+{
+    if (nRow < 0 || nRow >= m_nCount || m_nCount - 1 != m_pPlaylist->count()) {
+        reload();
+        return;
+    }
+
+    auto shift = [nRow](int &nValue) {
+        if (nValue == nRow)
+            nValue = -1;
+        else if (nValue > nRow)
+            nValue--;
+    };
+
+    beginRemoveRows(QModelIndex(), nRow, nRow);
+    m_nCount--;
+    shift(m_nCurrent);
+    shift(m_nSelected);
+    shift(m_nHovered);
+    endRemoveRows();
+
+    //后面各行的序号减一
+    if (nRow < m_nCount)
+        emit dataChanged(index(nRow), index(m_nCount - 1), QVector<int>() << Qt::DisplayRole);
+}
+
+void PlaylistItemModel::onCurrentChanged()
+{
+    const int nOld = m_nCurrent;
+    m_nCurrent = m_pPlaylist->current();
+    if (nOld != m_nCurrent) {
+        updateRow(nOld);
+        updateRow(m_nCurrent);
+    }
+}
+
+void PlaylistItemModel::onItemInfoUpdated(int nRow)
+{
+    updateRow(nRow);
+}
+
+void PlaylistItemModel::updateRow(int nRow)
+{
+    if (nRow < 0 || nRow >= m_nCount)
+        return;
+
+    const QModelIndex idx = index(nRow);
+    emit dataChanged(idx, idx);
+}
+
+PlaylistItemDelegate::PlaylistItemDelegate(QObject *pParent)
+    : QStyledItemDelegate(pParent), m_elidedCache(ELIDED_CACHE_SIZE)
+{
+}
+
+void PlaylistItemDelegate::paint(QPainter *pPainter, const QStyleOptionViewItem &option,
+                                 const QModelIndex &index) const
+{
+    const bool bDark = DGuiApplicationHelper::DarkType == DGuiApplicationHelper::instance()->themeType();
+    const bool bSelected = index.data(PlaylistItemModel::SelectedRole).toBool();
+    const bool bPlaying = index.data(PlaylistItemModel::PlayingRole).toBool();
+    const bool bValid = index.data(PlaylistItemModel::ValidRole).toBool();
+    const DPalette pal = DApplicationHelper::instance()->palette(option.widget);
+    const QRect rect(option.rect.topLeft(), QSize(qMin(option.rect.width(), PLAYITEM_WIDTH), PLAYITEM_HEIGHT));
+
+    pPainter->save();
+    pPainter->setRenderHint(QPainter::Antialiasing);
+
+    QPainterPath pp;
+    pp.addRoundedRect(rect, 8, 8);
+    //序号为偶数的行绘制底色
+    if (index.row() % 2) {
+        QColor bgColor;
+        if (bDark) {
+            bgColor = QColor(255, 255, 255);
+            bgColor.setAlphaF(0.05);
+        } else {
+            bgColor = QGuiApplication::palette().color(QPalette::AlternateBase);
+        }
+        pPainter->fillPath(pp, bgColor);
+    }
+    if (index.data(PlaylistItemModel::HoveredRole).toBool()) {
+        pPainter->fillPath(pp, bDark ? QColor(255, 255, 255, static_cast<int>(255 * 0.05))
+                           : QColor(0, 0, 0, static_cast<int>(255 * 0.05)));
+    }
+    if (bSelected) {
+        pPainter->fillPath(pp, DGuiApplicationHelper::instance()->applicationPalette().highlight().color());
+    }
+
+    QColor textColor = bDark ? Qt::white : Qt::black;
+    if (bSelected) {
+        textColor = Qt::white;
+    } else if (bPlaying) {
+        textColor = pal.color(DPalette::Highlight);
+    }
+
+    const QFont smallFont = DFontSizeManager::instance()->get(DFontSizeManager::T9, option.font);
+    const int nNameWidth = rect.width() - 104;
+    QRect indexRect(rect.left() + 10, rect.top(), 21, rect.height());
+    QRect nameRect(indexRect.right() + 1, rect.top() + (rect.height() - 36) / 2, nNameWidth, 36);
+
+    pPainter->setPen(textColor);
+    pPainter->setFont(smallFont);
+    pPainter->drawText(indexRect, Qt::AlignLeft | Qt::AlignVCenter, QString::number(index.row() + 1));
+
+    pPainter->setPen(!bValid && !bSelected ? pal.color(DPalette::TextTips) : textColor);
+    pPainter->setFont(option.font);
+    pPainter->drawText(nameRect, Qt::AlignLeft | Qt::AlignVCenter,
+                       elidedTitle(index.data(Qt::DisplayRole).toString(), option.font, nNameWidth));
+
+    //选中时该位置显示关闭按钮
+    if (!bSelected) {
+        pPainter->setPen(textColor);
+        pPainter->setFont(smallFont);
+        pPainter->drawText(rect, Qt::AlignRight | Qt::AlignVCenter,
+                           index.data(PlaylistItemModel::DurationRole).toString());
+    }
+
+    pPainter->restore();
+}
+
+QSize PlaylistItemDelegate::sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const
+{
+    Q_UNUSED(option);
+    Q_UNUSED(index);
+
+    return QSize(PLAYITEM_WIDTH, PLAYITEM_HEIGHT);
+}
+
+QString PlaylistItemDelegate::elidedTitle(const QString &sTitle, const QFont &font, int nWidth) const
+{
+    const QString sKey = QString("%1|%2|%3").arg(font.key()).arg(nWidth).arg(sTitle);
+    if (QString *pText = m_elidedCache.object(sKey))
+        return *pText;
+
+    const QString sText = utils::ElideText(sTitle, {nWidth, 36}, QTextOption::NoWrap,
+                                           font, Qt::ElideRight, 18, nWidth);
+    m_elidedCache.insert(sKey, new QString(sText));
+    return sText;
+}
+
+}
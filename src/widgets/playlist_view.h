@@ -0,0 +1,106 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file 播放列表界面使用的模型和委托
+ * 列表项不再各自创建控件，模型直接引用PlaylistModel中的条目，播放列表变化时只通知变化的行；
+ * 委托只绘制可见行，省略后的文件名按宽度和字体缓存，各行共用同一组字体和颜色
+ */
+#ifndef _DMR_PLAYLIST_VIEW_H
+#define _DMR_PLAYLIST_VIEW_H
+
+#include <QAbstractListModel>
+#include <QStyledItemDelegate>
+#include <QCache>
+
+namespace dmr {
+
+class PlaylistModel;
+struct PlayItemInfo;
+
+class PlaylistItemModel: public QAbstractListModel
+{
+    Q_OBJECT
+public:
+    enum ItemRole {
+        DurationRole = Qt::UserRole + 1,    ///时长文字，文件不存在时为提示文字
+        ValidRole,                          ///文件是否存在
+        PlayingRole,                        ///是否为当前播放项
+        SelectedRole,                       ///是否为选中项
+        HoveredRole,                        ///鼠标是否悬停
+    };
+
+    PlaylistItemModel(PlaylistModel *pPlaylist, QObject *pParent);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role) const override;
+    Qt::ItemFlags flags(const QModelIndex &index) const override;
+
+    /**
+     * @brief 条目信息，返回引用不复制
+     */
+    const PlayItemInfo &itemInfo(int nRow) const;
+    /**
+     * @brief 重新检查文件是否存在，结果变化时刷新该行
+     * @return 文件可以播放时返回true
+     */
+    bool refreshItem(int nRow);
+    /**
+     * @brief 按PlaylistModel的当前内容重建
+     */
+    void reload();
+
+    int selectedRow() const
+    {
+        return m_nSelected;
+    }
+    void setSelectedRow(int nRow);
+    int hoveredRow() const
+    {
+        return m_nHovered;
+    }
+    void setHoveredRow(int nRow);
+
+private slots:
+    void onItemsAppended();
+    void onItemRemoved(int nRow);
+    void onCurrentChanged();
+    void onItemInfoUpdated(int nRow);
+
+private:
+    /**
+     * @brief 行号变化后只刷新该行
+     */
+    void updateRow(int nRow);
+
+private:
+    PlaylistModel *m_pPlaylist;
+    int m_nCount {0};           //已通知视图的行数，PlaylistModel先变化、后发信号，不能直接使用其count
+    int m_nCurrent {-1};
+    int m_nSelected {-1};
+    int m_nHovered {-1};
+};
+
+class PlaylistItemDelegate: public QStyledItemDelegate
+{
+    Q_OBJECT
+public:
+    explicit PlaylistItemDelegate(QObject *pParent);
+
+    void paint(QPainter *pPainter, const QStyleOptionViewItem &option,
+               const QModelIndex &index) const override;
+    QSize sizeHint(const QStyleOptionViewItem &option, const QModelIndex &index) const override;
+
+private:
+    /**
+     * @brief 省略后的文件名，相同文件名、字体和宽度只计算一次
+     */
+    QString elidedTitle(const QString &sTitle, const QFont &font, int nWidth) const;
+
+private:
+    mutable QCache<QString, QString> m_elidedCache;
+};
+
+}
+
+#endif /* ifndef _DMR_PLAYLIST_VIEW_H */
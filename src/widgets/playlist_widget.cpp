@@ -14,6 +14,7 @@
 #include "movieinfo_dialog.h"
 #include "tip.h"
 #include "toolbutton.h"
+#include "playlist_view.h"
 
 #include <DApplication>
 #include <dimagebutton.h>
@@ -25,455 +26,6 @@
 #define POPUP_DURATION 350
 
 namespace dmr {
-class PlayItemTooltipHandler: public QObject
-{
-public:
-    explicit PlayItemTooltipHandler(QObject *parent): QObject(parent) {}
-
-protected:
-    bool eventFilter(QObject *obj, QEvent *event)
-    {
-        switch (event->type()) {
-        case QEvent::ToolTip: {
-            QHelpEvent *he = static_cast<QHelpEvent *>(event);
-            Tip *tip = obj->property("HintWidget").value<Tip *>();
-            QWidget *item = tip->property("for").value<QWidget *>();
-            DLabel *lb = tip->findChild<DLabel *>("TipText");
-            if (tip->isVisible())
-                return true; //tip弹出后不再更新位置
-            lb->setAlignment(Qt::AlignLeft);
-            tip->update();
-            tip->show();
-            tip->adjustSize();
-            tip->raise();
-            QPoint pos = he->globalPos() + QPoint{0, 10};
-            int dw = qApp->desktop()->availableGeometry(item).width();
-            if (pos.x() + tip->width() > dw) {
-                pos.rx() = dw - tip->width();
-            }
-            tip->move(pos);
-            return true;
-        }
-
-        case QEvent::Leave: {
-            auto tip = obj->property("HintWidget").value<Tip *>();
-            tip->hide();
-            event->ignore();
-            break;
-        }
-        default:
-            break;
-        }
-        return QObject::eventFilter(obj, event); // standard event processing
-    }
-};
-
-enum ItemState {
-    Normal,
-    Playing,
-    Invalid, // gets deleted or similar
-};
-
-class PlayItemWidget: public QFrame
-{
-    Q_OBJECT
-public:
-    friend class PlaylistWidget;
-
-    PlayItemWidget(const PlayItemInfo &pif, QListWidget *list = nullptr, int index = 0, PlaylistWidget *parent = nullptr)
-        : QFrame(), _pif {pif}, _listWidget {list}, _playlist{parent}
-    {
-        _thumb = nullptr;
-        m_pSvgWidget = nullptr;
-        setProperty("PlayItemThumb", "true");
-        setFrameShape(QFrame::NoFrame);
-        this->setObjectName(PLAYITEM_WIDGET);
-        auto kd = "local";
-        if (!_pif.url.isLocalFile()) {
-            if (_pif.url.scheme().startsWith("dvd")) {
-                kd = "dvd";
-            } else {
-                kd = "network";
-            }
-        }
-        setProperty("ItemKind", kd);
-
-        // it's the same for all themes
-        _play = QPixmap(":/resources/icons/dark/normal/film-top.svg");
-        _play.setDevicePixelRatio(qApp->devicePixelRatio());
-
-        setFixedSize(324, 40);
-        QHBoxLayout *l = new QHBoxLayout(this);
-        l->setContentsMargins(10, 0, 0, 0);
-        l->setSpacing(0);
-        setLayout(l);
-
-        _index = new DLabel(this);
-        DFontSizeManager::instance()->bind(_index, DFontSizeManager::T9);
-        _index->setText(QString::number(index + 1));
-        _index->setFixedWidth(21);
-        l->addWidget(_index);
-        QObject::connect(DGuiApplicationHelper::instance(), &DGuiApplicationHelper::themeTypeChanged, this, &PlayItemWidget::slotThemeTypeChanged);
-
-        _name = new DLabel(this);
-        _name->setProperty("Name", true);
-        _name->setFrameShape(QFrame::NoFrame);
-        _name->setTextInteractionFlags(Qt::NoTextInteraction);
-        _name->installEventFilter(this);
-        _name->setAutoFillBackground(false);
-
-        l->addWidget(_name);
-
-        _time = new DLabel(this);
-        DFontSizeManager::instance()->bind(_time, DFontSizeManager::T9);
-        _time->setProperty("Time", true);
-        _time->setText(_pif.mi.durationStr());
-        if (!_pif.valid) {
-            setState(ItemState::Invalid);
-            _time->setText(tr("The file does not exist"));
-        }
-        l->addStretch();
-        l->addWidget(_time);
-
-        _closeBtn = new DFloatingButton(DStyle::SP_CloseButton, this);
-        _closeBtn->setFocusPolicy(Qt::NoFocus);
-        _closeBtn->setObjectName(PLAYITEN_CLOSE_BUTTON);
-        _closeBtn->setAccessibleName(PLAYITEN_CLOSE_BUTTON);
-        _closeBtn->setIconSize(QSize(28, 28));
-        _closeBtn->setFixedSize(25, 25);
-        _closeBtn->hide();
-        connect(_closeBtn, &DFloatingButton::clicked, this, &PlayItemWidget::closeButtonClicked);
-
-        setToolTip(_pif.mi.title);
-        auto th = new PlayItemTooltipHandler(this);
-        auto t = new Tip(QPixmap(), _pif.mi.title, nullptr);
-        t->setWindowFlags(Qt::ToolTip | Qt::CustomizeWindowHint);
-        t->setText(_pif.mi.title);
-        t->resetSize(QApplication::desktop()->availableGeometry().width());
-        t->setAttribute(Qt::WA_TranslucentBackground);
-        t->setProperty("for", QVariant::fromValue<QWidget *>(this));
-        t->layout()->setContentsMargins(5, 10, 5, 10);
-        t->hide();
-        setProperty("HintWidget", QVariant::fromValue<QWidget *>(t));
-        if (!utils::check_wayland_env())
-            installEventFilter(th);
-//        connect(_playlist, &PlaylistWidget::sizeChange, this, &PlayItemWidget::slotSizeChange);
-
-        m_opacityEffect = new QGraphicsOpacityEffect;
-        _time->setGraphicsEffect(m_opacityEffect);
-        m_opacityEffect_1 = new QGraphicsOpacityEffect;
-        _index->setGraphicsEffect(m_opacityEffect_1);
-        setState(ItemState::Normal);
-    }
-    
-    ~PlayItemWidget() override
-    {
-        if (m_pSvgWidget) {
-            delete  m_pSvgWidget;
-            m_pSvgWidget = nullptr;
-        }
-
-        if (_thumb) {
-            delete _thumb;
-            _thumb = nullptr;
-        }
-    }
-
-    void updateInfo(const PlayItemInfo &pif)
-    {
-        _pif = pif;
-        _time->setText(_pif.mi.durationStr());
-        setToolTip(_pif.mi.title);
-        updateNameText();
-
-        if (!_pif.valid) {
-            setState(ItemState::Invalid);
-            _time->setText(tr("The file does not exist"));
-        }
-        update();
-    }
-
-    void setState(ItemState is)
-    {
-        setProperty("ItemState", is);
-        updateForeground();
-    }
-
-    ItemState state() const
-    {
-        return static_cast<ItemState>(property("ItemState").toInt());
-    }
-    void setIndex(int index)
-    {
-        _index->setText(QString::number(index + 1));
-    }
-
-    void setHovered(bool v)
-    {
-        if (_hovered != v) {
-            _hovered = v;
-            setProperty("hovered", v);
-        }
-    }
-
-    void setCurItemHovered(bool v)
-    {
-        if (_hovered != v) {
-            _hovered = v;
-            setProperty("hovered", v);
-        }
-
-        if (v) {
-            _closeBtn->show();
-            _closeBtn->raise();
-        } else {
-            _closeBtn->hide();
-        }
-
-        updateClosePosition();
-        update();
-    }
-
-    bool getBIsSelect() const
-    {
-        return m_bIsSelect;
-    }
-
-    void setBIsSelect(bool bIsSelect)
-    {
-        m_bIsSelect = bIsSelect;
-
-        updateForeground();
-    }
-
-    void doDoubleClick()
-    {
-        //FIXME: there is an potential inconsistency with model if pif did changed
-        //(i.e gets deleted).
-        _pif.refresh();
-        _time->setText(_pif.mi.durationStr());
-        if (!_pif.valid) {
-            setState(ItemState::Invalid);
-            _time->setText(tr("The file does not exist"));
-        }
-        if (!_pif.url.isLocalFile() || _pif.info.exists()) {
-            emit doubleClicked();
-        }
-    }
-
-signals:
-    void closeButtonClicked();
-    void doubleClicked();
-
-private slots:
-    void slotThemeTypeChanged()
-    {
-//        QPalette pa;
-        if (DGuiApplicationHelper::LightType == DGuiApplicationHelper::instance()->themeType()) {
-            if (_thumb) {
-                _thumb->setPic(_pif.thumbnail);
-            } else {
-                //m_pSvgWidget->load(QString(":/resources/icons/music-light.svg"));
-            }
-//            pa.setColor(QPalette::BrightText, Qt::black);
-//            _name->setPalette(pa);
-//            _index->setPalette(pa);
-            updateForeground();
-        };
-        if (DGuiApplicationHelper::DarkType == DGuiApplicationHelper::instance()->themeType()) {
-            if (_thumb) {
-                _thumb->setPic(_pif.thumbnail_dark);
-            } else {
-                //m_pSvgWidget->load(QString(":/resources/icons/music-dark.svg"));
-            }
-//            pa.setColor(QPalette::BrightText, Qt::white);
-//            _name->setPalette(pa);
-//            _index->setPalette(pa);
-            updateForeground();
-        }
-    }
-    void slotSizeChange()
-    {
-        setFixedWidth(_playlist->width());
-    }
-
-protected:
-    void updateClosePosition()
-    {
-        auto margin = 10;
-        _closeBtn->move(width() - _closeBtn->width() - margin,
-                        (height() - _closeBtn->height()) / 2);
-    }
-    void updateForeground()
-    {
-        m_highlightColor = Dtk::Gui::DGuiApplicationHelper::instance()->applicationPalette().highlight().color();
-
-        if(m_bIsSelect) {
-            _name->setForegroundRole(DPalette::Text);
-            _index->setForegroundRole(DPalette::Text);
-
-            QPalette pa;
-            pa.setColor(QPalette::Text, Qt::white);
-            _name->setPalette(pa);
-            _index->setPalette(pa);
-        } else {
-            if (state() == ItemState::Playing) {
-                _name->setForegroundRole(DPalette::Highlight);
-                _index->setForegroundRole(DPalette::Highlight);
-                _time->setForegroundRole(DPalette::Highlight);
-            } else {
-                _name->setForegroundRole(DPalette::BrightText);
-                _index->setForegroundRole(DPalette::BrightText);
-                _time->setForegroundRole(DPalette::BrightText);
-
-                QPalette pa;
-                if (DGuiApplicationHelper::LightType == DGuiApplicationHelper::instance()->themeType()) {
-                    pa.setColor(QPalette::BrightText, Qt::black);
-                    _name->setPalette(pa);
-                    _index->setPalette(pa);
-                } else if (DGuiApplicationHelper::DarkType == DGuiApplicationHelper::instance()->themeType()) {
-                    pa.setColor(QPalette::BrightText, Qt::white);
-                    _name->setPalette(pa);
-                    _index->setPalette(pa);
-                }
-            }
-        }
-    }
-    void leaveEvent(QEvent *e) override
-    {
-        _closeBtn->hide();
-        setHovered(false);
-
-        QFrame::leaveEvent(e);
-    }
-    void enterEvent(QEvent *e) override
-    {
-        _closeBtn->show();
-        _closeBtn->raise();
-
-        updateClosePosition();
-        setHovered(true);
-
-        QFrame::enterEvent(e);
-    }
-    bool eventFilter(QObject *obj, QEvent *e) override
-    {
-        if (e->type() == QEvent::MouseButtonDblClick) {
-            doDoubleClick();
-            return true;
-        }
-        return QWidget::eventFilter(obj, e);
-    }
-    void resizeEvent(QResizeEvent *re) override
-    {
-        updateClosePosition();
-        updateNameText();
-
-        QFrame::resizeEvent(re);
-    }
-    bool event(QEvent *ee) override
-    {
-        if (ee->type() == QEvent::Resize) {
-            _name->setFixedHeight(36);
-        }
-
-        if (ee->type() == QEvent::Move) {
-        }
-
-        return QFrame::event(ee);
-    }
-    void updateNameText()
-    {
-        _name->setText(utils::ElideText(_pif.mi.title, {width() - 104, 36}, QTextOption::NoWrap,
-                                        _name->font(), Qt::ElideRight, 18, width() - 104));
-        _name->setCursor(Qt::ArrowCursor);
-        _name->setFixedHeight(36);
-    }
-    void showEvent(QShowEvent *se) override
-    {
-        updateNameText();
-        QFrame::showEvent(se);
-    }
-    void mouseDoubleClickEvent(QMouseEvent *me) override
-    {
-        doDoubleClick();
-
-        QFrame::mouseDoubleClickEvent(me);
-    }
-    void paintEvent(QPaintEvent *pe) override
-    {
-        QPainter painter(this);
-        painter.setRenderHint(QPainter::Antialiasing);
-        QRectF bgRect;
-        bgRect.setSize(size());
-        const DPalette pal = QGuiApplication::palette();
-
-        if (!(_index->text().toInt() % 2)) {
-            QColor bgColor;
-            if (DGuiApplicationHelper::instance()->themeType() == DGuiApplicationHelper::DarkType) {
-                bgColor = QColor(255, 255, 255);
-                bgColor.setAlphaF(0.05);
-            } else {
-                bgColor = pal.color(DPalette::AlternateBase);
-            }
-            QPainterPath pp;
-            pp.addRoundedRect(bgRect, 8, 8);
-            painter.fillPath(pp, bgColor);
-        }
-
-        if (_hovered) {
-            DPalette pa = DApplicationHelper::instance()->palette(this);
-            pa.setBrush(DPalette::Text, pa.color(DPalette::Highlight));
-            QColor bgColor(255, 255, 255, static_cast<int>(255 * 0.05));
-            if (DGuiApplicationHelper::LightType == DGuiApplicationHelper::instance()->themeType()) {
-                bgColor = QColor(0, 0, 0, static_cast<int>(255 * 0.05));
-            }
-
-            QPainterPath pp;
-            pp.addRoundedRect(bgRect, 8, 8);
-            painter.fillPath(pp, bgColor);
-
-        }
-
-        if (!_pif.valid) {
-            setState(ItemState::Invalid);
-            _name->setForegroundRole(DPalette::TextTips);
-            _time->setText(tr("The file does not exist"));
-        }
-
-        if (m_bIsSelect) {
-            _time->hide();
-            _closeBtn->show();
-            _closeBtn->raise();
-            QPainterPath pp;
-            pp.addRoundedRect(bgRect, 8, 8);
-            painter.fillPath(pp, m_highlightColor);
-        } else {
-        _time->show();
-        _closeBtn->hide();
-    }
-        QFrame::paintEvent(pe);
-    }
-
-private:
-    QString _bg;
-    DLabel *_index;
-    ListPic *_thumb;
-    QSvgWidget *m_pSvgWidget;
-    DLabel *_name;
-    DLabel *_time;
-    QPixmap _play;
-    PlayItemInfo _pif;
-    DFloatingButton *_closeBtn;
-    QListWidget *_listWidget {nullptr};
-    bool _hovered {false};
-    PlaylistWidget *_playlist{nullptr};
-    bool m_bIsSelect = false;
-    QGraphicsOpacityEffect *m_opacityEffect {nullptr};
-    QGraphicsOpacityEffect *m_opacityEffect_1 {nullptr};
-    QColor m_highlightColor;
-};
-
 class MainWindowListener: public QObject
 {
 public:
@@ -547,9 +99,10 @@ class MouseEventListener: public QObject
 {
 public:
     explicit MouseEventListener(QObject *parent): QObject(parent) {}
-    void setListWidget(DListWidget* listWidget)
+    void setListView(DListView *listView, PlaylistItemModel *model)
     {
-        m_pListWidget = listWidget;
+        m_pListView = listView;
+        m_pModel = model;
     }
 
 protected:
@@ -557,20 +110,16 @@ protected:
     {
         if (event->type() == QEvent::MouseButtonPress) {
             QMouseEvent *pMouseEvent = static_cast<QMouseEvent *>(event);
-            if (pMouseEvent->buttons() == Qt::LeftButton && !m_pListWidget->itemAt(pMouseEvent->pos())) {
-                PlayItemWidget *pItem = reinterpret_cast<PlayItemWidget *>(m_pListWidget->itemWidget(m_pListWidget->currentItem()));
-                if(pItem)
-                {
-                    pItem->setBIsSelect(false); // 点击播放列表空白处，取消item选中效果
-                    m_pListWidget->update();
-                }
+            if (pMouseEvent->buttons() == Qt::LeftButton && !m_pListView->indexAt(pMouseEvent->pos()).isValid()) {
+                m_pModel->setSelectedRow(-1); // 点击播放列表空白处，取消item选中效果
             }
         }
 
         return QObject::eventFilter(obj, event);
     }
 private:
-    DListWidget* m_pListWidget;
+    DListView *m_pListView {nullptr};
+    PlaylistItemModel *m_pModel {nullptr};
 };
 
 PlaylistWidget::PlaylistWidget(QWidget *mw, PlayerEngine *mpv)
@@ -582,7 +131,6 @@ PlaylistWidget::PlaylistWidget(QWidget *mw, PlayerEngine *mpv)
 
     paOpen = nullptr;
     paClose = nullptr;
-    pSelectItemWgt = nullptr;
 
     setFixedWidth(344);
     QVBoxLayout *mainVLayout = new QVBoxLayout(this);
@@ -630,11 +178,19 @@ PlaylistWidget::PlaylistWidget(QWidget *mw, PlayerEngine *mpv)
     topLayout->addWidget(m_pClearButton);
     mainVLayout->addLayout(topLayout);
 
-    _playlist = new DListWidget();
+    //列表项由委托绘制，只绘制可见行，不再为每一行创建控件
+    _model = new PlaylistItemModel(&_engine->playlist(), this);
+    _playlist = new DListView();
+    _playlist->setModel(_model);
+    _playlist->setItemDelegate(new PlaylistItemDelegate(_playlist));
+    _playlist->setUniformItemSizes(true);
+    _playlist->setMouseTracking(true);
+    _playlist->setEditTriggers(QAbstractItemView::NoEditTriggers);
     _playlist->setAttribute(Qt::WA_DeleteOnClose);
     _playlist->setFixedSize(334, 440);
     _playlist->setContentsMargins(0, 0, 0, 0);
     _playlist->installEventFilter(this);
+    _playlist->viewport()->installEventFilter(this);
     _playlist->viewport()->setAutoFillBackground(false);
     _playlist->setAutoFillBackground(false);
     _playlist->setObjectName(PLAYLIST);
@@ -648,18 +204,34 @@ PlaylistWidget::PlaylistWidget(QWidget *mw, PlayerEngine *mpv)
     _playlist->setSelectionMode(QListView::NoSelection);
     _playlist->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     _playlist->setResizeMode(QListView::Adjust);
-    _playlist->setDragDropMode(QListView::InternalMove);
     _playlist->setSpacing(0);
-    _playlist->viewport()->setAcceptDrops(true);
-    _playlist->setDragEnabled(true);
+
+    _closeBtn = new DFloatingButton(DStyle::SP_CloseButton, _playlist->viewport());
+    _closeBtn->setFocusPolicy(Qt::NoFocus);
+    _closeBtn->setObjectName(PLAYITEN_CLOSE_BUTTON);
+    _closeBtn->setAccessibleName(PLAYITEN_CLOSE_BUTTON);
+    _closeBtn->setIconSize(QSize(28, 28));
+    _closeBtn->setFixedSize(25, 25);
+    _closeBtn->hide();
+    connect(_closeBtn, &DFloatingButton::clicked, this, &PlaylistWidget::slotCloseItem);
+
+    _tip = new Tip(QPixmap(), QString(), nullptr);
+    _tip->setWindowFlags(Qt::ToolTip | Qt::CustomizeWindowHint);
+    _tip->resetSize(QApplication::desktop()->availableGeometry().width());
+    _tip->setAttribute(Qt::WA_TranslucentBackground);
+    _tip->layout()->setContentsMargins(5, 10, 5, 10);
+    _tip->hide();
 
     MouseEventListener* pListener = new MouseEventListener(this);
-    pListener->setListWidget(_playlist);
+    pListener->setListView(_playlist, _model);
     _playlist->viewport()->installEventFilter(pListener);
     this->installEventFilter(pListener);
 
-    connect(_playlist, &DListWidget::itemClicked, this, &PlaylistWidget::slotShowSelectItem);
-    connect(_playlist, &DListWidget::currentItemChanged, this, &PlaylistWidget::OnItemChanged);
+    connect(_playlist, &DListView::clicked, this, &PlaylistWidget::slotShowSelectItem);
+    connect(_playlist, &DListView::doubleClicked, this, [ = ](const QModelIndex &index) {
+        activateRow(index.row());
+    });
+    connect(_playlist->selectionModel(), &QItemSelectionModel::currentChanged, this, &PlaylistWidget::OnItemChanged);
 
     if (!composited) {
         _playlist->setWindowFlags(Qt::FramelessWindowHint | Qt::BypassWindowManagerHint);
@@ -673,58 +245,47 @@ PlaylistWidget::PlaylistWidget(QWidget *mw, PlayerEngine *mpv)
     mw->installEventFilter(mwl);
 #endif
 
-    if (!_closeMapper) {
-        _closeMapper = new QSignalMapper(this);
-        connect(_closeMapper,
-                static_cast<void(QSignalMapper::*)(QWidget *)>(&QSignalMapper::mapped), this, &PlaylistWidget::slotCloseItem);
-
-    }
-
-    if (!_activateMapper) {
-        _activateMapper = new QSignalMapper(this);
-        connect(_activateMapper,
-                static_cast<void(QSignalMapper::*)(QWidget *)>(&QSignalMapper::mapped), this, &PlaylistWidget::slotDoubleClickedItem);
-
-    }
-
     connect(&_engine->playlist(), &PlaylistModel::emptied, this, &PlaylistWidget::clear);
     connect(&_engine->playlist(), &PlaylistModel::itemsAppended, this, &PlaylistWidget::appendItems);
     connect(&_engine->playlist(), &PlaylistModel::itemRemoved, this, &PlaylistWidget::removeItem);
     connect(&_engine->playlist(), &PlaylistModel::currentChanged, this, &PlaylistWidget::updateItemStates);
-    connect(&_engine->playlist(), &PlaylistModel::itemInfoUpdated, this, &PlaylistWidget::updateItemInfo);
+
+    //关闭按钮跟随悬停行和选中行
+    connect(_model, &PlaylistItemModel::dataChanged, this, &PlaylistWidget::updateCloseButton);
+    connect(_model, &PlaylistItemModel::rowsRemoved, this, &PlaylistWidget::updateCloseButton);
+    connect(_model, &PlaylistItemModel::modelReset, this, &PlaylistWidget::updateCloseButton);
+    connect(_playlist->verticalScrollBar(), &QScrollBar::valueChanged, this, &PlaylistWidget::updateCloseButton);
+    connect(DGuiApplicationHelper::instance(), &DGuiApplicationHelper::themeTypeChanged, this, [ = ] {
+        _playlist->viewport()->update();
+    });
 
     QTimer::singleShot(10, this, &PlaylistWidget::loadPlaylist);
+    connect(_playlist->verticalScrollBar(), &QScrollBar::valueChanged, this, &PlaylistWidget::prioritizeVisibleItems);
 
     connect(ActionFactory::get().playlistContextMenu(), &DMenu::aboutToShow, [ = ]() {
         QTimer::singleShot(20, [ = ]() {
-            if (_mouseItem) {
-                _clickedItem = _mouseItem;
-                (static_cast<PlayItemWidget *>(_mouseItem))->setHovered(true);
+            if (_mouseRow >= 0) {
+                _clickedRow = _mouseRow;
+                _model->setHoveredRow(_mouseRow);
             }
         });
     });
     connect(ActionFactory::get().playlistContextMenu(), &DMenu::aboutToHide, [ = ]() {
-        if (_mouseItem) {
-            (static_cast<PlayItemWidget *>(_mouseItem))->setHovered(false);
+        if (_mouseRow >= 0) {
+            _model->setHoveredRow(-1);
         }
     });
-
-    connect(_playlist->model(), &QAbstractItemModel::rowsMoved, this, &PlaylistWidget::slotRowsMoved);
 }
 
 PlaylistWidget::~PlaylistWidget()
 {
+    delete _tip;
 }
 
 void PlaylistWidget::updateSelectItem(const int key)
 {
-    auto curItem = _playlist->currentItem();
-    auto curRow = _playlist->row(curItem);
+    auto curRow = _playlist->currentIndex().row();
     qInfo() << "prevRow..." << curRow;
-    PlayItemWidget *prevItemWgt = nullptr;
-    if (curItem) {
-        prevItemWgt = reinterpret_cast<PlayItemWidget *>(_playlist->itemWidget(curItem));
-    }
 
     if (key == Qt::Key_Up) {
         if (curRow == -1) {
@@ -736,123 +297,74 @@ void PlaylistWidget::updateSelectItem(const int key)
             return;
         }
 
-        _playlist->setCurrentRow(_index);
+        _playlist->setCurrentIndex(_model->index(_index));
         qInfo() << "Enter Key_Up..." << _index;
-        auto curItemWgt = reinterpret_cast<PlayItemWidget *>(_playlist->itemWidget(_playlist->item(_index)));
-        if (prevItemWgt) {
-            prevItemWgt->setBIsSelect(false);
-        }
-        if (curItemWgt) {
-            curItemWgt->setBIsSelect(true);
-        }
+        _model->setSelectedRow(_index);
 
     } else if (key == Qt::Key_Down) {
-        if (_index >= _playlist->count() - 1) {
+        if (_index >= _model->rowCount() - 1) {
             return;
         }
         _index = curRow + 1;
-        _playlist->setCurrentRow(_index);
+        _playlist->setCurrentIndex(_model->index(_index));
         qInfo() << "Enter Key_Down..." << _index;
-        auto curItemWgt = reinterpret_cast<PlayItemWidget *>(_playlist->itemWidget(_playlist->item(_index)));
-        if (prevItemWgt) {
-            prevItemWgt->setBIsSelect(false);
-        }
-        if (curItemWgt) {
-            curItemWgt->setBIsSelect(true);
-        }
+        _model->setSelectedRow(_index);
     } else if (key == Qt::Key_Enter || key == Qt::Key_Return) {
         if (m_pClearButton == focusWidget()) {   //focus在清空按钮上则清空列表
             _engine->clearPlaylist();
-        } else {
-            slotDoubleClickedItem(prevItemWgt);  //Enter键播放
+        } else if (curRow >= 0) {
+            slotDoubleClickedItem(curRow);  //Enter键播放
         }
     }
 }
 
 void PlaylistWidget::clear()
 {
-    _playlist->clear();
-    QString s = QString(tr("%1 videos")).arg(_playlist->count());
+    _mouseRow = -1;
+    _clickedRow = -1;
+    QString s = QString(tr("%1 videos")).arg(_model->rowCount());
     _num->setText(s);
     _engine->getplaylist()->clearLoad();
 }
 
-void PlaylistWidget::updateItemInfo(int id)
-{
-    auto piw = dynamic_cast<PlayItemWidget *>(_playlist->itemWidget(_playlist->item(id)));
-    if (piw == nullptr)     //update info thx
-        return ;
-    piw->updateInfo(_engine->playlist().items()[id]);
-}
-
 void PlaylistWidget::updateItemStates()
 {
-    qInfo() << __func__ << _playlist->count() << "current = " << _engine->playlist().current();
-
-    for (int i = 0; i < _playlist->count(); i++) {
-        auto piw = dynamic_cast<PlayItemWidget *>(_playlist->itemWidget(_playlist->item(i)));
-
-        auto old = piw->state();
-        piw->setState(ItemState::Normal);
-        if (!piw->_pif.valid) {
-            piw->setState(ItemState::Invalid);
-        }
-
-        if (i == _engine->playlist().current()) {
-            if (piw->state() != ItemState::Playing) {
-                //scrollToItem只能更新scroll位置，不能同步列表项
-                //_playlist->scrollToItem(_playlist->item(i));
-                _playlist->setCurrentRow(i);
-                piw->setState(ItemState::Playing);
+    int nCurrent = _engine->playlist().current();
+    qInfo() << __func__ << _model->rowCount() << "current = " << nCurrent;
 
-            }
-        }
+    //播放状态由模型只刷新变化的两行，这里同步列表的当前行
+    if (nCurrent >= 0 && nCurrent < _model->rowCount()) {
+        //scrollTo只能更新scroll位置，不能同步列表项
+        _playlist->setCurrentIndex(_model->index(nCurrent));
     }
 }
 
 void PlaylistWidget::showItemInfo()
 {
-    if (!_mouseItem) return;
-    auto item = dynamic_cast<PlayItemWidget *>(_mouseItem);
-    if (item) {
-        MovieInfoDialog mid(item->_pif, _mw);
-        mid.exec();
-    }
+    if (_mouseRow < 0 || _mouseRow >= _model->rowCount()) return;
+    MovieInfoDialog mid(_model->itemInfo(_mouseRow), _mw);
+    mid.exec();
 }
 
 void PlaylistWidget::openItemInFM()
 {
-    if (!_mouseItem) return;
-    auto item = dynamic_cast<PlayItemWidget *>(_mouseItem);
-    if (item) {
-        utils::ShowInFileManager(item->_pif.mi.filePath);
-    }
+    if (_mouseRow < 0 || _mouseRow >= _model->rowCount()) return;
+    utils::ShowInFileManager(_model->itemInfo(_mouseRow).mi.filePath);
 }
 
 void PlaylistWidget::removeClickedItem(bool isShortcut)
 {
     if (isShortcut && isVisible()) {
-        for (int i = 0; i < _playlist->count(); i++) {
-            PlayItemWidget * piw = dynamic_cast<PlayItemWidget *>(_playlist->itemWidget(_playlist->item(i)));
-            qInfo() << piw->getBIsSelect();
-            if (piw->getBIsSelect()) {
-                _engine->playlist().remove(i);
-                return;
-            }
+        qInfo() << _model->selectedRow();
+        if (_model->selectedRow() >= 0) {
+            _engine->playlist().remove(_model->selectedRow());
+            return;
         }
     }
 
-    if (!_clickedItem) return;
-    PlayItemWidget * piw = dynamic_cast<PlayItemWidget *>(_clickedItem);
-    if (piw) {
-        qInfo() << __func__;
-        for (int i = 0; i < _playlist->count(); i++) {
-            if (_clickedItem == _playlist->itemWidget(_playlist->item(i))) {
-                _engine->playlist().remove(i);
-                break;
-            }
-        }
-    }
+    if (_clickedRow < 0 || _clickedRow >= _model->rowCount()) return;
+    qInfo() << __func__;
+    _engine->playlist().remove(_clickedRow);
 }
 
 void PlaylistWidget::slotCloseTimeTimeOut()
@@ -863,82 +375,65 @@ void PlaylistWidget::slotCloseTimeTimeOut()
     _mw->reflectActionToUI(ActionFactory::TogglePlaylist);
 }
 
-void PlaylistWidget::slotCloseItem(QWidget *w)
+void PlaylistWidget::slotCloseItem()
 {
     qInfo() << "item close clicked";
-    _clickedItem = w;
+    _clickedRow = _closeRow;
     _mw->requestAction(ActionFactory::ActionKind::PlaylistRemoveItem);
 }
 
-void PlaylistWidget::slotDoubleClickedItem(QWidget *w)
+void PlaylistWidget::slotDoubleClickedItem(int nRow)
 {
     qInfo() << "item double clicked";
+    if (nRow < 0 || nRow >= _model->rowCount())
+        return;
+
     QList<QVariant> args;
-    for (int i = 0; i < _playlist->count(); i++) {
-        if (w == _playlist->itemWidget(_playlist->item(i))) {
-            args << i;
-            _mw->requestAction(ActionFactory::ActionKind::GotoPlaylistSelected,
-                               false, args);
-
-            QTimer *closelistTImer = new QTimer;
-            closelistTImer->start(500);
-            connect(closelistTImer, &QTimer::timeout, this, &PlaylistWidget::slotCloseTimeTimeOut);
-            break;
-        }
-    }
+    args << nRow;
+    _mw->requestAction(ActionFactory::ActionKind::GotoPlaylistSelected,
+                       false, args);
+
+    QTimer *closelistTImer = new QTimer;
+    closelistTImer->start(500);
+    connect(closelistTImer, &QTimer::timeout, this, &PlaylistWidget::slotCloseTimeTimeOut);
 }
 
-void PlaylistWidget::slotRowsMoved()
+void PlaylistWidget::activateRow(int nRow)
 {
-    if (_lastDragged.first >= 0) {
-        int target = -1;
-        for (int i = 0; i < _playlist->count(); i++) {
-            auto piw = dynamic_cast<PlayItemWidget *>(_playlist->itemWidget(_playlist->item(i)));
-            if (piw == _lastDragged.second) {
-                target = i;
-                break;
-            }
-        }
-        qInfo() << "swap " << _lastDragged.first << target;
-        if (target >= 0 && _lastDragged.first != target) {
-            _engine->playlist().switchPosition(_lastDragged.first, target);
-            _lastDragged = {-1, nullptr};
-        }
+    if (nRow < 0 || nRow >= _model->rowCount())
+        return;
+
+    //文件可能已被删除，播放前重新检查
+    if (_model->refreshItem(nRow)) {
+        slotDoubleClickedItem(nRow);
     }
 }
 
 void PlaylistWidget::contextMenuEvent(QContextMenuEvent *cme)
 {
     bool on_item = false;
-    _mouseItem = nullptr;
-    QPoint globaPoint = _playlist->mapFromParent(cme->pos());
-
-    if (_playlist->itemAt(globaPoint)) {
-        _mouseItem = _playlist->itemWidget(_playlist->itemAt(globaPoint));
-        on_item = true;
-    }
+    QModelIndex index = _playlist->indexAt(_playlist->viewport()->mapFrom(this, cme->pos()));
+    _mouseRow = index.isValid() ? index.row() : -1;
+    on_item = index.isValid();
 
     if (CompositingManager::get().isPadSystem()) {
-        if (pSelectItemWgt) {
-            pSelectItemWgt->setBIsSelect(false);
+        if (on_item) {
+            _model->setSelectedRow(_mouseRow);
         }
-        auto piw = dynamic_cast<PlayItemWidget *>(_mouseItem);
-        piw->setBIsSelect(true);
-        pSelectItemWgt = piw;
     } else {
-        auto piw = dynamic_cast<PlayItemWidget *>(_mouseItem);
+        bool bValid = on_item && _model->itemInfo(_mouseRow).valid;
         auto menu = ActionFactory::get().playlistContextMenu();
         for (auto act : menu->actions()) {
             auto prop = static_cast<ActionFactory::ActionKind>(act->property("kind").toInt());
             bool on = true;
             if (prop == ActionFactory::ActionKind::PlaylistOpenItemInFM) {
-                on = on_item && piw->_pif.valid && piw->_pif.url.isLocalFile();
+                on = bValid && _model->itemInfo(_mouseRow).url.isLocalFile();
             } else if (prop == ActionFactory::ActionKind::PlaylistRemoveItem) {
                 on = on_item;
             } else if (prop == ActionFactory::ActionKind::PlaylistItemInfo) {
-                on = on_item && piw->_pif.valid;
+                on = bValid;
             } else {
-                on = _playlist->count() > 0 ? true : false;
+                on = _model->rowCount() > 0 ? true : false;
             }
             act->setEnabled(on);
         }
@@ -953,45 +448,26 @@ void PlaylistWidget::contextMenuEvent(QContextMenuEvent *cme)
 
 void PlaylistWidget::showEvent(QShowEvent *se)
 {
-    batchUpdateSizeHints();
     adjustSize();
 
+    prioritizeVisibleItems();
+
     QWidget::showEvent(se);
 }
 
 void PlaylistWidget::removeItem(int idx)
 {
     qInfo() << "idx = " << idx;
-    auto item_remove = this->_playlist->item(idx);
-    if (item_remove) {
-        QWidget *pItem = _playlist->itemWidget(item_remove);
-        PlayItemWidget *pCurItem = dynamic_cast<PlayItemWidget *>(pItem);
-        if (pCurItem == pSelectItemWgt) {
-            pSelectItemWgt = nullptr;            //如果删除的是原来选中的则置空
-        }
-        item_remove = this->_playlist->takeItem(idx);
-        delete item_remove;
-    }
-
-    this->_playlist->update();
-    for (int i = 0; i < _playlist->count(); i++) {
-        QWidget *item = _playlist->itemWidget(_playlist->item(i));
-        if (item) {
-            (dynamic_cast<PlayItemWidget *>(item))->setIndex(i);
-        }
-    }
+    _mouseRow = -1;
+    _clickedRow = -1;
 
-    if (_playlist->count() != 0 && _playlist->count() != idx) {
-        QWidget *item = _playlist->itemWidget(_playlist->item(idx));
-        PlayItemWidget *curItem = dynamic_cast<PlayItemWidget *>(item);
-        curItem->setCurItemHovered(true);
-    } else if (_playlist->count() != 0 && _playlist->count() == idx) {
-        QWidget *item = _playlist->itemWidget(_playlist->item(--idx));
-        PlayItemWidget *curItem = dynamic_cast<PlayItemWidget *>(item);
-        curItem->setCurItemHovered(true);
+    //删除后关闭按钮显示在原位置的条目上
+    int nCount = _model->rowCount();
+    if (nCount != 0) {
+        _model->setHoveredRow(qMin(idx, nCount - 1));
     }
 
-    QString s = QString(tr("%1 videos")).arg(_playlist->count());
+    QString s = QString(tr("%1 videos")).arg(nCount);
     _num->setText(s);
 }
 
@@ -999,73 +475,55 @@ void PlaylistWidget::appendItems()
 {
     qInfo() << __func__;
 
-    auto items = _engine->playlist().items();
-    auto p = items.begin() + this->_playlist->count();
-    while (p != items.end()) {
-        auto w = new PlayItemWidget(*p, this->_playlist, p - items.begin(), this);
-
-        auto item = new QListWidgetItem;
-        item->setFlags(Qt::NoItemFlags);
-        _playlist->addItem(item);
-        _playlist->setItemWidget(item, w);
-
-        connect(w, SIGNAL(closeButtonClicked()), _closeMapper, SLOT(map()));
-        connect(w, SIGNAL(doubleClicked()), _activateMapper, SLOT(map()));
-        _closeMapper->setMapping(w, w);
-        _activateMapper->setMapping(w, w);
-        ++p;
-
-    }
-    QString s = QString(tr("%1 videos")).arg(_playlist->count());
+    QString s = QString(tr("%1 videos")).arg(_model->rowCount());
     _num->setText(s);
-    batchUpdateSizeHints();
     updateItemStates();
-//    _playlist->setStyleSheet(styleSheet());
-//    setStyleSheet(styleSheet());
+    prioritizeVisibleItems();
 }
 
-void PlaylistWidget::slotShowSelectItem(QListWidgetItem *item)
+void PlaylistWidget::slotShowSelectItem(const QModelIndex &index)
 {
-    PlayItemWidget *pWidget = nullptr;
-
-    if (item) {
-        _playlist->setCurrentItem(item);
-        pWidget = reinterpret_cast<PlayItemWidget *>(_playlist->itemWidget(item));
-        if (!pWidget) {
-            return;
-        }
+    if (!index.isValid()) {
+        return;
     }
+    _playlist->setCurrentIndex(index);
 
     if (CompositingManager::get().isPadSystem()) {
-        pWidget->doDoubleClick();
-        if (pSelectItemWgt) {
-            pSelectItemWgt->setBIsSelect(false);
-            pSelectItemWgt = nullptr;
-        }
+        activateRow(index.row());
+        _model->setSelectedRow(-1);
     } else {
-        pWidget->setBIsSelect(true);
+        _model->setSelectedRow(index.row());
     }
 }
 
-void PlaylistWidget::OnItemChanged(QListWidgetItem *current, QListWidgetItem *previous)
+void PlaylistWidget::OnItemChanged(const QModelIndex &current, const QModelIndex &previous)
 {
-    PlayItemWidget *prevItemWgt = nullptr;
-    PlayItemWidget *curItemWgt = nullptr;
-    bool bIsPad = CompositingManager::get().isPadSystem();
-
-    if (previous) {
-        prevItemWgt = reinterpret_cast<PlayItemWidget *>(_playlist->itemWidget(previous));
-        if (!bIsPad && prevItemWgt) {
-            prevItemWgt->setBIsSelect(false);
-        }
+    Q_UNUSED(previous);
+
+    if (!CompositingManager::get().isPadSystem()) {
+        _model->setSelectedRow(current.isValid() ? current.row() : -1);
     }
+}
 
-    if (current) {
-        curItemWgt = reinterpret_cast<PlayItemWidget *>(_playlist->itemWidget(current));
-        if (!bIsPad && curItemWgt) {
-            curItemWgt->setBIsSelect(true);
-        }
+void PlaylistWidget::updateCloseButton()
+{
+    _closeRow = _model->hoveredRow() >= 0 ? _model->hoveredRow() : _model->selectedRow();
+    if (_closeRow < 0) {
+        _closeBtn->hide();
+        return;
+    }
+
+    QRect rect = _playlist->visualRect(_model->index(_closeRow));
+    if (!rect.isValid() || !_playlist->viewport()->rect().intersects(rect)) {
+        _closeBtn->hide();
+        return;
     }
+
+    auto margin = 10;
+    _closeBtn->move(qMin(rect.width(), 324) - _closeBtn->width() - margin,
+                    rect.top() + (rect.height() - _closeBtn->height()) / 2);
+    _closeBtn->show();
+    _closeBtn->raise();
 }
 
 void PlaylistWidget::resetFocusAttribute(bool &atr)
@@ -1076,43 +534,22 @@ void PlaylistWidget::resetFocusAttribute(bool &atr)
 void PlaylistWidget::loadPlaylist()
 {
     qInfo() << __func__;
-    _playlist->clear();
-
-
-    auto items = _engine->playlist().items();
-    auto p = items.begin();
-    while (p != items.end()) {
-        auto w = new PlayItemWidget(*p, this->_playlist, p - items.begin(), this);
-        auto item = new QListWidgetItem;
-        item->setFlags(Qt::NoItemFlags);
-        _playlist->addItem(item);
-        _playlist->setItemWidget(item, w);
-
-        connect(w, SIGNAL(closeButtonClicked()), _closeMapper, SLOT(map()));
-        connect(w, SIGNAL(doubleClicked()), _activateMapper, SLOT(map()));
-        _closeMapper->setMapping(w, w);
-        _activateMapper->setMapping(w, w);
-        ++p;
-    }
+    _model->reload();
 
-    batchUpdateSizeHints();
     updateItemStates();
-//    _playlist->setStyleSheet(styleSheet());
-    QString s = QString(tr("%1 videos")).arg(_playlist->count());
+    QString s = QString(tr("%1 videos")).arg(_model->rowCount());
     _num->setText(s);
-//    setStyleSheet(styleSheet());
 }
 
-void PlaylistWidget::batchUpdateSizeHints()
+void PlaylistWidget::prioritizeVisibleItems()
 {
-    if (isVisible()) {
-        for (int i = 0; i < this->_playlist->count(); i++) {
-            auto item = this->_playlist->item(i);
-            auto w = this->_playlist->itemWidget(item);
-            //auto t = w->size();
-            item->setSizeHint(w->size());
-        }
-    }
+    if (!isVisible() || _model->rowCount() == 0)
+        return;
+
+    QRect rect = _playlist->viewport()->rect();
+    int first = _playlist->indexAt(rect.topLeft()).row();
+    QModelIndex last = _playlist->indexAt(rect.bottomLeft());
+    _engine->playlist().prioritizeItems(qMax(first, 0), last.isValid() ? last.row() : _model->rowCount() - 1);
 }
 
 void PlaylistWidget::endAnimation()
@@ -1242,8 +679,6 @@ void PlaylistWidget::resizeEvent(QResizeEvent *ev)
     _playlist->setFixedHeight(view_rect.height() - 102);
     emit sizeChange();
 
-    QTimer::singleShot(100, this, &PlaylistWidget::batchUpdateSizeHints);
-
     QWidget::resizeEvent(ev);
 }
 
@@ -1262,7 +697,7 @@ bool PlaylistWidget::eventFilter(QObject *obj, QEvent *event)
             _mw->toolbox()->setBtnFocusSign(true);
             break;
         case QEvent::FocusOut:
-            if (_playlist->count() <= 0) {
+            if (_model->rowCount() <= 0) {
                 //如果播放列表为空，清空按钮上的焦点不向后传递
                 return true;
             }
@@ -1273,14 +708,14 @@ bool PlaylistWidget::eventFilter(QObject *obj, QEvent *event)
     } else if (obj == _playlist) {
         switch (event->type()) {
         case QEvent::FocusIn: {
-            if (_playlist->count()) {
+            if (_model->rowCount()) {
                 //The judgment here is to prevent the focus from shifting during mouse operation
                 if (!m_bButtonFocusOut) {
                     return true;
                 }
                 //焦点切换到播放列表，选中第一个条目
-                if (_playlist->currentRow() != 0) {
-                    _playlist->setCurrentRow(0);
+                if (_playlist->currentIndex().row() != 0) {
+                    _playlist->setCurrentIndex(_model->index(0));
                     _index = 0;
                     m_bButtonFocusOut = false;
                 }
@@ -1299,9 +734,48 @@ bool PlaylistWidget::eventFilter(QObject *obj, QEvent *event)
         default:
             break;
         }
+    } else if (obj == _playlist->viewport()) {
+        switch (event->type()) {
+        case QEvent::MouseMove: {
+            int nRow = _playlist->indexAt(static_cast<QMouseEvent *>(event)->pos()).row();
+            if (nRow != _model->hoveredRow()) {
+                _tip->hide();
+                _model->setHoveredRow(nRow);
+            }
+            break;
+        }
+        case QEvent::Leave:
+            _tip->hide();
+            _model->setHoveredRow(-1);
+            break;
+        case QEvent::ToolTip: {
+            //wayland下使用系统提示
+            if (utils::check_wayland_env())
+                break;
+            QHelpEvent *he = static_cast<QHelpEvent *>(event);
+            QModelIndex index = _playlist->indexAt(he->pos());
+            if (!index.isValid())
+                return true;
+            if (_tip->isVisible())
+                return true; //tip弹出后不再更新位置
+            _tip->setText(index.data(Qt::DisplayRole).toString());
+            _tip->findChild<DLabel *>("TipText")->setAlignment(Qt::AlignLeft);
+            _tip->update();
+            _tip->show();
+            _tip->adjustSize();
+            _tip->raise();
+            QPoint pos = he->globalPos() + QPoint{0, 10};
+            int dw = qApp->desktop()->availableGeometry(_playlist).width();
+            if (pos.x() + _tip->width() > dw) {
+                pos.rx() = dw - _tip->width();
+            }
+            _tip->move(pos);
+            return true;
+        }
+        default:
+            break;
+        }
     }
     return QObject::eventFilter(obj, event); // standard event processing
 }
 }
-
-#include "playlist_widget.moc"
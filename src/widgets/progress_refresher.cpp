@@ -0,0 +1,140 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "progress_refresher.h"
+#include "player_engine.h"
+
+#include <QWidget>
+#include <QWindow>
+#include <QScreen>
+#include <QGuiApplication>
+
+#define REFRESH_TEXT_INTERVAL 250       //时间文字刷新周期(ms)，4Hz
+#define REFRESH_DEFAULT_INTERVAL 16     //取不到屏幕刷新率时进度条的刷新周期(ms)
+
+namespace dmr {
+
+ProgressRefresher::ProgressRefresher(QWidget *pOwner, PlayerEngine *pEngine)
+    : QObject(pOwner), m_pOwner(pOwner), m_pEngine(pEngine)
+{
+    m_textTimer.setSingleShot(true);
+    m_textTimer.setInterval(REFRESH_TEXT_INTERVAL);
+    connect(&m_textTimer, &QTimer::timeout, this, &ProgressRefresher::refreshTime);
+
+    m_progressTimer.setSingleShot(true);
+    m_progressTimer.setTimerType(Qt::PreciseTimer);
+    connect(&m_progressTimer, &QTimer::timeout, this, &ProgressRefresher::refreshProgress);
+
+    connect(m_pEngine, &PlayerEngine::elapsedChanged, this, &ProgressRefresher::requestRefresh);
+    connect(m_pEngine, &PlayerEngine::updateDuration, this, &ProgressRefresher::requestRefresh);
+    //停止播放时进度可能不变，但时间文字需要清空
+    connect(m_pEngine, &PlayerEngine::stateChanged, this, &ProgressRefresher::requestRefresh);
+
+    m_pOwner->installEventFilter(this);
+    m_pOwner->window()->installEventFilter(this);
+}
+
+void ProgressRefresher::invalidate()
+{
+    m_lastText = Snapshot();
+    m_lastProgress = Snapshot();
+}
+
+int ProgressRefresher::frameInterval() const
+{
+    QScreen *pScreen = nullptr;
+    if (m_pOwner->window()->windowHandle())
+        pScreen = m_pOwner->window()->windowHandle()->screen();
+    if (!pScreen)
+        pScreen = QGuiApplication::primaryScreen();
+
+    if (!pScreen || pScreen->refreshRate() < 1.0)
+        return REFRESH_DEFAULT_INTERVAL;
+    return qMax(1, qRound(1000.0 / pScreen->refreshRate()));
+}
+
+void ProgressRefresher::requestRefresh()
+{
+    //不可见时不安排刷新，恢复显示时由eventFilter补一次
+    if (!isActive())
+        return;
+
+    //定时器已在等待时，本周期内的后续通知直接合并
+    if (!m_textTimer.isActive())
+        m_textTimer.start();
+    if (!m_progressTimer.isActive())
+        m_progressTimer.start(frameInterval());
+}
+
+bool ProgressRefresher::eventFilter(QObject *pObject, QEvent *pEvent)
+{
+    switch (pEvent->type()) {
+    case QEvent::Show:
+    case QEvent::WindowStateChange:
+        if (isActive()) {
+            //暂停期间的进度未显示过，立即刷新
+            invalidate();
+            m_textTimer.start(0);
+            m_progressTimer.start(0);
+        } else {
+            m_textTimer.stop();
+            m_progressTimer.stop();
+        }
+        break;
+    case QEvent::Hide:
+        m_textTimer.stop();
+        m_progressTimer.stop();
+        break;
+    default:
+        break;
+    }
+
+    return QObject::eventFilter(pObject, pEvent);
+}
+
+bool ProgressRefresher::isActive() const
+{
+    return m_pOwner->isVisible() && !m_pOwner->window()->isMinimized();
+}
+
+void ProgressRefresher::refreshTime()
+{
+    m_textTimer.setInterval(REFRESH_TEXT_INTERVAL);
+    if (!isActive())
+        return;
+
+    const Snapshot snapshot = current();
+    if (m_lastText.bValid && m_lastText.nDuration == snapshot.nDuration
+            && m_lastText.nElapsed == snapshot.nElapsed && m_lastText.bIdle == snapshot.bIdle)
+        return;
+
+    m_lastText = snapshot;
+    emit timeChanged(snapshot.nDuration, snapshot.nElapsed);
+}
+
+void ProgressRefresher::refreshProgress()
+{
+    if (!isActive())
+        return;
+
+    const Snapshot snapshot = current();
+    if (m_lastProgress.bValid && m_lastProgress.nDuration == snapshot.nDuration
+            && m_lastProgress.nElapsed == snapshot.nElapsed && m_lastProgress.bIdle == snapshot.bIdle)
+        return;
+
+    m_lastProgress = snapshot;
+    emit progressChanged(snapshot.nDuration, snapshot.nElapsed);
+}
+
+ProgressRefresher::Snapshot ProgressRefresher::current() const
+{
+    Snapshot snapshot;
+    snapshot.nDuration = m_pEngine->duration();
+    snapshot.nElapsed = m_pEngine->elapsed();
+    snapshot.bIdle = m_pEngine->state() == PlayerEngine::CoreState::Idle;
+    snapshot.bValid = true;
+    return snapshot;
+}
+
+}
@@ -0,0 +1,87 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+/**
+ * @file 播放进度的界面刷新调度
+ * 播放引擎每帧都发出elapsedChanged，这里合并同一周期内的通知：
+ * 时间文字按REFRESH_TEXT_INTERVAL刷新，进度条按屏幕刷新率刷新，
+ * 数值未变化时不发出信号；工具栏隐藏或窗口最小化时暂停，恢复显示后立即刷新一次
+ */
+#ifndef _DMR_PROGRESS_REFRESHER_H
+#define _DMR_PROGRESS_REFRESHER_H
+
+#include <QObject>
+#include <QTimer>
+
+class QWidget;
+
+namespace dmr {
+
+class PlayerEngine;
+
+class ProgressRefresher: public QObject
+{
+    Q_OBJECT
+public:
+    /**
+     * @param pOwner 显示进度的控件，其隐藏或所在窗口最小化时暂停刷新
+     * @param pEngine 播放引擎
+     */
+    ProgressRefresher(QWidget *pOwner, PlayerEngine *pEngine);
+
+    /**
+     * @brief 忘记上次发出的数值，下个周期无论是否变化都发出信号
+     */
+    void invalidate();
+    /**
+     * @brief 屏幕刷新周期(ms)
+     */
+    int frameInterval() const;
+
+signals:
+    /**
+     * @brief 时间文字需要刷新
+     * @param nDuration 总时长
+     * @param nElapsed 当前播放时间
+     */
+    void timeChanged(qint64 nDuration, qint64 nElapsed);
+    /**
+     * @brief 进度条需要刷新
+     */
+    void progressChanged(qint64 nDuration, qint64 nElapsed);
+
+public slots:
+    /**
+     * @brief 播放进度或时长变化，只安排刷新，不读取播放引擎
+     */
+    void requestRefresh();
+
+protected:
+    bool eventFilter(QObject *pObject, QEvent *pEvent) override;
+
+private:
+    bool isActive() const;
+    void refreshTime();
+    void refreshProgress();
+
+private:
+    struct Snapshot {
+        qint64 nDuration {-1};
+        qint64 nElapsed {-1};
+        bool bIdle {true};
+        bool bValid {false};
+    };
+
+    Snapshot current() const;
+
+    QWidget *m_pOwner;
+    PlayerEngine *m_pEngine;
+    QTimer m_textTimer;             //时间文字刷新定时器
+    QTimer m_progressTimer;         //进度条刷新定时器
+    Snapshot m_lastText;            //上次发出timeChanged时的进度
+    Snapshot m_lastProgress;        //上次发出progressChanged时的进度
+};
+
+}
+
+#endif /* ifndef _DMR_PROGRESS_REFRESHER_H */
@@ -17,6 +17,8 @@
 #include "tip.h"
 #include "utils.h"
 #include "filefilter.h"
+#include "film_strip.h"
+#include "progress_refresher.h"
 
 //#include <QtWidgets>
 #include <DImageButton>
@@ -38,6 +40,7 @@ static const int RIGHT_MARGIN = 10;
 static const QString SLIDER_ARROW = ":resources/icons/slider.svg";
 
 #define POPUP_DURATION 350
+#define SPRITE_PREPARE_RANGE 3  //预生成悬停预览图集时当前文件前后各取的条目数
 
 DWIDGET_USE_NAMESPACE
 
@@ -292,6 +295,9 @@ public:
         m_pFront->setFixedWidth(0);
         m_pFront->setContentsMargins(0, 0, 0, 0);
 
+        m_pStrip = new FilmStripItem(m_pBack);
+        m_pStripBlack = new FilmStripItem(m_pFront);
+
         m_pIndicator = new IndicatorItem(this);
         m_pIndicator->resize(5, 52);
         m_pIndicator->setObjectName("indicator");
@@ -375,50 +381,31 @@ public:
     /**
      * @brief setViewProgBar 设置胶片模式位置
      * @param pEngine 播放引擎对象指针
-     * @param pmList 彩色胶片图像列表
-     * @param pmBlackList 灰色胶片图像列表
+     * @param strip 彩色胶片条
+     * @param stripBlack 灰色胶片条
+     * @param nCount 胶片数量
      */
-    void setViewProgBar(PlayerEngine *pEngine, QList<QPixmap> pmList, QList<QPixmap> pmBlackList)
+    void setViewProgBar(PlayerEngine *pEngine, const QImage &strip, const QImage &stripBlack, int nCount)
     {
         m_pEngine = pEngine;
 
-        m_pViewProgBarLayout->setAlignment(Qt::AlignHCenter | Qt::AlignTop);
-        m_pViewProgBarLayout->setSpacing(1);
-
-        /*这段代码将胶片添加到两个label中，一个label置灰，一个彩色，通过光标调整两个label的位置
+        /*胶片分别绘制在彩色和置灰两个胶片条中，通过光标调整置灰胶片条的显示宽度
          *以实现通过光标来显示播放过的位置
          */
         const int nPixWidget = 42/*m_pProgBar->width() / 100*/;
-        m_nViewLength = (nPixWidget + 1) * pmList.count() - 1;
+        m_nViewLength = (nPixWidget + 1) * nCount - 1;
         m_nStartPoint = (m_pProgBar->width() - m_nViewLength) / 2; //开始位置
-        for (int i = 0; i < pmList.count(); i++) {
-            ImageItem *label = new ImageItem(pmList.at(i), false, m_pBack);
-            label->setMouseTracking(true);
-            label->move(i * (nPixWidget + 1) + m_nStartPoint, 5);
-            label->setFixedSize(nPixWidget, 42);
-
-            ImageItem *label_black = new ImageItem(pmBlackList.at(i), true, m_pFront);
-            label_black->setMouseTracking(true);
-            label_black->move(i * (nPixWidget + 1) + m_nStartPoint, 5);
-            label_black->setFixedSize(nPixWidget, 42);
-        }
+
+        m_pStrip->setStrip(strip, nCount, QSize(nPixWidget, 42), 1);
+        m_pStrip->move(m_nStartPoint, 5);
+        m_pStripBlack->setStrip(stripBlack, nCount, QSize(nPixWidget, 42), 1);
+        m_pStripBlack->move(m_nStartPoint, 5);
         update();
     }
     void clear()
     {
-        foreach (QLabel *label, m_pFront->findChildren<QLabel *>()) {
-            if (label) {
-                label->deleteLater();
-                label = nullptr;
-            }
-        }
-
-        foreach (QLabel *label, m_pBack->findChildren<QLabel *>()) {
-            if (label) {
-                label->deleteLater();
-                label = nullptr;
-            }
-        }
+        m_pStrip->clear();
+        m_pStripBlack->clear();
 
         m_pSliderTime->setVisible(false);
         m_pSliderArrowDown->setVisible(false);
@@ -573,6 +560,8 @@ private:
 //        m_pViewProgBarLoad = nullptr;
         m_pBack = nullptr;
         m_pFront = nullptr;
+        m_pStrip = nullptr;
+        m_pStripBlack = nullptr;
         m_pIndicator  = nullptr;
         m_pSliderTime = nullptr;
         m_pSliderArrowDown = nullptr;
@@ -600,6 +589,8 @@ private:
 //    viewProgBarLoad *m_pViewProgBarLoad;
     QWidget *m_pBack;
     QWidget *m_pFront;
+    FilmStripItem *m_pStrip;       ///彩色胶片条
+    FilmStripItem *m_pStripBlack;  ///灰色胶片条
     IndicatorItem *m_pIndicator;
     SliderTime *m_pSliderTime;
     DLabel *m_pSliderArrowDown;
@@ -758,41 +749,6 @@ private:
     bool m_bIsWM{false};
 };
 
-static QString libPath(const QString &strlib)
-{
-    QDir  dir;
-    QString path  = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
-    dir.setPath(path);
-    QStringList list = dir.entryList(QStringList() << (strlib + "*"), QDir::NoDotAndDotDot | QDir::Files); //filter name with strlib
-    if (list.contains(strlib)) {
-        return strlib;
-    } else {
-        list.sort();
-    }
-
-    Q_ASSERT(list.size() > 0);
-    return list.last();
-}
-
-void viewProgBarLoad::initThumb()
-{
-    QLibrary library(CompositingManager::libPath("libffmpegthumbnailer.so"));
-    m_mvideo_thumbnailer = (mvideo_thumbnailer) library.resolve("video_thumbnailer_create");
-    m_mvideo_thumbnailer_destroy = (mvideo_thumbnailer_destroy) library.resolve("video_thumbnailer_destroy");
-    m_mvideo_thumbnailer_create_image_data = (mvideo_thumbnailer_create_image_data) library.resolve("video_thumbnailer_create_image_data");
-    m_mvideo_thumbnailer_destroy_image_data = (mvideo_thumbnailer_destroy_image_data) library.resolve("video_thumbnailer_destroy_image_data");
-    m_mvideo_thumbnailer_generate_thumbnail_to_buffer = (mvideo_thumbnailer_generate_thumbnail_to_buffer) library.resolve("video_thumbnailer_generate_thumbnail_to_buffer");
-
-    if (m_mvideo_thumbnailer == nullptr || m_mvideo_thumbnailer_destroy == nullptr
-            || m_mvideo_thumbnailer_create_image_data == nullptr || m_mvideo_thumbnailer_destroy_image_data == nullptr
-            || m_mvideo_thumbnailer_generate_thumbnail_to_buffer == nullptr)
-    {
-        return;
-    }
-
-    m_video_thumbnailer = m_mvideo_thumbnailer();
-}
-
 void viewProgBarLoad::initMember()
 {
     m_pEngine = nullptr;
@@ -803,67 +759,27 @@ void viewProgBarLoad::initMember()
 
 void viewProgBarLoad::loadViewProgBar(QSize size)
 {
-    int pixWidget =  40;
     int num = int(m_pProgBar->width() / (40 + 1)); //number of thumbnails
-    int tmp = (num == 0) ? 0: (m_pEngine->duration() * 1000) / num;
-
-    QList<QPixmap> pmList;
-    QList<QPixmap> pmBlackList;
-
-    QTime time(0, 0, 0, 0);
-    if (m_pEngine->videoSize().width() > 0 && m_pEngine->videoSize().height() > 0) {
-        m_video_thumbnailer->thumbnail_size = (static_cast<int>(50 * (m_pEngine->videoSize().width() / m_pEngine->videoSize().height() * 50)
-                                                                * qApp->devicePixelRatio()));
-    }
-
-    if (m_image_data == nullptr) {
-        m_image_data = m_mvideo_thumbnailer_create_image_data();
+    if (num <= 0) {
+        return;
     }
 
-//    m_video_thumbnailer->seek_time = d.toString("hh:mm:ss").toLatin1().data();
-    int length = strlen(time.toString("hh:mm:ss").toLatin1().data());
-    memcpy(m_seekTime, time.toString("hh:mm:ss").toLatin1().data(), length + 1);
-    m_video_thumbnailer->seek_time = m_seekTime;
-
     auto url = m_pEngine->playlist().currentInfo().url;
-    auto file = QFileInfo(url.toLocalFile()).absoluteFilePath();
+    QFileInfo fi(QFileInfo(url.toLocalFile()).absoluteFilePath());
 
-    for (auto i = 0; i < num ; i++) {
-        if (isInterruptionRequested()) {
-            qInfo() << "isInterruptionRequested";
-            return;
-        }
-
-        time = time.addMSecs(tmp);
-
-//        m_video_thumbnailer->seek_time = d.toString("hh:mm:ss").toLatin1().data();
-        memcpy(m_seekTime, time.toString("hh:mm:ss").toLatin1().data(), length + 1);
-        m_video_thumbnailer->seek_time = m_seekTime;
-        try {
-
-            m_mvideo_thumbnailer_generate_thumbnail_to_buffer(m_video_thumbnailer, file.toUtf8().data(),  m_image_data);
-            auto img = QImage::fromData(m_image_data->image_data_ptr, static_cast<int>(m_image_data->image_data_size), "png");
-            if (img.format() == QImage::Format_Invalid) {
-                return;
-            }
-            auto img_tmp = img.scaledToHeight(50);
-
-
-            pmList.append(QPixmap::fromImage(img_tmp.copy(img_tmp.size().width() / 2 - 4, 0, pixWidget, 50))); //-2 为了1px的内边框
-            QImage img_black = img_tmp.convertToFormat(QImage::Format_Grayscale8);
-            pmBlackList.append(QPixmap::fromImage(img_black.copy(img_black.size().width() / 2 - 4, 0, pixWidget, 50)));
-
-        } catch (const std::logic_error &) {
-
-        }
+    //按物理像素生成，每张胶片取画面中间40x50
+    const QSize sliceSize = QSize(40, 50) * qApp->devicePixelRatio();
+    QImage strip = FilmStrip::get().generate(fi, num, sliceSize, [this]() {
+        return isInterruptionRequested();
+    });
+    if (strip.isNull()) {
+        qInfo() << "film strip is not loaded" << isInterruptionRequested();
+        return;
     }
-
-    m_mvideo_thumbnailer_destroy_image_data(m_image_data);
-    m_image_data = nullptr;
+    QImage stripBlack = strip.convertToFormat(QImage::Format_Grayscale8);
 
     m_pListPixmapMutex->lock();
-    m_pParent->addpmList(pmList);
-    m_pParent->addpmBlackList(pmBlackList);
+    m_pParent->setFilmStrip(strip, stripBlack, num);
     m_pListPixmapMutex->unlock();
     emit sigFinishiLoad(size);
 //    emit finished();
@@ -903,11 +819,16 @@ void ToolboxProxy::finishLoadSlot(QSize size)
 {
     qInfo() << "thumbnail has finished";
 
-    if (m_pmList.isEmpty()) return;
     if (!m_bThumbnailmode) {
         return;
     }
-    m_pViewProgBar->setViewProgBar(m_pEngine, m_pmList, m_pmBlackList);
+    m_listPixmapMutex.lock();
+    QImage strip = m_filmStrip;
+    QImage stripBlack = m_filmStripBlack;
+    int nCount = m_nFilmStripCount;
+    m_listPixmapMutex.unlock();
+    if (strip.isNull()) return;
+    m_pViewProgBar->setViewProgBar(m_pEngine, strip, stripBlack, nCount);
 
     if(CompositingManager::get().platform() == Platform::X86) {
         if (m_pEngine->state() != PlayerEngine::CoreState::Idle) {
@@ -1254,8 +1175,15 @@ void ToolboxProxy::setup()
     connect(m_pEngine, &PlayerEngine::stateChanged, this, &ToolboxProxy::updatePlayState);
     connect(m_pEngine, &PlayerEngine::stateChanged, this, &ToolboxProxy::updateButtonStates);   // 控件状态变化由updateButtonStates统一处理
     connect(m_pEngine, &PlayerEngine::fileLoaded, this, &ToolboxProxy::slotFileLoaded);
-    connect(m_pEngine, &PlayerEngine::elapsedChanged, this, &ToolboxProxy::slotElapsedChanged);
-    connect(m_pEngine, &PlayerEngine::updateDuration, this, &ToolboxProxy::slotElapsedChanged);
+    //播放进度每帧都会变化，由刷新调度合并后按显示需要的频率更新时间和进度条
+    m_pProgressRefresher = new ProgressRefresher(this, m_pEngine);
+    connect(m_pProgressRefresher, &ProgressRefresher::timeChanged, this, &ToolboxProxy::slotElapsedChanged);
+    connect(m_pProgressRefresher, &ProgressRefresher::progressChanged, this, [ = ](qint64 nDuration, qint64 nElapsed) {
+        //投屏时进度条跟随投屏设备，不使用本地播放进度
+        if(m_mircastWidget->getMircastState() != MircastWidget::Idel)
+            return;
+        updateMovieProgress(nDuration, nElapsed);
+    });
 
     connect(window()->windowHandle(), &QWindow::windowStateChanged, this, &ToolboxProxy::updateFullState);
 
@@ -1297,8 +1225,9 @@ void ToolboxProxy::updatePreviewTime(qint64 secs, const QPoint &pos)
 
 void ToolboxProxy::initMember()
 {
-    m_pmList.clear();
-    m_pmBlackList.clear();
+    m_filmStrip = QImage();
+    m_filmStripBlack = QImage();
+    m_nFilmStripCount = 0;
 
     m_pPlaylist = nullptr;
 
@@ -1335,6 +1264,7 @@ void ToolboxProxy::initMember()
     m_pmiracastBtnTip = nullptr;
 
     m_pWorker = nullptr;
+    m_pProgressRefresher = nullptr;
     m_pPaOpen = nullptr;
     m_pPaClose = nullptr;
 
@@ -1575,6 +1505,8 @@ void ToolboxProxy::slotSliderPressed()
 void ToolboxProxy::slotSliderReleased()
 {
     m_bMousePree = false;
+    //拖动期间进度条未随播放更新，下个周期强制刷新
+    m_pProgressRefresher->invalidate();
     if (m_mircastWidget->getMircastState() == MircastWidget::Screening)
         m_mircastWidget->slotSeekMircast(m_pProgBar->slider()->sliderPosition());
     else
@@ -1612,6 +1544,29 @@ void ToolboxProxy::slotFileLoaded()
     m_pProgBar->slider()->setRange(0, static_cast<int>(m_pEngine->duration()));
     m_pProgBar_Widget->setCurrentIndex(1);
     update();
+    //后台为当前文件及播放列表中前后相邻的本地视频预生成悬停预览图集，
+    //只取固定范围，避免大播放列表每次加载文件都遍历全部条目
+    if (CompositingManager::isMpvExists() && Settings::get().isSet(Settings::PreviewOnMouseover)
+            && !m_pEngine->currFileIsAudio()) {
+        const QList<PlayItemInfo> &listItem = m_pEngine->playlist().items();
+        const int nCurrent = m_pEngine->playlist().current();
+        QList<QUrl> listUrl;
+        QSet<QUrl> setUrl;
+        listUrl << m_pEngine->playlist().currentInfo().url;
+        setUrl << listUrl.first();
+        for (int i = 1; i <= SPRITE_PREPARE_RANGE; i++) {
+            for (int nIndex : {nCurrent + i, nCurrent - i}) {
+                if (nIndex < 0 || nIndex >= listItem.size())
+                    continue;
+                const PlayItemInfo &info = listItem[nIndex];
+                if (info.url.isLocalFile() && info.mi.vCodecID != -1 && !setUrl.contains(info.url)) {
+                    setUrl.insert(info.url);
+                    listUrl << info.url;
+                }
+            }
+        }
+        ThumbnailWorker::get().prepareSprites(listUrl);
+    }
     //正在投屏时如果当前播放为音频直接播放下一首。
     if(m_pEngine->currFileIsAudio()&&m_mircastWidget->getMircastState() != MircastWidget::Idel) {
         //如果全是音频文件则退出投屏
@@ -1670,17 +1625,16 @@ void ToolboxProxy::slotFileLoaded()
     m_mircastWidget->playNext();
 }
 
-void ToolboxProxy::slotElapsedChanged()
+void ToolboxProxy::slotElapsedChanged(qint64 nDuration, qint64 nElapsed)
 {
     if(m_mircastWidget->getMircastState() != MircastWidget::Idel)
         return;
     quint64 url = static_cast<quint64>(-1);
     if (m_pEngine->playlist().current() != -1) {
-        url = static_cast<quint64>(m_pEngine->duration());
+        url = static_cast<quint64>(nDuration);
     }
     //TODO(xxxpengfei):此处代码同时更新全屏的时长并未判断全屏状态，请维护同事查看是否存在优化空间
-    updateTimeInfo(static_cast<qint64>(url), m_pEngine->elapsed(), m_pTimeLabel, m_pTimeLabelend, true);
-    updateMovieProgress();
+    updateTimeInfo(static_cast<qint64>(url), nElapsed, m_pTimeLabel, m_pTimeLabelend, true);
 }
 
 void ToolboxProxy::slotApplicationStateChanged(Qt::ApplicationState e)
@@ -1722,8 +1676,9 @@ void ToolboxProxy::slotUpdateThumbnailTimeOut()
 
     m_pViewProgBar->clear();  //清除前一次进度条中的缩略图,以便显示新的缩略图
     m_listPixmapMutex.lock();
-    m_pmList.clear();
-    m_pmBlackList.clear();
+    m_filmStrip = QImage();
+    m_filmStripBlack = QImage();
+    m_nFilmStripCount = 0;
     m_listPixmapMutex.unlock();
 
     if (m_pWorker == nullptr) {
@@ -1910,11 +1865,16 @@ void ToolboxProxy::updateTimeVisible(bool visible)
 }
 
 void ToolboxProxy::updateMovieProgress()
+{
+    updateMovieProgress(m_pEngine->duration(), m_pEngine->elapsed());
+}
+
+void ToolboxProxy::updateMovieProgress(qint64 nDuration, qint64 nElapsed)
 {
     if (m_bMousePree == true)
         return ;
-    auto d = m_pEngine->duration();
-    auto e = m_pEngine->elapsed();
+    auto d = nDuration;
+    auto e = nElapsed;
     if (d > m_pProgBar->maximum()) {
         d = m_pProgBar->maximum();
     }
@@ -2619,8 +2579,6 @@ viewProgBarLoad::viewProgBarLoad(PlayerEngine *engine, DMRSlider *progBar, Toolb
     m_pParent = parent;
     m_pEngine = engine;
     m_pProgBar = progBar;
-    m_seekTime = new char[12];
-    initThumb();
 }
 
 void viewProgBarLoad::setListPixmapMutex(QMutex *pMutex)
@@ -2635,13 +2593,6 @@ void viewProgBarLoad::run()
 
 viewProgBarLoad::~viewProgBarLoad()
 {
-    delete [] m_seekTime;
-    m_seekTime = nullptr;
-
-    if (m_video_thumbnailer != nullptr) {
-        m_mvideo_thumbnailer_destroy(m_video_thumbnailer);
-        m_video_thumbnailer = nullptr;
-    }
 }
 
 }
@@ -41,6 +41,7 @@ DWIDGET_USE_NAMESPACE
 
 namespace dmr {
 class PlayerEngine;
+class ProgressRefresher;
 class VolumeButton;
 class ToolButton;
 class MainWindow;
@@ -52,18 +53,43 @@ class VolumeSlider;
 class ViewProgBar;
 class viewProgBarLoad;
 class PlaylistWidget;
-class ImageItem : public DLabel
+class FilmStripItem : public QWidget
 {
     Q_OBJECT
 public:
     /**
-     * @brief ImageItem 实现胶片整体的窗口布局
-     * @param image 胶片
-     * @param bIsblack 是否为灰色胶片
+     * @brief FilmStripItem 实现胶片整体的窗口布局
+     * 所有胶片绘制在一张缓存图像中，主题或尺寸变化时才重新生成
      * @param parent 父窗口
      */
-    ImageItem(QPixmap image, bool bIsblack = false, QWidget *parent = nullptr): DLabel(parent), m_pixmap(image)
+    explicit FilmStripItem(QWidget *parent = nullptr): QWidget(parent)
     {
+        setMouseTracking(true);
+        connect(DGuiApplicationHelper::instance(), &DGuiApplicationHelper::themeTypeChanged, this, [ = ] {
+            m_cache = QPixmap();
+            update();
+        });
+    }
+    /**
+     * @brief setStrip 设置胶片条
+     * @param strip 横向拼接的胶片图像
+     * @param nCount 胶片数量
+     * @param itemSize 单张胶片显示尺寸
+     * @param nSpacing 胶片间隔
+     */
+    void setStrip(const QImage &strip, int nCount, const QSize &itemSize, int nSpacing)
+    {
+        m_strip = strip;
+        m_nCount = nCount;
+        m_itemSize = itemSize;
+        m_nSpacing = nSpacing;
+        m_cache = QPixmap();
+        setFixedSize(nCount > 0 ? (itemSize.width() + nSpacing) * nCount - nSpacing : 0, itemSize.height());
+        update();
+    }
+    void clear()
+    {
+        setStrip(QImage(), 0, QSize(), 0);
     }
 protected:
     /**
@@ -71,43 +97,58 @@ protected:
      */
     void paintEvent(QPaintEvent *)
     {
-        QPainter painter(this);
-        painter.setRenderHints(QPainter::HighQualityAntialiasing | QPainter::SmoothPixmapTransform |
-                               QPainter::Antialiasing);
-
-        QSize size(m_pixmap.size());
-        QBitmap mask(size);
+        if (m_nCount <= 0 || m_strip.isNull())
+            return;
 
-        QPainter painter1(&mask);
-        painter1.setRenderHints(QPainter::HighQualityAntialiasing | QPainter::SmoothPixmapTransform |
-                                QPainter::Antialiasing);
-        painter1.fillRect(mask.rect(), Qt::white);
-        painter1.setBrush(QColor(0, 0, 0));
-        painter1.drawRoundedRect(mask.rect(), 5, 5);
+        if (m_cache.isNull() || m_cache.size() != size() * devicePixelRatioF())
+            render();
 
-        QPixmap image = m_pixmap;
-        image.setMask(mask);
-
-        painter.setClipping(true);
-        QPainterPath bg0;
-        bg0.addRoundedRect(rect(), 5, 5);
-        painter.setClipPath(bg0);
-        painter.drawPixmap(rect(), image);
+        QPainter painter(this);
+        painter.drawPixmap(0, 0, m_cache);
+    }
+private:
+    /**
+     * @brief render 将所有胶片绘制成带圆角和边框的缓存图像
+     */
+    void render()
+    {
+        const qreal dpr = devicePixelRatioF();
+        m_cache = QPixmap(size() * dpr);
+        m_cache.setDevicePixelRatio(dpr);
+        m_cache.fill(Qt::transparent);
 
+        QPainter painter(&m_cache);
+        painter.setRenderHints(QPainter::HighQualityAntialiasing | QPainter::SmoothPixmapTransform |
+                               QPainter::Antialiasing);
         QPen pen;
         pen.setWidth(2);
         if (DGuiApplicationHelper::LightType == DGuiApplicationHelper::instance()->themeType()) {
             pen.setColor(QColor(0, 0, 0, int(0.1 * 255)));
-            painter.setPen(pen);
-        } else if (DGuiApplicationHelper::DarkType == DGuiApplicationHelper::instance()->themeType()) {
+        } else {
             pen.setColor(QColor(255, 255, 255, int(0.1 * 255)));
+        }
+
+        const int nSliceWidth = m_strip.width() / m_nCount;
+        for (int i = 0; i < m_nCount; i++) {
+            QRect rect(QPoint(i * (m_itemSize.width() + m_nSpacing), 0), m_itemSize);
+            QPainterPath path;
+            path.addRoundedRect(rect, 5, 5);
+
+            painter.setClipPath(path);
+            painter.drawImage(rect, m_strip, QRect(i * nSliceWidth, 0, nSliceWidth, m_strip.height()));
+            painter.setClipping(false);
+
             painter.setPen(pen);
+            painter.setBrush(Qt::NoBrush);
+            painter.drawRoundedRect(rect, 5, 5);
         }
-        painter.setBrush(Qt::NoBrush);
-        painter.drawRoundedRect(rect(), 5, 5);
     }
-private:
-    QPixmap m_pixmap;    ///胶片的图像
+
+    QImage m_strip;          ///横向拼接的胶片图像
+    int m_nCount {0};        ///胶片数量
+    QSize m_itemSize;        ///单张胶片显示尺寸
+    int m_nSpacing {0};      ///胶片间隔
+    QPixmap m_cache;         ///绘制好的胶片条
 };
 
 /**
@@ -221,22 +262,16 @@ public:
      */
     void setPlaylist(PlaylistWidget *pPlaylist);
     /**
-     * @brief addpmList 将读取到的缩略图加载到列表中
-     * @param pm 缩略图图像
+     * @brief setFilmStrip 设置读取到的胶片条
+     * @param strip 彩色胶片条
+     * @param stripBlack 灰色胶片条
+     * @param nCount 胶片数量
      */
-    void addpmList(QList<QPixmap> &pm)
+    void setFilmStrip(const QImage &strip, const QImage &stripBlack, int nCount)
     {
-        m_pmList.clear();
-        m_pmList.append(pm);
-    }
-    /**
-     * @brief addpmBlackList 将读取到的缩略图加载到灰色列表中
-     * @param pm_black 缩略图图像
-     */
-    void addpmBlackList(QList<QPixmap> &pmBlack)
-    {
-        m_pmBlackList.clear();
-        m_pmBlackList.append(pmBlack);
+        m_filmStrip = strip;
+        m_filmStripBlack = stripBlack;
+        m_nFilmStripCount = nCount;
     }
     /**
      * @brief setVolSliderHide 将音量条控件隐藏
@@ -426,6 +461,12 @@ protected slots:
      * @brief updateMovieProgress 更新影片进度条
      */
     void updateMovieProgress();
+    /**
+     * @brief updateMovieProgress 按给定的时长和播放时间更新影片进度条
+     * @param nDuration 视频总时长
+     * @param nElapsed 当前播放的时间点
+     */
+    void updateMovieProgress(qint64 nDuration, qint64 nElapsed);
     /**
      * @brief updateButtonStates
      */
@@ -481,9 +522,11 @@ protected slots:
      */
     void slotFileLoaded();
     /**
-     * @brief slotElapsedChanged 当前播放时长变化槽函数
+     * @brief slotElapsedChanged 当前播放时长变化槽函数，由刷新调度按固定频率调用
+     * @param nDuration 视频总时长
+     * @param nElapsed 当前播放的时间点
      */
-    void slotElapsedChanged();
+    void slotElapsedChanged(qint64 nDuration, qint64 nElapsed);
     /**
      * @brief slotApplicationStateChanged 应用状态变化才敢三个月
      * @param e 状态
@@ -567,6 +610,7 @@ private:
 
     MainWindow *m_pMainWindow;          ///主窗口
     PlayerEngine *m_pEngine;            ///播放引擎
+    ProgressRefresher *m_pProgressRefresher; ///播放进度刷新调度
     PlaylistWidget *m_pPlaylist;        ///播放列表窗口
 
     DWidget *m_pProgBarspec;             ///空白进度条窗口
@@ -608,8 +652,9 @@ private:
     QPropertyAnimation *m_pPaOpen;       ///工具栏升起动画
     QPropertyAnimation *m_pPaClose;      ///工具栏降下动画
 
-    QList<QPixmap > m_pmList;
-    QList<QPixmap > m_pmBlackList;
+    QImage m_filmStrip;             ///彩色胶片条
+    QImage m_filmStripBlack;        ///灰色胶片条
+    int m_nFilmStripCount;          ///胶片数量
 
     QMutex m_listPixmapMutex;       ///缩略图list的锁
 
@@ -683,10 +728,6 @@ signals:
 protected:
     void run();
 private:
-    /**
-     * @brief initThumb 动态初始化缩略图获取
-     */
-    void initThumb();
     /**
      * @brief initMember 初始化成员变量
      */
@@ -696,16 +737,6 @@ private:
     ToolboxProxy *m_pParent;      ///主窗口
     DMRSlider *m_pProgBar;        ///胶片模式窗口
     QMutex *m_pListPixmapMutex;   ///线程锁
-    char *m_seekTime;             ///图像时间
-
-    video_thumbnailer *m_video_thumbnailer = nullptr;
-    image_data *m_image_data = nullptr;
-    mvideo_thumbnailer m_mvideo_thumbnailer = nullptr;
-    mvideo_thumbnailer_destroy m_mvideo_thumbnailer_destroy = nullptr;
-    mvideo_thumbnailer_create_image_data m_mvideo_thumbnailer_create_image_data = nullptr;
-    mvideo_thumbnailer_destroy_image_data m_mvideo_thumbnailer_destroy_image_data = nullptr;
-    mvideo_thumbnailer_generate_thumbnail_to_buffer m_mvideo_thumbnailer_generate_thumbnail_to_buffer = nullptr;
-
 };
 }
 
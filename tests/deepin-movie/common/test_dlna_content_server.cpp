@@ -0,0 +1,291 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QTest>
+#include <QTcpSocket>
+#include <QTemporaryFile>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "dlna/dlnacontentserver.h"
+
+#define TEST_FILE_SIZE (4 * 1024 * 1024)
+#define STRESS_CLIENTS 8
+#define STRESS_REQUESTS 16
+
+/**
+ * @brief patternByte 文件内容由位置和种子决定，便于校验收到的区间
+ */
+static char patternByte(qint64 nPos, int nSeed)
+{
+    return static_cast<char>((nPos * 31 + nSeed) % 251);
+}
+
+static QByteArray expectedRange(qint64 nStart, qint64 nLength, int nSeed)
+{
+    QByteArray data(static_cast<int>(nLength), 0);
+    for (int i = 0; i < data.size(); i++) {
+        data[i] = patternByte(nStart + i, nSeed);
+    }
+    return data;
+}
+
+/**
+ * @brief createTestFile 生成测试文件
+ */
+static bool createTestFile(QTemporaryFile &file, int nSeed)
+{
+    if (!file.open())
+        return false;
+    const int nBlock = 64 * 1024;
+    for (qint64 nPos = 0; nPos < TEST_FILE_SIZE; nPos += nBlock) {
+        file.write(expectedRange(nPos, nBlock, nSeed));
+    }
+    return file.flush();
+}
+
+/**
+ * @brief 在系统分配的端口上启动服务，析构时关闭并释放
+ */
+class TestServer
+{
+public:
+    TestServer()
+    {
+        m_pServer = new DlnaContentServer(nullptr, 0);
+        QElapsedTimer wait;
+        wait.start();
+        while (!m_pServer->getIsStartHttpServer() && wait.elapsed() < 3000) {
+            QTest::qWait(20);
+        }
+        if (m_pServer->getIsStartHttpServer())
+            m_pServer->setBaseUrl(QString("http://127.0.0.1:%1/").arg(port()));
+    }
+    ~TestServer()
+    {
+        QMetaObject::invokeMethod(m_pServer, "closeServer", Qt::BlockingQueuedConnection);
+        delete m_pServer;
+    }
+
+    DlnaContentServer *operator->() const
+    {
+        return m_pServer;
+    }
+    bool isStarted() const
+    {
+        return m_pServer->getIsStartHttpServer() && port() > 0;
+    }
+    quint16 port() const
+    {
+        return static_cast<quint16>(m_pServer->serverPort());
+    }
+
+private:
+    DlnaContentServer *m_pServer;
+};
+
+struct HttpReply {
+    int nStatus {-1};
+    QByteArray body;
+};
+
+/**
+ * @brief request 在已连接的套接字上发送一次请求并读完应答
+ * @param sPath 请求路径
+ * @param sRange Range头，为空时不发送
+ * @return 应答，出错时nStatus为-1
+ */
+static HttpReply request(QTcpSocket &socket, const QString &sPath, const QString &sRange)
+{
+    QString sRequest = QString("GET %1 HTTP/1.1\r\nHost: 127.0.0.1\r\n").arg(sPath);
+    if (!sRange.isEmpty())
+        sRequest += QString("Range: %1\r\n").arg(sRange);
+    socket.write((sRequest + "\r\n").toLatin1());
+
+    HttpReply reply;
+    QByteArray header;
+    qint64 nContentLength = -1;
+    while (nContentLength < 0 || reply.body.size() < nContentLength) {
+        if (!socket.bytesAvailable() && !socket.waitForReadyRead(5000))
+            return HttpReply();
+
+        QByteArray data = socket.read(nContentLength < 0 ? socket.bytesAvailable()
+                                                         : qMin(socket.bytesAvailable(), nContentLength - reply.body.size()));
+        if (nContentLength < 0) {
+            header.append(data);
+            int nPos = header.indexOf("\r\n\r\n");
+            if (nPos < 0)
+                continue;
+            data = header.mid(nPos + 4);
+            header.truncate(nPos);
+            QList<QByteArray> lines = header.split('\n');
+            reply.nStatus = lines.first().split(' ').value(1).toInt();
+            for (const QByteArray &line : lines) {
+                if (line.toLower().startsWith("content-length:"))
+                    nContentLength = line.mid(line.indexOf(':') + 1).trimmed().toLongLong();
+            }
+            if (nContentLength < 0)
+                return HttpReply();
+        }
+        reply.body.append(data);
+    }
+
+    return reply;
+}
+
+static HttpReply requestRange(QTcpSocket &socket, const QString &sPath, qint64 nStart, qint64 nLength)
+{
+    return request(socket, sPath, nLength > 0 ? QString("bytes=%1-%2").arg(nStart).arg(nStart + nLength - 1)
+                                               : QString("bytes=%1-").arg(nStart));
+}
+
+TEST(DlnaContentServer, rangeContent)
+{
+    QTemporaryFile file;
+    ASSERT_TRUE(createTestFile(file, 0));
+
+    TestServer server;
+    ASSERT_TRUE(server.isStarted());
+    const QString sPath = QUrl(server->publishFile(file.fileName())).path();
+
+    QTcpSocket socket;
+    socket.connectToHost("127.0.0.1", server.port());
+    ASSERT_TRUE(socket.waitForConnected(3000));
+
+    //完整文件
+    HttpReply reply = request(socket, sPath, QString());
+    EXPECT_EQ(reply.nStatus, 200);
+    EXPECT_EQ(reply.body.size(), TEST_FILE_SIZE);
+    EXPECT_TRUE(reply.body == expectedRange(0, TEST_FILE_SIZE, 0));
+
+    //随机seek，复用同一连接
+    for (int i = 1; i <= 16; i++) {
+        const qint64 nStart = static_cast<qint64>(TEST_FILE_SIZE) / 17 * i + i;
+        reply = requestRange(socket, sPath, nStart, 64 * 1024);
+        EXPECT_EQ(reply.nStatus, 206);
+        EXPECT_TRUE(reply.body == expectedRange(nStart, 64 * 1024, 0)) << "range start" << nStart;
+    }
+
+    //到文件结尾的区间
+    reply = requestRange(socket, sPath, TEST_FILE_SIZE - 1000, 0);
+    EXPECT_EQ(reply.nStatus, 206);
+    EXPECT_TRUE(reply.body == expectedRange(TEST_FILE_SIZE - 1000, 1000, 0));
+
+    //越界区间
+    reply = request(socket, sPath, QString("bytes=%1-").arg(TEST_FILE_SIZE * 2));
+    EXPECT_EQ(reply.nStatus, 416);
+    EXPECT_TRUE(reply.body.isEmpty());
+
+    //取消发布后返回404，不再回退到其他文件
+    server->unpublishFile(file.fileName());
+    EXPECT_EQ(request(socket, sPath, QString()).nStatus, 404);
+    EXPECT_EQ(request(socket, "/test.mkv", QString()).nStatus, 404);
+}
+
+TEST(DlnaContentServer, concurrentRangeClients)
+{
+    QTemporaryFile firstFile;
+    QTemporaryFile secondFile;
+    ASSERT_TRUE(createTestFile(firstFile, 0));
+    ASSERT_TRUE(createTestFile(secondFile, 1));
+
+    TestServer server;
+    ASSERT_TRUE(server.isStarted());
+    const quint16 nPort = server.port();
+    QStringList listPath;
+    listPath << QUrl(server->publishFile(firstFile.fileName())).path()
+             << QUrl(server->publishFile(secondFile.fileName())).path();
+    EXPECT_NE(listPath[0], listPath[1]);
+    EXPECT_EQ(QUrl(server->publishFile(firstFile.fileName())).path(), listPath[0]);
+
+    //未发布的路径返回404，连接保持可用
+    {
+        QTcpSocket socket;
+        socket.connectToHost("127.0.0.1", nPort);
+        ASSERT_TRUE(socket.waitForConnected(3000));
+        EXPECT_EQ(request(socket, "/unknown.mkv", QString()).nStatus, 404);
+        HttpReply reply = requestRange(socket, listPath[1], 1000, 1000);
+        EXPECT_EQ(reply.nStatus, 206);
+        EXPECT_TRUE(reply.body == expectedRange(1000, 1000, 1));
+    }
+
+    //每个客户端在一条持久连接上交替请求两个发布文件的随机区间，校验内容来自正确的文件和位置
+    std::atomic<int> nFailed(0);
+    std::vector<std::thread> clients;
+    for (int nClient = 0; nClient < STRESS_CLIENTS; nClient++) {
+        clients.emplace_back([&, nClient]() {
+            QTcpSocket socket;
+            socket.connectToHost("127.0.0.1", nPort);
+            if (!socket.waitForConnected(3000)) {
+                nFailed++;
+                return;
+            }
+            for (int i = 0; i < STRESS_REQUESTS; i++) {
+                const qint64 nLength = 256 * 1024;
+                const qint64 nStart = (static_cast<qint64>(nClient) * 7919 + i * 104729) * 4096
+                                      % (TEST_FILE_SIZE - nLength);
+                HttpReply reply = requestRange(socket, listPath[i % 2], nStart, nLength);
+                if (reply.nStatus != 206 || reply.body != expectedRange(nStart, nLength, i % 2)) {
+                    nFailed++;
+                    return;
+                }
+            }
+        });
+    }
+    for (std::thread &client : clients) {
+        client.join();
+    }
+    EXPECT_EQ(nFailed, 0);
+}
+
+TEST(DlnaContentServer, loopbackBenchmark)
+{
+    QTemporaryFile file;
+    ASSERT_TRUE(createTestFile(file, 0));
+
+    TestServer server;
+    ASSERT_TRUE(server.isStarted());
+    const QString sPath = QUrl(server->publishFile(file.fileName())).path();
+
+    QTcpSocket socket;
+    socket.connectToHost("127.0.0.1", server.port());
+    ASSERT_TRUE(socket.waitForConnected(3000));
+
+    //持续传输：在同一连接上反复读取完整文件
+    const int nRounds = 16;
+    QElapsedTimer timer;
+    timer.start();
+    qint64 nBytes = 0;
+    for (int i = 0; i < nRounds; i++) {
+        HttpReply reply = request(socket, sPath, QString());
+        ASSERT_EQ(reply.nStatus, 200);
+        nBytes += reply.body.size();
+    }
+    const double dSecs = qMax<qint64>(timer.nsecsElapsed(), 1) / 1e9;
+    qInfo() << "dlna loopback throughput(MB/s):" << nBytes / dSecs / (1 << 20);
+    EXPECT_EQ(nBytes, static_cast<qint64>(TEST_FILE_SIZE) * nRounds);
+
+    //seek后首字节延迟：请求随机位置的小区间，取平均和最大值
+    const int nSeeks = 64;
+    qint64 nTotalNsecs = 0;
+    qint64 nMaxNsecs = 0;
+    for (int i = 0; i < nSeeks; i++) {
+        const qint64 nStart = (static_cast<qint64>(i) * 104729 * 4096 + i) % (TEST_FILE_SIZE - 4096);
+        timer.restart();
+        HttpReply reply = requestRange(socket, sPath, nStart, 1);
+        const qint64 nNsecs = timer.nsecsElapsed();
+        ASSERT_EQ(reply.nStatus, 206);
+        EXPECT_TRUE(reply.body == expectedRange(nStart, 1, 0));
+        nTotalNsecs += nNsecs;
+        nMaxNsecs = qMax(nMaxNsecs, nNsecs);
+    }
+    qInfo() << "dlna first byte after seek(ms): avg" << nTotalNsecs / 1e6 / nSeeks << "max" << nMaxNsecs / 1e6;
+}
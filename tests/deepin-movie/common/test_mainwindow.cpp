@@ -167,7 +167,7 @@ TEST(MainWindow, tabInteraction)
     VolumeButton *volBtn = toolboxProxy->volBtn();
     ToolButton *listBtn = toolboxProxy->listBtn();
     PlaylistWidget *playlistWidget;
-    DListWidget *playlist;
+    DListView *playlist;
     QList<QUrl> listPlayFiles;
     QTestEventList testEventList;
 
@@ -766,7 +766,7 @@ TEST(ToolBox, playListWidget)
     ToolboxProxy *toolboxProxy = w->toolbox();
     ToolButton *listBtn = toolboxProxy->listBtn();
     PlaylistWidget *playlistWidget = w->playlist();
-    DListWidget *playlist = playlistWidget->get_playlist();
+    DListView *playlist = playlistWidget->get_playlist();
     DFloatingButton *playItemCloseBtn;
     //playlist item event
     QEvent tooltipEvent(QEvent::ToolTip);
@@ -780,16 +780,16 @@ TEST(ToolBox, playListWidget)
     QTest::mouseMove(listBtn, QPoint(), 200);
     QTest::mouseClick(listBtn, Qt::LeftButton, Qt::NoModifier, QPoint(), 300);  //playlist popup
 
-    QTest::mouseMove(playlist->itemWidget(playlist->item(0)), QPoint(), 700);
+    QTest::mouseMove(playlist->viewport(), playlist->visualRect(playlist->model()->index(0, 0)).center(), 700);
     QTest::qWait(1000);
 //    QApplication::sendEvent(playlist->itemWidget(playlist->item(0)), &tooltipEvent);
-    QApplication::sendEvent(playlist->itemWidget(playlist->item(0)), &leaveEvent);
-    QTest::mouseMove(playlist->itemWidget(playlist->item(1)), QPoint(), 200);
-    QTest::mouseClick(playlist->itemWidget(playlist->item(1)), Qt::LeftButton, Qt::NoModifier, QPoint(), 200);
-    QTest::mouseMove(playlist->itemWidget(playlist->item(0)), QPoint(), 200);
-    QTest::mouseClick(playlist->itemWidget(playlist->item(0)), Qt::LeftButton, Qt::NoModifier, QPoint(), 200);
-    QTest::mouseMove(playlist->itemWidget(playlist->item(1)), QPoint(), 200);
-    QTest::mouseDClick(playlist->itemWidget(playlist->item(1)), Qt::LeftButton, Qt::NoModifier, QPoint(), 200);
+    QApplication::sendEvent(playlist->viewport(), &leaveEvent);
+    QTest::mouseMove(playlist->viewport(), playlist->visualRect(playlist->model()->index(1, 0)).center(), 200);
+    QTest::mouseClick(playlist->viewport(), Qt::LeftButton, Qt::NoModifier, playlist->visualRect(playlist->model()->index(1, 0)).center(), 200);
+    QTest::mouseMove(playlist->viewport(), playlist->visualRect(playlist->model()->index(0, 0)).center(), 200);
+    QTest::mouseClick(playlist->viewport(), Qt::LeftButton, Qt::NoModifier, playlist->visualRect(playlist->model()->index(0, 0)).center(), 200);
+    QTest::mouseMove(playlist->viewport(), playlist->visualRect(playlist->model()->index(1, 0)).center(), 200);
+    QTest::mouseDClick(playlist->viewport(), Qt::LeftButton, Qt::NoModifier, playlist->visualRect(playlist->model()->index(1, 0)).center(), 200);
 
     QTest::mouseMove(listBtn, QPoint(), 1000);
     QTest::mouseClick(listBtn, Qt::LeftButton, Qt::NoModifier, QPoint(), 200);  //playlist popup
@@ -809,8 +809,8 @@ TEST(ToolBox, playListWidget)
     QWheelEvent wheelEvent = QWheelEvent(point, 20, Qt::MidButton, Qt::NoModifier);
     QApplication::sendEvent(w, &wheelEvent);
 
-    QTest::mouseMove(playlist->itemWidget(playlist->item(0)), QPoint(), 200);
-    QTest::mouseClick(playlist->itemWidget(playlist->item(0)), Qt::LeftButton, Qt::NoModifier, QPoint(), 500);
+    QTest::mouseMove(playlist->viewport(), playlist->visualRect(playlist->model()->index(0, 0)).center(), 200);
+    QTest::mouseClick(playlist->viewport(), Qt::LeftButton, Qt::NoModifier, playlist->visualRect(playlist->model()->index(0, 0)).center(), 500);
     playItemCloseBtn = playlist->findChild<DFloatingButton *>(PLAYITEN_CLOSE_BUTTON);
     QTest::mouseMove(playItemCloseBtn, QPoint(), 100);
     QTest::mouseClick(playItemCloseBtn, Qt::LeftButton, Qt::NoModifier, QPoint(), 200);
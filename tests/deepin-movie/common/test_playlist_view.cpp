@@ -0,0 +1,124 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QTest>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <gtest/gtest.h>
+
+#define private public
+#include "application.h"
+#include "player_engine.h"
+#include "playlist_model.h"
+#include "playlist_view.h"
+
+using namespace dmr;
+
+/**
+ * @brief 追加条目，文件名即序号，nInvalidRow对应的条目标记为文件不存在
+ */
+static void appendItems(PlaylistModel &playlist, int nFrom, int nCount, int nInvalidRow = -1)
+{
+    QList<PlayItemInfo> batch;
+    for (int i = nFrom; i < nFrom + nCount; i++) {
+        PlayItemInfo pif;
+        pif.valid = i != nInvalidRow;
+        pif.loaded = true;
+        pif.url = QUrl::fromLocalFile(QString("/tmp/playlist_view/%1.mp4").arg(i));
+        pif.mi.valid = true;
+        pif.mi.title = pif.url.fileName();
+        pif.mi.duration = 60 * i;
+        batch.append(pif);
+    }
+    playlist.handleAsyncAppendResults(batch);
+}
+
+TEST(PlaylistItemModel, appendRemoveClear)
+{
+    MainWindow *w = dApp->getMainWindow();
+    PlaylistModel playlist(w->engine());
+    //播放列表文件指向临时目录，避免改写用户的播放列表
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    playlist._playlistFile = dir.filePath("playlist");
+    playlist._journalFile = playlist._playlistFile + ".journal";
+
+    qRegisterMetaType<QVector<int>>("QVector<int>");
+    PlaylistItemModel model(&playlist, nullptr);
+    QSignalSpy insertSpy(&model, &QAbstractItemModel::rowsInserted);
+    QSignalSpy removeSpy(&model, &QAbstractItemModel::rowsRemoved);
+    QSignalSpy changeSpy(&model, &QAbstractItemModel::dataChanged);
+    QSignalSpy resetSpy(&model, &QAbstractItemModel::modelReset);
+
+    //每批追加只插入新增的行
+    appendItems(playlist, 0, 5, 4);
+    appendItems(playlist, 5, 2);
+    ASSERT_EQ(model.rowCount(), 7);
+    ASSERT_EQ(insertSpy.count(), 2);
+    EXPECT_EQ(insertSpy[0][1].toInt(), 0);
+    EXPECT_EQ(insertSpy[0][2].toInt(), 4);
+    EXPECT_EQ(insertSpy[1][1].toInt(), 5);
+    EXPECT_EQ(insertSpy[1][2].toInt(), 6);
+    EXPECT_EQ(resetSpy.count(), 0);
+
+    //各角色的值
+    EXPECT_EQ(model.index(0).data(Qt::DisplayRole).toString(), QString("0.mp4"));
+    EXPECT_EQ(model.index(6).data(Qt::ToolTipRole).toString(), QString("6.mp4"));
+    EXPECT_EQ(model.index(2).data(PlaylistItemModel::DurationRole).toString(), playlist.items()[2].mi.durationStr());
+    EXPECT_TRUE(model.index(2).data(PlaylistItemModel::ValidRole).toBool());
+    EXPECT_FALSE(model.index(4).data(PlaylistItemModel::ValidRole).toBool());
+    EXPECT_FALSE(model.index(4).data(PlaylistItemModel::DurationRole).toString().isEmpty());
+    EXPECT_FALSE(model.index(7).data(Qt::DisplayRole).isValid());
+
+    //选中、悬停和当前项变化时只刷新新旧两行
+    changeSpy.clear();
+    model.setSelectedRow(5);
+    model.setHoveredRow(2);
+    playlist._current = 3;
+    emit playlist.currentChanged();
+    EXPECT_EQ(changeSpy.count(), 3);
+    model.setHoveredRow(2);
+    EXPECT_EQ(changeSpy.count(), 3);
+    EXPECT_TRUE(model.index(5).data(PlaylistItemModel::SelectedRole).toBool());
+    EXPECT_TRUE(model.index(2).data(PlaylistItemModel::HoveredRole).toBool());
+    EXPECT_TRUE(model.index(3).data(PlaylistItemModel::PlayingRole).toBool());
+    EXPECT_FALSE(model.index(4).data(PlaylistItemModel::PlayingRole).toBool());
+
+    //删除前面的行，选中、悬停和当前项跟着前移，后面各行刷新序号
+    changeSpy.clear();
+    playlist.remove(1);
+    ASSERT_EQ(removeSpy.count(), 1);
+    EXPECT_EQ(removeSpy[0][1].toInt(), 1);
+    EXPECT_EQ(removeSpy[0][2].toInt(), 1);
+    EXPECT_EQ(model.rowCount(), 6);
+    EXPECT_EQ(model.selectedRow(), 4);
+    EXPECT_EQ(model.hoveredRow(), 1);
+    EXPECT_TRUE(model.index(2).data(PlaylistItemModel::PlayingRole).toBool());
+    EXPECT_EQ(model.index(1).data(Qt::DisplayRole).toString(), QString("2.mp4"));
+    ASSERT_GE(changeSpy.count(), 1);
+    EXPECT_EQ(changeSpy[0][0].value<QModelIndex>().row(), 1);
+    EXPECT_EQ(changeSpy[0][1].value<QModelIndex>().row(), 5);
+
+    //删除悬停的行，悬停清空
+    playlist.remove(1);
+    EXPECT_EQ(removeSpy.count(), 2);
+    EXPECT_EQ(model.rowCount(), 5);
+    EXPECT_EQ(model.hoveredRow(), -1);
+    EXPECT_EQ(model.selectedRow(), 3);
+    EXPECT_TRUE(model.index(1).data(PlaylistItemModel::PlayingRole).toBool());
+    EXPECT_EQ(model.index(1).data(Qt::DisplayRole).toString(), QString("3.mp4"));
+    EXPECT_EQ(resetSpy.count(), 0);
+
+    //清空播放列表时整体重建
+    playlist.clear();
+    EXPECT_EQ(resetSpy.count(), 1);
+    EXPECT_EQ(model.rowCount(), 0);
+    EXPECT_EQ(model.selectedRow(), -1);
+    EXPECT_EQ(model.hoveredRow(), -1);
+    EXPECT_FALSE(model.index(0).data(Qt::DisplayRole).isValid());
+
+    playlist.clearPlaylist();
+}
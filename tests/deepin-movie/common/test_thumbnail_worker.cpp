@@ -0,0 +1,146 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QTest>
+#include <QSignalSpy>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QDebug>
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+#include "application.h"
+#define private public
+#include "thumbnail_worker.h"
+#include "thumbnail_sprite_cache.h"
+#include "compositing_manager.h"
+
+using namespace dmr;
+
+/**
+ * @brief hoverLatency 模拟鼠标在进度条上移动，统计从请求到缩略图可用的耗时
+ */
+static QList<qint64> hoverLatency(const QUrl &url, const QList<int> &positions)
+{
+    ThumbnailWorker &worker = ThumbnailWorker::get();
+    QList<qint64> listCost;
+
+    for (int nSecs : positions) {
+        QSignalSpy spy(&worker, &ThumbnailWorker::thumbGenerated);
+        QElapsedTimer timer;
+        timer.start();
+        worker.requestThumb(url, nSecs);
+        while (worker.getThumb(url, nSecs).isNull() && timer.elapsed() < 5000) {
+            spy.wait(50);
+        }
+        listCost.append(timer.elapsed());
+    }
+
+    std::sort(listCost.begin(), listCost.end());
+    return listCost;
+}
+
+TEST(ThumbnailWorker, hoverToPreviewLatency)
+{
+    if (!CompositingManager::isMpvExists())
+        return;
+
+    QUrl url = QUrl::fromLocalFile("/data/source/deepin-movie-reborn/movie/demo.mp4");
+    if (!QFileInfo::exists(url.toLocalFile()))
+        return;
+
+    //先于hoverToPreview运行，首轮不命中缓存
+    QList<int> positions;
+    for (int i = 0; i < 30; i++) {
+        positions.append(i * 7 % 60);
+    }
+
+    QList<qint64> listCold = hoverLatency(url, positions);
+    QList<qint64> listWarm = hoverLatency(url, positions);
+
+    qInfo() << "decoders:" << ThumbnailWorker::get().decoderCount()
+            << "cold median(ms):" << listCold.at(listCold.size() / 2) << "max(ms):" << listCold.last()
+            << "warm median(ms):" << listWarm.at(listWarm.size() / 2) << "max(ms):" << listWarm.last();
+
+    EXPECT_LE(listWarm.at(listWarm.size() / 2), listCold.at(listCold.size() / 2));
+}
+
+TEST(ThumbnailWorker, hoverToPreview)
+{
+    if (!CompositingManager::isMpvExists())
+        return;
+
+    QUrl url = QUrl::fromLocalFile("/data/source/deepin-movie-reborn/movie/demo.mp4");
+    ThumbnailWorker &worker = ThumbnailWorker::get();
+    if (!QFileInfo::exists(url.toLocalFile()) || worker.decoderCount() == 0)
+        return;
+
+    //连续移动时旧位置的请求会被取消，最后一个位置一定会生成
+    QSignalSpy spy(&worker, &ThumbnailWorker::thumbGenerated);
+    int nLast = 0;
+    for (int i = 0; i < 30; i++) {
+        nLast = i * 7 % 60;
+        worker.requestThumb(url, nLast);
+    }
+    QElapsedTimer timer;
+    timer.start();
+    while (!worker.isThumbGenerated(url, nLast) && timer.elapsed() < 10000) {
+        spy.wait(50);
+    }
+    ASSERT_TRUE(worker.isThumbGenerated(url, nLast));
+    EXPECT_FALSE(worker.getThumb(url, nLast).isNull());
+
+    //同一时间段内的位置共用缓存，已生成的请求立即通知
+    const int nSameBucket = ThumbnailWorker::bucketOf(nLast) + 1;
+    EXPECT_TRUE(worker.isThumbGenerated(url, nSameBucket));
+    spy.clear();
+    worker.requestThumb(url, nSameBucket);
+    ASSERT_EQ(spy.count(), 1);
+    EXPECT_EQ(spy.first().at(0).toUrl(), url);
+    EXPECT_EQ(spy.first().at(1).toInt(), nSameBucket);
+}
+
+TEST(ThumbnailWorker, bucket)
+{
+    EXPECT_EQ(ThumbnailWorker::bucketOf(0), ThumbnailWorker::bucketOf(1));
+    EXPECT_NE(ThumbnailWorker::bucketOf(1), ThumbnailWorker::bucketOf(2));
+}
+
+TEST(ThumbnailWorker, spriteLookup)
+{
+    QUrl url = QUrl::fromLocalFile("/data/source/deepin-movie-reborn/movie/demo.mp4");
+    if (!QFileInfo::exists(url.toLocalFile()))
+        return;
+
+    //图集写入临时目录，不影响用户的缓存
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    ThumbnailSpriteCache &cache = ThumbnailSpriteCache::get();
+    const QString sOldDir = cache.cacheDir();
+    cache.setCacheDir(dir.path());
+
+    QSignalSpy spy(&cache, &ThumbnailSpriteCache::spriteReady);
+    QImage img;
+    EXPECT_FALSE(cache.lookup(url, 0, img));
+    cache.prepare({url}, ThumbnailWorker::thumbSize());
+    EXPECT_TRUE(spy.wait(30000));
+    QTest::qWait(10);
+
+    EXPECT_EQ(QDir(dir.path()).entryList(QStringList() << "*.sprite", QDir::Files).size(), 1);
+    EXPECT_TRUE(cache.lookup(url, 0, img));
+    EXPECT_FALSE(img.isNull());
+    EXPECT_TRUE(cache.lookup(url, ThumbnailSpriteCache::interval(), img));
+    EXPECT_FALSE(img.isNull());
+
+    //已有图集的文件不再加入队列
+    cache.prepare({url, url}, ThumbnailWorker::thumbSize());
+    {
+        QMutexLocker lock(&cache.m_mutex);
+        EXPECT_TRUE(cache.m_listQueue.isEmpty());
+    }
+
+    cache.setCacheDir(sOldDir);
+}
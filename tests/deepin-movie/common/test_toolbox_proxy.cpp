@@ -14,12 +14,15 @@
 #include <QtTest>
 #include <QTest>
 #include <QTestEventList>
+#include <QTemporaryDir>
 #include <DSlider>
 #include <DListWidget>
 #include <QMenu>
 #include "presenter.h"
 #include "titlebar.h"
 #include "src/widgets/tip.h"
+#include "src/libdmr/film_strip.h"
+#include "src/widgets/progress_refresher.h"
 
 using namespace dmr;
 /*TEST(ToolBox, buttonBoxButton)
@@ -87,3 +90,83 @@ TEST(ToolBox, animationLabel)
     QApplication::sendEvent(aLabel, &moveEvent);
     QApplication::sendEvent(aLabel, &releaseEvent);
 }
+
+TEST(ToolBox, filmStrip)
+{
+    const QSize sliceSize(40, 50);
+    EXPECT_TRUE(FilmStrip::get().generate(QFileInfo("/not/exist.mp4"), 10, sliceSize).isNull());
+
+    QFileInfo fi("/data/source/deepin-movie-reborn/movie/demo.mp4");
+    if (!fi.exists())
+        return;
+
+    //胶片条写入临时目录，不影响用户的缓存
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString sOldDir = FilmStrip::get().cacheDir();
+    FilmStrip::get().setCacheDir(dir.path());
+
+    //第一次解码生成，第二次读取缓存
+    QElapsedTimer timer;
+    timer.start();
+    QImage strip = FilmStrip::get().generate(fi, 24, sliceSize);
+    qInfo() << "film strip decode(ms):" << timer.elapsed();
+    ASSERT_FALSE(strip.isNull());
+    EXPECT_EQ(strip.size(), QSize(sliceSize.width() * 24, sliceSize.height()));
+
+    timer.restart();
+    QImage cached = FilmStrip::get().generate(fi, 24, sliceSize);
+    qInfo() << "film strip cached(ms):" << timer.elapsed();
+    EXPECT_EQ(cached, strip);
+
+    //命中缓存时刷新修改时间，淘汰时按最近使用排序
+    QFileInfoList listCache = QDir(dir.path()).entryInfoList(QDir::Files);
+    ASSERT_EQ(listCache.size(), 1);
+    const QString sCache = listCache.first().absoluteFilePath();
+    {
+        QFile file(sCache);
+        ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+        file.setFileTime(QDateTime::currentDateTime().addDays(-1), QFileDevice::FileModificationTime);
+    }
+    FilmStrip::get().generate(fi, 24, sliceSize);
+    EXPECT_GT(QFileInfo(sCache).lastModified(), QDateTime::currentDateTime().addSecs(-60));
+
+    FilmStrip::get().setCacheDir(sOldDir);
+}
+
+TEST(ToolBox, progressRefresher)
+{
+    //每帧的进度通知合并为一次刷新，数值不变或控件隐藏时不刷新
+    MainWindow* w = dApp->getMainWindow();
+    QWidget *pOwner = new QWidget(w);
+    ProgressRefresher *pRefresher = new ProgressRefresher(pOwner, w->engine());
+    QSignalSpy timeSpy(pRefresher, &ProgressRefresher::timeChanged);
+    QSignalSpy progressSpy(pRefresher, &ProgressRefresher::progressChanged);
+
+    w->show();
+    pOwner->show();
+    timeSpy.clear();
+    progressSpy.clear();
+    pRefresher->invalidate();
+    for (int i = 0; i < 100; i++) {
+        emit w->engine()->elapsedChanged();
+    }
+    QTest::qWait(400);
+    EXPECT_EQ(timeSpy.count(), 1);
+    EXPECT_EQ(progressSpy.count(), 1);
+
+    for (int i = 0; i < 100; i++) {
+        emit w->engine()->elapsedChanged();
+    }
+    QTest::qWait(400);
+    EXPECT_EQ(timeSpy.count(), 1);
+    EXPECT_EQ(progressSpy.count(), 1);
+
+    pOwner->hide();
+    pRefresher->invalidate();
+    emit w->engine()->elapsedChanged();
+    QTest::qWait(400);
+    EXPECT_EQ(timeSpy.count(), 1);
+
+    pOwner->deleteLater();
+}
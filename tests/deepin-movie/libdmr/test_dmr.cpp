@@ -8,12 +8,16 @@
 #include <QTestEventList>
 #include <QDebug>
 #include <QTimer>
+#include <QTemporaryDir>
 #include <QAbstractButton>
 #include <DSettingsDialog>
 #include <dwidgetstype.h>
 #include <QWidget>
 
 #include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <vector>
 #include <gtest/gtest.h>
 
 #include "application.h"
@@ -21,6 +25,10 @@
 #include "player_engine.h"
 #include "compositing_manager.h"
 #include "movie_configuration.h"
+#include "gstutils.h"
+#include "hwdec_probe.h"
+#include "runtime_registry.h"
+#include "startup_scheduler.h"
 
 TEST(libdmr, libdmrTest)
 {
@@ -101,3 +109,175 @@ TEST(libdmr, movieConfiguration)
                 ConfigKnownKey::ExternalSubs, QString());
 }
 
+TEST(libdmr, movieConfigurationWriteBehind)
+{
+    //连续写入合并后提交，读取结果包含尚未提交的写入
+    auto &mc = MovieConfiguration::get();
+    const QUrl url("write-behind-movie");
+    mc.removeUrl(url);
+    for (int i = 0; i < 10; i++) {
+        mc.updateUrl(url, ConfigKnownKey::StartPos, i);
+    }
+    mc.updateUrl(url, ConfigKnownKey::SubId, 2);
+    EXPECT_EQ(mc.getByUrl(url, ConfigKnownKey::StartPos).toInt(), 9);
+    EXPECT_EQ(mc.queryByUrl(url).size(), 2);
+    EXPECT_TRUE(mc.urlExists(url));
+
+    mc.removeUrl(url);
+    EXPECT_FALSE(mc.urlExists(url));
+    EXPECT_TRUE(mc.queryByUrl(url).isEmpty());
+}
+
+TEST(libdmr, gstDiscovery)
+{
+    //同一文件的多次提交共用一次探测，失败时也会返回结果
+    QList<QUrl> listUrl;
+    for (int i = 0; i < 8; i++) {
+        listUrl << QUrl::fromLocalFile(QString("/tmp/gst_discovery/%1.mp4").arg(i % 4));
+    }
+    QList<QFuture<dmr::MediaProbeResultPtr>> listFuture = dmr::GstUtils::get()->discover(listUrl);
+    ASSERT_EQ(listFuture.size(), listUrl.size());
+    for (QFuture<dmr::MediaProbeResultPtr> &future : listFuture) {
+        future.waitForFinished();
+        ASSERT_FALSE(future.result().isNull());
+        EXPECT_FALSE(future.result()->opened);
+    }
+
+    dmr::MovieInfo mi = dmr::GstUtils::get()->parseFileByGst(QFileInfo("/tmp/gst_discovery/0.mp4"));
+    EXPECT_EQ(mi.title, QString("0.mp4"));
+
+    //存在的文件无论分到哪个探测线程，都拿到同一份结果
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    QFile file(dir.filePath("broken.mp4"));
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(4096, 'x'));
+    file.close();
+    const QUrl url = QUrl::fromLocalFile(file.fileName());
+    QFuture<dmr::MediaProbeResultPtr> first = dmr::GstUtils::get()->discover(url);
+    QFuture<dmr::MediaProbeResultPtr> second = dmr::GstUtils::get()->discover(url);
+    ASSERT_FALSE(first.result().isNull());
+    EXPECT_EQ(first.result().data(), second.result().data());
+}
+
+TEST(libdmr, hwdecCapabilities)
+{
+    //能力表写入临时目录，不改写用户的缓存
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString sOldFile = dmr::HwdecProbe::get().capabilityFile();
+    dmr::HwdecProbe::get().setCapabilityFile(dir.filePath("hwdec_capabilities.ini"));
+
+    //能力表记录的结果可直接查询，无法打开的文件不进行硬解探测
+    QVariant value;
+    dmr::HwdecProbe::get().storeCapability("test-caps", QVariantList() << 1 << 1920 << 1080);
+    ASSERT_TRUE(dmr::HwdecProbe::get().lookupCapability("test-caps", value));
+    EXPECT_EQ(value.toList().size(), 3);
+    EXPECT_EQ(value.toList()[1].toInt(), 1920);
+    EXPECT_FALSE(dmr::HwdecProbe::get().lookupCapability("test-caps-missing", value));
+
+    QList<QString> hwList;
+    EXPECT_FALSE(dmr::HwdecProbe::get().isFileCanHwdec(QUrl::fromLocalFile("/tmp/hwdec_caps/none.mp4"), hwList));
+    EXPECT_TRUE(hwList.isEmpty());
+
+    //重新读取缓存文件后结果仍在
+    dmr::HwdecProbe::get().setCapabilityFile(dir.filePath("hwdec_capabilities.ini"));
+    EXPECT_TRUE(dmr::HwdecProbe::get().lookupCapability("test-caps", value));
+    EXPECT_TRUE(QFile::exists(dir.filePath("hwdec_capabilities.ini")));
+
+    dmr::HwdecProbe::get().setCapabilityFile(sOldFile);
+}
+
+TEST(libdmr, runtimeRegistry)
+{
+    //与逐次扫描库目录的结果一致，重复查询不再访问文件系统
+    const QStringList listLib = QStringList() << "libmpv.so." << "libavcodec.so" << "libavformat.so"
+                                << "libffmpegthumbnailer.so" << "libgstreamer-1.0.so";
+    const QString sLibDir = QLibraryInfo::location(QLibraryInfo::LibrariesPath);
+    const int nRounds = 50;
+
+    QElapsedTimer timer;
+    timer.start();
+    QStringList listScanned;
+    for (int i = 0; i < nRounds; i++) {
+        listScanned.clear();
+        for (const QString &sLib : listLib) {
+            QStringList list = QDir(sLibDir).entryList(QStringList() << (sLib + "*"), QDir::NoDotAndDotDot | QDir::Files);
+            list.sort();
+            listScanned << (list.contains(sLib) ? sLibDir + QDir::separator() + sLib
+                            : (list.isEmpty() ? QString() : sLibDir + QDir::separator() + list.last()));
+        }
+    }
+    const qint64 nScanNs = timer.nsecsElapsed();
+
+    const qint64 nWarmUp = dmr::RuntimeRegistry::get().warmUp();
+    timer.restart();
+    QStringList listCached;
+    for (int i = 0; i < nRounds; i++) {
+        listCached.clear();
+        for (const QString &sLib : listLib) {
+            listCached << dmr::RuntimeRegistry::get().libPath(sLib);
+        }
+        dmr::CompositingManager::isMpvExists();
+    }
+    const qint64 nCachedNs = timer.nsecsElapsed();
+    qInfo() << "registry warm up(ms):" << nWarmUp << "scan(ns):" << nScanNs << "cached(ns):" << nCachedNs;
+
+    EXPECT_EQ(listCached, listScanned);
+    EXPECT_LT(nCachedNs, nScanNs);
+    EXPECT_EQ(dmr::RuntimeRegistry::get().resolve("libdmr-not-exists.so", "none"), nullptr);
+    EXPECT_EQ(&dmr::RuntimeRegistry::get().library("libavcodec.so"), &dmr::RuntimeRegistry::get().library("libavcodec.so"));
+
+    //库在交出前已加载，多个线程同时解析函数得到同一个地址
+    if (dmr::RuntimeRegistry::get().hasLibrary("libavcodec.so")) {
+        QLibrary &library = dmr::RuntimeRegistry::get().library("libavcodec.so");
+        EXPECT_TRUE(library.isLoaded());
+        const QFunctionPointer pExpect = dmr::RuntimeRegistry::get().resolve("libavcodec.so", "avcodec_find_decoder");
+        std::atomic<int> nMismatch(0);
+        std::vector<std::thread> workers;
+        for (int i = 0; i < 8; i++) {
+            workers.emplace_back([&library, &nMismatch, pExpect]() {
+                for (int j = 0; j < 100; j++) {
+                    if (library.resolve("avcodec_find_decoder") != pExpect)
+                        nMismatch++;
+                }
+            });
+        }
+        for (std::thread &worker : workers) {
+            worker.join();
+        }
+        EXPECT_EQ(nMismatch, 0);
+    }
+}
+
+TEST(libdmr, startupScheduler)
+{
+    //并发任务完成后记入启动记录，探测结果按驱动指纹缓存
+    dmr::StartupScheduler::get().run("test-phase", [] {}).waitForFinished();
+    bool bFound = false;
+    for (const auto &item : dmr::StartupScheduler::get().trace()) {
+        if (item.first == "test-phase")
+            bFound = true;
+    }
+    EXPECT_TRUE(bFound);
+
+    //探测结果写入临时文件，不影响用户的缓存
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString sOldFile = dmr::StartupScheduler::get().probeFile();
+    dmr::StartupScheduler::get().setProbeFile(dir.filePath("startup_probes.ini"));
+
+    QVariant value;
+    dmr::StartupScheduler::get().storeProbe("test-probe", true);
+    EXPECT_TRUE(dmr::StartupScheduler::get().lookupProbe("test-probe", value));
+    EXPECT_TRUE(value.toBool());
+    EXPECT_FALSE(dmr::StartupScheduler::get().lookupProbe("test-probe-missing", value));
+    EXPECT_EQ(dmr::StartupScheduler::driverFingerprint(), dmr::StartupScheduler::driverFingerprint());
+
+    //重新读取文件也能取到
+    dmr::StartupScheduler::get().setProbeFile(dir.filePath("startup_probes.ini"));
+    EXPECT_TRUE(dmr::StartupScheduler::get().lookupProbe("test-probe", value));
+    EXPECT_TRUE(QFileInfo::exists(dir.filePath("startup_probes.ini")));
+
+    dmr::StartupScheduler::get().setProbeFile(sOldFile);
+}
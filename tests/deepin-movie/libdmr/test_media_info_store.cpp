@@ -0,0 +1,205 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QTest>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QtSql>
+
+#include <gtest/gtest.h>
+
+#include "application.h"
+#define private public
+#include "media_info_store.h"
+
+using namespace dmr;
+
+/**
+ * @brief 测试期间数据库和旧版本缓存目录指向临时目录，析构时恢复
+ */
+class TempStore
+{
+public:
+    TempStore()
+        : m_sOldPath(MediaInfoStore::get().dbPath())
+        , m_sOldLegacyDir(MediaInfoStore::get().m_sLegacyDir)
+    {
+        MediaInfoStore::get().m_sLegacyDir = m_dir.filePath("legacy/%1");
+        MediaInfoStore::get().setDbPath(m_dir.filePath("mediainfo.db"));
+    }
+    ~TempStore()
+    {
+        MediaInfoStore::get().setDbPath(m_sOldPath);
+        MediaInfoStore::get().m_sLegacyDir = m_sOldLegacyDir;
+    }
+
+    QString filePath(const QString &sName) const
+    {
+        return m_dir.filePath(sName);
+    }
+
+private:
+    QTemporaryDir m_dir;
+    QString m_sOldPath;
+    QString m_sOldLegacyDir;
+};
+
+static qint64 updatedOf(const QFileInfo &fi)
+{
+    QSqlQuery q(MediaInfoStore::get().database());
+    q.prepare("select updated from media where path = ?");
+    q.addBindValue(fi.absoluteFilePath());
+    if (!q.exec() || !q.next())
+        return -1;
+    return q.value(0).toLongLong();
+}
+
+TEST(MediaInfoStore, roundTrip)
+{
+    TempStore store;
+    QTemporaryDir dir;
+    QFile f(dir.filePath("a.mp4"));
+    f.open(QIODevice::WriteOnly);
+    f.write("0123456789");
+    f.close();
+
+    QFileInfo fi(f.fileName());
+    MovieInfo mi;
+    mi.valid = true;
+    mi.duration = 120;
+    mi.width = 1920;
+    mi.height = 1080;
+    mi.creation = "creation";
+    MediaInfoStore::get().save(fi, mi);
+
+    MovieInfo cached;
+    EXPECT_TRUE(MediaInfoStore::get().lookup(fi, cached));
+    EXPECT_EQ(cached.duration, 120);
+    EXPECT_EQ(cached.width, 1920);
+    EXPECT_EQ(cached.title, fi.fileName());
+
+    //文件变化后缓存失效
+    f.open(QIODevice::Append);
+    f.write("changed");
+    f.close();
+    fi.refresh();
+    EXPECT_FALSE(MediaInfoStore::get().lookup(fi, cached));
+
+    MediaInfoStore::get().remove(fi);
+}
+
+TEST(MediaInfoStore, restoreLargePlaylist)
+{
+    TempStore store;
+    QTemporaryDir dir;
+    QList<QFileInfo> listFile;
+    MovieInfo mi;
+    mi.valid = true;
+    mi.duration = 60;
+
+    for (int i = 0; i < 5000; i++) {
+        QFile f(dir.filePath(QString("%1.mp4").arg(i)));
+        f.open(QIODevice::WriteOnly);
+        f.close();
+        listFile.append(QFileInfo(f.fileName()));
+        MediaInfoStore::get().save(listFile.last(), mi);
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    int nHit = 0;
+    for (const QFileInfo &fi : listFile) {
+        MovieInfo cached;
+        if (MediaInfoStore::get().lookup(fi, cached))
+            nHit++;
+    }
+    qInfo() << "restore 5000 entries(ms):" << timer.elapsed();
+    EXPECT_EQ(nHit, listFile.size());
+
+    for (const QFileInfo &fi : listFile) {
+        MediaInfoStore::get().remove(fi);
+    }
+}
+
+TEST(MediaInfoStore, pruneLeastRecentlyUsed)
+{
+    TempStore store;
+    QFile f(store.filePath("used.mp4"));
+    f.open(QIODevice::WriteOnly);
+    f.close();
+    QFileInfo fi(f.fileName());
+    MovieInfo mi;
+    mi.valid = true;
+    mi.duration = 30;
+    MediaInfoStore::get().save(fi, mi);
+
+    //最早写入的记录被读取后刷新使用时间
+    QSqlDatabase db = MediaInfoStore::get().database();
+    QSqlQuery q(db);
+    ASSERT_TRUE(q.exec("update media set updated = 1"));
+    MovieInfo cached;
+    ASSERT_TRUE(MediaInfoStore::get().lookup(fi, cached));
+    EXPECT_GT(updatedOf(fi), 1);
+
+    //超出上限(20000)时淘汰最久未使用的记录，刚读取过的保留
+    ASSERT_TRUE(db.transaction());
+    QSqlQuery qInsert(db);
+    ASSERT_TRUE(qInsert.prepare("insert into media (path, size, mtime, updated) values (?, 0, 0, 2)"));
+    for (int i = 0; i < 20000; i++) {
+        qInsert.addBindValue(QString("/nonexistent/%1.mp4").arg(i));
+        qInsert.exec();
+    }
+    ASSERT_TRUE(db.commit());
+    MediaInfoStore::get().prune(db);
+
+    ASSERT_TRUE(q.exec("select count(*) from media") && q.next());
+    EXPECT_EQ(q.value(0).toInt(), 20000);
+    EXPECT_TRUE(MediaInfoStore::get().lookup(fi, cached));
+}
+
+TEST(MediaInfoStore, migrateLegacy)
+{
+    TempStore store;
+    QFile f(store.filePath("legacy.mp4"));
+    f.open(QIODevice::WriteOnly);
+    f.write("0123456789");
+    f.close();
+    QFileInfo fi(f.fileName());
+
+    //按旧版本格式写入缓存文件
+    const QString sHash = QCryptographicHash::hash(QUrl::fromLocalFile(fi.absoluteFilePath()).toEncoded(),
+                                                   QCryptographicHash::Sha256).toHex();
+    const QString sInfoDir = store.filePath("legacy/cacheinfo");
+    QDir().mkpath(sInfoDir);
+    QFile legacy(QString("%1/%2").arg(sInfoDir).arg(sHash));
+    ASSERT_TRUE(legacy.open(QIODevice::WriteOnly));
+    {
+        MovieInfo mi;
+        mi.valid = true;
+        mi.fileSize = fi.size();
+        mi.duration = 90;
+        mi.width = 640;
+        mi.height = 480;
+        QDataStream ds(&legacy);
+        ds << mi.valid << mi.title << mi.fileType << mi.resolution << mi.filePath << mi.creation
+           << mi.raw_rotate << mi.fileSize << mi.duration << mi.width << mi.height
+           << mi.vCodecID << mi.vCodeRate << mi.fps << mi.proportion
+           << mi.aCodeID << mi.aCodeRate << mi.aDigit << mi.channels << mi.sampling;
+#ifdef _MOVIE_USE_
+        ds << mi.strFmtName;
+#endif
+    }
+    legacy.close();
+
+    //命中时迁入数据库并删除旧文件
+    MovieInfo cached;
+    ASSERT_TRUE(MediaInfoStore::get().lookup(fi, cached));
+    EXPECT_EQ(cached.duration, 90);
+    EXPECT_EQ(cached.width, 640);
+    EXPECT_FALSE(QFile::exists(legacy.fileName()));
+    EXPECT_GT(updatedOf(fi), 0);
+    EXPECT_TRUE(MediaInfoStore::get().lookup(fi, cached));
+}
@@ -8,12 +8,15 @@
 #include <QTestEventList>
 #include <QDebug>
 #include <QTimer>
+#include <QElapsedTimer>
 #include <QAbstractButton>
 #include <DSettingsDialog>
 #include <dwidgetstype.h>
 #include <QWidget>
 
 #include <unistd.h>
+#include <atomic>
+#include <thread>
 #include <gtest/gtest.h>
 
 #include "application.h"
@@ -21,6 +24,10 @@
 #include "player_engine.h"
 #include "compositing_manager.h"
 #include "movie_configuration.h"
+#define private public
+#include "mpv_event_thread.h"
+#include "dir_scanner.h"
+#include "filefilter.h"
 
 TEST(PlayerEngine, playerEngine)
 {
@@ -35,6 +42,223 @@ TEST(PlayerEngine, playerEngine)
     engine->toggleMute();
 }
 
+TEST(PlayerEngine, hotPathBenchmark)
+{
+    MainWindow *w = dApp->getMainWindow();
+    PlayerEngine *engine =  w->engine();
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 nSum = 0;
+    for (int i = 0; i < 10000; i++) {
+        nSum += engine->duration();
+    }
+    qInfo() << "10000 duration() calls(ms):" << timer.elapsed() << nSum;
+
+    timer.restart();
+    for (int i = 0; i < 10000; i++) {
+        nSum += engine->elapsed();
+    }
+    qInfo() << "10000 elapsed() calls(ms):" << timer.elapsed() << nSum;
+
+    timer.restart();
+    for (int i = 0; i < 1000; i++) {
+        for (const PlayItemInfo &pif : engine->playlist().items()) {
+            nSum += pif.mi.duration;
+        }
+    }
+    qInfo() << "1000 playlist iterations(ms):" << timer.elapsed() << nSum;
+
+    PlayItemInfo pif;
+    EXPECT_TRUE(pif.thumbnail().isNull());
+    QPixmap pm(16, 16);
+    pif.setThumbnail(pm, pm);
+    PlayItemInfo copy = pif;
+    EXPECT_EQ(copy.thumb.data(), pif.thumb.data());
+    EXPECT_FALSE(copy.thumbnailDark().isNull());
+}
+
+TEST(PlayerEngine, mpvEventQueue)
+{
+    //生产者线程入队，当前线程按顺序取出
+    dmr::MpvSpscQueue<int> queue;
+    const int nCount = 100000;
+    std::thread producer([&]() {
+        for (int i = 0; i < nCount; i++) {
+            int nValue = i;
+            queue.push(std::move(nValue));
+        }
+    });
+
+    int nExpect = 0;
+    int nValue = -1;
+    while (nExpect < nCount) {
+        if (!queue.pop(nValue))
+            continue;
+        if (nValue != nExpect)
+            break;
+        nExpect++;
+    }
+    producer.join();
+    EXPECT_EQ(nExpect, nCount);
+    EXPECT_FALSE(queue.pop(nValue));
+}
+
+static std::atomic<int> s_nFakeEvents {0};
+
+/**
+ * @brief 代替mpv_wait_event，先送出s_nFakeEvents个事件，之后没有事件
+ */
+static mpv_event *fakeWaitEvent(mpv_handle *, double dTimeout)
+{
+    static mpv_event event;
+    event = mpv_event();
+    if (s_nFakeEvents.load() > 0) {
+        s_nFakeEvents--;
+        event.event_id = MPV_EVENT_PLAYBACK_RESTART;
+    } else {
+        event.event_id = MPV_EVENT_NONE;
+        QThread::msleep(static_cast<unsigned long>(dTimeout * 1000));
+    }
+    return &event;
+}
+
+TEST(PlayerEngine, mpvEventStatistics)
+{
+    const int nCount = 100;
+    s_nFakeEvents.store(nCount);
+    dmr::MpvPropertyMirror mirror;
+    dmr::MpvEventThread thread(nullptr, fakeWaitEvent, nullptr, &mirror);
+    thread.takeStatistics();
+    thread.start();
+
+    //界面线程取出全部事件并累计处理耗时
+    int nTaken = 0;
+    dmr::MpvEventData event;
+    QElapsedTimer timer;
+    timer.start();
+    while (nTaken < nCount && timer.elapsed() < 5000) {
+        thread.acknowledge();
+        while (thread.takeEvent(event)) {
+            nTaken++;
+        }
+        QThread::msleep(1);
+    }
+    thread.addGuiTime(5 * 1000 * 1000);
+    QThread::msleep(10);
+    thread.stop();
+
+    dmr::MpvEventThread::Statistics stat = thread.takeStatistics();
+    qInfo() << "mpv events/s:" << stat.dEventsPerSec << "gui ms/s:" << stat.dGuiMsPerSec;
+    EXPECT_EQ(nTaken, nCount);
+    EXPECT_GT(stat.dEventsPerSec, 0.0);
+    EXPECT_GT(stat.dGuiMsPerSec, 0.0);
+
+    //读取后计数清零
+    stat = thread.takeStatistics();
+    EXPECT_EQ(stat.dEventsPerSec, 0.0);
+    EXPECT_EQ(stat.dGuiMsPerSec, 0.0);
+}
+
+/**
+ * @brief 等待事件线程把属性写入镜像，镜像值与同步读取一致时返回true
+ */
+static bool waitMirrorMatches(dmr::MpvProxy *pProxy, dmr::MpvPropertyMirror::Property prop, const char *pName)
+{
+    QElapsedTimer timer;
+    timer.start();
+    do {
+        double dMirror = 0.0;
+        const double dSync = pProxy->my_get_property(pProxy->m_handle, pName).toDouble();
+        if (pProxy->m_mirror.getDouble(prop, dMirror) && qFuzzyCompare(dMirror + 1.0, dSync + 1.0))
+            return true;
+        QTest::qWait(10);
+    } while (timer.elapsed() < 3000);
+
+    return false;
+}
+
+TEST(PlayerEngine, mpvPropertyMirror)
+{
+    MainWindow *w = dApp->getMainWindow();
+    dmr::MpvProxy *pProxy = dynamic_cast<dmr::MpvProxy *>(w->engine()->getMpvProxy());
+    if (!pProxy || !pProxy->m_bInited || !pProxy->m_pEventThread)
+        return;
+
+    const QVariant oldVolume = pProxy->my_get_property(pProxy->m_handle, "volume");
+    auto expectVolume = [pProxy]() {
+        //与原来按同步读取toInt()截断后换算的显示音量一致
+        const int nActual = static_cast<int>(pProxy->my_get_property(pProxy->m_handle, "volume").toDouble());
+        const int nDisplay = static_cast<int>((nActual - 40) / 60.0 * 100.0);
+        return nDisplay > 100 ? nActual : nDisplay;
+    };
+
+    //set_property后镜像与同步读取一致，非整数音量截断取整
+    pProxy->my_set_property(pProxy->m_handle, "volume", 87.6);
+    ASSERT_TRUE(waitMirrorMatches(pProxy, dmr::MpvPropertyMirror::Volume, "volume"));
+    EXPECT_EQ(pProxy->volume(), expectVolume());
+
+    //command修改后同样一致
+    pProxy->my_command(pProxy->m_handle, QList<QVariant> {"add", "volume", -10.3});
+    ASSERT_TRUE(waitMirrorMatches(pProxy, dmr::MpvPropertyMirror::Volume, "volume"));
+    EXPECT_EQ(pProxy->volume(), expectVolume());
+
+    pProxy->my_command(pProxy->m_handle, QList<QVariant> {"set", "sub-delay", "0.25"});
+    EXPECT_TRUE(waitMirrorMatches(pProxy, dmr::MpvPropertyMirror::SubDelay, "sub-delay"));
+
+    pProxy->my_set_property(pProxy->m_handle, "volume", oldVolume);
+    pProxy->my_set_property(pProxy->m_handle, "sub-delay", 0.0);
+}
+
+TEST(PlayerEngine, dirScanner)
+{
+    //多层文件夹、隐藏文件、指向上层的软链接
+    QTemporaryDir tmpDir;
+    ASSERT_TRUE(tmpDir.isValid());
+    QDir root(tmpDir.path());
+    root.mkpath("a/b/c");
+    root.mkpath("d");
+    const QStringList listFile {"1.mp4", "a/2.mkv", "a/b/3.mp3", "a/b/c/4.mp4", "d/5.txt", "d/.6.mp4"};
+    for (const QString &sFile : listFile) {
+        QFile file(root.filePath(sFile));
+        file.open(QIODevice::WriteOnly);
+    }
+    QFile::link(root.path(), root.filePath("a/b/c/loop"));
+
+    QAtomicInt stop(0);
+    //每个文件夹一批，按先序遍历的顺序交出，与各线程扫描快慢无关
+    QList<QUrl> listExpect;
+    for (const QString &sFile : QStringList {"1.mp4", "a/2.mkv", "a/b/3.mp3", "a/b/c/4.mp4"}) {
+        listExpect << QUrl::fromLocalFile(QFileInfo(root.filePath(sFile)).absoluteFilePath());
+    }
+    for (int i = 0; i < 5; i++) {
+        QList<QUrl> listBatched;
+        int nBatch = 0;
+        dmr::DirScanner scanner([](const QString & sFile) {
+            return !sFile.endsWith(".txt");
+        }, &stop);
+        QList<QUrl> listUrl = scanner.scan(QStringList() << root.path(), [&](const QList<QUrl> &listBatch) {
+            listBatched << listBatch;
+            nBatch++;
+        });
+        EXPECT_EQ(listUrl, listExpect);
+        EXPECT_EQ(listBatched, listExpect);
+        EXPECT_EQ(nBatch, 4);
+    }
+
+    dmr::DirScanner stopped(nullptr, &stop);
+    stop.store(1);
+    EXPECT_TRUE(stopped.scan(QStringList() << root.path()).isEmpty());
+
+    //后缀不明的文件按文件头判断
+    QFile file(root.filePath("d/noext"));
+    file.open(QIODevice::WriteOnly);
+    file.write(QByteArray::fromHex("1a45dfa3") + QByteArray(60, 0));
+    file.close();
+    EXPECT_TRUE(FileFilter::instance()->isMediaCandidate(file.fileName()));
+    EXPECT_FALSE(FileFilter::instance()->isMediaCandidate(root.filePath("d/5.txt")));
+}
+
 TEST(PlayerEngine, movieInfo)
 {
 #ifdef _LIBDMR_
@@ -0,0 +1,190 @@
+// SPDX-FileCopyrightText: 2023 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include <QtTest>
+#include <QTest>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QSignalSpy>
+#include <QTemporaryDir>
+
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#define private public
+#include "application.h"
+#include "player_engine.h"
+#include "playlist_model.h"
+
+using namespace dmr;
+
+/**
+ * @brief 播放列表和日志文件指向临时目录，避免改写用户的播放列表
+ */
+static void useTempPlaylist(PlaylistModel &model, const QTemporaryDir &dir)
+{
+    model._playlistFile = dir.filePath("playlist");
+    model._journalFile = model._playlistFile + ".journal";
+}
+
+TEST(PlaylistModel, append10kUrls)
+{
+    MainWindow *w = dApp->getMainWindow();
+    PlaylistModel model(w->engine());
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    useTempPlaylist(model, dir);
+    QSignalSpy spy(&model, &PlaylistModel::itemsAppended);
+
+    QList<PlayItemInfo> batch;
+    int nBatch = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < 10000; i++) {
+        PlayItemInfo pif;
+        pif.valid = true;
+        pif.loaded = true;
+        pif.url = QUrl::fromLocalFile(QString("/tmp/playlist_bench/%1.mp4").arg(i));
+        pif.mi.valid = true;
+        pif.mi.title = pif.url.fileName();
+        batch.append(pif);
+
+        if (batch.size() == APPEND_BATCH_COUNT || i == 9999) {
+            model.handleAsyncAppendResults(batch);
+            batch.clear();
+            nBatch++;
+        }
+    }
+    qInfo() << "append 10000 urls in" << nBatch << "batches(ms):" << timer.elapsed();
+    EXPECT_EQ(model.count(), 10000);
+    EXPECT_EQ(spy.count(), nBatch);
+
+    timer.restart();
+    model.savePlaylist();
+    qInfo() << "save 10000 urls(ms):" << timer.elapsed();
+    EXPECT_EQ(QSettings(model._playlistFile, QSettings::NativeFormat).value("playlist/9999").toUrl(),
+              model.items()[9999].url);
+    EXPECT_FALSE(QFileInfo::exists(model._journalFile));
+
+    model.clearPlaylist();
+}
+
+TEST(PlaylistModel, urlIndex)
+{
+    MainWindow *w = dApp->getMainWindow();
+    PlaylistModel model(w->engine());
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    useTempPlaylist(model, dir);
+
+    QList<PlayItemInfo> batch;
+    for (int i = 0; i < 100000; i++) {
+        PlayItemInfo pif;
+        pif.valid = true;
+        pif.loaded = true;
+        pif.url = QUrl::fromLocalFile(QString("/tmp/playlist_index/%1.mp4").arg(i));
+        pif.mi.valid = true;
+        batch.append(pif);
+    }
+    model.handleAsyncAppendResults(batch);
+    ASSERT_EQ(model.count(), 100000);
+
+    QElapsedTimer timer;
+    timer.start();
+    int nFound = 0;
+    for (int i = 0; i < 100000; i++) {
+        if (model.indexOf(QUrl::fromLocalFile(QString("/tmp/playlist_index/%1.mp4").arg(i))) == i)
+            nFound++;
+    }
+    qInfo() << "look up 100000 urls(ms):" << timer.elapsed();
+    EXPECT_EQ(nFound, 100000);
+    EXPECT_EQ(model.indexOf(QUrl::fromLocalFile("/tmp/playlist_index/./5.mp4")), 5);
+
+    QUrl first = model.items()[0].url;
+    QUrl second = model.items()[1].url;
+    model.switchPosition(0, 1);
+    EXPECT_EQ(model.indexOf(first), 1);
+    EXPECT_EQ(model.indexOf(second), 0);
+
+    model.remove(0);
+    EXPECT_EQ(model.indexOf(second), -1);
+    EXPECT_EQ(model.indexOf(first), 0);
+    EXPECT_EQ(model.indexOf(model.items()[99998].url), 99998);
+
+    model.clearPlaylist();
+}
+
+TEST(PlaylistModel, probePool)
+{
+    MainWindow *w = dApp->getMainWindow();
+    PlaylistModel model(w->engine());
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    useTempPlaylist(model, dir);
+    PlayInfoProbePool pool(&model);
+
+    QList<QUrl> listDelivered;
+    QObject::connect(&pool, &PlayInfoProbePool::resultsReady, [&listDelivered](const QList<PlayItemInfo> &pil) {
+        for (const PlayItemInfo &pif : pil) {
+            listDelivered.append(pif.url);
+        }
+    });
+
+    //优先级不同、并发解析，同一请求内仍按提交顺序送出
+    QList<AppendJob> jobs;
+    QList<int> priorities;
+    QList<QUrl> listExpect;
+    for (int i = 0; i < 50; i++) {
+        QUrl url = QUrl::fromLocalFile(QString("/tmp/probe_pool/%1.mp4").arg(i));
+        jobs.append(qMakePair(url, QFileInfo(url.toLocalFile())));
+        priorities.append(i == 0 ? PlayInfoProbePool::UserPriority : PlayInfoProbePool::SiblingPriority);
+        listExpect.append(url);
+    }
+    pool.submit(jobs, priorities);
+    EXPECT_TRUE(pool.isBusy());
+    QTRY_VERIFY_WITH_TIMEOUT(!pool.isBusy(), 10000);
+    EXPECT_EQ(listDelivered, listExpect);
+
+    //取消后不再送出结果
+    listDelivered.clear();
+    pool.submit(jobs, priorities);
+    pool.cancelAll();
+    EXPECT_FALSE(pool.isBusy());
+    QTest::qWait(200);
+    EXPECT_TRUE(listDelivered.isEmpty());
+
+    //取消时正在解析的文件重新提交后，新任务的结果照常送出
+    pool.submit(jobs, priorities);
+    QTest::qWait(1);
+    pool.cancelAll();
+    pool.submit(jobs, priorities);
+    QTRY_VERIFY_WITH_TIMEOUT(!pool.isBusy(), 10000);
+    EXPECT_EQ(listDelivered, listExpect);
+    EXPECT_TRUE(pool.m_cancelled.isEmpty());
+}
+
+TEST(PlaylistModel, appendFromWorkerThread)
+{
+    QUrl url = QUrl::fromLocalFile("/data/source/deepin-movie-reborn/movie/demo.mp4");
+    if (!QFileInfo::exists(url.toLocalFile()))
+        return;
+
+    MainWindow *w = dApp->getMainWindow();
+    PlaylistModel model(w->engine());
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    useTempPlaylist(model, dir);
+
+    //扫描线程追加的请求转到界面线程处理
+    std::thread worker([&model, url]() {
+        model.appendAsync(QList<QUrl>() << url);
+    });
+    worker.join();
+    QTRY_COMPARE_WITH_TIMEOUT(model.count(), 1, 10000);
+    if (model.m_pProbePool)
+        EXPECT_EQ(model.m_pProbePool->thread(), model.thread());
+
+    model.clearPlaylist();
+}